@@ -29,4 +29,8 @@ glslangValidator.exe -V SSAO/SSAO.frag -o SSAO/SSAO.frag.spv
 glslangValidator.exe -V shadowMapping/directionalShadowMapping.vert -o shadowMapping/directionalShadowMapping.vert.spv
 glslangValidator.exe -V shadowMapping/pointShadowMapping.vert -o shadowMapping/pointShadowMapping.vert.spv
 glslangValidator.exe -V shadowMapping/pointShadowMapping.frag -o shadowMapping/pointShadowMapping.frag.spv
+glslangValidator.exe -V culling/frustumCulling.comp -o culling/frustumCulling.comp.spv
+glslangValidator.exe -V culling/hiZDepth.comp -o culling/hiZDepth.comp.spv
+glslangValidator.exe -V culling/hiZDownsample.comp -o culling/hiZDownsample.comp.spv
+glslangValidator.exe -V depthPrepass/depthPrepass.vert -o depthPrepass/depthPrepass.vert.spv
 pause
\ No newline at end of file
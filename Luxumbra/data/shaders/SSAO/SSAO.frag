@@ -15,6 +15,7 @@ layout(push_constant) uniform PushConstants
 	float kernelRadius;
 	float bias;
 	float strenght;
+	vec2 renderScale;
 };
 
 #define MAX_SSAO_KERNEL_SIZE  32
@@ -33,13 +34,17 @@ void main()
 
 float SSAO()
 {
-	vec3 fragPosition = texture(positionMap, textureCoordinate).rgb;
-	vec3 normal = normalize(texture(normalMap, textureCoordinate).rgb * 2.0 - 1.0);
-
 	ivec2 textureDimension = textureSize(positionMap, 0);
 	ivec2 noiseTextureDimension = textureSize(SSAONoise, 0);
 
-	vec2 noiseUV = vec2(float(textureDimension.x) / float(noiseTextureDimension.x), float(textureDimension.y) / float(noiseTextureDimension.y)) * textureCoordinate;
+	// Only the scaled fraction of the targets was rendered this frame
+	vec2 halfTexel = 0.5 / vec2(textureDimension);
+	vec2 sceneCoordinate = textureCoordinate * renderScale;
+
+	vec3 fragPosition = texture(positionMap, sceneCoordinate).rgb;
+	vec3 normal = normalize(texture(normalMap, sceneCoordinate).rgb * 2.0 - 1.0);
+
+	vec2 noiseUV = vec2(float(textureDimension.x) / float(noiseTextureDimension.x), float(textureDimension.y) / float(noiseTextureDimension.y)) * sceneCoordinate;
 	vec3 randomVec = texture(SSAONoise, noiseUV).xyz *  2.0 - 1.0;
 
 	vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -58,7 +63,7 @@ float SSAO()
 		offset.xyz /= offset.w;
 		offset.xyz = offset.xyz * 0.5 + 0.5;
 
-		float sampleDepth = -texture(positionMap, offset.xy).w;
+		float sampleDepth = -texture(positionMap, clamp(offset.xy * renderScale, halfTexel, renderScale - halfTexel)).w;
 		float rangeCheck = smoothstep(0.0, 1.0, kernelRadius / abs(fragPosition.z - sampleDepth));
 
 		occlusion += (sampleDepth >= samplePosition.z + bias ? 1.0 : 0.0) * rangeCheck;
@@ -21,8 +21,14 @@ layout(push_constant) uniform PushConstants
 	int splitViewMask;
 	float FXAAContrastThreshold;
 	float FXAARelativeThreshold;
+	vec2 renderScale;
 };
 
+// Fraction of the render targets rendered this frame, clamped half a texel in so bilinear taps never read outside
+vec2 sceneCoordinate;
+vec2 sceneCoordinateMin;
+vec2 sceneCoordinateMax;
+
 
 
 #define SPLIT_VIEW_TONE_MAPPING_MASK 1
@@ -42,9 +48,15 @@ float BlurSSAO();
 vec3 FXAA();
 float RGBToLuma(vec3 rgb);
 float Quality(int i);
+vec3 SampleScene(vec2 uv);
+vec3 SampleCatmullRom(vec2 uv);
 
 void main() 
 {
+	sceneCoordinateMin = 0.5 * inverseScreenSize;
+	sceneCoordinateMax = renderScale - 0.5 * inverseScreenSize;
+	sceneCoordinate = clamp(textureCoordinate * renderScale, sceneCoordinateMin, sceneCoordinateMax);
+
 	outColor =  vec4(FXAA(), 1.0);
 
 	if (splitViewMask != 0)
@@ -60,12 +72,12 @@ void main()
 			if ((splitViewMask & SPLIT_VIEW_FXAA_MASK) == SPLIT_VIEW_FXAA_MASK)
 				outColor = vec4(FXAA(), 1.0);
 			else
-				outColor = vec4(ToneMapGammaCorrect(texture(renderTarget, textureCoordinate).rgb), 1.0);
+				outColor = vec4(ToneMapGammaCorrect(SampleScene(sceneCoordinate)), 1.0);
 		}
 		else
 		{
-			vec4 indirect = texture(IndirectColorMap, textureCoordinate);
-			outColor = pow(texture(renderTarget, textureCoordinate) + indirect, vec4(1.0/2.2));
+			vec3 indirect = texture(IndirectColorMap, sceneCoordinate).rgb;
+			outColor = vec4(pow(SampleScene(sceneCoordinate) + indirect, vec3(1.0/2.2)), 1.0);
 		}
 
 		if (textureCoordinate.x < splitViewRatio + 0.001 && textureCoordinate.x > splitViewRatio - 0.001)
@@ -83,7 +95,7 @@ float BlurSSAO()
 		for (int y = -blurRange; y < blurRange; y++) 
 		{
 			vec2 offset = vec2(float(x), float(y)) * texelSize;
-			result += texture(SSAOMap, textureCoordinate + offset).r;
+			result += texture(SSAOMap, clamp(sceneCoordinate + offset, sceneCoordinateMin, sceneCoordinateMax)).r;
 		}
 	}
 
@@ -126,7 +138,7 @@ vec3 ToneMapGammaCorrect(vec3 color)
 	if(splitViewMask != 0)
 		ssao = ((splitViewMask & SPLIT_VIEW_SSAO_MASK) == SPLIT_VIEW_SSAO_MASK) ? ssao : 1.0;
 
-	vec3 indirect = texture(IndirectColorMap, textureCoordinate).rgb * ssao;
+	vec3 indirect = texture(IndirectColorMap, sceneCoordinate).rgb * ssao;
 
 	if ((splitViewMask & SPLIT_VIEW_DIRECT_ONLY_MASK) == SPLIT_VIEW_DIRECT_ONLY_MASK)
 		indirect = vec3(0.0f);
@@ -155,14 +167,14 @@ vec3 ToneMapGammaCorrect(vec3 color)
 
 vec3 FXAA()
 {
-	vec3 colorCenter = ToneMapGammaCorrect(texture(renderTarget, textureCoordinate).rgb);
+	vec3 colorCenter = ToneMapGammaCorrect(SampleScene(sceneCoordinate));
 
 	float lumaCenter = RGBToLuma(colorCenter);
 
-	float lumaDown = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(0, -1)).rgb));
-	float lumaUp = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(0, 1)).rgb));
-	float lumaLeft = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(-1, 0)).rgb));
-	float lumaRight = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(1, 0)).rgb));
+	float lumaDown = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(0, -1)).rgb));
+	float lumaUp = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(0, 1)).rgb));
+	float lumaLeft = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(-1, 0)).rgb));
+	float lumaRight = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(1, 0)).rgb));
 
 	float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
 	float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
@@ -172,10 +184,10 @@ vec3 FXAA()
 	if (deltaLuma < max(FXAAContrastThreshold, lumaMax * FXAARelativeThreshold))
 		return colorCenter;
 
-	float lumaDownLeft = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(-1, -1)).rgb));
-	float lumaUpRight = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(1, 1)).rgb));
-	float lumaDownRight = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(1, -1)).rgb));
-	float lumaUpLeft = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, textureCoordinate, ivec2(-1, 1)).rgb));
+	float lumaDownLeft = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(-1, -1)).rgb));
+	float lumaUpRight = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(1, 1)).rgb));
+	float lumaDownRight = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(1, -1)).rgb));
+	float lumaUpLeft = RGBToLuma(ToneMapGammaCorrect(textureOffset(renderTarget, sceneCoordinate, ivec2(-1, 1)).rgb));
 
 	float lumaDownUp = lumaDown + lumaUp;
 	float lumaLeftRight = lumaLeft + lumaRight;
@@ -214,7 +226,7 @@ vec3 FXAA()
 	else
 		lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
 
-	vec2 currentUV = textureCoordinate;
+	vec2 currentUV = sceneCoordinate;
 
 	if (isHorizontal)
 		currentUV.y += stepLength * 0.5;
@@ -274,8 +286,8 @@ vec3 FXAA()
 		}
 	}
 
-	float distance1 = isHorizontal ? (textureCoordinate.x - uv1.x) : (textureCoordinate.y - uv1.y);
-	float distance2 = isHorizontal ? (uv2.x - textureCoordinate.x) : (uv2.y - textureCoordinate.y);
+	float distance1 = isHorizontal ? (sceneCoordinate.x - uv1.x) : (sceneCoordinate.y - uv1.y);
+	float distance2 = isHorizontal ? (uv2.x - sceneCoordinate.x) : (uv2.y - sceneCoordinate.y);
 
 	bool isDirection1 = distance1 < distance2;
 	float distanceFinal = min(distance1, distance2);
@@ -299,14 +311,61 @@ vec3 FXAA()
 
 	finalOffset = max(finalOffset, subPixelOffsetFinal);
 
-	vec2 finalUV = textureCoordinate;
+	vec2 finalUV = sceneCoordinate;
 
 	if(isHorizontal)
 		finalUV.y += finalOffset * stepLength;
 	else
 		finalUV.x += finalOffset * stepLength;
 
-	return ToneMapGammaCorrect(texture(renderTarget, finalUV).rgb);
+	return ToneMapGammaCorrect(SampleScene(clamp(finalUV, sceneCoordinateMin, sceneCoordinateMax)));
+}
+
+vec3 SampleScene(vec2 uv)
+{
+	// Bilinear is exact when the targets are rendered at full resolution
+	if (renderScale.x == 1.0 && renderScale.y == 1.0)
+		return texture(renderTarget, uv).rgb;
+
+	return SampleCatmullRom(uv);
+}
+
+// Catmull-Rom bicubic upscale folded into 9 bilinear taps
+vec3 SampleCatmullRom(vec2 uv)
+{
+	vec2 samplePosition = uv / inverseScreenSize;
+	vec2 texturePosition1 = floor(samplePosition - 0.5) + 0.5;
+
+	vec2 f = samplePosition - texturePosition1;
+
+	vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+	vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+	vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+	vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+	vec2 w12 = w1 + w2;
+	vec2 offset12 = w2 / w12;
+
+	vec2 texturePosition0 = clamp((texturePosition1 - 1.0) * inverseScreenSize, sceneCoordinateMin, sceneCoordinateMax);
+	vec2 texturePosition3 = clamp((texturePosition1 + 2.0) * inverseScreenSize, sceneCoordinateMin, sceneCoordinateMax);
+	vec2 texturePosition12 = clamp((texturePosition1 + offset12) * inverseScreenSize, sceneCoordinateMin, sceneCoordinateMax);
+
+	vec3 result = vec3(0.0);
+
+	result += texture(renderTarget, vec2(texturePosition0.x, texturePosition0.y)).rgb * w0.x * w0.y;
+	result += texture(renderTarget, vec2(texturePosition12.x, texturePosition0.y)).rgb * w12.x * w0.y;
+	result += texture(renderTarget, vec2(texturePosition3.x, texturePosition0.y)).rgb * w3.x * w0.y;
+
+	result += texture(renderTarget, vec2(texturePosition0.x, texturePosition12.y)).rgb * w0.x * w12.y;
+	result += texture(renderTarget, vec2(texturePosition12.x, texturePosition12.y)).rgb * w12.x * w12.y;
+	result += texture(renderTarget, vec2(texturePosition3.x, texturePosition12.y)).rgb * w3.x * w12.y;
+
+	result += texture(renderTarget, vec2(texturePosition0.x, texturePosition3.y)).rgb * w0.x * w3.y;
+	result += texture(renderTarget, vec2(texturePosition12.x, texturePosition3.y)).rgb * w12.x * w3.y;
+	result += texture(renderTarget, vec2(texturePosition3.x, texturePosition3.y)).rgb * w3.x * w3.y;
+
+	// The negative lobes can ring below zero around bright HDR texels
+	return max(result, vec3(0.0));
 }
 
 
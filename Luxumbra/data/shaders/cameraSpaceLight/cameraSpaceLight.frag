@@ -5,6 +5,10 @@
 #define DIRECTIONAL_LIGHT_MAX_COUNT 4
 #define POINT_LIGHT_MAX_COUNT 64
 
+#define LIGHT_CLUSTER_GRID_X 16
+#define LIGHT_CLUSTER_GRID_Y 9
+#define LIGHT_CLUSTER_GRID_Z 24
+
 layout(location = 0) in FsIn
 {
 	vec3 positionWS;
@@ -30,6 +34,7 @@ struct DirectionalLight
 	float shadowMapTexelSize;
 	float pcfExtent;
 	float pcfKernelSize;
+	int shadowMapIndex;
 };
 
 struct PointLight
@@ -37,6 +42,7 @@ struct PointLight
 	vec3 position;
 	vec3 color;
 	float radius;
+	int shadowMapIndex;
 };
 
 layout(set = 0, binding = 1) uniform DirectionalLightBuffer
@@ -55,13 +61,7 @@ layout(set = 0, binding = 5) uniform samplerCube irradianceMap;
 layout(set = 0, binding = 6) uniform samplerCube prefilteredMap;
 layout(set = 0, binding = 7) uniform sampler2D BRDFLut;
 
-layout(push_constant) uniform PushConsts
-{
-	layout(offset = 64) uint directionalLightCount;
-	layout(offset = 68) uint pointLightCount;
-} pushConsts;
-
-layout(set = 1, binding = 0) uniform Material
+struct MaterialParameters
 {
 	vec3 baseColor;
 	float metallic;
@@ -71,7 +71,35 @@ layout(set = 1, binding = 0) uniform Material
 	float clearCoatPerceptualRoughness;
 	int useTextureMask;
 	int isUnlit;
-} material;
+};
+
+layout(std430, set = 0, binding = 8) readonly buffer MaterialTable
+{
+	MaterialParameters materials[];
+};
+
+// Froxels over the render extent with exponential depth slices, each one lists the point lights overlapping it
+layout(std430, set = 0, binding = 9) readonly buffer LightClusterGrid
+{
+	vec2 clusterTileScale;
+	float clusterDepthScale;
+	float clusterDepthBias;
+	uvec2 clusters[];
+};
+
+layout(std430, set = 0, binding = 10) readonly buffer LightIndexList
+{
+	uint lightIndices[];
+};
+
+layout(push_constant) uniform PushConsts
+{
+	layout(offset = 0) uint directionalLightCount;
+	layout(offset = 4) uint pointLightCount;
+	layout(offset = 8) uint materialIndex;
+} pushConsts;
+
+MaterialParameters material;
 
 layout(set = 1, binding = 1) uniform sampler2D albedo;
 layout(set = 1, binding = 2) uniform sampler2D normalMap;
@@ -113,6 +141,8 @@ float linearDepth(float depth)
 
 void main()
 {
+	material = materials[pushConsts.materialIndex];
+
 	if(texture(albedo, fsIn.textureCoordinateLS).a <= 0.0)
 		discard;
 
@@ -172,9 +202,18 @@ void main()
 		directColor += DirectColor(lightDir, viewDir, normal, roughness, F0, NdotV, diffuseColor, radiance, shadow, clearCoatRoughness);
 	}
 
-	// Point lights
-	for (int i = 0; i < pushConsts.pointLightCount; i++)
+	// Point lights of the fragment's cluster
+	uvec3 cluster;
+	cluster.xy = uvec2(gl_FragCoord.xy * clusterTileScale);
+	cluster.z = uint(max(log(-fsIn.positionVS.z) * clusterDepthScale + clusterDepthBias, 0.0));
+	cluster = min(cluster, uvec3(LIGHT_CLUSTER_GRID_X - 1, LIGHT_CLUSTER_GRID_Y - 1, LIGHT_CLUSTER_GRID_Z - 1));
+
+	uvec2 clusterLights = clusters[(cluster.z * LIGHT_CLUSTER_GRID_Y + cluster.y) * LIGHT_CLUSTER_GRID_X + cluster.x];
+
+	for (uint clusterLight = 0; clusterLight < clusterLights.y; clusterLight++)
 	{
+		int i = int(lightIndices[clusterLights.x + clusterLight]);
+
 		vec3 fragToLight = pointLights[i].position - fsIn.positionWS;
 
 		lightDir = normalize(mat3(fsIn.viewMatrix) * fragToLight);
@@ -292,6 +331,11 @@ vec3 DirectColor(vec3 lightDir, vec3 viewDir, vec3 normal, float roughness, vec3
 
 float DirectionalShadow(vec4 shadowCoord, int lightIndex)
 {
+	int shadowMapIndex = directionalLights[lightIndex].shadowMapIndex;
+
+	if (shadowMapIndex < 0)
+		return 1.0;
+
 	if (abs(shadowCoord.x) > 1.0 || abs(shadowCoord.y) > 1.0 || abs(shadowCoord.z) > 1.0)
 		return 0.0;
 
@@ -308,7 +352,7 @@ float DirectionalShadow(vec4 shadowCoord, int lightIndex)
 		{
 			vec2 pcfUV = shadowUV + vec2(x, y) * shadowMapTexelSize;
 
-			if (shadowCoord.z <= texture(directionalShadowMaps[lightIndex], pcfUV).x)
+			if (shadowCoord.z <= texture(directionalShadowMaps[shadowMapIndex], pcfUV).x)
 				lightedCount += 1.0;
 		}
 	}
@@ -316,9 +360,38 @@ float DirectionalShadow(vec4 shadowCoord, int lightIndex)
 	return lightedCount / directionalLights[lightIndex].pcfKernelSize;
 }
 
+// The cluster lists differ between neighbouring fragments, the shadow map array is only indexed with constants
+// and sampled without derivatives
+#define SAMPLE_POINT_SHADOW_MAP(index) case index: return textureLod(pointLightShadowMaps[index], direction, 0.0).r;
+#define SAMPLE_POINT_SHADOW_MAPS_8(first) \
+	SAMPLE_POINT_SHADOW_MAP(first) SAMPLE_POINT_SHADOW_MAP(first + 1) SAMPLE_POINT_SHADOW_MAP(first + 2) SAMPLE_POINT_SHADOW_MAP(first + 3) \
+	SAMPLE_POINT_SHADOW_MAP(first + 4) SAMPLE_POINT_SHADOW_MAP(first + 5) SAMPLE_POINT_SHADOW_MAP(first + 6) SAMPLE_POINT_SHADOW_MAP(first + 7)
+
+float SamplePointShadowMap(vec3 direction, int shadowMapIndex)
+{
+	switch (shadowMapIndex)
+	{
+		SAMPLE_POINT_SHADOW_MAPS_8(0)
+		SAMPLE_POINT_SHADOW_MAPS_8(8)
+		SAMPLE_POINT_SHADOW_MAPS_8(16)
+		SAMPLE_POINT_SHADOW_MAPS_8(24)
+		SAMPLE_POINT_SHADOW_MAPS_8(32)
+		SAMPLE_POINT_SHADOW_MAPS_8(40)
+		SAMPLE_POINT_SHADOW_MAPS_8(48)
+		SAMPLE_POINT_SHADOW_MAPS_8(56)
+	}
+
+	return 0.0;
+}
+
 float PointShadow(vec3 lightToFrag, float lightDist, int lightIndex)
 {
-	float sampledDist = texture(pointLightShadowMaps[lightIndex], normalize(lightToFrag)).r;
+	int shadowMapIndex = pointLights[lightIndex].shadowMapIndex;
+
+	if (shadowMapIndex < 0)
+		return 1.0;
+
+	float sampledDist = SamplePointShadowMap(normalize(lightToFrag), shadowMapIndex);
 
 	if (lightDist <= sampledDist + 0.15)
 		return 1.0;
@@ -6,6 +6,7 @@ layout(location = 1) in vec2 inTextureCoordinate;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec3 inTangent;
 layout(location = 4) in vec3 inBitangent;
+layout(location = 5) in mat4 inModel;
 
 layout(location = 0) out VsOut
 {
@@ -27,14 +28,12 @@ layout(set = 0, binding = 0) uniform ViewProj
 	vec2 nearFarPlane;
 } vp;
 
-layout(push_constant) uniform Model
-{
-	mat4 model;
-} m;
+// Same position as depthPrepass.vert, bit for bit
+invariant gl_Position;
 
 void main() 
 {
-	vec4 fragPosition = m.model * vec4(inPosition, 1.0);
+	vec4 fragPosition = inModel * vec4(inPosition, 1.0);
     gl_Position = vp.proj * vp.view * fragPosition;
 
 	vsOut.positionWS = fragPosition.xyz;
@@ -43,10 +42,10 @@ void main()
 
 	vsOut.textureCoordinateLS = inTextureCoordinate;
 
-	mat3 normalMatrix = transpose(inverse(mat3(m.model)));
+	mat3 normalMatrix = transpose(inverse(mat3(inModel)));
 	vsOut.normalWS = normalMatrix * inNormal;
 
-	mat3 modelToView = mat3(vp.view) * mat3(m.model);
+	mat3 modelToView = mat3(vp.view) * mat3(inModel);
 
 	vec3 T = normalize(modelToView * inTangent);
 	vec3 B = normalize(modelToView * inBitangent);
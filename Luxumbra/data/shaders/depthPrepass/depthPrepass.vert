@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inModel;
+
+layout(set = 0, binding = 0) uniform ViewProj
+{
+	mat4 view;
+	mat4 proj;
+	vec2 nearFarPlane;
+} vp;
+
+// Must match cameraSpaceLight.vert, the opaque pass tests its depth for equality
+invariant gl_Position;
+
+void main()
+{
+	vec4 fragPosition = inModel * vec4(inPosition, 1.0);
+	gl_Position = vp.proj * vp.view * fragPosition;
+}
@@ -2,6 +2,7 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inModel;
 
 layout(location = 0) out vec4 outPositionLS;
 
@@ -13,12 +14,11 @@ layout(set = 0, binding = 0) uniform LightInfo
 
 layout(push_constant) uniform PushConsts
 {
-	layout(offset = 0)  mat4 model;
-	layout(offset = 64) uint vpIndex;
+	layout(offset = 0) uint vpIndex;
 } pushConsts;
 
 void main()
 {
-	outPositionLS = lightInfo.view[pushConsts.vpIndex] * pushConsts.model * vec4(inPosition, 1.0);
+	outPositionLS = lightInfo.view[pushConsts.vpIndex] * inModel * vec4(inPosition, 1.0);
 	gl_Position = lightInfo.proj * outPositionLS;
 }
\ No newline at end of file
@@ -3,7 +3,7 @@
 
 #include "Luxumbra.h"
 
-#include "glm\glm.hpp"
+#include "glm/glm.hpp"
 
 namespace lux
 {
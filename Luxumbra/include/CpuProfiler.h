@@ -0,0 +1,85 @@
+#ifndef CPU_PROFILER_H_INCLUDED
+#define CPU_PROFILER_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <vector>
+#include <string>
+
+#define CPU_PROFILER_MAX_THREAD_COUNT 32
+#define CPU_PROFILER_EVENT_BUFFER_SIZE 4096
+
+#ifdef ENABLE_CPU_PROFILER
+#define CPU_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_IMPL(a, b)
+#define CPU_PROFILE_SCOPE(name) lux::CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define CPU_PROFILE_FUNCTION() CPU_PROFILE_SCOPE(__FUNCTION__)
+#define CPU_PROFILE_THREAD_NAME(name) lux::CpuProfiler::SetCurrentThreadName(name)
+#define CPU_PROFILE_FRAME() lux::CpuProfiler::BeginFrame()
+#else
+#define CPU_PROFILE_SCOPE(name)
+#define CPU_PROFILE_FUNCTION()
+#define CPU_PROFILE_THREAD_NAME(name)
+#define CPU_PROFILE_FRAME()
+#endif // ENABLE_CPU_PROFILER
+
+namespace lux
+{
+
+	// Times are in nanoseconds since the profiler started, names must be string literals
+	struct CpuProfileEvent
+	{
+		const char* name;
+		int64_t start;
+		int64_t end;
+		uint32_t depth;
+	};
+
+	struct CpuProfileThreadEvents
+	{
+		uint32_t threadIndex;
+		const char* threadName;
+		std::vector<CpuProfileEvent> events;
+	};
+
+	// Every thread writes its own ring buffer without locking, readers drop the events overwritten while they copy
+	class CpuProfiler
+	{
+	public:
+		static void SetCurrentThreadName(const char* name) noexcept;
+		static void BeginFrame() noexcept;
+
+		static int64_t GetTime() noexcept;
+		static uint32_t EnterScope() noexcept;
+		static void LeaveScope(const char* name, int64_t start, uint32_t depth) noexcept;
+
+		// Events that started during the last complete frame
+		static void GetLastFrameEvents(std::vector<CpuProfileThreadEvents>& threads, int64_t& frameStart, int64_t& frameEnd) noexcept;
+		static bool ExportChromeTrace(const std::string& filePath) noexcept;
+
+	private:
+		static void ReadThreadEvents(uint32_t threadIndex, int64_t minStart, int64_t maxStart, std::vector<CpuProfileEvent>& events) noexcept;
+	};
+
+	class CpuProfileScope
+	{
+	public:
+		CpuProfileScope() = delete;
+		CpuProfileScope(const char* name) noexcept;
+		CpuProfileScope(const CpuProfileScope&) = delete;
+		CpuProfileScope(CpuProfileScope&&) = delete;
+
+		~CpuProfileScope() noexcept;
+
+		const CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+		const CpuProfileScope& operator=(CpuProfileScope&&) = delete;
+
+	private:
+		const char* name;
+		int64_t start;
+		uint32_t depth;
+	};
+
+} // namespace lux
+
+#endif // CPU_PROFILER_H_INCLUDED
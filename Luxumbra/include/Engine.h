@@ -3,12 +3,32 @@
 
 #include "Luxumbra.h"
 
+#include <chrono>
+
 #include "Window.h"
-#include "rhi\RHI.h"
-#include "scene\Scene.h"
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+#include "rhi/RHI.h"
+#include "scene/Scene.h"
 #include "resource/ResourceManager.h"
 
 
+#define FRAME_TIME_HISTORY_SIZE 240
+#define JOB_BENCHMARK_FRAME_COUNT 120
+
+// Headless runs use a fixed timestep so every run animates the scene the same way
+#define HEADLESS_DEFAULT_FRAME_COUNT 300
+#define HEADLESS_DELTA_TIME (1.f / 60.f)
+
+// Benchmarks run headless, warm-up frames settle caches and the GPU profiler history before measuring
+#define BENCHMARK_WARMUP_FRAME_COUNT 60
+#define BENCHMARK_DEFAULT_FRAME_COUNT 600
+
+// Frustum culling micro-benchmark, random boxes around a fixed camera, the same seed every run
+#define CULLING_BENCHMARK_SEED 1234u
+#define CULLING_BENCHMARK_WARMUP_ITERATION_COUNT 20
+#define CULLING_BENCHMARK_ITERATION_COUNT 200
+
 namespace lux
 {
 	enum class SCENE : int32_t
@@ -19,9 +39,43 @@ namespace lux
 		PBR_MATERIALS_SCENE,
 		TRANSPARENT_SCENE,
 		DIRECTIONAL_SHADOW_SCENE,
+		STRESS_SCENE,
 		SCENE_COUNT
 	};
 
+	// Averages in milliseconds for one job thread count
+	struct JobBenchmarkResult
+	{
+		float cpuTime;
+		float frameTime;
+	};
+
+	// Milliseconds, nearest rank percentiles
+	struct BenchmarkStatistics
+	{
+		float average;
+		float p50;
+		float p95;
+		float p99;
+		float max;
+	};
+
+	struct BenchmarkPassResult
+	{
+		std::string name;
+		BenchmarkStatistics statistics;
+		size_t sampleCount;
+	};
+
+	struct BenchmarkSceneResult
+	{
+		std::string sceneName;
+		bool isDepthPrepassEnabled;
+		BenchmarkStatistics frameTime;
+		BenchmarkStatistics sceneUpdateTime;
+		std::vector<BenchmarkPassResult> gpuPasses;
+	};
+
 	class Engine
 	{
 	public:
@@ -34,30 +88,67 @@ namespace lux
 		const Engine& operator=(const Engine&) = delete;
 		const Engine& operator=(Engine&&) = delete;
 
-		bool Initialize(uint32_t windowWidth, uint32_t windowHeight) noexcept;
+		bool Initialize(uint32_t windowWidth, uint32_t windowHeight, bool isHeadless = false, bool isMeshArenaDeviceLocal = true) noexcept;
 		void Run() noexcept;
+		void RunHeadless(SCENE sceneIndex, uint32_t frameCount) noexcept;
+		void RunBenchmark(uint32_t frameCount) noexcept;
+
+		// Does not need an initialized engine
+		static void RunCullingBenchmark() noexcept;
 
 		scene::Scene& GetScene(SCENE scene) noexcept;
 		resource::ResourceManager& GetResourceManager() noexcept;
 
 	private:
+		void EndSceneBuild() noexcept;
+		bool RunSceneBenchmark(SCENE sceneIndex, uint32_t frameCount, BenchmarkSceneResult& result) noexcept;
+		bool ExportBenchmark(const std::vector<BenchmarkSceneResult>& results, uint32_t frameCount, const std::string& filePath) const noexcept;
 		void Update(scene::Scene& scene, float deltaTime) noexcept;
 		void DrawImgui(scene::Scene& scene, float deltaTime) noexcept;
 		void DisplayCameraNode(scene::CameraNode* node) noexcept;
 		void DisplayMeshNodes(const std::vector<scene::MeshNode*>& meshes) noexcept;
 		void DisplayLightNodes(const std::vector<scene::LightNode*>& lights) noexcept;
 		void DisplayMaterials(const std::vector<scene::MeshNode*>& meshes) noexcept;
+		void DisplayMemoryUsage() noexcept;
+		void DisplayJobs() noexcept;
+		void DisplayGpuProfiler() noexcept;
+		void DisplayCpuProfiler() noexcept;
+		void UpdateJobBenchmark(float deltaTime) noexcept;
 		void DisplayNode(scene::Node* node) noexcept;
 
 		bool isInitialized;
 
 		Window window;
+		JobSystem jobSystem;
 		rhi::RHI rhi;
 		std::array<scene::Scene, TO_SIZE_T(SCENE::SCENE_COUNT)> scenes;
 		resource::ResourceManager resourceManager;
 
 		int32_t currentScene;
 
+		std::chrono::steady_clock::time_point sceneBuildStartTime;
+
+		// Frame times in milliseconds, used as a ring buffer
+		std::array<float, FRAME_TIME_HISTORY_SIZE> frameTimes;
+		size_t frameTimeIndex;
+
+		// CPU time of the scene update jobs of the last frame, in milliseconds
+		float lastSceneUpdateTime;
+
+		// Job benchmark, every thread count renders JOB_BENCHMARK_FRAME_COUNT frames, 0 when idle
+		uint32_t jobBenchmarkThreadCount;
+		uint32_t jobBenchmarkFrame;
+		uint32_t jobThreadCountBeforeBenchmark;
+		float jobBenchmarkCPUTimeSum;
+		float jobBenchmarkFrameTimeSum;
+		std::vector<JobBenchmarkResult> jobBenchmarkResults;
+
+		// Last complete frame shown in the flame view, kept while paused
+		std::vector<CpuProfileThreadEvents> cpuProfilerThreads;
+		int64_t cpuProfilerFrameStart;
+		int64_t cpuProfilerFrameEnd;
+		bool isCpuProfilerPaused;
+
 		bool drawGUI;
 	};
 
@@ -0,0 +1,62 @@
+#ifndef FRUSTUM_H_INCLUDED
+#define FRUSTUM_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "AABB.h"
+
+namespace lux
+{
+
+	// The planes point inside, a point is in front of a plane when dot(plane.xyz, point) + plane.w >= 0
+	struct Frustum
+	{
+		Frustum() noexcept;
+		explicit Frustum(const glm::mat4& viewProj) noexcept;
+		Frustum(const Frustum&) noexcept = default;
+		Frustum(Frustum&&) noexcept = default;
+
+		~Frustum() noexcept = default;
+
+		const Frustum& operator =(const Frustum&) = delete;
+		const Frustum& operator =(Frustum&&) = delete;
+
+		std::array<glm::vec4, 6> planes;
+	};
+
+	// World space boxes stored as structure of arrays, the culling loads the same coordinate of 4 boxes at once
+	struct CullingBounds
+	{
+		CullingBounds() noexcept;
+		CullingBounds(const CullingBounds&) = delete;
+		CullingBounds(CullingBounds&&) = delete;
+
+		~CullingBounds() noexcept = default;
+
+		const CullingBounds& operator =(const CullingBounds&) = delete;
+		const CullingBounds& operator =(CullingBounds&&) = delete;
+
+		void Clear() noexcept;
+		void Reserve(size_t count) noexcept;
+		void Add(const glm::vec3& worldMin, const glm::vec3& worldMax) noexcept;
+		void Add(const AABB& localAABB, const glm::mat4& transform) noexcept;
+		size_t GetCount() const noexcept;
+
+		std::vector<float> minX, minY, minZ;
+		std::vector<float> maxX, maxY, maxZ;
+	};
+
+	// Replaces visibleIndices with the indices of the boxes touching the frustum, in increasing order
+	void CullBounds(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visibleIndices) noexcept;
+
+	// Reference version without SIMD, used to check and measure CullBounds
+	void CullBoundsScalar(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visibleIndices) noexcept;
+
+} // namespace lux
+
+#endif // FRUSTUM_H_INCLUDED
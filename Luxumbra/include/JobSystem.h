@@ -0,0 +1,110 @@
+#ifndef JOB_SYSTEM_H_INCLUDED
+#define JOB_SYSTEM_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#define JOB_SYSTEM_MAX_THREAD_COUNT 16
+
+namespace lux
+{
+
+	// Dependency counter: incremented for every job submitted against it, decremented when a job completes
+	struct JobCounter
+	{
+		JobCounter() noexcept;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter(JobCounter&&) = delete;
+
+		~JobCounter() noexcept = default;
+
+		const JobCounter& operator=(const JobCounter&) = delete;
+		const JobCounter& operator=(JobCounter&&) = delete;
+
+		bool IsDone() const noexcept;
+
+		std::atomic<uint32_t> value;
+	};
+
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	// The owner thread pushes and pops at the back, thieves steal from the front
+	struct JobQueue
+	{
+		JobQueue() noexcept;
+		JobQueue(const JobQueue&) = delete;
+		JobQueue(JobQueue&&) = delete;
+
+		~JobQueue() noexcept = default;
+
+		const JobQueue& operator=(const JobQueue&) = delete;
+		const JobQueue& operator=(JobQueue&&) = delete;
+
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	class JobSystem
+	{
+	public:
+		JobSystem() noexcept;
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) = delete;
+
+		~JobSystem() noexcept;
+
+		const JobSystem& operator=(const JobSystem&) = delete;
+		const JobSystem& operator=(JobSystem&&) = delete;
+
+		void Initialize() noexcept;
+
+		// Threads able to run jobs, the main thread included
+		uint32_t GetMaxThreadCount() const noexcept;
+		uint32_t GetThreadCount() const noexcept;
+		void SetThreadCount(uint32_t newThreadCount) noexcept;
+
+		// 0 on the main thread, [1, GetMaxThreadCount()[ on the workers
+		static uint32_t GetCurrentThreadIndex() noexcept;
+
+		void Run(std::function<void()>&& function, JobCounter& counter) noexcept;
+		void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& function, JobCounter& counter) noexcept;
+
+		// Runs pending jobs until the counter reaches zero
+		void Wait(const JobCounter& counter) noexcept;
+
+	private:
+		void WorkerLoop(uint32_t threadIndex) noexcept;
+		bool TryRunJob(uint32_t threadIndex) noexcept;
+		bool PopJob(uint32_t threadIndex, Job& job) noexcept;
+		bool StealJob(uint32_t threadIndex, Job& job) noexcept;
+
+		bool isInitialized;
+
+		uint32_t maxThreadCount;
+		std::atomic<uint32_t> threadCount;
+
+		std::array<JobQueue, JOB_SYSTEM_MAX_THREAD_COUNT> queues;
+		std::vector<std::thread> workers;
+
+		std::atomic<uint32_t> pendingJobCount;
+
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+		bool isStopping;
+	};
+
+} // namespace lux
+
+#endif // JOB_SYSTEM_H_INCLUDED
@@ -12,7 +12,18 @@
 #define PREFILTERED_TEXTURE_SIZE 512
 #define BRDF_LUT_TEXTURE_SIZE 512
 
+// Frames the CPU may record ahead of the GPU: 1 for lowest latency, 3 for highest throughput
+#define MAX_FRAMES_IN_FLIGHT 2
+
 #define USE_COMPUTE_SHADER_FOR_IBL_RESOURCES
+#define DUMP_MEMORY_REPORT_AT_EXIT
+#define ENABLE_CPU_PROFILER
+
+#define MEMORY_REPORT_FILE_PATH "data/memoryReport.json"
+#define GPU_PROFILE_FILE_PATH "data/gpuProfile.csv"
+#define CPU_TRACE_FILE_PATH "data/cpuTrace.json"
+#define BENCHMARK_FILE_PATH "data/benchmark.json"
+#define CULLING_BENCHMARK_FILE_PATH "data/cullingBenchmark.json"
 
 #define TO_SIZE_T(x) static_cast<size_t>(x)
 #define TO_INT16_T(x) static_cast<int16_t>(x)
@@ -20,9 +31,16 @@
 #define TO_UINT32_T(x) static_cast<uint32_t>(x)
 #define TO_FLOAT(x) static_cast<float>(x)
 
+#ifdef _WIN32
+#define DEBUG_BREAK() __debugbreak()
+#else // !_WIN32
+#include <csignal>
+#define DEBUG_BREAK() std::raise(SIGTRAP)
+#endif // _WIN32
+
 #ifdef _DEBUG
 #include <cassert>
-#define ASSERT(x) if(x == false) { __debugbreak(); assert(false); }
+#define ASSERT(x) if(x == false) { DEBUG_BREAK(); assert(false); }
 #else // !_DEBUG
 #define ASSERT(x)
 #endif // _DEBUG
@@ -3,9 +3,9 @@
 
 #include <array>
 
-#include "glm\glm.hpp"
+#include "glm/glm.hpp"
 
-#include "rhi\LuxVkImpl.h"
+#include "rhi/LuxVkImpl.h"
 
 namespace lux
 {
@@ -23,6 +23,10 @@ namespace lux
 		static std::array<VkVertexInputAttributeDescription, 3> GetBasicAttributeDescriptions() noexcept;
 		static std::array<VkVertexInputAttributeDescription, 5> GetFullAttributeDescriptions() noexcept;
 
+		// Per-instance model matrix, one column per attribute
+		static VkVertexInputBindingDescription GetInstanceBindingDescription() noexcept;
+		static std::array<VkVertexInputAttributeDescription, 4> GetInstanceAttributeDescriptions(uint32_t firstLocation) noexcept;
+
 		bool operator==(const Vertex& lhs) const noexcept;
 	};
 
@@ -8,8 +8,8 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 #endif // _WIN32
 
-#include "GLFW\glfw3.h"
-#include "GLFW\glfw3native.h"
+#include "GLFW/glfw3.h"
+#include "GLFW/glfw3native.h"
 
 namespace lux
 {
@@ -42,12 +42,18 @@ namespace lux
 		const Window& operator=(Window&&) = delete;
 
 		bool Initialize(uint32_t width, uint32_t height) noexcept;
+		bool InitializeHeadless(uint32_t width, uint32_t height) noexcept;
+#ifdef _WIN32
 		HWND GetHandle() const noexcept;
+#endif // _WIN32
 		GLFWwindow* GetGLFWWindow() const noexcept;
+		bool GetIsHeadless() const noexcept;
 
 		void PollEvents() noexcept;
 		bool ShouldClose() const noexcept;
 
+		uint32_t GetWidth() const noexcept;
+		uint32_t GetHeight() const noexcept;
 		float GetAspect() const noexcept;
 
 		bool GetHasFocus() const noexcept;
@@ -61,6 +67,7 @@ namespace lux
 
 	private:
 		bool isInitialized;
+		bool isHeadless;
 
 		uint32_t width, height;
 		GLFWwindow* window;
@@ -5,10 +5,10 @@
 
 #include <vector>
 
-#include "glm\glm.hpp"
+#include "glm/glm.hpp"
 
-#include "rhi\Buffer.h"
-#include "resource\Texture.h"
+#include "rhi/Buffer.h"
+#include "resource/Texture.h"
 
 namespace lux::resource
 {
@@ -68,14 +68,17 @@ namespace lux::resource
 		std::string name;
 
 		bool isTransparent;
+		// Opaque but some fragments are discarded, the depth prepass cannot write its depth
+		bool isAlphaTested;
 		MaterialParameters parameter;
 		std::shared_ptr<Texture> albedo;
 		std::shared_ptr<Texture> normal;
 		std::shared_ptr<Texture> metallicRoughness;
 		std::shared_ptr<Texture> ambientOcclusion;
 		
-		std::vector<rhi::Buffer> buffer;
-		std::vector<VkDescriptorSet> descriptorSet;
+		VkDescriptorPool descriptorPool;
+		VkDescriptorSet descriptorSet;
+		uint32_t materialIndex;
 	};
 
 } // namespace lux::resource
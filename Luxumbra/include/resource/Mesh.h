@@ -3,7 +3,6 @@
 
 #include "Luxumbra.h"
 
-#include "rhi\Buffer.h"
 #include "AABB.h"
 
 namespace lux::resource
@@ -21,11 +20,19 @@ namespace lux::resource
 		Mesh& operator=(const Mesh&) = delete;
 		Mesh& operator=(Mesh&&) = delete;
 	
+		// Range of the mesh in the RHI mesh arena
 		uint32_t indexCount;
-		lux::rhi::Buffer vertexBuffer;
-		lux::rhi::Buffer indexBuffer;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t vertexCount;
+
+		// Small identifier used by the render queue keys, reused once the mesh is destroyed
+		uint32_t meshIndex;
 
 		AABB aabb;
+
+		// Every vertex lies on one plane, a view ray crosses the surface at most once
+		bool isPlanar;
 	};
 
 } // namespace lux::resource
@@ -6,10 +6,10 @@
 #include <unordered_map>
 #include <array>
 
-#include "rhi\RHI.h"
-#include "resource\Mesh.h"
-#include "resource\Texture.h"
-#include "resource\Material.h"
+#include "rhi/RHI.h"
+#include "resource/Mesh.h"
+#include "resource/Texture.h"
+#include "resource/Material.h"
 #include "Vertex.h"
 
 namespace lux::resource
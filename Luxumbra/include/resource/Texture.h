@@ -3,7 +3,7 @@
 
 #include "Luxumbra.h"
 
-#include "rhi\Image.h"
+#include "rhi/Image.h"
 
 namespace lux::resource
 {
@@ -23,6 +23,9 @@ namespace lux::resource
 
 		rhi::Image image;
 		VkSampler sampler;
+
+		// At least one texel has a null alpha, the opaque shading discards it
+		bool hasTransparentTexels;
 	};
 
 } // namespace lux::resource
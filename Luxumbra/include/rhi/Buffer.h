@@ -3,7 +3,10 @@
 
 #include "Luxumbra.h"
 
-#include "rhi\LuxVkImpl.h"
+#include <string>
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/MemoryAllocator.h"
 
 namespace lux::rhi
 {
@@ -15,6 +18,8 @@ namespace lux::rhi
 		VkSharingMode sharingMode;
 		VkMemoryPropertyFlags memoryProperty;
 		void* data;
+		MemoryCategory memoryCategory;
+		std::string debugName;
 	};
 
 	struct Buffer
@@ -29,7 +34,7 @@ namespace lux::rhi
 		const Buffer& operator==(Buffer&&) = delete;
 		
 		VkBuffer buffer;
-		VkDeviceMemory memory;
+		MemoryAllocation allocation;
 		VkDeviceSize size;
 	};
 
@@ -3,7 +3,7 @@
 
 #include "Luxumbra.h"
 
-#include "rhi\LuxVkImpl.h"
+#include "rhi/LuxVkImpl.h"
 
 
 namespace lux::rhi
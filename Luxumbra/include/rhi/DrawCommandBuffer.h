@@ -0,0 +1,43 @@
+#ifndef DRAW_COMMAND_BUFFER_H_INCLUDED
+#define DRAW_COMMAND_BUFFER_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+
+#define DRAW_COMMAND_BUFFER_INITIAL_CAPACITY 1024
+
+namespace lux::rhi
+{
+
+	// Indexed indirect draw records of the frame, the per draw data lives in the instance buffer at each record's firstInstance
+	struct DrawCommandBuffer
+	{
+		DrawCommandBuffer() noexcept;
+		DrawCommandBuffer(const DrawCommandBuffer&) = delete;
+		DrawCommandBuffer(DrawCommandBuffer&&) = delete;
+
+		~DrawCommandBuffer() noexcept = default;
+
+		const DrawCommandBuffer& operator=(const DrawCommandBuffer&) = delete;
+		const DrawCommandBuffer& operator=(DrawCommandBuffer&&) = delete;
+
+		// Without drawIndirectFirstInstance the records are replayed as direct draws
+		bool isIndirectFirstInstanceSupported;
+		bool isMultiDrawIndirectSupported;
+
+		// One mapped buffer per frame in flight, replaced by a larger one when a frame does not fit
+		std::array<Buffer, MAX_FRAMES_IN_FLIGHT> buffers;
+		std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> capacities;
+
+		// Filled while the draw lists are built, copied to the frame's buffer before recording
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+	};
+
+} // namespace lux::rhi
+
+#endif // DRAW_COMMAND_BUFFER_H_INCLUDED
@@ -0,0 +1,49 @@
+#ifndef DYNAMIC_RESOLUTION_H_INCLUDED
+#define DYNAMIC_RESOLUTION_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include "rhi/LuxVkImpl.h"
+
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+#define DYNAMIC_RESOLUTION_MAX_SCALE 1.0f
+#define DYNAMIC_RESOLUTION_DEFAULT_TARGET_FRAME_TIME 16.0f
+
+// Frames between two scale changes, the GPU time of a frame is read back MAX_FRAMES_IN_FLIGHT frames later
+#define DYNAMIC_RESOLUTION_ADJUSTMENT_INTERVAL 8
+#define DYNAMIC_RESOLUTION_MAX_SCALE_STEP 0.1f
+
+// The scale only grows back once the frame is under this fraction of the budget
+#define DYNAMIC_RESOLUTION_INCREASE_THRESHOLD 0.85f
+#define DYNAMIC_RESOLUTION_SMOOTHING 0.2f
+
+namespace lux::rhi
+{
+
+	// The forward and SSAO targets keep the swapchain size, a scaled sub rectangle of them is rendered then upscaled by the blit pass
+	struct DynamicResolution
+	{
+		DynamicResolution() noexcept;
+		DynamicResolution(const DynamicResolution&) = delete;
+		DynamicResolution(DynamicResolution&&) = delete;
+
+		~DynamicResolution() noexcept = default;
+
+		const DynamicResolution& operator=(const DynamicResolution&) = delete;
+		const DynamicResolution& operator=(DynamicResolution&&) = delete;
+
+		bool isEnabled;
+
+		float scale;
+		VkExtent2D renderExtent;
+
+		// Milliseconds
+		float targetFrameTime;
+		float smoothedFrameTime;
+
+		uint32_t lastAdjustmentFrame;
+	};
+
+} // namespace lux::rhi
+
+#endif // DYNAMIC_RESOLUTION_H_INCLUDED
@@ -5,11 +5,15 @@
 
 #include <vector>
 
-#include "glm\glm.hpp"
+#include "glm/glm.hpp"
 
+#include "Frustum.h"
 #include "LuxVkImpl.h"
-#include "rhi\Image.h"
-#include "resource\Mesh.h"
+#include "rhi/Image.h"
+#include "rhi/Buffer.h"
+#include "rhi/RenderQueue.h"
+#include "resource/Mesh.h"
+#include "scene/MeshNode.h"
 
 
 namespace lux::rhi
@@ -21,9 +25,9 @@ namespace lux::rhi
 		glm::vec2 nearFarPlane;
 	};
 
-	struct RtModelConstant
+	struct RtMaterialConstant
 	{
-		glm::mat4 model;
+		uint32_t materialIndex;
 	};
 
 	struct PostProcessParameters
@@ -35,6 +39,7 @@ namespace lux::rhi
 		int splitViewMask;
 		float FXAAContrastThreshold = 0.0312f;
 		float FXAARelativeThreshold = 0.125f;
+		glm::vec2 renderScale = glm::vec2(1.0f);
 	};
 
 	enum PostProcessSplitViewMask
@@ -54,6 +59,7 @@ namespace lux::rhi
 		float kernelRadius = 0.5f;
 		float bias = 0.01f;
 		float strenght = 1.0f;
+		glm::vec2 renderScale = glm::vec2(1.0f);
 	};
 
 	struct ForwardRenderer
@@ -92,6 +98,11 @@ namespace lux::rhi
 		VkFormat rtImageFormat;
 
 		VkRenderPass rtRenderPass;
+
+		// Compatible with the render pass, the occlusion culling builds the Hi-Z pyramid between them
+		VkRenderPass rtEarlyRenderPass;
+		VkRenderPass rtLateRenderPass;
+
 		std::vector<VkFramebuffer> rtFrameBuffers;
 		VkDescriptorPool descriptorPool;
 
@@ -99,38 +110,65 @@ namespace lux::rhi
 		GraphicsPipeline rtCutoutGraphicsPipeline;
 		GraphicsPipeline rtTransparentBackGraphicsPipeline;
 		GraphicsPipeline rtTransparentFrontGraphicsPipeline;
+		GraphicsPipeline rtTransparentTwoSidedGraphicsPipeline;
 
 		GraphicsPipelineCreateInfo rtGraphicsPipelineCI;
 		GraphicsPipelineCreateInfo rtCutoutGraphicsPipelineCI;
 		GraphicsPipelineCreateInfo rtTransparentBackGraphicsPipelineCI;
 		GraphicsPipelineCreateInfo rtTransparentFrontGraphicsPipelineCI;
+		GraphicsPipelineCreateInfo rtTransparentTwoSidedGraphicsPipelineCI;
+
+		// Depth prepass, the opaque batches it drew are then shaded with an equal depth test and no depth write
+
+		bool isDepthPrepassEnabled;
+
+		GraphicsPipeline rtDepthPrepassGraphicsPipeline;
+		GraphicsPipeline rtDepthEqualGraphicsPipeline;
+
+		GraphicsPipelineCreateInfo rtDepthPrepassGraphicsPipelineCI;
+		GraphicsPipelineCreateInfo rtDepthEqualGraphicsPipelineCI;
 
-		std::vector<VkDescriptorSet> rtViewDescriptorSets;
+		VkDescriptorSet rtViewDescriptorSet;
 		std::vector<VkDescriptorSet> rtModelDescriptorSets;
 
 		// Env map
 
 		GraphicsPipeline envMapGraphicsPipeline;
 		GraphicsPipelineCreateInfo envMapGraphicsPipelineCI;
-		std::vector<VkDescriptorSet> envMapViewDescriptorSets;
+		VkDescriptorSet envMapViewDescriptorSet;
 
 		// Uniforms
 
-		RtModelConstant modelConstant;
 		RtViewProjUniform rtViewProjUniform;
-		std::vector<Buffer> viewProjUniformBuffers;
+		uint32_t viewProjUniformOffset;
+
+		// Draws of the frame sorted by key, read by the recording tasks
+
+		RenderQueue renderQueue;
+		size_t firstRecordingTaskIndex;
+		size_t earlyRecordingTaskCount;
+		size_t recordingTaskCount;
+
+		// Records of the opaque batches filled by the late culling phase, drawn in the late render pass
+		uint32_t lateFirstDrawCommand;
+
+		// Mesh nodes inside the camera frustum, their world bounds are rebuilt every frame
+
+		CullingBounds meshBounds;
+		std::vector<uint32_t> visibleMeshIndices;
+		std::vector<scene::MeshNode*> visibleMeshes;
 
 		// Attachments
 
 		std::vector<VkImage> rtColorAttachmentImages;
 		std::vector<VkImageView> rtColorAttachmentImageViews;
-		std::vector<VkDeviceMemory> rtColorAttachmentImageMemories;
+		std::vector<MemoryAllocation> rtColorAttachmentImageAllocations;
 
 		Image rtResolveColorAttachment;
 
 		VkImage rtDepthAttachmentImage;
 		VkImageView rtDepthAttachmentImageView;
-		VkDeviceMemory rtDepthAttachmentMemory;
+		MemoryAllocation rtDepthAttachmentAllocation;
 
 		Image rtPositionMap;
 		Image rtResolvePositionMap;
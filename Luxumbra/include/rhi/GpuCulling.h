@@ -0,0 +1,135 @@
+#ifndef GPU_CULLING_H_INCLUDED
+#define GPU_CULLING_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+#include "rhi/Image.h"
+#include "rhi/ComputePipeline.h"
+
+#define GPU_CULLING_GROUP_SIZE 64
+#define GPU_CULLING_INITIAL_INSTANCE_CAPACITY 4096
+#define GPU_CULLING_INITIAL_VIEW_CAPACITY 64
+
+#define GPU_CULLING_INVALID_DRAW_COMMAND UINT32_MAX
+
+#define HI_Z_GROUP_SIZE 8
+#define HI_Z_MIP_COUNT 8
+
+namespace lux::rhi
+{
+
+	enum class GpuCullingPhase : uint32_t
+	{
+		GPU_CULLING_PHASE_EARLY = 0,
+		GPU_CULLING_PHASE_LATE
+	};
+
+	// World space frustum planes, xyz points inside, the matrices project the bounds on the Hi-Z pyramid
+	struct GpuCullingView
+	{
+		std::array<glm::vec4, 6> planes;
+		glm::mat4 viewProj;
+		glm::mat4 previousViewProj;
+	};
+
+	// Matches the std430 layout of the culling shader, the bounds are the mesh local AABB
+	// The early phase appends to drawCommand, the late phase re-tests the occluded instances and appends to lateDrawCommand
+	struct GpuCullingInstance
+	{
+		glm::vec4 aabbMin;
+		glm::vec4 aabbMax;
+		uint32_t sourceInstance;
+		uint32_t drawCommand;
+		uint32_t view;
+		uint32_t lateDrawCommand;
+	};
+
+	struct GpuCullingPushConstant
+	{
+		uint32_t instanceCount;
+		GpuCullingPhase phase;
+		uint32_t isHiZValid;
+		uint32_t padding;
+		glm::uvec2 hiZExtent;
+	};
+
+	struct HiZPushConstant
+	{
+		glm::uvec2 sourceExtent;
+		glm::uvec2 extent;
+		int32_t sampleCount;
+	};
+
+	// Each culled view gets a copy of its queue's draw records with no instance, the compute pass
+	// appends the visible model matrices to the copies and to the culled instance buffer
+	struct GpuCuller
+	{
+		GpuCuller() noexcept;
+		GpuCuller(const GpuCuller&) = delete;
+		GpuCuller(GpuCuller&&) = delete;
+
+		~GpuCuller() noexcept = default;
+
+		const GpuCuller& operator=(const GpuCuller&) = delete;
+		const GpuCuller& operator=(GpuCuller&&) = delete;
+
+		// The culled draw counts only exist on the GPU, they need indirect draws with a firstInstance
+		bool isSupported;
+		bool isEnabled;
+
+		// Latched when the frame starts so every pass of the frame reads the same instance buffer
+		bool isActive;
+
+		ComputePipeline pipeline;
+		VkDescriptorPool descriptorPool;
+		std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets;
+
+		// One buffer of each per frame in flight, replaced by a larger one when a frame does not fit
+		std::array<Buffer, MAX_FRAMES_IN_FLIGHT> instanceBuffers;
+		std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> instanceCapacities;
+		std::array<Buffer, MAX_FRAMES_IN_FLIGHT> viewBuffers;
+		std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> viewCapacities;
+		std::array<Buffer, MAX_FRAMES_IN_FLIGHT> culledInstanceBuffers;
+		std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> culledInstanceCapacities;
+
+		std::vector<GpuCullingInstance> instances;
+		std::vector<GpuCullingView> views;
+		uint32_t culledInstanceCount;
+
+		// Occlusion culling against a max depth pyramid of the forward pass, the instances hidden in last frame's
+		// pyramid are re-tested against the pyramid of this frame's early draws before the late forward pass
+
+		bool isOcclusionCullingEnabled;
+		bool isOcclusionActive;
+
+		// Written by the early phase, the late phase only re-tests the instances it did not draw
+		std::array<Buffer, MAX_FRAMES_IN_FLIGHT> earlyVisibilityBuffers;
+		std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> earlyVisibilityCapacities;
+
+		// Mip 0 covers the depth attachment rounded up so every mip of the rendered region is a whole texel
+		Image hiZImage;
+		std::array<VkImageView, HI_Z_MIP_COUNT> hiZMipImageViews;
+		VkExtent2D hiZImageExtent;
+		VkSampler hiZSampler;
+
+		ComputePipeline hiZDepthPipeline;
+		ComputePipeline hiZDownsamplePipeline;
+		VkDescriptorPool hiZDescriptorPool;
+		std::array<VkDescriptorSet, HI_Z_MIP_COUNT> hiZDescriptorSets;
+
+		// The pyramid of the previous frame, its view and the region of the depth it was built from
+		bool isHiZValid;
+		glm::mat4 hiZViewProj;
+		VkExtent2D hiZRenderExtent;
+	};
+
+} // namespace lux::rhi
+
+#endif // GPU_CULLING_H_INCLUDED
@@ -0,0 +1,76 @@
+#ifndef GPU_PROFILER_H_INCLUDED
+#define GPU_PROFILER_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <map>
+
+#include "rhi/LuxVkImpl.h"
+
+// Every scope writes a begin and an end timestamp
+#define GPU_PROFILER_MAX_SCOPE_COUNT 512
+#define GPU_PROFILER_HISTORY_SIZE 240
+#define GPU_PROFILER_INVALID_SCOPE UINT32_MAX
+
+namespace lux::rhi
+{
+
+	// Last GPU_PROFILER_HISTORY_SIZE durations of one named pass, in milliseconds, used as a ring buffer
+	struct GpuPassTimings
+	{
+		std::string name;
+		std::array<float, GPU_PROFILER_HISTORY_SIZE> samples;
+		size_t sampleCount;
+		uint64_t lastFrame;
+	};
+
+	struct GpuPassStatistics
+	{
+		std::string name;
+		float last;
+		float average;
+		float p50;
+		float p95;
+		float p99;
+		float max;
+		size_t sampleCount;
+	};
+
+	struct GpuPassTime
+	{
+		std::string name;
+		float time;
+	};
+
+	struct GpuProfiler
+	{
+		GpuProfiler() noexcept;
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler(GpuProfiler&&) = delete;
+
+		~GpuProfiler() noexcept = default;
+
+		const GpuProfiler& operator=(const GpuProfiler&) = delete;
+		const GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+		bool isSupported;
+
+		// Nanoseconds per timestamp tick
+		float timestampPeriod;
+		uint64_t timestampMask;
+
+		// A frame's queries are read back once its fence is waited on, MAX_FRAMES_IN_FLIGHT frames later
+		std::array<VkQueryPool, MAX_FRAMES_IN_FLIGHT> queryPools;
+		std::array<std::vector<size_t>, MAX_FRAMES_IN_FLIGHT> frameScopePassIndices;
+		std::vector<uint64_t> queryResults;
+
+		std::vector<GpuPassTimings> passes;
+		std::map<std::string, size_t> passIndices;
+	};
+
+} // namespace lux::rhi
+
+#endif // GPU_PROFILER_H_INCLUDED
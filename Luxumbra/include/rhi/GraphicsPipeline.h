@@ -6,7 +6,7 @@
 #include <string>
 #include <vector>
 
-#include "rhi\LuxVkImpl.h"
+#include "rhi/LuxVkImpl.h"
 #include "Vertex.h"
 
 namespace lux::rhi
@@ -19,6 +19,8 @@ namespace lux::rhi
 		std::string binaryFragmentFilePath;
 		std::string cacheFilePath;
 		lux::VertexLayout vertexLayout;
+		// Reads a model matrix per instance from vertex binding 1, located after the vertex attributes
+		VkBool32 enableInstancing = VK_FALSE;
 		VkPrimitiveTopology primitiveTopology;
 		float viewportWidth;
 		float viewportHeight;
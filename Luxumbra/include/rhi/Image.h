@@ -5,7 +5,8 @@
 
 #include <string>
 
-#include "rhi\LuxVkImpl.h"
+#include "rhi/LuxVkImpl.h"
+#include "rhi/MemoryAllocator.h"
 
 namespace lux::rhi
 {
@@ -24,6 +25,8 @@ namespace lux::rhi
 		void* imageData;
 		uint64_t imageSize;
 		bool useInComputeShader;
+		MemoryCategory memoryCategory;
+		std::string debugName;
 	};
 
 	struct CubeMapCreateInfo
@@ -49,7 +52,7 @@ namespace lux::rhi
 
 		VkImage image;
 		VkImageView imageView;
-		VkDeviceMemory memory;
+		MemoryAllocation allocation;
 	};
 
 } // namespace lux::rhi
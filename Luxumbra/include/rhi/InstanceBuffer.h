@@ -0,0 +1,41 @@
+#ifndef INSTANCE_BUFFER_H_INCLUDED
+#define INSTANCE_BUFFER_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+
+#define INSTANCE_BUFFER_INITIAL_CAPACITY 1024
+
+namespace lux::rhi
+{
+
+	// Model matrices of the frame's instanced draws, read as a vertex buffer with an instance input rate
+	struct InstanceBuffer
+	{
+		InstanceBuffer() noexcept;
+		InstanceBuffer(const InstanceBuffer&) = delete;
+		InstanceBuffer(InstanceBuffer&&) = delete;
+
+		~InstanceBuffer() noexcept = default;
+
+		const InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+		const InstanceBuffer& operator=(InstanceBuffer&&) = delete;
+
+		// One mapped buffer per frame in flight, replaced by a larger one when a frame does not fit
+		std::array<Buffer, MAX_FRAMES_IN_FLIGHT> buffers;
+		std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> capacities;
+
+		// Filled while the draw lists are built, copied to the frame's buffer before recording
+		std::vector<glm::mat4> instances;
+	};
+
+} // namespace lux::rhi
+
+#endif // INSTANCE_BUFFER_H_INCLUDED
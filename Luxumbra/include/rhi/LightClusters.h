@@ -0,0 +1,96 @@
+#ifndef LIGHT_CLUSTERS_H_INCLUDED
+#define LIGHT_CLUSTERS_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+
+#define LIGHT_CLUSTER_GRID_X 16
+#define LIGHT_CLUSTER_GRID_Y 9
+#define LIGHT_CLUSTER_GRID_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_GRID_X * LIGHT_CLUSTER_GRID_Y * LIGHT_CLUSTER_GRID_Z)
+
+// Room for 16 lights per cluster on average, a cluster past the end of the list loses its last lights
+#define LIGHT_CLUSTER_MAX_INDEX_COUNT (LIGHT_CLUSTER_COUNT * 16)
+
+#define LIGHT_CLUSTER_POINT_LIGHT_MAX_COUNT 64
+
+namespace lux::rhi
+{
+
+	// Matches the header of the cluster grid in cameraSpaceLight.frag, a fragment finds its cluster with
+	// gl_FragCoord.xy * tileScale and log(view depth) * depthScale + depthBias
+	struct LightClusterParameters
+	{
+		glm::vec2 tileScale;
+		float depthScale;
+		float depthBias;
+	};
+
+	// Offset in the light index list and light count of a cluster
+	struct LightClusterRecord
+	{
+		uint32_t firstLightIndex;
+		uint32_t lightCount;
+	};
+
+	struct LightClusterStatistics
+	{
+		uint32_t indexCount;
+		uint32_t maxClusterLightCount;
+		uint32_t droppedIndexCount;
+	};
+
+	// Froxel grid over the render extent with exponential depth slices, rebuilt on the CPU every frame from the
+	// point light spheres. The forward shader only loops over the lights of the fragment's cluster
+	struct LightClusterer
+	{
+		LightClusterer() noexcept;
+		LightClusterer(const LightClusterer&) = delete;
+		LightClusterer(LightClusterer&&) = delete;
+
+		~LightClusterer() noexcept = default;
+
+		const LightClusterer& operator=(const LightClusterer&) = delete;
+		const LightClusterer& operator=(LightClusterer&&) = delete;
+
+		// Disabled, every fragment reads a single cluster holding all the lights
+		bool isEnabled;
+
+		// One region per frame in flight, the grid then the light index list, both bound with the frame offset
+		Buffer buffer;
+		uint8_t* mappedData;
+		VkDeviceSize indexListOffset;
+		VkDeviceSize frameSize;
+		uint32_t frameOffset;
+
+		// World position and radius of the point lights in light buffer order, filled with the light buffer
+		std::array<glm::vec4, LIGHT_CLUSTER_POINT_LIGHT_MAX_COUNT> pointLights;
+		uint32_t pointLightCount;
+
+		// View space bounds of the froxels, only rebuilt when the projection changes
+		glm::mat4 boundsProjection;
+		std::vector<glm::vec3> clusterMins;
+		std::vector<glm::vec3> clusterMaxs;
+
+		// Clusters overlapped by each light, in light order
+		std::vector<uint32_t> lightClusterIndices;
+		std::array<uint32_t, LIGHT_CLUSTER_POINT_LIGHT_MAX_COUNT + 1> lightFirstClusterIndices;
+		std::vector<uint32_t> clusterLightCounts;
+
+		// Copied to the frame region once complete
+		std::vector<LightClusterRecord> clusterRecords;
+		std::vector<uint32_t> lightIndices;
+
+		LightClusterStatistics statistics;
+	};
+
+} // namespace lux::rhi
+
+#endif // LIGHT_CLUSTERS_H_INCLUDED
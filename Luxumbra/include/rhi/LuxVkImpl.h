@@ -1,11 +1,11 @@
 #ifndef LUX_VK_IMPL_H_INCLUDED
 #define LUX_VK_IMPL_H_INCLUDED
 
-#include "volk\volk.h"
+#include "volk/volk.h"
 
 #ifdef _DEBUG
 #include "Logger.h"
-#define CHECK_VK(vkFunctionCall) { VkResult result = vkFunctionCall; if (VK_SUCCESS != (result)) { Logger::Log(LogLevel::LOG_LEVEL_ERROR, #vkFunctionCall); __debugbreak(); } }
+#define CHECK_VK(vkFunctionCall) { VkResult result = vkFunctionCall; if (VK_SUCCESS != (result)) { Logger::Log(LogLevel::LOG_LEVEL_ERROR, #vkFunctionCall); DEBUG_BREAK(); } }
 #define VULKAN_ENABLE_VALIDATION
 #else // !_DEBUG
 #include "Logger.h"
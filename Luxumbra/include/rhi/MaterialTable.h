@@ -0,0 +1,46 @@
+#ifndef MATERIAL_TABLE_H_INCLUDED
+#define MATERIAL_TABLE_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <vector>
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+#include "resource/Material.h"
+
+#define MATERIAL_TABLE_INITIAL_CAPACITY 256
+
+namespace lux::rhi
+{
+
+	// Matches the std430 array stride of the material table in the shaders
+	struct alignas(16) MaterialTableEntry
+	{
+		resource::MaterialParameters parameters;
+	};
+
+	struct MaterialTable
+	{
+		MaterialTable() noexcept;
+		MaterialTable(const MaterialTable&) = delete;
+		MaterialTable(MaterialTable&&) = delete;
+
+		~MaterialTable() noexcept = default;
+
+		const MaterialTable& operator=(const MaterialTable&) = delete;
+		const MaterialTable& operator=(MaterialTable&&) = delete;
+
+		Buffer buffer;
+		uint32_t capacity;
+
+		// CPU copy of the table, the dirty entries are uploaded before the next frame, one copy per run of adjacent indices
+		std::vector<MaterialTableEntry> entries;
+		std::vector<uint32_t> freeIndices;
+		std::vector<uint32_t> dirtyIndices;
+		std::vector<bool> isEntryDirty;
+	};
+
+} // namespace lux::rhi
+
+#endif // MATERIAL_TABLE_H_INCLUDED
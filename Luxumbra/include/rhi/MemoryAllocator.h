@@ -0,0 +1,123 @@
+#ifndef MEMORY_ALLOCATOR_H_INCLUDED
+#define MEMORY_ALLOCATOR_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <vector>
+#include <string>
+
+#include "rhi/LuxVkImpl.h"
+
+#define MEMORY_BLOCK_SIZE (64 * 1024 * 1024)
+
+namespace lux::rhi
+{
+
+	enum class MemoryCategory : uint32_t
+	{
+		MEMORY_CATEGORY_OTHER = 0,
+		MEMORY_CATEGORY_ATTACHMENT,
+		MEMORY_CATEGORY_SHADOW_MAP,
+		MEMORY_CATEGORY_IBL,
+		MEMORY_CATEGORY_TEXTURE,
+		MEMORY_CATEGORY_MESH,
+		MEMORY_CATEGORY_UNIFORM,
+		MEMORY_CATEGORY_MATERIAL,
+		MEMORY_CATEGORY_INSTANCE,
+		MEMORY_CATEGORY_DRAW_COMMAND,
+		MEMORY_CATEGORY_CULLING,
+		MEMORY_CATEGORY_STAGING,
+		MEMORY_CATEGORY_COUNT
+	};
+
+	struct MemoryRange
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		VkDeviceSize usedSize;
+		uint32_t memoryType;
+		uint32_t allocationCount;
+		bool isLinear;
+		bool isDedicated;
+		void* mappedData;
+		std::vector<MemoryRange> freeRanges;
+	};
+
+	struct MemoryAllocation
+	{
+		MemoryAllocation() noexcept;
+		MemoryAllocation(const MemoryAllocation&) = delete;
+		MemoryAllocation(MemoryAllocation&&) = default;
+
+		~MemoryAllocation() noexcept = default;
+
+		const MemoryAllocation& operator=(const MemoryAllocation&) = delete;
+		const MemoryAllocation& operator=(MemoryAllocation&&) = delete;
+
+		VkDeviceMemory memory;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		uint32_t memoryType;
+		uint32_t blockIndex;
+		uint32_t recordIndex;
+		void* mappedData;
+	};
+
+	// Bookkeeping of a live allocation, used for memory reports only
+	struct MemoryAllocationRecord
+	{
+		std::string debugName;
+		MemoryCategory category;
+		VkDeviceSize size;
+		uint32_t memoryType;
+		bool isAlive;
+	};
+
+	struct MemoryHeapUsage
+	{
+		VkMemoryHeapFlags flags;
+		VkDeviceSize heapSize;
+		VkDeviceSize blockSize;
+		VkDeviceSize usedSize;
+		uint32_t blockCount;
+		uint32_t allocationCount;
+	};
+
+	struct MemoryCategoryUsage
+	{
+		VkDeviceSize usedSize;
+		VkDeviceSize deviceLocalSize;
+		VkDeviceSize hostVisibleSize;
+		uint32_t allocationCount;
+	};
+
+	struct MemoryAllocator
+	{
+		MemoryAllocator() noexcept;
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator(MemoryAllocator&&) = delete;
+
+		~MemoryAllocator() noexcept = default;
+
+		const MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+		const MemoryAllocator& operator=(MemoryAllocator&&) = delete;
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+
+		std::vector<MemoryBlock> blocks;
+
+		std::vector<MemoryAllocationRecord> records;
+		std::vector<uint32_t> freeRecordIndices;
+	};
+
+	const char* GetMemoryCategoryName(MemoryCategory category) noexcept;
+
+} // namespace lux::rhi
+
+#endif // MEMORY_ALLOCATOR_H_INCLUDED
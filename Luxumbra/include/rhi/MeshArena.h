@@ -0,0 +1,61 @@
+#ifndef MESH_ARENA_H_INCLUDED
+#define MESH_ARENA_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <vector>
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+
+#define MESH_ARENA_VERTEX_CAPACITY (512 * 1024)
+#define MESH_ARENA_INDEX_CAPACITY (2 * 1024 * 1024)
+
+namespace lux::resource
+{
+	class Mesh;
+} // namespace lux::resource
+
+namespace lux::rhi
+{
+
+	struct MeshArenaRange
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct MeshArena
+	{
+		MeshArena() noexcept;
+		MeshArena(const MeshArena&) = delete;
+		MeshArena(MeshArena&&) = delete;
+
+		~MeshArena() noexcept = default;
+
+		const MeshArena& operator=(const MeshArena&) = delete;
+		const MeshArena& operator=(MeshArena&&) = delete;
+
+		// Device local buffers are filled through staging, host visible ones are written directly
+		bool isDeviceLocal;
+
+		Buffer vertexBuffer;
+		Buffer indexBuffer;
+
+		uint32_t vertexCapacity;
+		uint32_t indexCapacity;
+
+		// Offset-sorted free lists, in vertices and indices
+		std::vector<MeshArenaRange> freeVertexRanges;
+		std::vector<MeshArenaRange> freeIndexRanges;
+
+		// Meshes living in the arena, patched when the arena is compacted
+		std::vector<resource::Mesh*> meshes;
+
+		std::vector<uint32_t> freeMeshIndices;
+		uint32_t meshIndexCount;
+	};
+
+} // namespace lux::rhi
+
+#endif // MESH_ARENA_H_INCLUDED
@@ -0,0 +1,71 @@
+#ifndef PARALLEL_RECORDER_H_INCLUDED
+#define PARALLEL_RECORDER_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <array>
+#include <vector>
+#include <functional>
+#include <atomic>
+
+#include "JobSystem.h"
+#include "rhi/LuxVkImpl.h"
+
+#define RECORDING_DRAWS_PER_TASK 64
+
+namespace lux::rhi
+{
+
+	// Records one render pass instance into a secondary command buffer
+	struct RecordingTask
+	{
+		VkRenderPass renderPass;
+		VkFramebuffer framebuffer;
+		std::function<void(VkCommandBuffer)> record;
+
+		VkCommandBuffer commandBuffer;
+	};
+
+	// Command pools are externally synchronized, each recording thread owns one per frame in flight
+	struct RecordingThreadContext
+	{
+		RecordingThreadContext() noexcept;
+		RecordingThreadContext(const RecordingThreadContext&) = delete;
+		RecordingThreadContext(RecordingThreadContext&&) = delete;
+
+		~RecordingThreadContext() noexcept = default;
+
+		const RecordingThreadContext& operator=(const RecordingThreadContext&) = delete;
+		const RecordingThreadContext& operator=(RecordingThreadContext&&) = delete;
+
+		std::array<VkCommandPool, MAX_FRAMES_IN_FLIGHT> commandPools;
+		std::array<std::vector<VkCommandBuffer>, MAX_FRAMES_IN_FLIGHT> commandBuffers;
+		size_t usedCommandBufferCount;
+	};
+
+	struct ParallelRecorder
+	{
+		ParallelRecorder() noexcept;
+		ParallelRecorder(const ParallelRecorder&) = delete;
+		ParallelRecorder(ParallelRecorder&&) = delete;
+
+		~ParallelRecorder() noexcept = default;
+
+		const ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+		const ParallelRecorder& operator=(ParallelRecorder&&) = delete;
+
+		JobSystem* jobSystem;
+
+		// Indexed by job system thread, context 0 belongs to the render thread
+		std::array<RecordingThreadContext, JOB_SYSTEM_MAX_THREAD_COUNT> threadContexts;
+
+		std::vector<RecordingTask> tasks;
+		std::atomic<size_t> nextTaskIndex;
+
+		// CPU time spent recording the last frame, in milliseconds
+		float lastRecordingTime;
+	};
+
+} // namespace lux::rhi
+
+#endif // PARALLEL_RECORDER_H_INCLUDED
@@ -5,25 +5,38 @@
 
 #include <vector>
 
-#include "rhi\LuxVkImpl.h"
+#include "rhi/LuxVkImpl.h"
 #include "Window.h"
-#include "rhi\GraphicsPipeline.h"
-#include "rhi\ComputePipeline.h"
-#include "rhi\ForwardRenderer.h"
-#include "rhi\ShadowMapper.h"
-#include "rhi\Image.h"
-#include "rhi\Buffer.h"
-#include "resource\Mesh.h"
-#include "resource\Material.h"
-#include "scene\CameraNode.h"
-#include "scene\MeshNode.h"
-#include "scene\LightNode.h"
+#include "JobSystem.h"
+#include "rhi/GraphicsPipeline.h"
+#include "rhi/ComputePipeline.h"
+#include "rhi/ForwardRenderer.h"
+#include "rhi/ShadowMapper.h"
+#include "rhi/Image.h"
+#include "rhi/Buffer.h"
+#include "rhi/MemoryAllocator.h"
+#include "rhi/UniformRingBuffer.h"
+#include "rhi/MeshArena.h"
+#include "rhi/InstanceBuffer.h"
+#include "rhi/DrawCommandBuffer.h"
+#include "rhi/GpuCulling.h"
+#include "rhi/MaterialTable.h"
+#include "rhi/LightClusters.h"
+#include "rhi/UploadBatch.h"
+#include "rhi/ParallelRecorder.h"
+#include "rhi/GpuProfiler.h"
+#include "rhi/DynamicResolution.h"
+#include "resource/Mesh.h"
+#include "resource/Material.h"
+#include "scene/CameraNode.h"
+#include "scene/MeshNode.h"
+#include "scene/LightNode.h"
 
 namespace lux::rhi
 {
 #define DIRECTIONAL_LIGHT_MAX_COUNT 4
 #define POINT_LIGHT_MAX_COUNT 64
-#define MATERIAL_MAX_SET 128
+#define MATERIAL_DESCRIPTOR_POOL_SET_COUNT 128
 
 	using namespace lux;
 
@@ -35,6 +48,7 @@ namespace lux::rhi
 		float shadowMapTexelSize;
 		float pcfExtent;
 		float pcfKernelSize;
+		int32_t shadowMapIndex;
 	};
 
 	struct PointLightBuffer
@@ -42,6 +56,7 @@ namespace lux::rhi
 		alignas(16) glm::vec3 position;
 		alignas(16) glm::vec3 color;
 		float radius;
+		int32_t shadowMapIndex;
 	};
 
 	struct LightCountsPushConstant
@@ -62,16 +77,57 @@ namespace lux::rhi
 		const RHI& operator=(const RHI&) = delete;
 		const RHI& operator=(RHI&&) = delete;
 
-		bool Initialize(const Window& window) noexcept;
+		bool Initialize(const Window& window, JobSystem& jobSystem) noexcept;
 		void Render(const scene::CameraNode* camera, const std::vector<scene::MeshNode*> meshes, const std::vector<scene::LightNode*>& lights) noexcept;
 
 		void WaitIdle() noexcept;
 
+		void BeginUploadBatch() noexcept;
+		void EndUploadBatch() noexcept;
+		uint32_t GetUploadSubmitCount() const noexcept;
+
+		float GetLastRecordingTime() const noexcept;
+
+		bool GetIsGpuProfilerSupported() const noexcept;
+		void GetGpuPassStatistics(std::vector<GpuPassStatistics>& statistics) const noexcept;
+		void GetLastGpuPassTimes(std::vector<GpuPassTime>& times) const noexcept;
+		bool ExportGpuProfile(const std::string& filePath) const noexcept;
+
+		bool GetIsDynamicResolutionEnabled() const noexcept;
+		void SetIsDynamicResolutionEnabled(bool isEnabled) noexcept;
+		float GetRenderScale() const noexcept;
+		void SetRenderScale(float newScale) noexcept;
+		VkExtent2D GetRenderExtent() const noexcept;
+		float GetDynamicResolutionTargetFrameTime() const noexcept;
+		void SetDynamicResolutionTargetFrameTime(float newTargetFrameTime) noexcept;
+
+		bool GetIsGpuCullingSupported() const noexcept;
+		bool GetIsGpuCullingEnabled() const noexcept;
+		void SetIsGpuCullingEnabled(bool isEnabled) noexcept;
+		bool GetIsOcclusionCullingEnabled() const noexcept;
+		void SetIsOcclusionCullingEnabled(bool isEnabled) noexcept;
+
+		bool GetIsCpuCullingEnabled() const noexcept;
+		void SetIsCpuCullingEnabled(bool isEnabled) noexcept;
+
+		bool GetIsDepthPrepassEnabled() const noexcept;
+		void SetIsDepthPrepassEnabled(bool isEnabled) noexcept;
+
+		// Set before Initialize, benchmarks compare both modes
+		bool GetIsMeshArenaDeviceLocal() const noexcept;
+		void SetIsMeshArenaDeviceLocal(bool isDeviceLocal) noexcept;
+
+		bool GetIsLightClusteringEnabled() const noexcept;
+		void SetIsLightClusteringEnabled(bool isEnabled) noexcept;
+		const LightClusterStatistics& GetLightClusterStatistics() const noexcept;
+
 		void CreateMaterial(resource::Material& material) noexcept;
+		void UpdateMaterial(const resource::Material& material) noexcept;
 		void DestroyMaterial(resource::Material& material) noexcept;
 
 		void CreateBuffer(const BufferCreateInfo& luxBufferCI, Buffer& buffer) noexcept;
 		void UpdateBuffer(Buffer& buffer, void* newData) noexcept;
+		void UpdateBuffer(Buffer& buffer, const void* newData, VkDeviceSize offset, VkDeviceSize size) noexcept;
 		void DestroyBuffer(Buffer& buffer) noexcept;
 		
 		void CreateImage(const ImageCreateInfo& luxImageCI, Image& image) noexcept;
@@ -82,6 +138,9 @@ namespace lux::rhi
 		void DestroyImage(Image& image) noexcept;
 		void DestroyImage(Image& image, VkSampler* sampler) noexcept;
 
+		bool CreateMeshGeometry(resource::Mesh& mesh, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) noexcept;
+		void DestroyMeshGeometry(resource::Mesh& mesh) noexcept;
+
 		void GenerateCubemapFromHDR(const Image& HDRSource, Image& cubemap) noexcept;
 		void GenerateIBLResources(const Image& cubemapSource, Image& irradiance, Image& prefiltered, Image& BRDFLut) noexcept;
 		void CreateEnvMapDescriptorSet(Image& image) noexcept;
@@ -100,12 +159,23 @@ namespace lux::rhi
 		void SetShadowMappingDepthBiasConstantFactor(float newConstantFactor) noexcept;
 		void SetShadowMappingDepthBiasSlopeFactor(float newSlopeFactor) noexcept;
 
+		void GetMemoryHeapUsages(std::vector<MemoryHeapUsage>& heapUsages) const noexcept;
+		void GetMemoryCategoryUsages(std::vector<MemoryCategoryUsage>& categoryUsages) const noexcept;
+		const std::vector<MemoryAllocationRecord>& GetMemoryAllocationRecords() const noexcept;
+		bool DumpMemoryReport(const std::string& filePath) const noexcept;
+
 		static const uint32_t SWAPCHAIN_MIN_IMAGE_COUNT = 2;
 		ForwardRenderer forward;
 
 	private:
 		bool isInitialized;
 
+		// No surface nor swapchain, the frames are rendered to offscreen images and never presented
+		bool isHeadless;
+
+		// Mesh nodes outside a view frustum are left out of its render queue
+		bool isCpuCullingEnabled;
+
 		VkInstance instance;
 		VkSurfaceKHR surface;
 		VkPhysicalDevice physicalDevice;
@@ -129,23 +199,22 @@ namespace lux::rhi
 		uint32_t swapchainImageCount;
 		std::vector<VkImage> swapchainImages;
 		std::vector<VkImageView> swapchainImageViews;
+		std::vector<MemoryAllocation> offscreenImageAllocations;
 		
 		std::vector<VkSemaphore> presentSemaphores;
 		std::vector<VkSemaphore> acquireSemaphores;
 
 		std::vector<VkFence> fences;
-		VkFence shadowFence;
-		VkEvent shadowEvent;
 
 		VkDescriptorPool imguiDescriptorPool;
-		VkDescriptorPool materialDescriptorPool;
+		std::vector<VkDescriptorPool> materialDescriptorPools;
 
 
 		VkCommandPool commandPool;
 		std::vector<VkCommandBuffer> commandBuffers;
 
-		std::vector<Buffer> directionalLightUniformBuffers;
-		std::vector<Buffer> pointLightUniformBuffers;
+		uint32_t directionalLightUniformOffset;
+		uint32_t pointLightUniformOffset;
 		LightCountsPushConstant lightCountsPushConstant;
 
 		VkCommandPool computeCommandPool;
@@ -156,9 +225,47 @@ namespace lux::rhi
 
 		ShadowMapper shadowMapper;
 
+		MemoryAllocator memoryAllocator;
+
+		UniformRingBuffer uniformRingBuffer;
+
+		MeshArena meshArena;
+
+		InstanceBuffer instanceBuffer;
+
+		DrawCommandBuffer drawCommandBuffer;
+
+		GpuCuller gpuCuller;
+
+		MaterialTable materialTable;
+
+		LightClusterer lightClusterer;
+
+		UploadBatch uploadBatch;
+
+		ParallelRecorder parallelRecorder;
+
+		GpuProfiler gpuProfiler;
+
+		DynamicResolution dynamicResolution;
+
 		void InitInstanceAndDevice(const Window& window) noexcept;
 		void InitSwapchain() noexcept;
+		void CreateSwapchain() noexcept;
+		void CreateOffscreenImages() noexcept;
 		void InitCommandBuffer() noexcept;
+		void InitMemoryAllocator() noexcept;
+		void InitUniformRingBuffer() noexcept;
+		void InitMeshArena() noexcept;
+		void InitInstanceBuffer() noexcept;
+		void InitDrawCommandBuffer() noexcept;
+		void InitGpuCulling() noexcept;
+		void InitMaterialTable() noexcept;
+		void InitLightClusters() noexcept;
+		void InitUploadBatch() noexcept;
+		void InitParallelRecorder(JobSystem& jobSystem) noexcept;
+		void InitGpuProfiler() noexcept;
+		void InitDynamicResolution() noexcept;
 
 		void InitShadowMapperRenderPasses() noexcept;
 		void InitShadowMapperPipelines() noexcept;
@@ -171,7 +278,8 @@ namespace lux::rhi
 		void InitForwardSampler() noexcept;
 		void InitForwardDescriptorPool() noexcept;
 		void InitForwardDescriptorSets() noexcept;
-		void InitForwardUniformBuffers() noexcept;
+
+		void InitHiZPyramid() noexcept;
 
 		void TMP_DestroyIBLResource() noexcept;
 		
@@ -188,28 +296,114 @@ namespace lux::rhi
 
 		void GenerateSSAOKernels() noexcept;
 
-		void RenderShadowMaps(VkCommandBuffer commandBuffer, const std::vector<scene::LightNode*>& lights,const std::vector<scene::MeshNode*>& meshes) noexcept;
-		void RenderForward(VkCommandBuffer commandBuffer, int imageIndex, const scene::CameraNode* camera, const std::vector<scene::MeshNode*>& meshes, const std::vector<scene::LightNode*>& lights) noexcept;
+		void PrepareShadowMaps(const std::vector<scene::LightNode*>& lights, const std::vector<scene::MeshNode*>& meshes) noexcept;
+		void RenderShadowMaps(VkCommandBuffer commandBuffer) noexcept;
+		void RecordDirectionalShadowMap(VkCommandBuffer commandBuffer, uint32_t viewProjUniformOffset, const RenderQueue& viewQueue) const noexcept;
+		void RecordPointShadowMapFace(VkCommandBuffer commandBuffer, uint32_t viewProjUniformOffset, uint32_t face, const RenderQueue& viewQueue) const noexcept;
+		void BuildRenderQueue(RenderQueue& renderQueue, const scene::CameraNode* camera, const std::vector<scene::MeshNode*>& meshes) const noexcept;
+		void BuildShadowRenderQueue(RenderQueue& renderQueue, const std::vector<scene::MeshNode*>& meshes) const noexcept;
+		void BuildRenderBatches(RenderQueue& renderQueue) noexcept;
+		RenderQueue& BuildShadowViewRenderQueue(const glm::mat4& viewProj) noexcept;
+		void PrepareForward(const scene::CameraNode* camera, const std::vector<scene::MeshNode*>& meshes) noexcept;
+		void RenderForward(VkCommandBuffer commandBuffer) noexcept;
+		void AddForwardOpaqueRecordingTasks(VkRenderPass renderPass, uint32_t firstDrawCommand, const std::string& depthPrepassScopeName, const std::string& opaqueScopeName) noexcept;
+		void RecordForwardDepthPrepass(VkCommandBuffer commandBuffer, uint32_t firstDrawCommand) const noexcept;
+		void RecordForwardOpaqueDraws(VkCommandBuffer commandBuffer, uint32_t firstDrawCommand, size_t firstBatch, size_t batchCount) const noexcept;
+		void RecordForwardEnvMap(VkCommandBuffer commandBuffer) const noexcept;
+		void RecordForwardTransparentDraws(VkCommandBuffer commandBuffer) const noexcept;
 		void RenderPostProcess(VkCommandBuffer commandBuffer, int imageIndex, const scene::CameraNode* camera) noexcept;
 
-		void BuildLightUniformBuffers(size_t lightCount) noexcept;
-
 		void GenerateCubemap(const CubeMapCreateInfo& luxCubemapCI, const Image& source, Image& image) noexcept;
 
-		void UpdateForwardUniformBuffers(const scene::CameraNode* camera, const std::vector<resource::Material*>& materials) noexcept;
+		void UpdateForwardUniformBuffers(const scene::CameraNode* camera) noexcept;
+
+		void BuildLightClusterBounds(const glm::mat4& projection, float nearPlane, float farPlane) noexcept;
+		void BuildLightClusters() noexcept;
 
 		void DestroySwapchainRelatedResources() noexcept;
 		void DestroyComputeRelatedResources() noexcept;
 		void DestroyShadowMapper() noexcept;
 		void DestroyForwardRenderer() noexcept;
+		void DestroyMemoryAllocator() noexcept;
+		void DestroyUniformRingBuffer() noexcept;
+		void DestroyMeshArena() noexcept;
+		void DestroyInstanceBuffer() noexcept;
+		void DestroyDrawCommandBuffer() noexcept;
+		void DestroyGpuCulling() noexcept;
+		void DestroyMaterialTable() noexcept;
+		void DestroyLightClusters() noexcept;
+		void DestroyUploadBatch() noexcept;
+		void DestroyParallelRecorder() noexcept;
+		void DestroyGpuProfiler() noexcept;
 
 		void InitImgui() noexcept;
 		void RenderImgui() noexcept;
 
+		bool AllocateMemory(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags memoryProperty, bool isLinear, MemoryCategory category, const std::string& debugName, MemoryAllocation& allocation) noexcept;
+		void FreeMemory(MemoryAllocation& allocation) noexcept;
+		void CreateMemoryAllocationRecord(MemoryCategory category, const std::string& debugName, MemoryAllocation& allocation) noexcept;
+		uint32_t CreateMemoryBlock(uint32_t memoryType, VkDeviceSize size, bool isLinear, bool isDedicated) noexcept;
+		bool SubAllocateMemoryBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) noexcept;
+		void DestroyMemoryBlock(MemoryBlock& block) noexcept;
+
+		void BeginUniformRingBufferFrame() noexcept;
+		uint32_t PushUniformData(const void* data, VkDeviceSize size) noexcept;
+
+		void CreateMeshArenaBuffers(uint32_t vertexCapacity, uint32_t indexCapacity) noexcept;
+		bool AllocateMeshArenaRange(std::vector<MeshArenaRange>& freeRanges, uint32_t count, uint32_t& offset) noexcept;
+		void FreeMeshArenaRange(std::vector<MeshArenaRange>& freeRanges, uint32_t offset, uint32_t count) noexcept;
+		void CompactMeshArena(uint32_t requiredVertexCount, uint32_t requiredIndexCount) noexcept;
+		void BindMeshArena(VkCommandBuffer commandBuffer) const noexcept;
+
+		void CreateInstanceBuffer(size_t frameIndex, uint32_t capacity) noexcept;
+		void BeginInstanceBufferFrame() noexcept;
+		void UploadInstanceBuffer() noexcept;
+		void BindInstanceBuffer(VkCommandBuffer commandBuffer) const noexcept;
+
+		void CreateDrawCommandBuffer(size_t frameIndex, uint32_t capacity) noexcept;
+		void BeginDrawCommandBufferFrame() noexcept;
+		void UploadDrawCommandBuffer() noexcept;
+		void CommandDrawIndexedIndirect(VkCommandBuffer commandBuffer, uint32_t firstDrawCommand, uint32_t drawCount) const noexcept;
+
+		void CreateGpuCullingBuffer(Buffer& buffer, uint32_t& capacity, uint32_t newCapacity, VkDeviceSize elementSize, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryProperty, const std::string& debugName) noexcept;
+		void ReserveGpuCullingBuffer(Buffer& buffer, uint32_t& capacity, uint32_t count, VkDeviceSize elementSize, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryProperty, const std::string& debugName) noexcept;
+		void BeginGpuCullingFrame() noexcept;
+		uint32_t AddGpuCullingView(const RenderQueue& renderQueue, const glm::mat4& viewProj) noexcept;
+		uint32_t AddGpuOcclusionCullingView(const RenderQueue& renderQueue, const glm::mat4& viewProj, uint32_t& lateFirstDrawCommand) noexcept;
+		void UploadGpuCulling() noexcept;
+		void CommandDispatchGpuCulling(VkCommandBuffer commandBuffer, GpuCullingPhase phase) noexcept;
+		void CommandBuildHiZPyramid(VkCommandBuffer commandBuffer) noexcept;
+
+		VkDescriptorPool CreateMaterialDescriptorPool() noexcept;
+		void CreateMaterialTableBuffer(uint32_t capacity) noexcept;
+		void MarkMaterialTableEntryDirty(uint32_t materialIndex) noexcept;
+		void UploadMaterialTable() noexcept;
+
+		VkCommandBuffer RecordUploadCommands() noexcept;
+		void* AllocateUploadStaging(VkDeviceSize size, VkBuffer& stagingBuffer, VkDeviceSize& stagingOffset) noexcept;
+		void FlushUploadBatch() noexcept;
+
+		void BeginParallelRecordingFrame() noexcept;
+		size_t AddRecordingTask(VkRenderPass renderPass, VkFramebuffer framebuffer, std::function<void(VkCommandBuffer)>&& record) noexcept;
+		void ExecuteRecordingTasks() noexcept;
+		void CommandExecuteRecordingTasks(VkCommandBuffer commandBuffer, size_t firstTaskIndex, size_t taskCount) const noexcept;
+		void RunRecordingTasks(uint32_t threadIndex) noexcept;
+
+		void BeginGpuProfilerFrame() noexcept;
+		void CommandResetGpuProfiler(VkCommandBuffer commandBuffer) noexcept;
+		uint32_t AddGpuTimestampScope(const std::string& passName) noexcept;
+		void CommandBeginGpuTimestamp(VkCommandBuffer commandBuffer, uint32_t scopeIndex) const noexcept;
+		void CommandEndGpuTimestamp(VkCommandBuffer commandBuffer, uint32_t scopeIndex) const noexcept;
+		bool GetGpuPassLastTime(const std::string& passName, float& time) const noexcept;
+
+		void UpdateDynamicResolution() noexcept;
+		void UpdateRenderExtent() noexcept;
+		void CommandSetRenderViewport(VkCommandBuffer commandBuffer) const noexcept;
+
 		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const noexcept;
 		VkFormat FindSupportedImageFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags features) const noexcept;
 
-		VkCommandBuffer BeginSingleTimeCommandBuffer() const noexcept;
+		VkCommandBuffer BeginSingleTimeCommandBuffer() noexcept;
 		void EndSingleTimeCommandBuffer(VkCommandBuffer commandBuffer) const noexcept;
 
 		void CommandTransitionImageLayout(VkCommandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t layerCount = 1, uint32_t levelCount = 1, uint32_t baseMipLevel = 0) noexcept;
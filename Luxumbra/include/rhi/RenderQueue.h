@@ -0,0 +1,94 @@
+#ifndef RENDER_QUEUE_H_INCLUDED
+#define RENDER_QUEUE_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <vector>
+
+#include "scene/MeshNode.h"
+
+// Opaque draw key fields, from the most significant: pass | pipeline | material | mesh | depth
+#define RENDER_QUEUE_DEPTH_BITS 24
+#define RENDER_QUEUE_MESH_BITS 18
+#define RENDER_QUEUE_MATERIAL_BITS 16
+#define RENDER_QUEUE_PIPELINE_BITS 4
+#define RENDER_QUEUE_PASS_BITS 2
+
+#define RENDER_QUEUE_DEPTH_SHIFT 0
+#define RENDER_QUEUE_MESH_SHIFT (RENDER_QUEUE_DEPTH_SHIFT + RENDER_QUEUE_DEPTH_BITS)
+#define RENDER_QUEUE_MATERIAL_SHIFT (RENDER_QUEUE_MESH_SHIFT + RENDER_QUEUE_MESH_BITS)
+#define RENDER_QUEUE_PIPELINE_SHIFT (RENDER_QUEUE_MATERIAL_SHIFT + RENDER_QUEUE_MATERIAL_BITS)
+#define RENDER_QUEUE_PASS_SHIFT (RENDER_QUEUE_PIPELINE_SHIFT + RENDER_QUEUE_PIPELINE_BITS)
+
+// Transparent keys blend back to front, the same fields below the pipeline are reordered: inverted depth | material | mesh
+#define RENDER_QUEUE_TRANSPARENT_MESH_SHIFT 0
+#define RENDER_QUEUE_TRANSPARENT_MATERIAL_SHIFT (RENDER_QUEUE_TRANSPARENT_MESH_SHIFT + RENDER_QUEUE_MESH_BITS)
+#define RENDER_QUEUE_TRANSPARENT_DEPTH_SHIFT (RENDER_QUEUE_TRANSPARENT_MATERIAL_SHIFT + RENDER_QUEUE_MATERIAL_BITS)
+
+// 8 bits per radix sort pass
+#define RENDER_QUEUE_RADIX_BITS 8
+#define RENDER_QUEUE_RADIX_SIZE (1 << RENDER_QUEUE_RADIX_BITS)
+#define RENDER_QUEUE_RADIX_PASS_COUNT (64 / RENDER_QUEUE_RADIX_BITS)
+
+namespace lux::rhi
+{
+
+	enum RenderQueuePass : uint64_t
+	{
+		RENDER_QUEUE_PASS_OPAQUE = 0,
+		RENDER_QUEUE_PASS_TRANSPARENT
+	};
+
+	enum RenderQueuePipeline : uint64_t
+	{
+		RENDER_QUEUE_PIPELINE_OPAQUE = 0,
+		RENDER_QUEUE_PIPELINE_TRANSPARENT,
+		RENDER_QUEUE_PIPELINE_ALPHA_TESTED
+	};
+
+	struct RenderQueueItem
+	{
+		uint64_t key;
+		const scene::MeshNode* meshNode;
+	};
+
+	// One instanced draw, the model matrices of its instances start at firstInstance in the instance buffer,
+	// its indirect draw record is the batch index offset by the queue's firstDrawCommand
+	struct RenderBatch
+	{
+		uint64_t key;
+		const scene::MeshNode* meshNode;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	// Rebuilt every frame, the buffers keep their capacity so filling and sorting do not allocate once warm
+	struct RenderQueue
+	{
+		RenderQueue() noexcept;
+		RenderQueue(const RenderQueue&) = delete;
+		RenderQueue(RenderQueue&&) = delete;
+
+		~RenderQueue() noexcept = default;
+
+		const RenderQueue& operator=(const RenderQueue&) = delete;
+		const RenderQueue& operator=(RenderQueue&&) = delete;
+
+		std::vector<RenderQueueItem> items;
+		std::vector<RenderQueueItem> sortScratch;
+
+		// Items of the opaque pass come first once sorted
+		size_t opaqueItemCount;
+
+		std::vector<RenderBatch> batches;
+		size_t opaqueBatchCount;
+
+		// Opaque batches without alpha test come first, the depth prepass draws them
+		size_t depthPrepassBatchCount;
+
+		uint32_t firstDrawCommand;
+	};
+
+} // namespace lux::rhi
+
+#endif // RENDER_QUEUE_H_INCLUDED
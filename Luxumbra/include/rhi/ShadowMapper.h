@@ -3,11 +3,17 @@
 
 #include "Luxumbra.h"
 
-#include "glm\glm.hpp"
+#include <deque>
 
-#include "rhi\GraphicsPipeline.h"
-#include "rhi\Buffer.h"
-#include "rhi\Image.h"
+#include "glm/glm.hpp"
+
+#include "Frustum.h"
+
+#include "rhi/GraphicsPipeline.h"
+#include "rhi/Buffer.h"
+#include "rhi/Image.h"
+#include "rhi/RenderQueue.h"
+#include "scene/LightNode.h"
 
 #define DIRECTIONAL_SHADOW_MAP_TEXTURE_SIZE 2048
 #define POINT_SHADOW_MAP_TEXTURE_SIZE 512
@@ -26,9 +32,12 @@ namespace lux::rhi
 		glm::mat4 proj;
 	};
 
-	struct ShadowMappingModelConstant
+	// Shadow map rendered this frame, the point light faces use 6 consecutive recording tasks
+	struct ShadowMapPass
 	{
-		glm::mat4 model;
+		scene::LightType lightType;
+		int16_t resourceIndex;
+		size_t firstTaskIndex;
 	};
 
 	struct ShadowMapper
@@ -60,16 +69,26 @@ namespace lux::rhi
 		Image dummyDirectionalShadowMap;
 		VkFramebuffer directionalFramebuffer;
 		std::vector<Image> directionalShadowMaps;
-		std::vector<Buffer> directionalUniformBuffers;
-		std::vector<VkDescriptorSet> directionalUniformBufferDescriptorSets;
+		VkDescriptorSet directionalViewProjDescriptorSet;
 
 		Image pointShadowMapIntermediate;
 		Image pointShadowMapDepth;
 		Image dummyPointShadowMap;
 		VkFramebuffer pointFramebuffer;
 		std::vector<Image> pointShadowMaps;
-		std::vector<Buffer> pointUniformBuffers;
-		std::vector<VkDescriptorSet> pointUniformBufferDescriptorSets;
+		VkDescriptorSet pointViewProjDescriptorSet;
+
+		std::vector<ShadowMapPass> passes;
+
+		// Shadow casters sorted once per frame, their world bounds are stored in the same order
+		RenderQueue renderQueue;
+		CullingBounds casterBounds;
+		std::vector<uint32_t> visibleCasterIndices;
+
+		// One queue per light view holding the casters inside its frustum,
+		// a deque keeps the references captured by the recording tasks valid while it grows
+		std::deque<RenderQueue> viewQueues;
+		size_t viewQueueCount;
 	};
 
 } // namespace lux::rhi
@@ -0,0 +1,36 @@
+#ifndef UNIFORM_RING_BUFFER_H_INCLUDED
+#define UNIFORM_RING_BUFFER_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+
+#define UNIFORM_RING_BUFFER_FRAME_SIZE (256 * 1024)
+
+namespace lux::rhi
+{
+
+	struct UniformRingBuffer
+	{
+		UniformRingBuffer() noexcept;
+		UniformRingBuffer(const UniformRingBuffer&) = delete;
+		UniformRingBuffer(UniformRingBuffer&&) = delete;
+
+		~UniformRingBuffer() noexcept = default;
+
+		const UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+		const UniformRingBuffer& operator=(UniformRingBuffer&&) = delete;
+
+		Buffer buffer;
+		uint8_t* mappedData;
+
+		VkDeviceSize alignment;
+		VkDeviceSize frameSize;
+		VkDeviceSize frameOffset;
+		VkDeviceSize head;
+	};
+
+} // namespace lux::rhi
+
+#endif // UNIFORM_RING_BUFFER_H_INCLUDED
@@ -0,0 +1,47 @@
+#ifndef UPLOAD_BATCH_H_INCLUDED
+#define UPLOAD_BATCH_H_INCLUDED
+
+#include "Luxumbra.h"
+
+#include <vector>
+
+#include "rhi/LuxVkImpl.h"
+#include "rhi/Buffer.h"
+
+#define UPLOAD_STAGING_ARENA_SIZE (32 * 1024 * 1024)
+#define UPLOAD_STAGING_ALIGNMENT 16
+
+namespace lux::rhi
+{
+
+	struct UploadBatch
+	{
+		UploadBatch() noexcept;
+		UploadBatch(const UploadBatch&) = delete;
+		UploadBatch(UploadBatch&&) = delete;
+
+		~UploadBatch() noexcept = default;
+
+		const UploadBatch& operator=(const UploadBatch&) = delete;
+		const UploadBatch& operator=(UploadBatch&&) = delete;
+
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+
+		// Nesting depth of BeginUploadBatch, the batch is submitted when it goes back to 0
+		uint32_t depth;
+		bool isRecording;
+		uint32_t submitCount;
+
+		// Linear staging memory, rewound after each submission
+		Buffer stagingArena;
+		uint8_t* stagingData;
+		VkDeviceSize stagingOffset;
+
+		// Uploads bigger than the arena, released after the submission
+		std::vector<Buffer> dedicatedStagingBuffers;
+	};
+
+} // namespace lux::rhi
+
+#endif // UPLOAD_BATCH_H_INCLUDED
@@ -3,8 +3,9 @@
 
 #include "Luxumbra.h"
 
-#include "scene\Node.h"
+#include "scene/Node.h"
 #include "Window.h"
+#include "Frustum.h"
 
 namespace lux::scene
 {
@@ -27,6 +28,7 @@ namespace lux::scene
 		glm::mat4 GetPerspectiveProjectionTransform() const noexcept;
 		float GetNearDistance() const noexcept;
 		float GetFarDistance() const noexcept;
+		Frustum GetFrustum() const noexcept;
 
 		
 
@@ -5,9 +5,9 @@
 
 #include <vector>
 
-#include "scene\Node.h"
-#include "scene\MeshNode.h"
-#include "rhi\Image.h"
+#include "scene/Node.h"
+#include "scene/MeshNode.h"
+#include "rhi/Image.h"
 
 namespace lux::scene
 {
@@ -3,9 +3,9 @@
 
 #include "Luxumbra.h"
 
-#include "scene\Node.h"
-#include "resource\Mesh.h"
-#include "resource\Material.h"
+#include "scene/Node.h"
+#include "resource/Mesh.h"
+#include "resource/Material.h"
 
 namespace lux::scene
 {
@@ -32,10 +32,18 @@ namespace lux::scene
 		bool GetIsCastingShadow() const noexcept;
 		void SetIsCastingShadow(bool newIsCastingShadow) noexcept;
 
+		// Caches the world transform and bounds once per frame, renderers read the cached values
+		void UpdateWorldTransform() noexcept;
+		const glm::mat4& GetCachedWorldTransform() const noexcept;
+		const AABB& GetWorldAABB() const noexcept;
+
 	private:
 		std::shared_ptr<resource::Mesh> mesh;
 		std::shared_ptr<resource::Material> material;
 		bool isCastingShadow;
+
+		glm::mat4 worldTransform;
+		AABB worldAABB;
 	};
 
 } // namespace lux::scene
@@ -3,8 +3,8 @@
 
 #include "Luxumbra.h"
 
-#include "glm\glm.hpp"
-#include "glm\gtx\quaternion.hpp"
+#include "glm/glm.hpp"
+#include "glm/gtx/quaternion.hpp"
 
 namespace lux::scene
 {
@@ -39,12 +39,21 @@ namespace lux::scene
 		void SetWorldPosition(glm::vec3 newPosition) noexcept;
 		void SetWorldRotation(glm::quat newRotation) noexcept;
 
+		glm::vec3 GetAngularVelocity() const noexcept;
+		void SetAngularVelocity(glm::vec3 newAngularVelocity) noexcept;
+
+		// Only touches the node's own local state, nodes can be updated concurrently
+		void Update(float deltaTime) noexcept;
+
 	private:
 		Node* parent;
 
 		glm::vec3 position;
 		glm::vec3 rotation;
 		glm::vec3 scale;
+
+		// Radians per second applied to the local rotation
+		glm::vec3 angularVelocity;
 	};
 
 } // namespace lux::scene
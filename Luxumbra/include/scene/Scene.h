@@ -6,11 +6,14 @@
 #include <vector>
 
 #include "Window.h"
-#include "resource\ResourceManager.h"
-#include "scene\Node.h"
-#include "scene\CameraNode.h"
-#include "scene\MeshNode.h"
-#include "scene\LightNode.h"
+#include "JobSystem.h"
+#include "resource/ResourceManager.h"
+#include "scene/Node.h"
+#include "scene/CameraNode.h"
+#include "scene/MeshNode.h"
+#include "scene/LightNode.h"
+
+#define SCENE_UPDATE_BATCH_SIZE 256
 
 namespace lux::scene
 {
@@ -28,12 +31,20 @@ namespace lux::scene
 		const Scene& operator=(Scene&&) = delete;
 
 		void Initialize(const Window& window, rhi::RHI& rhi, resource::ResourceManager& resourceManager) noexcept;
+		void Update(JobSystem& jobSystem, float deltaTime) noexcept;
 
 		CameraNode* GetCurrentCamera() const noexcept;
 		LightNode* GetShadowCastingDirectional() const noexcept;
 		const std::vector<MeshNode*>& GetMeshNodes() const noexcept;
 		const std::vector<LightNode*>& GetLightNodes() const noexcept;
 
+		bool GetIsDepthPrepassEnabled() const noexcept;
+		void SetIsDepthPrepassEnabled(bool isEnabled) noexcept;
+
+		// Local rotations of every node in creation order, the animated nodes turn a little more every update
+		void GetNodeRotations(std::vector<glm::vec3>& rotations) const noexcept;
+		void SetNodeRotations(const std::vector<glm::vec3>& rotations) noexcept;
+
 		Node* AddNode(Node* parent, glm::vec3 position, glm::vec3 rotation, bool isWorldPosition) noexcept;
 		CameraNode* AddCameraNode(Node* parent, glm::vec3 position, glm::vec3 rotation, bool isWorldPosition, float fovy, float nearDist, float farDist, bool makeCurrentCamera) noexcept;
 		MeshNode* AddMeshNode(Node* parent, glm::vec3 position, glm::vec3 rotation, bool isWorldPosition, const std::string& meshFileName, const std::string& materialName) noexcept;
@@ -49,6 +60,9 @@ namespace lux::scene
 		std::vector<MeshNode*> meshNodes;
 		std::vector<LightNode*> lightNodes;
 		CameraNode* currentCamera;
+
+		// Worth it when the opaque meshes overlap a lot on screen
+		bool isDepthPrepassEnabled;
 	};
 
 } // namespace lux::scene
@@ -12,6 +12,9 @@ namespace lux::utility
 	std::vector<char> ReadFile(const std::string& filePath) noexcept;
 	float Lerp(float a, float b, float t) noexcept;
 
+	// Nearest rank percentile, p in [0, 1] of samples sorted in ascending order
+	float Percentile(const std::vector<float>& sortedSamples, float p) noexcept;
+
 } // namespace lux::utility
 
 #endif // UTILITY_H_INCLUDED
\ No newline at end of file
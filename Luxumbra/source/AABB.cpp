@@ -12,7 +12,7 @@ namespace lux
 	AABB& AABB::Transform(const glm::mat4& transform) noexcept
 	{
 		glm::vec3 oldMin = min, oldMax = max;
-		glm::vec3 translation = transform[3].xyz;
+		glm::vec3 translation = glm::vec3(transform[3]);
 
 		glm::mat3 rot = glm::mat3(transform);
 		rot[2] *= -1.f;
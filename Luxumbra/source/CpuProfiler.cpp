@@ -0,0 +1,198 @@
+#include "CpuProfiler.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace lux
+{
+
+	struct CpuProfilerThreadBuffer
+	{
+		std::array<CpuProfileEvent, CPU_PROFILER_EVENT_BUFFER_SIZE> events;
+		std::atomic<uint64_t> writeIndex;
+		std::atomic<const char*> name;
+	};
+
+	static const std::chrono::steady_clock::time_point profilerStartTime = std::chrono::steady_clock::now();
+
+	static std::array<CpuProfilerThreadBuffer, CPU_PROFILER_MAX_THREAD_COUNT> threadBuffers;
+	static std::atomic<uint32_t> threadBufferCount(0);
+
+	static std::atomic<int64_t> lastFrameStart(0);
+	static std::atomic<int64_t> currentFrameStart(0);
+
+	static thread_local CpuProfilerThreadBuffer* currentThreadBuffer = nullptr;
+	static thread_local bool isCurrentThreadRegistered = false;
+	static thread_local uint32_t currentDepth = 0;
+
+	static CpuProfilerThreadBuffer* GetCurrentThreadBuffer() noexcept
+	{
+		if (!isCurrentThreadRegistered)
+		{
+			isCurrentThreadRegistered = true;
+
+			// Threads past CPU_PROFILER_MAX_THREAD_COUNT are not profiled
+			uint32_t threadIndex = threadBufferCount.fetch_add(1);
+
+			if (threadIndex < CPU_PROFILER_MAX_THREAD_COUNT)
+				currentThreadBuffer = &threadBuffers[TO_SIZE_T(threadIndex)];
+		}
+
+		return currentThreadBuffer;
+	}
+
+	void CpuProfiler::SetCurrentThreadName(const char* name) noexcept
+	{
+		CpuProfilerThreadBuffer* threadBuffer = GetCurrentThreadBuffer();
+
+		if (threadBuffer)
+			threadBuffer->name.store(name, std::memory_order_release);
+	}
+
+	void CpuProfiler::BeginFrame() noexcept
+	{
+		int64_t now = GetTime();
+
+		lastFrameStart.store(currentFrameStart.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		currentFrameStart.store(now, std::memory_order_relaxed);
+	}
+
+	int64_t CpuProfiler::GetTime() noexcept
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerStartTime).count();
+	}
+
+	uint32_t CpuProfiler::EnterScope() noexcept
+	{
+		return currentDepth++;
+	}
+
+	void CpuProfiler::LeaveScope(const char* name, int64_t start, uint32_t depth) noexcept
+	{
+		currentDepth--;
+
+		CpuProfilerThreadBuffer* threadBuffer = GetCurrentThreadBuffer();
+
+		if (!threadBuffer)
+			return;
+
+		// Single writer, the index is published once the event is complete
+		uint64_t writeIndex = threadBuffer->writeIndex.load(std::memory_order_relaxed);
+
+		CpuProfileEvent& event = threadBuffer->events[writeIndex % CPU_PROFILER_EVENT_BUFFER_SIZE];
+		event.name = name;
+		event.start = start;
+		event.end = GetTime();
+		event.depth = depth;
+
+		threadBuffer->writeIndex.store(writeIndex + 1, std::memory_order_release);
+	}
+
+	void CpuProfiler::GetLastFrameEvents(std::vector<CpuProfileThreadEvents>& threads, int64_t& frameStart, int64_t& frameEnd) noexcept
+	{
+		frameStart = lastFrameStart.load(std::memory_order_relaxed);
+		frameEnd = currentFrameStart.load(std::memory_order_relaxed);
+
+		uint32_t threadCount = std::min(threadBufferCount.load(std::memory_order_acquire), TO_UINT32_T(CPU_PROFILER_MAX_THREAD_COUNT));
+
+		threads.resize(TO_SIZE_T(threadCount));
+
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			CpuProfileThreadEvents& thread = threads[TO_SIZE_T(i)];
+			thread.threadIndex = i;
+			thread.threadName = threadBuffers[TO_SIZE_T(i)].name.load(std::memory_order_acquire);
+
+			ReadThreadEvents(i, frameStart, frameEnd, thread.events);
+		}
+	}
+
+	bool CpuProfiler::ExportChromeTrace(const std::string& filePath) noexcept
+	{
+		std::ofstream file(filePath, std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to open Chrome trace file ", filePath);
+			return false;
+		}
+
+		uint32_t threadCount = std::min(threadBufferCount.load(std::memory_order_acquire), TO_UINT32_T(CPU_PROFILER_MAX_THREAD_COUNT));
+
+		std::vector<CpuProfileEvent> events;
+		bool isFirstEvent = true;
+
+		file << "{\n\t\"traceEvents\": [";
+
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			const char* threadName = threadBuffers[TO_SIZE_T(i)].name.load(std::memory_order_acquire);
+
+			file << (isFirstEvent ? "\n" : ",\n");
+			file << "\t\t{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << i
+				<< ", \"args\": { \"name\": \"" << (threadName ? threadName : "Thread") << ' ' << i << "\" } }";
+			isFirstEvent = false;
+
+			ReadThreadEvents(i, INT64_MIN, INT64_MAX, events);
+
+			// Chrome trace timestamps are in microseconds
+			for (const CpuProfileEvent& event : events)
+			{
+				file << ",\n\t\t{ \"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << i
+					<< ", \"ts\": " << static_cast<double>(event.start) / 1000.0
+					<< ", \"dur\": " << static_cast<double>(event.end - event.start) / 1000.0 << " }";
+			}
+		}
+
+		file << "\n\t]\n}\n";
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Chrome trace exported to ", filePath);
+
+		return true;
+	}
+
+	void CpuProfiler::ReadThreadEvents(uint32_t threadIndex, int64_t minStart, int64_t maxStart, std::vector<CpuProfileEvent>& events) noexcept
+	{
+		const CpuProfilerThreadBuffer& threadBuffer = threadBuffers[TO_SIZE_T(threadIndex)];
+
+		events.clear();
+
+		uint64_t endIndex = threadBuffer.writeIndex.load(std::memory_order_acquire);
+		uint64_t beginIndex = endIndex > CPU_PROFILER_EVENT_BUFFER_SIZE ? endIndex - CPU_PROFILER_EVENT_BUFFER_SIZE : 0;
+
+		std::vector<CpuProfileEvent> copiedEvents(TO_SIZE_T(endIndex - beginIndex));
+
+		for (uint64_t i = beginIndex; i < endIndex; i++)
+			copiedEvents[TO_SIZE_T(i - beginIndex)] = threadBuffer.events[i % CPU_PROFILER_EVENT_BUFFER_SIZE];
+
+		// The owner kept writing during the copy, the oldest slots may hold newer events now. The slot of the next
+		// event may already be half written
+		uint64_t newEndIndex = threadBuffer.writeIndex.load(std::memory_order_acquire);
+		uint64_t firstValidIndex = newEndIndex >= CPU_PROFILER_EVENT_BUFFER_SIZE ? newEndIndex - CPU_PROFILER_EVENT_BUFFER_SIZE + 1 : 0;
+
+		for (uint64_t i = std::max(beginIndex, firstValidIndex); i < endIndex; i++)
+		{
+			const CpuProfileEvent& event = copiedEvents[TO_SIZE_T(i - beginIndex)];
+
+			if (event.start >= minStart && event.start < maxStart)
+				events.push_back(event);
+		}
+	}
+
+	CpuProfileScope::CpuProfileScope(const char* name) noexcept
+		: name(name), start(CpuProfiler::GetTime()), depth(CpuProfiler::EnterScope())
+	{
+
+	}
+
+	CpuProfileScope::~CpuProfileScope() noexcept
+	{
+		CpuProfiler::LeaveScope(name, start, depth);
+	}
+
+} // namespace lux
@@ -1,19 +1,80 @@
 #include "Engine.h"
 
 #include <set>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <cstdio>
 
-#include "imgui\imgui.h"
-#include "imgui\imgui_impl_glfw.h"
-#include "imgui\imgui_impl_vulkan.h"
+#include "Logger.h"
+#include "CpuProfiler.h"
+#include "Frustum.h"
+#include "utility/Utility.h"
 
-#include "glm\gtc\type_ptr.hpp"
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_vulkan.h"
+
+#include "glm/gtc/type_ptr.hpp"
 
 namespace lux
 {
 
+	// Offsets from the start pose of the scene camera, positions in its local frame and rotations in degrees
+	struct BenchmarkCameraKey
+	{
+		glm::vec3 positionOffset;
+		glm::vec3 rotationOffset;
+	};
+
+	// Keys are evenly spaced over the measured frames, the path ends where it started
+	static const std::array<BenchmarkCameraKey, 5> benchmarkCameraPath = { {
+		{ glm::vec3(0.f), glm::vec3(0.f) },
+		{ glm::vec3(0.f, 0.f, -1.5f), glm::vec3(0.f, 20.f, 0.f) },
+		{ glm::vec3(1.f, 0.5f, -2.5f), glm::vec3(-10.f, -15.f, 0.f) },
+		{ glm::vec3(-1.f, 0.25f, -1.f), glm::vec3(5.f, -30.f, 0.f) },
+		{ glm::vec3(0.f), glm::vec3(0.f) }
+	} };
+
+	static const std::array<const char*, TO_SIZE_T(SCENE::SCENE_COUNT)> benchmarkSceneNames = {
+		"Sphere", "PostProcess", "PBR Models", "PBR Materials", "Transparent", "Directional Shadow", "Stress"
+	};
+
+	static void ComputeBenchmarkStatistics(std::vector<float>& samples, BenchmarkStatistics& statistics) noexcept
+	{
+		statistics = { 0.f, 0.f, 0.f, 0.f, 0.f };
+
+		size_t sampleCount = samples.size();
+
+		if (sampleCount == 0)
+			return;
+
+		std::sort(samples.begin(), samples.end());
+
+		float sum = 0.f;
+		for (float sample : samples)
+			sum += sample;
+
+		statistics.average = sum / TO_FLOAT(sampleCount);
+		statistics.p50 = utility::Percentile(samples, 0.50f);
+		statistics.p95 = utility::Percentile(samples, 0.95f);
+		statistics.p99 = utility::Percentile(samples, 0.99f);
+		statistics.max = samples.back();
+	}
+
+	static void WriteBenchmarkStatistics(std::ofstream& file, const BenchmarkStatistics& statistics) noexcept
+	{
+		file << "\"average\": " << statistics.average << ", \"p50\": " << statistics.p50 << ", \"p95\": " << statistics.p95
+			<< ", \"p99\": " << statistics.p99 << ", \"max\": " << statistics.max;
+	}
+
 	Engine::Engine() noexcept
-		: isInitialized(false), window(), rhi(), scenes(), resourceManager(rhi),
-		currentScene(0), drawGUI(true)
+		: isInitialized(false), window(), jobSystem(), rhi(), scenes(), resourceManager(rhi),
+		currentScene(0), sceneBuildStartTime(), frameTimes(), frameTimeIndex(0), lastSceneUpdateTime(0.f),
+		jobBenchmarkThreadCount(0), jobBenchmarkFrame(0), jobThreadCountBeforeBenchmark(0), jobBenchmarkCPUTimeSum(0.f), jobBenchmarkFrameTimeSum(0.f), jobBenchmarkResults(0),
+		cpuProfilerThreads(0), cpuProfilerFrameStart(0), cpuProfilerFrameEnd(0), isCpuProfilerPaused(false),
+		drawGUI(true)
 	{
 
 	}
@@ -21,16 +82,41 @@ namespace lux
 	Engine::~Engine()
 	{
 		rhi.WaitIdle();
+
+#ifdef DUMP_MEMORY_REPORT_AT_EXIT
+		if (isInitialized)
+			rhi.DumpMemoryReport(MEMORY_REPORT_FILE_PATH);
+#endif // DUMP_MEMORY_REPORT_AT_EXIT
 	}
 
-	bool Engine::Initialize(uint32_t windowWidth, uint32_t windowHeight) noexcept
+	bool Engine::Initialize(uint32_t windowWidth, uint32_t windowHeight, bool isHeadless, bool isMeshArenaDeviceLocal) noexcept
 	{
-		if (!window.Initialize(windowWidth, windowHeight))
+		CPU_PROFILE_THREAD_NAME("Main Thread");
+
+#ifndef _WIN32
+		// The window surface is only created through Win32, other platforms render offscreen
+		if (!isHeadless)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Windowed rendering is only supported on Windows, run with --headless");
 			return false;
+		}
+#endif // !_WIN32
+
+		bool isWindowInitialized = isHeadless ? window.InitializeHeadless(windowWidth, windowHeight) : window.Initialize(windowWidth, windowHeight);
+
+		if (!isWindowInitialized)
+			return false;
+
+		jobSystem.Initialize();
+
+		rhi.SetIsMeshArenaDeviceLocal(isMeshArenaDeviceLocal);
 
-		if (!rhi.Initialize(window))
+		if (!rhi.Initialize(window, jobSystem))
 			return false;
 
+		// Everything uploaded until Run shares a single submission
+		sceneBuildStartTime = std::chrono::steady_clock::now();
+		rhi.BeginUploadBatch();
 
 		resourceManager.Initialize();
 
@@ -47,16 +133,24 @@ namespace lux
 	{
 		currentScene = 0;
 
+		EndSceneBuild();
+
 		bool inputExit = false;
 
 		while (!window.ShouldClose() && !inputExit)
 		{
+			CPU_PROFILE_FRAME();
+			CPU_PROFILE_SCOPE("Engine::Run");
+
 			window.PollEvents();
 
 			inputExit = window.GetActionsStatus(Action::EXIT);
 
 			float deltaTime = window.GetDeltaTime();
 
+			frameTimes[frameTimeIndex] = deltaTime * 1000.f;
+			frameTimeIndex = (frameTimeIndex + 1) % FRAME_TIME_HISTORY_SIZE;
+
 			scene::Scene& scene = scenes[TO_SIZE_T(currentScene)];
 
 			if (window.GetHasFocus())
@@ -65,9 +159,389 @@ namespace lux
 
 				DrawImgui(scene, deltaTime);
 
+				std::chrono::steady_clock::time_point sceneUpdateStartTime = std::chrono::steady_clock::now();
+
+				scene.Update(jobSystem, deltaTime);
+
+				std::chrono::duration<float, std::milli> sceneUpdateTime = std::chrono::steady_clock::now() - sceneUpdateStartTime;
+				lastSceneUpdateTime = sceneUpdateTime.count();
+
+				rhi.SetIsDepthPrepassEnabled(scene.GetIsDepthPrepassEnabled());
 				rhi.Render(scene.GetCurrentCamera(), scene.GetMeshNodes(), scene.GetLightNodes());
+
+				if (jobBenchmarkThreadCount != 0)
+					UpdateJobBenchmark(deltaTime);
+			}
+		}
+	}
+
+	void Engine::RunHeadless(SCENE sceneIndex, uint32_t frameCount) noexcept
+	{
+		currentScene = TO_INT32_T(sceneIndex);
+
+		EndSceneBuild();
+
+		scene::Scene& scene = scenes[TO_SIZE_T(currentScene)];
+
+		rhi.SetIsDepthPrepassEnabled(scene.GetIsDepthPrepassEnabled());
+
+		// Headless runs are compared between builds, the render scale must not follow the GPU time
+		bool wasDynamicResolutionEnabled = rhi.GetIsDynamicResolutionEnabled();
+		float renderScale = rhi.GetRenderScale();
+
+		rhi.SetIsDynamicResolutionEnabled(false);
+		rhi.SetRenderScale(DYNAMIC_RESOLUTION_MAX_SCALE);
+
+		std::chrono::steady_clock::time_point runStartTime = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < frameCount; i++)
+		{
+			CPU_PROFILE_FRAME();
+			CPU_PROFILE_SCOPE("Engine::RunHeadless");
+
+			scene.Update(jobSystem, HEADLESS_DELTA_TIME);
+
+			rhi.Render(scene.GetCurrentCamera(), scene.GetMeshNodes(), scene.GetLightNodes());
+		}
+
+		rhi.WaitIdle();
+
+		std::chrono::duration<float, std::milli> runTime = std::chrono::steady_clock::now() - runStartTime;
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Headless run of scene ", currentScene, ": ", frameCount, " frames in ", runTime.count(), " ms, ",
+			frameCount > 0 ? runTime.count() / TO_FLOAT(frameCount) : 0.f, " ms per frame");
+
+		rhi.SetRenderScale(renderScale);
+		rhi.SetIsDynamicResolutionEnabled(wasDynamicResolutionEnabled);
+	}
+
+	void Engine::RunBenchmark(uint32_t frameCount) noexcept
+	{
+		EndSceneBuild();
+
+		frameCount = std::max(frameCount, 1u);
+
+		// A render scale that follows the GPU time would make two runs incomparable
+		bool wasDynamicResolutionEnabled = rhi.GetIsDynamicResolutionEnabled();
+		float renderScale = rhi.GetRenderScale();
+
+		rhi.SetIsDynamicResolutionEnabled(false);
+		rhi.SetRenderScale(DYNAMIC_RESOLUTION_MAX_SCALE);
+
+		std::vector<BenchmarkSceneResult> results;
+		results.reserve(scenes.size());
+
+		for (size_t i = 0; i < scenes.size(); i++)
+		{
+			currentScene = TO_INT32_T(i);
+
+			// Every scene is measured without then with the depth prepass, whatever its own setting. Both halves start
+			// from the same pose of the animated nodes
+			scene::Scene& scene = scenes[i];
+			bool wasDepthPrepassEnabled = scene.GetIsDepthPrepassEnabled();
+
+			std::vector<glm::vec3> nodeRotations;
+			scene.GetNodeRotations(nodeRotations);
+
+			for (bool isDepthPrepassEnabled : { false, true })
+			{
+				scene.SetNodeRotations(nodeRotations);
+				scene.SetIsDepthPrepassEnabled(isDepthPrepassEnabled);
+
+				BenchmarkSceneResult result;
+
+				if (!RunSceneBenchmark(static_cast<SCENE>(i), frameCount, result))
+					break;
+
+				Logger::Log(LogLevel::LOG_LEVEL_INFO, "Benchmark of ", result.sceneName, " scene", isDepthPrepassEnabled ? " with depth prepass" : "", ": frame time p50 ", result.frameTime.p50,
+					" ms, p95 ", result.frameTime.p95, " ms, p99 ", result.frameTime.p99, " ms");
+
+				results.push_back(std::move(result));
+			}
+
+			scene.SetIsDepthPrepassEnabled(wasDepthPrepassEnabled);
+		}
+
+		ExportBenchmark(results, frameCount, BENCHMARK_FILE_PATH);
+
+		rhi.SetRenderScale(renderScale);
+		rhi.SetIsDynamicResolutionEnabled(wasDynamicResolutionEnabled);
+	}
+
+	bool Engine::RunSceneBenchmark(SCENE sceneIndex, uint32_t frameCount, BenchmarkSceneResult& result) noexcept
+	{
+		scene::Scene& scene = scenes[TO_SIZE_T(sceneIndex)];
+		scene::CameraNode* camera = scene.GetCurrentCamera();
+
+		result.sceneName = benchmarkSceneNames[TO_SIZE_T(sceneIndex)];
+		result.isDepthPrepassEnabled = scene.GetIsDepthPrepassEnabled();
+
+		if (camera == nullptr)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_WARNING, "Benchmark skipped the ", result.sceneName, " scene, it has no camera");
+			return false;
+		}
+
+		glm::vec3 startPosition = camera->GetLocalPosition();
+		glm::vec3 startRotation = camera->GetLocalRotation();
+		glm::quat startOrientation(startRotation);
+
+		std::vector<float> frameTimes;
+		std::vector<float> sceneUpdateTimes;
+		frameTimes.reserve(TO_SIZE_T(frameCount));
+		sceneUpdateTimes.reserve(TO_SIZE_T(frameCount));
+
+		// Passes keep the order they are first read back in, which is their submission order
+		std::vector<std::string> passNames;
+		std::vector<std::vector<float>> passSamples;
+		std::map<std::string, size_t> passIndices;
+		std::vector<rhi::GpuPassTime> gpuPassTimes;
+
+		float pathLength = TO_FLOAT(benchmarkCameraPath.size() - 1);
+
+		rhi.SetIsDepthPrepassEnabled(result.isDepthPrepassEnabled);
+
+		for (uint32_t i = 0; i < BENCHMARK_WARMUP_FRAME_COUNT + frameCount; i++)
+		{
+			CPU_PROFILE_FRAME();
+			CPU_PROFILE_SCOPE("Engine::RunSceneBenchmark");
+
+			bool isMeasured = i >= BENCHMARK_WARMUP_FRAME_COUNT;
+
+			// The camera holds its start pose during the warm-up
+			float pathTime = 0.f;
+			if (isMeasured && frameCount > 1)
+				pathTime = TO_FLOAT(i - BENCHMARK_WARMUP_FRAME_COUNT) / TO_FLOAT(frameCount - 1) * pathLength;
+
+			size_t keyIndex = std::min(TO_SIZE_T(pathTime), benchmarkCameraPath.size() - 2);
+			float keyBlend = pathTime - TO_FLOAT(keyIndex);
+
+			const BenchmarkCameraKey& fromKey = benchmarkCameraPath[keyIndex];
+			const BenchmarkCameraKey& toKey = benchmarkCameraPath[keyIndex + 1];
+
+			glm::vec3 positionOffset = glm::mix(fromKey.positionOffset, toKey.positionOffset, keyBlend);
+			glm::vec3 rotationOffset = glm::mix(fromKey.rotationOffset, toKey.rotationOffset, keyBlend);
+
+			camera->SetLocalPosition(startPosition + glm::rotate(startOrientation, positionOffset));
+			camera->SetLocalRotation(startRotation + glm::radians(rotationOffset));
+
+			std::chrono::steady_clock::time_point frameStartTime = std::chrono::steady_clock::now();
+
+			scene.Update(jobSystem, HEADLESS_DELTA_TIME);
+
+			std::chrono::steady_clock::time_point sceneUpdateEndTime = std::chrono::steady_clock::now();
+
+			rhi.Render(scene.GetCurrentCamera(), scene.GetMeshNodes(), scene.GetLightNodes());
+
+			std::chrono::steady_clock::time_point frameEndTime = std::chrono::steady_clock::now();
+
+			if (!isMeasured)
+				continue;
+
+			std::chrono::duration<float, std::milli> frameTime = frameEndTime - frameStartTime;
+			std::chrono::duration<float, std::milli> sceneUpdateTime = sceneUpdateEndTime - frameStartTime;
+
+			frameTimes.push_back(frameTime.count());
+			sceneUpdateTimes.push_back(sceneUpdateTime.count());
+
+			// GPU times lag MAX_FRAMES_IN_FLIGHT frames behind, the first ones belong to the end of the warm-up
+			rhi.GetLastGpuPassTimes(gpuPassTimes);
+
+			for (const rhi::GpuPassTime& passTime : gpuPassTimes)
+			{
+				std::map<std::string, size_t>::const_iterator it = passIndices.find(passTime.name);
+				size_t passIndex;
+
+				if (it == passIndices.cend())
+				{
+					passIndex = passNames.size();
+					passNames.push_back(passTime.name);
+					passSamples.emplace_back();
+					passSamples.back().reserve(TO_SIZE_T(frameCount));
+					passIndices[passTime.name] = passIndex;
+				}
+				else
+					passIndex = it->second;
+
+				passSamples[passIndex].push_back(passTime.time);
+			}
+		}
+
+		rhi.WaitIdle();
+
+		camera->SetLocalPosition(startPosition);
+		camera->SetLocalRotation(startRotation);
+
+		ComputeBenchmarkStatistics(frameTimes, result.frameTime);
+		ComputeBenchmarkStatistics(sceneUpdateTimes, result.sceneUpdateTime);
+
+		result.gpuPasses.resize(passNames.size());
+
+		for (size_t i = 0; i < passNames.size(); i++)
+		{
+			BenchmarkPassResult& passResult = result.gpuPasses[i];
+			passResult.name = passNames[i];
+			passResult.sampleCount = passSamples[i].size();
+
+			ComputeBenchmarkStatistics(passSamples[i], passResult.statistics);
+		}
+
+		return true;
+	}
+
+	bool Engine::ExportBenchmark(const std::vector<BenchmarkSceneResult>& results, uint32_t frameCount, const std::string& filePath) const noexcept
+	{
+		std::ofstream file(filePath, std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to open benchmark file ", filePath);
+			return false;
+		}
+
+		VkExtent2D renderExtent = rhi.GetRenderExtent();
+
+		file << "{\n\t\"frameCount\": " << frameCount
+			<< ",\n\t\"warmupFrameCount\": " << BENCHMARK_WARMUP_FRAME_COUNT
+			<< ",\n\t\"deltaTime\": " << HEADLESS_DELTA_TIME
+			<< ",\n\t\"renderWidth\": " << renderExtent.width
+			<< ",\n\t\"renderHeight\": " << renderExtent.height
+			<< ",\n\t\"jobThreadCount\": " << jobSystem.GetThreadCount()
+			<< ",\n\t\"meshMemory\": \"" << (rhi.GetIsMeshArenaDeviceLocal() ? "deviceLocal" : "hostVisible") << "\""
+			<< ",\n\t\"scenes\": [";
+
+		for (size_t i = 0, sceneCount = results.size(); i < sceneCount; i++)
+		{
+			const BenchmarkSceneResult& result = results[i];
+
+			file << (i == 0 ? "\n" : ",\n");
+			file << "\t\t{\n\t\t\t\"name\": \"" << result.sceneName << "\",\n\t\t\t\"depthPrepass\": " << (result.isDepthPrepassEnabled ? "true" : "false")
+				<< ",\n\t\t\t\"frameTime\": { ";
+			WriteBenchmarkStatistics(file, result.frameTime);
+			file << " },\n\t\t\t\"sceneUpdateTime\": { ";
+			WriteBenchmarkStatistics(file, result.sceneUpdateTime);
+			file << " },\n\t\t\t\"gpuPasses\": [";
+
+			for (size_t j = 0, passCount = result.gpuPasses.size(); j < passCount; j++)
+			{
+				const BenchmarkPassResult& passResult = result.gpuPasses[j];
+
+				file << (j == 0 ? "\n" : ",\n");
+				file << "\t\t\t\t{ \"name\": \"" << passResult.name << "\", \"samples\": " << passResult.sampleCount << ", ";
+				WriteBenchmarkStatistics(file, passResult.statistics);
+				file << " }";
+			}
+
+			file << "\n\t\t\t]\n\t\t}";
+		}
+
+		file << "\n\t]\n}\n";
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Benchmark exported to ", filePath);
+
+		return true;
+	}
+
+	void Engine::RunCullingBenchmark() noexcept
+	{
+		static const std::array<size_t, 2> boxCounts = { 10000, 100000 };
+
+		// Camera at the origin looking down -Z, the boxes fill a cube around it so about a sixth of them are visible
+		glm::mat4 proj = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+		proj[1][1] *= -1.f;
+
+		Frustum frustum(proj);
+
+		std::ofstream file(CULLING_BENCHMARK_FILE_PATH, std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to open benchmark file ", CULLING_BENCHMARK_FILE_PATH);
+			return;
+		}
+
+		file << "{\n\t\"warmupIterationCount\": " << CULLING_BENCHMARK_WARMUP_ITERATION_COUNT
+			<< ",\n\t\"iterationCount\": " << CULLING_BENCHMARK_ITERATION_COUNT
+			<< ",\n\t\"simd\": \"SSE\""
+			<< ",\n\t\"runs\": [";
+
+		for (size_t i = 0; i < boxCounts.size(); i++)
+		{
+			size_t boxCount = boxCounts[i];
+
+			std::mt19937 generator(CULLING_BENCHMARK_SEED);
+			std::uniform_real_distribution<float> positionDistribution(-100.f, 100.f);
+			std::uniform_real_distribution<float> extentDistribution(0.1f, 2.f);
+
+			CullingBounds bounds;
+			bounds.Reserve(boxCount);
+
+			for (size_t j = 0; j < boxCount; j++)
+			{
+				glm::vec3 center(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator));
+				glm::vec3 extents(extentDistribution(generator), extentDistribution(generator), extentDistribution(generator));
+
+				bounds.Add(center - extents, center + extents);
+			}
+
+			std::vector<uint32_t> scalarIndices;
+			std::vector<uint32_t> simdIndices;
+			scalarIndices.reserve(boxCount);
+			simdIndices.reserve(boxCount);
+
+			std::vector<float> scalarTimes;
+			std::vector<float> simdTimes;
+			scalarTimes.reserve(CULLING_BENCHMARK_ITERATION_COUNT);
+			simdTimes.reserve(CULLING_BENCHMARK_ITERATION_COUNT);
+
+			for (uint32_t j = 0; j < CULLING_BENCHMARK_WARMUP_ITERATION_COUNT + CULLING_BENCHMARK_ITERATION_COUNT; j++)
+			{
+				std::chrono::steady_clock::time_point scalarStartTime = std::chrono::steady_clock::now();
+				CullBoundsScalar(frustum, bounds, scalarIndices);
+				std::chrono::steady_clock::time_point simdStartTime = std::chrono::steady_clock::now();
+				CullBounds(frustum, bounds, simdIndices);
+				std::chrono::steady_clock::time_point simdEndTime = std::chrono::steady_clock::now();
+
+				if (j < CULLING_BENCHMARK_WARMUP_ITERATION_COUNT)
+					continue;
+
+				scalarTimes.push_back(std::chrono::duration<float, std::milli>(simdStartTime - scalarStartTime).count());
+				simdTimes.push_back(std::chrono::duration<float, std::milli>(simdEndTime - simdStartTime).count());
 			}
+
+			// Both versions must agree on every box, not only on the count
+			bool isMatching = scalarIndices == simdIndices;
+
+			if (!isMatching)
+				Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Culling benchmark: the SIMD culling kept ", simdIndices.size(), " boxes out of ", boxCount, ", the scalar one ", scalarIndices.size());
+
+			BenchmarkStatistics scalarStatistics;
+			BenchmarkStatistics simdStatistics;
+			ComputeBenchmarkStatistics(scalarTimes, scalarStatistics);
+			ComputeBenchmarkStatistics(simdTimes, simdStatistics);
+
+			Logger::Log(LogLevel::LOG_LEVEL_INFO, "Culling benchmark: ", boxCount, " boxes, ", simdIndices.size(), " visible, scalar p50 ", scalarStatistics.p50,
+				" ms, SIMD p50 ", simdStatistics.p50, " ms (x", scalarStatistics.p50 / std::max(simdStatistics.p50, 1e-6f), ")");
+
+			file << (i == 0 ? "\n" : ",\n");
+			file << "\t\t{\n\t\t\t\"boxCount\": " << boxCount << ",\n\t\t\t\"visibleCount\": " << simdIndices.size()
+				<< ",\n\t\t\t\"isMatching\": " << (isMatching ? "true" : "false") << ",\n\t\t\t\"scalar\": { ";
+			WriteBenchmarkStatistics(file, scalarStatistics);
+			file << " },\n\t\t\t\"simd\": { ";
+			WriteBenchmarkStatistics(file, simdStatistics);
+			file << " }\n\t\t}";
 		}
+
+		file << "\n\t]\n}\n";
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Culling benchmark exported to ", CULLING_BENCHMARK_FILE_PATH);
+	}
+
+	void Engine::EndSceneBuild() noexcept
+	{
+		rhi.EndUploadBatch();
+
+		std::chrono::duration<float, std::milli> sceneBuildTime = std::chrono::steady_clock::now() - sceneBuildStartTime;
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Scenes built in ", sceneBuildTime.count(), " ms, ", rhi.GetUploadSubmitCount(), " upload submissions");
 	}
 
 	scene::Scene& Engine::GetScene(SCENE scene) noexcept
@@ -82,6 +556,8 @@ namespace lux
 
 	void Engine::Update(scene::Scene& scene, float deltaTime) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		scene::CameraNode* camera = scene.GetCurrentCamera();
 		float moveDelta = 3.f * deltaTime;
 
@@ -169,6 +645,8 @@ namespace lux
 
 	void Engine::DrawImgui(scene::Scene& scene, float deltaTime) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		ImGui_ImplVulkan_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
@@ -178,7 +656,7 @@ namespace lux
 			float framerate = 1.f / deltaTime;
 
 			char buf[128];
-			sprintf_s(buf, "Luxumbra Engine %d###Luxumbra Engine", (int)framerate);
+			snprintf(buf, sizeof(buf), "Luxumbra Engine %d###Luxumbra Engine", (int)framerate);
 
 			ImGui::Begin(buf);
 
@@ -188,6 +666,7 @@ namespace lux
 			ImGui::RadioButton("PBR Materials Scene", &currentScene, TO_INT32_T(SCENE::PBR_MATERIALS_SCENE));
 			ImGui::RadioButton("Transparent Scene", &currentScene, TO_INT32_T(SCENE::TRANSPARENT_SCENE));
 			ImGui::RadioButton("Shadow Scene", &currentScene, TO_INT32_T(SCENE::DIRECTIONAL_SHADOW_SCENE));
+			ImGui::RadioButton("Stress Scene", &currentScene, TO_INT32_T(SCENE::STRESS_SCENE));
 
 			if (ImGui::Button("Reload Shader"))
 			{
@@ -369,6 +848,113 @@ namespace lux
 
 				if (ImGui::BeginTabItem("Render Settings"))
 				{
+					if (ImGui::CollapsingHeader("Frame Time", ImGuiTreeNodeFlags_DefaultOpen))
+					{
+						ImGui::Spacing();
+
+						float frameTimeSum = 0.f;
+						float frameTimeMax = 0.f;
+
+						for (float frameTime : frameTimes)
+						{
+							frameTimeSum += frameTime;
+							frameTimeMax = std::max(frameTimeMax, frameTime);
+						}
+
+						ImGui::Text("Average: %.3f ms, Max: %.3f ms (last %d frames)", frameTimeSum / TO_FLOAT(FRAME_TIME_HISTORY_SIZE), frameTimeMax, FRAME_TIME_HISTORY_SIZE);
+						ImGui::PlotLines("##FrameTimes", frameTimes.data(), FRAME_TIME_HISTORY_SIZE, TO_INT32_T(frameTimeIndex), nullptr, 0.f, frameTimeMax, ImVec2(0.f, 60.f));
+					}
+
+					if (ImGui::CollapsingHeader("Dynamic Resolution", ImGuiTreeNodeFlags_DefaultOpen))
+					{
+						ImGui::Spacing();
+
+						bool isDynamicResolutionEnabled = rhi.GetIsDynamicResolutionEnabled();
+
+						if (ImGui::Checkbox("Automatic", &isDynamicResolutionEnabled))
+							rhi.SetIsDynamicResolutionEnabled(isDynamicResolutionEnabled);
+
+						// The automatic scale follows the GPU frame time, it needs the timestamp queries
+						if (isDynamicResolutionEnabled && !rhi.GetIsGpuProfilerSupported())
+							ImGui::TextDisabled("Timestamp queries are not supported, the scale stays fixed");
+
+						if (isDynamicResolutionEnabled)
+						{
+							float targetFrameTime = rhi.GetDynamicResolutionTargetFrameTime();
+
+							if (ImGui::SliderFloat("Target GPU frame time", &targetFrameTime, 4.f, 33.f, "%.1f ms"))
+								rhi.SetDynamicResolutionTargetFrameTime(targetFrameTime);
+						}
+						else
+						{
+							float renderScale = rhi.GetRenderScale();
+
+							if (ImGui::SliderFloat("Render scale", &renderScale, DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE, "%.2f"))
+								rhi.SetRenderScale(renderScale);
+						}
+
+						VkExtent2D renderExtent = rhi.GetRenderExtent();
+						ImGui::Text("Render resolution: %u x %u (%.0f%%)", renderExtent.width, renderExtent.height, rhi.GetRenderScale() * 100.f);
+					}
+
+					if (ImGui::CollapsingHeader("Depth Prepass", ImGuiTreeNodeFlags_DefaultOpen))
+					{
+						ImGui::Spacing();
+
+						bool isDepthPrepassEnabled = scene.GetIsDepthPrepassEnabled();
+
+						if (ImGui::Checkbox("Depth prepass for this scene", &isDepthPrepassEnabled))
+							scene.SetIsDepthPrepassEnabled(isDepthPrepassEnabled);
+
+						ImGui::TextDisabled("Compare Forward Depth Prepass + Forward Opaque in the GPU profiler");
+					}
+
+					if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen))
+					{
+						ImGui::Spacing();
+
+						bool isCpuCullingEnabled = rhi.GetIsCpuCullingEnabled();
+
+						if (ImGui::Checkbox("CPU frustum culling", &isCpuCullingEnabled))
+							rhi.SetIsCpuCullingEnabled(isCpuCullingEnabled);
+
+						if (rhi.GetIsGpuCullingSupported())
+						{
+							bool isGpuCullingEnabled = rhi.GetIsGpuCullingEnabled();
+
+							if (ImGui::Checkbox("GPU frustum culling", &isGpuCullingEnabled))
+								rhi.SetIsGpuCullingEnabled(isGpuCullingEnabled);
+
+							bool isOcclusionCullingEnabled = rhi.GetIsOcclusionCullingEnabled();
+
+							if (ImGui::Checkbox("GPU occlusion culling (Hi-Z)", &isOcclusionCullingEnabled))
+								rhi.SetIsOcclusionCullingEnabled(isOcclusionCullingEnabled);
+
+							ImGui::TextDisabled("Compare Forward Early Opaque + Forward Late Opaque in the GPU profiler");
+						}
+						else
+							ImGui::TextDisabled("drawIndirectFirstInstance is not supported, GPU culling disabled");
+					}
+
+					if (ImGui::CollapsingHeader("Light Clustering", ImGuiTreeNodeFlags_DefaultOpen))
+					{
+						ImGui::Spacing();
+
+						bool isLightClusteringEnabled = rhi.GetIsLightClusteringEnabled();
+
+						if (ImGui::Checkbox("Clustered point lights", &isLightClusteringEnabled))
+							rhi.SetIsLightClusteringEnabled(isLightClusteringEnabled);
+
+						const rhi::LightClusterStatistics& statistics = rhi.GetLightClusterStatistics();
+
+						ImGui::Text("Grid: %u x %u x %u clusters", LIGHT_CLUSTER_GRID_X, LIGHT_CLUSTER_GRID_Y, LIGHT_CLUSTER_GRID_Z);
+						ImGui::Text("Light indices: %u / %u", statistics.indexCount, LIGHT_CLUSTER_MAX_INDEX_COUNT);
+						ImGui::Text("Most lights in a cluster: %u", statistics.maxClusterLightCount);
+
+						if (statistics.droppedIndexCount > 0)
+							ImGui::Text("Dropped light indices: %u", statistics.droppedIndexCount);
+					}
+
 					if (ImGui::CollapsingHeader("Shadow Mapping", ImGuiTreeNodeFlags_DefaultOpen))
 					{
 						ImGui::Spacing();
@@ -386,6 +972,36 @@ namespace lux
 					ImGui::EndTabItem();
 				}
 
+				if (ImGui::BeginTabItem("GPU Profiler"))
+				{
+					DisplayGpuProfiler();
+
+					ImGui::EndTabItem();
+				}
+
+#ifdef ENABLE_CPU_PROFILER
+				if (ImGui::BeginTabItem("CPU Profiler"))
+				{
+					DisplayCpuProfiler();
+
+					ImGui::EndTabItem();
+				}
+#endif // ENABLE_CPU_PROFILER
+
+				if (ImGui::BeginTabItem("Jobs"))
+				{
+					DisplayJobs();
+
+					ImGui::EndTabItem();
+				}
+
+				if (ImGui::BeginTabItem("Memory"))
+				{
+					DisplayMemoryUsage();
+
+					ImGui::EndTabItem();
+				}
+
 				if (ImGui::BeginTabItem("Scene"))
 				{
 					scene::CameraNode* camera = scene.GetCurrentCamera();
@@ -524,27 +1140,32 @@ namespace lux
 					{
 						resource::MaterialParameters& matParameters = currentMaterial->parameter;
 						int textureMask = matParameters.textureMask;
+						bool isDirty = false;
 
-						ImGui::ColorEdit3("Base Color", glm::value_ptr(matParameters.baseColor));
+						isDirty |= ImGui::ColorEdit3("Base Color", glm::value_ptr(matParameters.baseColor));
 
 						if ((textureMask & resource::TextureMask::METALLIC_TEXTURE_MASK) != resource::TextureMask::METALLIC_TEXTURE_MASK)
 						{
 							bool metallic = (bool)matParameters.metallic;
-							ImGui::Checkbox("Metallic", &metallic);
+							isDirty |= ImGui::Checkbox("Metallic", &metallic);
 							matParameters.metallic = metallic;
 						}
 
 						if (matParameters.metallic == 0.f)
 						{
-							ImGui::SliderFloat("Reflectance", &matParameters.reflectance, 0.0f, 1.0f, "%.3f");
+							isDirty |= ImGui::SliderFloat("Reflectance", &matParameters.reflectance, 0.0f, 1.0f, "%.3f");
 						}
 
 						if((textureMask & resource::TextureMask::ROUGHNESS_TEXTURE_MASK) != resource::TextureMask::ROUGHNESS_TEXTURE_MASK)
-							ImGui::SliderFloat("Roughness", &matParameters.perceptualRoughness, 0.045f, 1.0f, "%.3f");
+							isDirty |= ImGui::SliderFloat("Roughness", &matParameters.perceptualRoughness, 0.045f, 1.0f, "%.3f");
+
+						isDirty |= ImGui::SliderFloat("Clear Coat", &matParameters.clearCoat, 0.0f, 1.0f, "%.3f");
 
-						ImGui::SliderFloat("Clear Coat", &matParameters.clearCoat, 0.0f, 1.0f, "%.3f");
+						isDirty |= ImGui::SliderFloat("Cleat Coat Roughness", &matParameters.clearCoatPerceptualRoughness, 0.045f, 1.0f, "%.3f");
 
-						ImGui::SliderFloat("Cleat Coat Roughness", &matParameters.clearCoatPerceptualRoughness, 0.045f, 1.0f, "%.3f");
+						// Only edited materials are uploaded to the material table
+						if (isDirty)
+							rhi.UpdateMaterial(*currentMaterial);
 
 						ImGui::TreePop();
 					}
@@ -554,6 +1175,243 @@ namespace lux
 		}
 	}
 
+	void Engine::DisplayJobs() noexcept
+	{
+		int threadCount = TO_INT32_T(jobSystem.GetThreadCount());
+		int maxThreadCount = TO_INT32_T(jobSystem.GetMaxThreadCount());
+
+		if (ImGui::SliderInt("Job threads", &threadCount, 1, maxThreadCount) && jobBenchmarkThreadCount == 0)
+			jobSystem.SetThreadCount(TO_UINT32_T(threadCount));
+
+		ImGui::Text("Scene update: %.3f ms", lastSceneUpdateTime);
+		ImGui::Text("Command recording: %.3f ms", rhi.GetLastRecordingTime());
+
+		ImGui::NewLine();
+
+		if (jobBenchmarkThreadCount == 0)
+		{
+			if (ImGui::Button("Run Job Benchmark"))
+			{
+				jobThreadCountBeforeBenchmark = jobSystem.GetThreadCount();
+				jobBenchmarkThreadCount = 1;
+				jobBenchmarkFrame = 0;
+				jobBenchmarkCPUTimeSum = 0.f;
+				jobBenchmarkFrameTimeSum = 0.f;
+				jobBenchmarkResults.clear();
+
+				jobSystem.SetThreadCount(jobBenchmarkThreadCount);
+			}
+		}
+		else
+		{
+			ImGui::Text("Benchmarking %u thread(s)... %u/%d frames", jobBenchmarkThreadCount, jobBenchmarkFrame, JOB_BENCHMARK_FRAME_COUNT);
+		}
+
+		for (size_t i = 0; i < jobBenchmarkResults.size(); i++)
+		{
+			const JobBenchmarkResult& result = jobBenchmarkResults[i];
+
+			ImGui::Text("%zu thread(s): update + recording %.3f ms (x%.2f), frame %.3f ms (x%.2f)", i + 1,
+				result.cpuTime, jobBenchmarkResults[0].cpuTime / result.cpuTime, result.frameTime, jobBenchmarkResults[0].frameTime / result.frameTime);
+		}
+	}
+
+	void Engine::DisplayGpuProfiler() noexcept
+	{
+		if (!rhi.GetIsGpuProfilerSupported())
+		{
+			ImGui::Text("Timestamp queries are not supported by this device");
+			return;
+		}
+
+		if (ImGui::Button("Export to CSV"))
+			rhi.ExportGpuProfile(GPU_PROFILE_FILE_PATH);
+
+		ImGui::Text("Milliseconds over the last %d frames, read back %d frames late", GPU_PROFILER_HISTORY_SIZE, MAX_FRAMES_IN_FLIGHT);
+
+		ImGui::NewLine();
+
+		std::vector<rhi::GpuPassStatistics> statistics;
+		rhi.GetGpuPassStatistics(statistics);
+
+		ImGui::Columns(6, "##GpuPasses");
+		ImGui::SetColumnWidth(0, 180.f);
+
+		ImGui::Text("Pass"); ImGui::NextColumn();
+		ImGui::Text("Last"); ImGui::NextColumn();
+		ImGui::Text("Average"); ImGui::NextColumn();
+		ImGui::Text("p50"); ImGui::NextColumn();
+		ImGui::Text("p95"); ImGui::NextColumn();
+		ImGui::Text("p99"); ImGui::NextColumn();
+		ImGui::Separator();
+
+		for (const rhi::GpuPassStatistics& passStatistics : statistics)
+		{
+			ImGui::Text("%s", passStatistics.name.c_str()); ImGui::NextColumn();
+			ImGui::Text("%.3f", passStatistics.last); ImGui::NextColumn();
+			ImGui::Text("%.3f", passStatistics.average); ImGui::NextColumn();
+			ImGui::Text("%.3f", passStatistics.p50); ImGui::NextColumn();
+			ImGui::Text("%.3f", passStatistics.p95); ImGui::NextColumn();
+			ImGui::Text("%.3f", passStatistics.p99); ImGui::NextColumn();
+		}
+
+		ImGui::Columns(1);
+	}
+
+	void Engine::DisplayCpuProfiler() noexcept
+	{
+		ImGui::Checkbox("Pause", &isCpuProfilerPaused);
+		ImGui::SameLine();
+
+		if (ImGui::Button("Export Chrome Trace"))
+			CpuProfiler::ExportChromeTrace(CPU_TRACE_FILE_PATH);
+
+		if (!isCpuProfilerPaused)
+			CpuProfiler::GetLastFrameEvents(cpuProfilerThreads, cpuProfilerFrameStart, cpuProfilerFrameEnd);
+
+		if (cpuProfilerFrameEnd <= cpuProfilerFrameStart)
+			return;
+
+		float frameDuration = TO_FLOAT(cpuProfilerFrameEnd - cpuProfilerFrameStart);
+
+		ImGui::Text("Last frame: %.3f ms", frameDuration / 1000000.f);
+		ImGui::NewLine();
+
+		const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+		const float width = ImGui::GetContentRegionAvail().x;
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+		for (const CpuProfileThreadEvents& thread : cpuProfilerThreads)
+		{
+			if (thread.events.empty())
+				continue;
+
+			uint32_t maxDepth = 0;
+			for (const CpuProfileEvent& event : thread.events)
+				maxDepth = std::max(maxDepth, event.depth);
+
+			ImGui::Text("%s %u", thread.threadName ? thread.threadName : "Thread", thread.threadIndex);
+
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			ImVec2 size(width, rowHeight * TO_FLOAT(maxDepth + 1));
+
+			ImGui::InvisibleButton(("##CpuProfilerThread" + std::to_string(thread.threadIndex)).c_str(), size);
+			ImGui::PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+
+			// One row per scope depth, horizontal position and width proportional to time
+			for (const CpuProfileEvent& event : thread.events)
+			{
+				float startX = origin.x + TO_FLOAT(event.start - cpuProfilerFrameStart) / frameDuration * width;
+				float endX = origin.x + TO_FLOAT(event.end - cpuProfilerFrameStart) / frameDuration * width;
+				endX = std::max(endX, startX + 1.f);
+
+				ImVec2 min(startX, origin.y + rowHeight * TO_FLOAT(event.depth));
+				ImVec2 max(endX, min.y + rowHeight - 1.f);
+
+				ImU32 color = ImGui::GetColorU32(ImVec4(0.3f + 0.1f * TO_FLOAT(event.depth % 5), 0.45f, 0.7f - 0.1f * TO_FLOAT(event.depth % 5), 1.f));
+				drawList->AddRectFilled(min, max, color);
+
+				if (ImGui::CalcTextSize(event.name).x < endX - startX)
+					drawList->AddText(ImVec2(min.x + 2.f, min.y), ImGui::GetColorU32(ImGuiCol_Text), event.name);
+
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s: %.3f ms", event.name, TO_FLOAT(event.end - event.start) / 1000000.f);
+			}
+
+			ImGui::PopClipRect();
+		}
+	}
+
+	void Engine::UpdateJobBenchmark(float deltaTime) noexcept
+	{
+		jobBenchmarkCPUTimeSum += lastSceneUpdateTime + rhi.GetLastRecordingTime();
+		jobBenchmarkFrameTimeSum += deltaTime * 1000.f;
+		jobBenchmarkFrame++;
+
+		if (jobBenchmarkFrame < JOB_BENCHMARK_FRAME_COUNT)
+			return;
+
+		JobBenchmarkResult result;
+		result.cpuTime = jobBenchmarkCPUTimeSum / TO_FLOAT(JOB_BENCHMARK_FRAME_COUNT);
+		result.frameTime = jobBenchmarkFrameTimeSum / TO_FLOAT(JOB_BENCHMARK_FRAME_COUNT);
+		jobBenchmarkResults.push_back(result);
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Job benchmark: ", jobBenchmarkThreadCount, " thread(s), update + recording ", result.cpuTime, " ms, frame ", result.frameTime,
+			" ms average over ", JOB_BENCHMARK_FRAME_COUNT, " frames");
+
+		jobBenchmarkFrame = 0;
+		jobBenchmarkCPUTimeSum = 0.f;
+		jobBenchmarkFrameTimeSum = 0.f;
+
+		if (jobBenchmarkThreadCount < jobSystem.GetMaxThreadCount())
+		{
+			jobBenchmarkThreadCount++;
+			jobSystem.SetThreadCount(jobBenchmarkThreadCount);
+		}
+		else
+		{
+			jobBenchmarkThreadCount = 0;
+			jobSystem.SetThreadCount(jobThreadCountBeforeBenchmark);
+		}
+	}
+
+	void Engine::DisplayMemoryUsage() noexcept
+	{
+		const float megabyte = 1024.f * 1024.f;
+
+		if (ImGui::Button("Dump to JSON"))
+			rhi.DumpMemoryReport(MEMORY_REPORT_FILE_PATH);
+
+		ImGui::NewLine();
+
+		if (ImGui::CollapsingHeader("Heaps", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			std::vector<rhi::MemoryHeapUsage> heapUsages;
+			rhi.GetMemoryHeapUsages(heapUsages);
+
+			for (size_t i = 0; i < heapUsages.size(); i++)
+			{
+				const rhi::MemoryHeapUsage& heapUsage = heapUsages[i];
+
+				if (heapUsage.blockCount == 0)
+					continue;
+
+				bool isDeviceLocal = heapUsage.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+				ImGui::Text("Heap %d (%s): %.2f / %.2f MB in %d blocks, %d allocations", TO_INT32_T(i), isDeviceLocal ? "Device" : "Host",
+					TO_FLOAT(heapUsage.usedSize) / megabyte, TO_FLOAT(heapUsage.blockSize) / megabyte, heapUsage.blockCount, heapUsage.allocationCount);
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Categories", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			std::vector<rhi::MemoryCategoryUsage> categoryUsages;
+			rhi.GetMemoryCategoryUsages(categoryUsages);
+
+			for (size_t i = 0; i < categoryUsages.size(); i++)
+			{
+				const rhi::MemoryCategoryUsage& categoryUsage = categoryUsages[i];
+
+				if (categoryUsage.allocationCount == 0)
+					continue;
+
+				ImGui::Text("%s: %.2f MB (device %.2f MB, host visible %.2f MB), %d allocations", rhi::GetMemoryCategoryName(static_cast<rhi::MemoryCategory>(i)),
+					TO_FLOAT(categoryUsage.usedSize) / megabyte, TO_FLOAT(categoryUsage.deviceLocalSize) / megabyte, TO_FLOAT(categoryUsage.hostVisibleSize) / megabyte, categoryUsage.allocationCount);
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Allocations"))
+		{
+			for (const rhi::MemoryAllocationRecord& record : rhi.GetMemoryAllocationRecords())
+			{
+				if (record.isAlive == false)
+					continue;
+
+				ImGui::Text("[%s] %s: %.2f MB", rhi::GetMemoryCategoryName(record.category), record.debugName.c_str(), TO_FLOAT(record.size) / megabyte);
+			}
+		}
+	}
+
 	void Engine::DisplayNode(scene::Node* node) noexcept
 	{
 		//Position
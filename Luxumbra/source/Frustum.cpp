@@ -0,0 +1,171 @@
+#include "Frustum.h"
+
+#include <xmmintrin.h>
+
+namespace lux
+{
+
+	Frustum::Frustum() noexcept
+		: planes()
+	{
+
+	}
+
+	Frustum::Frustum(const glm::mat4& viewProj) noexcept
+		: planes()
+	{
+		// Gribb-Hartmann plane extraction, the clip space depth goes from 0 to 1
+		glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+		glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+		glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+		glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+		planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
+	}
+
+	CullingBounds::CullingBounds() noexcept
+		: minX(0), minY(0), minZ(0), maxX(0), maxY(0), maxZ(0)
+	{
+
+	}
+
+	void CullingBounds::Clear() noexcept
+	{
+		minX.clear();
+		minY.clear();
+		minZ.clear();
+		maxX.clear();
+		maxY.clear();
+		maxZ.clear();
+	}
+
+	void CullingBounds::Reserve(size_t count) noexcept
+	{
+		minX.reserve(count);
+		minY.reserve(count);
+		minZ.reserve(count);
+		maxX.reserve(count);
+		maxY.reserve(count);
+		maxZ.reserve(count);
+	}
+
+	void CullingBounds::Add(const glm::vec3& worldMin, const glm::vec3& worldMax) noexcept
+	{
+		minX.push_back(worldMin.x);
+		minY.push_back(worldMin.y);
+		minZ.push_back(worldMin.z);
+		maxX.push_back(worldMax.x);
+		maxY.push_back(worldMax.y);
+		maxZ.push_back(worldMax.z);
+	}
+
+	void CullingBounds::Add(const AABB& localAABB, const glm::mat4& transform) noexcept
+	{
+		// Center and extents, the world extents are the local ones through the absolute rotation and scale
+		glm::vec3 center = (localAABB.min + localAABB.max) * 0.5f;
+		glm::vec3 extents = (localAABB.max - localAABB.min) * 0.5f;
+
+		glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.f));
+		glm::vec3 worldExtents = glm::mat3(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2]))) * extents;
+
+		Add(worldCenter - worldExtents, worldCenter + worldExtents);
+	}
+
+	size_t CullingBounds::GetCount() const noexcept
+	{
+		return minX.size();
+	}
+
+	// Only the box corner furthest along the plane normal needs to be tested
+	static bool IsBoxInFrustum(const Frustum& frustum, const CullingBounds& bounds, size_t index) noexcept
+	{
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			float x = plane.x >= 0.f ? bounds.maxX[index] : bounds.minX[index];
+			float y = plane.y >= 0.f ? bounds.maxY[index] : bounds.minY[index];
+			float z = plane.z >= 0.f ? bounds.maxZ[index] : bounds.minZ[index];
+
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.f)
+				return false;
+		}
+
+		return true;
+	}
+
+	void CullBoundsScalar(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visibleIndices) noexcept
+	{
+		visibleIndices.clear();
+
+		for (size_t i = 0, count = bounds.GetCount(); i < count; i++)
+		{
+			if (IsBoxInFrustum(frustum, bounds, i))
+				visibleIndices.push_back(TO_UINT32_T(i));
+		}
+	}
+
+	void CullBounds(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visibleIndices) noexcept
+	{
+		visibleIndices.clear();
+
+		size_t count = bounds.GetCount();
+
+		// The corner coordinates tested against a plane only depend on the signs of its normal
+		std::array<const float*, 6> planeX, planeY, planeZ;
+
+		for (size_t p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+
+			planeX[p] = plane.x >= 0.f ? bounds.maxX.data() : bounds.minX.data();
+			planeY[p] = plane.y >= 0.f ? bounds.maxY.data() : bounds.minY.data();
+			planeZ[p] = plane.z >= 0.f ? bounds.maxZ.data() : bounds.minZ.data();
+		}
+
+		size_t i = 0;
+
+		const size_t simdWidth = 4;
+
+		std::array<__m128, 6> nx, ny, nz, nw;
+
+		for (size_t p = 0; p < 6; p++)
+		{
+			nx[p] = _mm_set1_ps(frustum.planes[p].x);
+			ny[p] = _mm_set1_ps(frustum.planes[p].y);
+			nz[p] = _mm_set1_ps(frustum.planes[p].z);
+			nw[p] = _mm_set1_ps(frustum.planes[p].w);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; i + simdWidth <= count; i += simdWidth)
+		{
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+
+			for (size_t p = 0; p < 6; p++)
+			{
+				// Same association as IsBoxInFrustum so both versions round identically
+				__m128 distance = _mm_add_ps(_mm_mul_ps(nx[p], _mm_loadu_ps(planeX[p] + i)), _mm_mul_ps(ny[p], _mm_loadu_ps(planeY[p] + i)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(nz[p], _mm_loadu_ps(planeZ[p] + i)));
+				distance = _mm_add_ps(distance, nw[p]);
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+
+			for (size_t lane = 0; mask != 0; lane++, mask >>= 1)
+			{
+				if (mask & 1)
+					visibleIndices.push_back(TO_UINT32_T(i + lane));
+			}
+		}
+
+		// Remaining boxes that do not fill a register
+		for (; i < count; i++)
+		{
+			if (IsBoxInFrustum(frustum, bounds, i))
+				visibleIndices.push_back(TO_UINT32_T(i));
+		}
+	}
+
+} // namespace lux
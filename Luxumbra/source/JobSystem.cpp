@@ -0,0 +1,214 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+#include "CpuProfiler.h"
+
+namespace lux
+{
+
+	static thread_local uint32_t currentThreadIndex = 0;
+
+	JobCounter::JobCounter() noexcept
+		: value(0)
+	{
+
+	}
+
+	bool JobCounter::IsDone() const noexcept
+	{
+		return value.load(std::memory_order_acquire) == 0;
+	}
+
+	JobQueue::JobQueue() noexcept
+		: mutex(), jobs()
+	{
+
+	}
+
+	JobSystem::JobSystem() noexcept
+		: isInitialized(false), maxThreadCount(1), threadCount(1), queues(), workers(0), pendingJobCount(0),
+		sleepMutex(), sleepCondition(), isStopping(false)
+	{
+
+	}
+
+	JobSystem::~JobSystem() noexcept
+	{
+		if (!isInitialized)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+
+			isStopping = true;
+		}
+
+		sleepCondition.notify_all();
+
+		for (std::thread& worker : workers)
+			worker.join();
+
+		workers.clear();
+	}
+
+	void JobSystem::Initialize() noexcept
+	{
+		maxThreadCount = std::clamp(std::thread::hardware_concurrency(), 1u, TO_UINT32_T(JOB_SYSTEM_MAX_THREAD_COUNT));
+		threadCount = maxThreadCount;
+
+		currentThreadIndex = 0;
+
+		workers.reserve(TO_SIZE_T(maxThreadCount - 1));
+		for (uint32_t i = 1; i < maxThreadCount; i++)
+			workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Job system started with ", maxThreadCount, " threads");
+
+		isInitialized = true;
+	}
+
+	uint32_t JobSystem::GetMaxThreadCount() const noexcept
+	{
+		return maxThreadCount;
+	}
+
+	uint32_t JobSystem::GetThreadCount() const noexcept
+	{
+		return threadCount;
+	}
+
+	void JobSystem::SetThreadCount(uint32_t newThreadCount) noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+
+			threadCount = std::clamp(newThreadCount, 1u, maxThreadCount);
+		}
+
+		sleepCondition.notify_all();
+	}
+
+	uint32_t JobSystem::GetCurrentThreadIndex() noexcept
+	{
+		return currentThreadIndex;
+	}
+
+	void JobSystem::Run(std::function<void()>&& function, JobCounter& counter) noexcept
+	{
+		counter.value.fetch_add(1, std::memory_order_relaxed);
+
+		{
+			JobQueue& queue = queues[TO_SIZE_T(currentThreadIndex)];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+
+			queue.jobs.push_back({ std::move(function), &counter });
+		}
+
+		// Taking the lock orders the increment with a worker about to sleep
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+
+			pendingJobCount++;
+		}
+
+		sleepCondition.notify_one();
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& function, JobCounter& counter) noexcept
+	{
+		ASSERT(batchSize > 0);
+
+		for (size_t first = 0; first < count; first += batchSize)
+		{
+			size_t last = std::min(first + batchSize, count);
+
+			Run([function, first, last]() { function(first, last); }, counter);
+		}
+	}
+
+	void JobSystem::Wait(const JobCounter& counter) noexcept
+	{
+		// The waiting thread helps instead of blocking, so waiting from inside a job cannot starve the pool
+		while (!counter.IsDone())
+		{
+			if (!TryRunJob(currentThreadIndex))
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t threadIndex) noexcept
+	{
+		currentThreadIndex = threadIndex;
+
+		CPU_PROFILE_THREAD_NAME("Job Worker");
+
+		while (true)
+		{
+			if (threadIndex < threadCount && TryRunJob(threadIndex))
+				continue;
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+
+			sleepCondition.wait(lock, [this, threadIndex]()
+			{
+				return isStopping || (pendingJobCount > 0 && threadIndex < threadCount);
+			});
+
+			if (isStopping)
+				return;
+		}
+	}
+
+	bool JobSystem::TryRunJob(uint32_t threadIndex) noexcept
+	{
+		Job job;
+
+		if (!PopJob(threadIndex, job) && !StealJob(threadIndex, job))
+			return false;
+
+		pendingJobCount--;
+
+		job.function();
+
+		// The counter may live on the waiter's stack, it must not be touched after this
+		job.counter->value.fetch_sub(1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool JobSystem::PopJob(uint32_t threadIndex, Job& job) noexcept
+	{
+		JobQueue& queue = queues[TO_SIZE_T(threadIndex)];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.jobs.empty())
+			return false;
+
+		job = std::move(queue.jobs.back());
+		queue.jobs.pop_back();
+
+		return true;
+	}
+
+	bool JobSystem::StealJob(uint32_t threadIndex, Job& job) noexcept
+	{
+		for (uint32_t i = 1; i < maxThreadCount; i++)
+		{
+			JobQueue& queue = queues[TO_SIZE_T((threadIndex + i) % maxThreadCount)];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+
+			if (queue.jobs.empty())
+				continue;
+
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+
+			return true;
+		}
+
+		return false;
+	}
+
+} // namespace lux
@@ -79,6 +79,31 @@ namespace lux
 		return attributeDescription;
 	}
 
+	VkVertexInputBindingDescription Vertex::GetInstanceBindingDescription() noexcept
+	{
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(glm::mat4);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	std::array<VkVertexInputAttributeDescription, 4> Vertex::GetInstanceAttributeDescriptions(uint32_t firstLocation) noexcept
+	{
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescription = {};
+
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			attributeDescription[i].binding = 1;
+			attributeDescription[i].location = firstLocation + i;
+			attributeDescription[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescription[i].offset = TO_UINT32_T(sizeof(glm::vec4) * i);
+		}
+
+		return attributeDescription;
+	}
+
 	bool Vertex::operator==(const Vertex& lhs) const noexcept
 	{
 		return position == lhs.position && textureCoordinate == lhs.textureCoordinate && normal == lhs.normal;
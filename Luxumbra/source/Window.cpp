@@ -1,8 +1,8 @@
 #include "Window.h"
 
-#include "imgui\imgui.h"
-#include "imgui\imgui_impl_glfw.h"
-#include "imgui\imgui_impl_vulkan.h"
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_vulkan.h"
 
 namespace lux
 {
@@ -13,7 +13,7 @@ namespace lux
 	void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods) noexcept;
 
 	Window::Window() noexcept
-		: isInitialized(false), width(0), height(0), window(nullptr), hasFocus(true),
+		: isInitialized(false), isHeadless(false), width(0), height(0), window(nullptr), hasFocus(true),
 		actionsStatus{ false }, mouseXDelta(0.f), mouseYDelta(0.f), deltaTime(0.f)
 	{
 		luxWindow = this;
@@ -21,7 +21,7 @@ namespace lux
 
 	Window::~Window() noexcept
 	{
-		if (isInitialized)
+		if (isInitialized && !isHeadless)
 		{
 			ImGui_ImplGlfw_Shutdown();
 			ImGui::DestroyContext();
@@ -71,18 +71,40 @@ namespace lux
 		return true;
 	}
 
+	bool Window::InitializeHeadless(uint32_t width, uint32_t height) noexcept
+	{
+		// Only the size is kept, the renderer draws to offscreen images and there is no input nor UI
+		this->width = width;
+		this->height = height;
+
+		isHeadless = true;
+		isInitialized = true;
+
+		return true;
+	}
+
+#ifdef _WIN32
 	HWND Window::GetHandle() const noexcept
 	{
 		return glfwGetWin32Window(window);
 	}
+#endif // _WIN32
 
 	GLFWwindow* Window::GetGLFWWindow() const noexcept
 	{
 		return window;
 	}
 
+	bool Window::GetIsHeadless() const noexcept
+	{
+		return isHeadless;
+	}
+
 	void Window::PollEvents() noexcept
 	{
+		if (isHeadless)
+			return;
+
 		glfwPollEvents();
 
 		static double oldX = 0., oldY = 0.;
@@ -108,9 +130,22 @@ namespace lux
 
 	bool Window::ShouldClose() const noexcept
 	{
+		if (isHeadless)
+			return false;
+
 		return glfwWindowShouldClose(window);
 	}
 
+	uint32_t Window::GetWidth() const noexcept
+	{
+		return width;
+	}
+
+	uint32_t Window::GetHeight() const noexcept
+	{
+		return height;
+	}
+
 	float Window::GetAspect() const noexcept
 	{
 		return TO_FLOAT(width) / TO_FLOAT(height);
@@ -1,11 +1,15 @@
 #include "Engine.h"
 
+#include <string>
+#include <cstdlib>
+
 void BuildPostProcessScene(lux::Engine& luxUmbra) noexcept;
 void BuildDirectionalShadowScene(lux::Engine& luxUmbra) noexcept;
 void BuildPBRModels(lux::Engine& luxUmbra) noexcept;
 void BuildPBRMaterials(lux::Engine& luxUmbra) noexcept;
 void BuildSphereScene(lux::Engine& luxUmbra) noexcept;
 void BuildTransparentScene(lux::Engine& luxUmbra) noexcept;
+void BuildStressScene(lux::Engine& luxUmbra) noexcept;
 
 
 void AddDirectionalLightDebugMesh(lux::scene::Scene& scene, lux::scene::LightNode* light) noexcept;
@@ -15,9 +19,52 @@ void CreateMaterials(lux::Engine& luxUmbra) noexcept;
 
 int main(int ac, char* av[])
 {
+	// --headless [--frames N] [--scene INDEX] renders N frames of one scene without a window
+	// --benchmark [--frames N] renders N measured frames of every scene, without then with the depth prepass, without a window and writes BENCHMARK_FILE_PATH
+	// --host-visible-meshes keeps the mesh arena in host visible memory instead of device local memory, to compare both in a benchmark
+	// --benchmark-culling times the frustum culling of 10k and 100k boxes and writes CULLING_BENCHMARK_FILE_PATH
+	bool isHeadless = false;
+	bool isBenchmark = false;
+	bool isCullingBenchmark = false;
+	bool isMeshArenaDeviceLocal = true;
+	uint32_t headlessFrameCount = 0;
+	int32_t headlessScene = TO_INT32_T(lux::SCENE::SPHERE_SCENE);
+
+	for (int i = 1; i < ac; i++)
+	{
+		std::string argument(av[i]);
+
+		if (argument == "--headless")
+			isHeadless = true;
+		else if (argument == "--benchmark")
+			isBenchmark = true;
+		else if (argument == "--benchmark-culling")
+			isCullingBenchmark = true;
+		else if (argument == "--host-visible-meshes")
+			isMeshArenaDeviceLocal = false;
+		else if (argument == "--frames" && i + 1 < ac)
+			headlessFrameCount = TO_UINT32_T(std::strtoul(av[++i], nullptr, 10));
+		else if (argument == "--scene" && i + 1 < ac)
+			headlessScene = TO_INT32_T(std::strtol(av[++i], nullptr, 10));
+	}
+
+	if (headlessScene < 0 || headlessScene >= TO_INT32_T(lux::SCENE::SCENE_COUNT))
+		headlessScene = TO_INT32_T(lux::SCENE::SPHERE_SCENE);
+
+	if (headlessFrameCount == 0)
+		headlessFrameCount = isBenchmark ? BENCHMARK_DEFAULT_FRAME_COUNT : HEADLESS_DEFAULT_FRAME_COUNT;
+
+	// Runs before the engine is created, it needs neither a device nor a scene
+	if (isCullingBenchmark)
+	{
+		lux::Engine::RunCullingBenchmark();
+		return 0;
+	}
+
 	lux::Engine luxUmbra;
 
-	luxUmbra.Initialize(1200, 800);
+	if (!luxUmbra.Initialize(1200, 800, isHeadless || isBenchmark, isMeshArenaDeviceLocal))
+		return 1;
 
 	lux::resource::ResourceManager& resourceManager = luxUmbra.GetResourceManager();
 	resourceManager.UseCubemap("data/envmaps/Ridgecrest_Road_Ref.hdr");
@@ -30,8 +77,14 @@ int main(int ac, char* av[])
 	BuildDirectionalShadowScene(luxUmbra);
 	BuildPBRModels(luxUmbra);
 	BuildPBRMaterials(luxUmbra);
+	BuildStressScene(luxUmbra);
 
-	luxUmbra.Run();
+	if (isBenchmark)
+		luxUmbra.RunBenchmark(headlessFrameCount);
+	else if (isHeadless)
+		luxUmbra.RunHeadless(static_cast<lux::SCENE>(headlessScene), headlessFrameCount);
+	else
+		luxUmbra.Run();
 
 	return 0;
 }
@@ -471,6 +524,57 @@ void BuildPostProcessScene(lux::Engine& luxUmbra) noexcept
 
 }
 
+void BuildStressScene(lux::Engine& luxUmbra) noexcept
+{
+	lux::scene::Scene& scene = luxUmbra.GetScene(lux::SCENE::STRESS_SCENE);
+	lux::resource::ResourceManager& resourceManager = luxUmbra.GetResourceManager();
+
+	const glm::vec3 colors[4] = { { 0.8f, 0.1f, 0.1f }, { 0.1f, 0.8f, 0.1f }, { 0.1f, 0.1f, 0.8f }, { 0.8f, 0.8f, 0.8f } };
+
+	lux::resource::MaterialCreateInfo stressMaterialCI;
+	stressMaterialCI.metallic = false;
+	stressMaterialCI.perceptualRoughness = 0.5f;
+	stressMaterialCI.reflectance = 0.5f;
+	stressMaterialCI.isTransparent = false;
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		stressMaterialCI.baseColor = colors[i];
+		resourceManager.CreateMaterial("Stress_" + std::to_string(i), stressMaterialCI);
+	}
+
+	// 16 x 16 spinning pivots carrying a ring of 16 cubes each, 4096 moving meshes in total
+	size_t gridSize = 16;
+	size_t ringSize = 16;
+
+	for (size_t i = 0; i < gridSize; i++)
+	{
+		for (size_t j = 0; j < gridSize; j++)
+		{
+			lux::scene::Node* pivot = scene.AddNode(nullptr, { TO_FLOAT(i) * 3.f, 0.f, TO_FLOAT(j) * -3.f }, glm::vec3(0.f), false);
+			pivot->SetAngularVelocity({ 0.f, 0.5f + TO_FLOAT((i + j) % 4) * 0.25f, 0.f });
+
+			std::string materialName("Stress_" + std::to_string((i + j) % 4));
+
+			for (size_t k = 0; k < ringSize; k++)
+			{
+				float angle = 2.f * PI * TO_FLOAT(k) / TO_FLOAT(ringSize);
+
+				lux::scene::MeshNode* cube = scene.AddMeshNode(pivot, { cosf(angle), 0.f, sinf(angle) }, { 0.f, -angle, 0.f }, false, lux::resource::MeshPrimitive::MESH_CUBE_PRIMITIVE, materialName);
+				cube->SetLocalScale(glm::vec3(0.15f));
+				cube->SetAngularVelocity({ 1.f, 0.f, 0.f });
+			}
+		}
+	}
+
+	scene.AddLightNode(nullptr, { 0.0f, 0.0f, 0.0f }, glm::radians(glm::vec3(-45.f, 30.f, 0.f)), false, lux::scene::LightType::LIGHT_TYPE_DIRECTIONAL, { 1.0f, 1.0f, 1.0f });
+
+	scene.AddCameraNode(nullptr, { 22.5f, 15.f, 12.f }, glm::radians(glm::vec3(-30.0f, 0.0f, 0.0f)), false, 45.f, 0.01f, 1000.f, true);
+
+	// The rings hide each other, most of their fragments are shaded for nothing without a depth prepass
+	scene.SetIsDepthPrepassEnabled(true);
+}
+
 void AddDirectionalLightDebugMesh(lux::scene::Scene& scene, lux::scene::LightNode* light) noexcept
 {
 	glm::vec3 debugLightScale = glm::vec3(0.05f, 0.05f, 0.3f);
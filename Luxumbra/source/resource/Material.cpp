@@ -1,12 +1,13 @@
-#include "resource\Material.h"
+#include "resource/Material.h"
 
 namespace lux::resource
 {
 
 	Material::Material(const std::string& name, MaterialCreateInfo materialCI) noexcept
-		: name(name), isTransparent(materialCI.isTransparent), 
+		: name(name), isTransparent(materialCI.isTransparent), isAlphaTested(materialCI.albedo != nullptr && materialCI.albedo->hasTransparentTexels),
 		albedo(materialCI.albedo), normal(materialCI.normal),
-		metallicRoughness(materialCI.metallicRoughness), ambientOcclusion(materialCI.ambientOcclusion)
+		metallicRoughness(materialCI.metallicRoughness), ambientOcclusion(materialCI.ambientOcclusion),
+		descriptorPool(VK_NULL_HANDLE), descriptorSet(VK_NULL_HANDLE), materialIndex(UINT32_MAX)
 	{
 		parameter.baseColor = materialCI.baseColor;
 		parameter.reflectance = materialCI.reflectance;
@@ -1,9 +1,10 @@
-#include "resource\Mesh.h"
+#include "resource/Mesh.h"
 
 namespace lux::resource
 {
 
 	Mesh::Mesh() noexcept
+		: indexCount(0), firstIndex(0), vertexOffset(0), vertexCount(0), meshIndex(0), aabb(), isPlanar(false)
 	{
 
 	}
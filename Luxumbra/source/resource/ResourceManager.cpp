@@ -1,15 +1,16 @@
-#include "resource\ResourceManager.h"
+#include "resource/ResourceManager.h"
 
-#include "assimp\Importer.hpp"
-#include "assimp\scene.h"
-#include "assimp\postprocess.h"
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
 
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb\stb_image.h"
+#include "stb/stb_image.h"
 
-#include "glm\gtc\type_ptr.hpp"
+#include "glm/gtc/type_ptr.hpp"
 
 #include "Logger.h"
+#include "CpuProfiler.h"
 
 namespace lux::resource
 {
@@ -141,34 +142,45 @@ namespace lux::resource
 		}
 	}
 
+	static bool IsMeshPlanar(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const AABB& aabb) noexcept
+	{
+		// Plane of the first triangle that is not degenerate
+		glm::vec3 normal(0.f);
+		size_t i = 0;
+
+		for (; i + 2 < indices.size() && glm::dot(normal, normal) == 0.f; i += 3)
+		{
+			const glm::vec3& p0 = vertices[indices[i]].position;
+			normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+		}
+
+		if (glm::dot(normal, normal) == 0.f)
+			return false;
+
+		normal = glm::normalize(normal);
+
+		const glm::vec3& origin = vertices[indices[i - 3]].position;
+		float tolerance = glm::length(aabb.max - aabb.min) * 1e-4f;
+
+		for (const Vertex& vertex : vertices)
+		{
+			if (std::abs(glm::dot(normal, vertex.position - origin)) > tolerance)
+				return false;
+		}
+
+		return true;
+	}
+
 	void ResourceManager::BuildPrimitiveMeshes() noexcept
 	{
 		std::vector<Vertex> sphereVertices;
 		std::vector<uint32_t> sphereIndices;
 
 		GenerateSphere(sphereVertices, sphereIndices, 64, 64);
-		
-		// TODO: use staging buffer
-		rhi::BufferCreateInfo vertexBufferCI = {};
-		vertexBufferCI.usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		vertexBufferCI.size = sizeof(Vertex) * sphereVertices.size();
-		vertexBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		vertexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		vertexBufferCI.data = sphereVertices.data();
-
-		rhi::BufferCreateInfo indexBufferCI = {};
-		indexBufferCI.usageFlags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-		indexBufferCI.size = sizeof(uint32_t) * sphereIndices.size();
-		indexBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		indexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		indexBufferCI.data = sphereIndices.data();
 
 		std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>();
 
-		rhi.CreateBuffer(vertexBufferCI, sphereMesh->vertexBuffer);
-		rhi.CreateBuffer(indexBufferCI, sphereMesh->indexBuffer);
-	
-		sphereMesh->indexCount = TO_UINT32_T(sphereIndices.size());
+		rhi.CreateMeshGeometry(*sphereMesh, sphereVertices, sphereIndices);
 
 		primitiveMeshes[TO_SIZE_T(MeshPrimitive::MESH_SPHERE_PRIMITIVE)] = sphereMesh;
 	}
@@ -236,6 +248,8 @@ namespace lux::resource
 		imageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
 		imageCI.imageData = textureData;
 		imageCI.imageSize = imageSize;
+		imageCI.memoryCategory = rhi::MemoryCategory::MEMORY_CATEGORY_IBL;
+		imageCI.debugName = filenames;
 		
 		rhi::Image source;
 		rhi.CreateImage(imageCI, source);
@@ -253,6 +267,8 @@ namespace lux::resource
 
 	std::shared_ptr<Mesh> ResourceManager::LoadMesh(const std::string& filename, float scale, bool isPrimitive) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
 		Assimp::Importer importer;
 		importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, scale);
@@ -324,24 +340,9 @@ namespace lux::resource
 			}
 		}
 
-		rhi::BufferCreateInfo vertexBufferCI = {};
-		vertexBufferCI.usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		vertexBufferCI.size = sizeof(Vertex) * vertices.size();
-		vertexBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		vertexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		vertexBufferCI.data = vertices.data();
-
-		rhi::BufferCreateInfo indexBufferCI = {};
-		indexBufferCI.usageFlags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-		indexBufferCI.size = sizeof(uint32_t) * indices.size();
-		indexBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		indexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		indexBufferCI.data = indices.data();
-
-		rhi.CreateBuffer(vertexBufferCI, mesh->vertexBuffer);
-		rhi.CreateBuffer(indexBufferCI, mesh->indexBuffer);
+		mesh->isPlanar = IsMeshPlanar(vertices, indices, mesh->aabb);
 
-		mesh->indexCount = TO_UINT32_T(indices.size());
+		rhi.CreateMeshGeometry(*mesh, vertices, indices);
 
 		if (isPrimitive == false)
 			meshes[filename] = mesh;
@@ -351,6 +352,8 @@ namespace lux::resource
 
 	std::shared_ptr<Texture> ResourceManager::LoadTexture(const std::string& filename, bool generateMipMap, bool isPrimitive) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		std::shared_ptr<Texture> texture = std::make_shared<Texture>();
 
 		int textureWidth, textureHeight, textureChannels;
@@ -359,6 +362,15 @@ namespace lux::resource
 	
 		uint64_t imageSize = textureWidth * textureHeight * 4;
 
+		for (uint64_t i = 3; i < imageSize; i += 4)
+		{
+			if (textureData[i] == 0)
+			{
+				texture->hasTransparentTexels = true;
+				break;
+			}
+		}
+
 		rhi::ImageCreateInfo imageCI = {};
 		imageCI.format = VK_FORMAT_R8G8B8A8_UNORM;
 		imageCI.width = TO_UINT32_T(textureWidth);
@@ -371,6 +383,8 @@ namespace lux::resource
 		imageCI.imageData = textureData;
 		imageCI.imageSize = imageSize;
 		imageCI.mipmapCount = static_cast<uint32_t>(std::floor(std::log2(std::max(textureWidth, textureHeight)))) + 1;
+		imageCI.memoryCategory = rhi::MemoryCategory::MEMORY_CATEGORY_TEXTURE;
+		imageCI.debugName = filename;
 
 		rhi.CreateImage(imageCI, texture->image, &texture->sampler);
 
@@ -389,16 +403,14 @@ namespace lux::resource
 
 		for (; it != itE; ++it)
 		{
-			rhi.DestroyBuffer(it->second->vertexBuffer);
-			rhi.DestroyBuffer(it->second->indexBuffer);
+			rhi.DestroyMeshGeometry(*it->second);
 		}
 
 		meshes.clear();
 
 		for (size_t i = 0; i < primitiveMeshes.size(); i++)
 		{
-			rhi.DestroyBuffer(primitiveMeshes[i]->vertexBuffer);
-			rhi.DestroyBuffer(primitiveMeshes[i]->indexBuffer);
+			rhi.DestroyMeshGeometry(*primitiveMeshes[i]);
 		}
 	}
 
@@ -1,4 +1,4 @@
-#include "resource\Texture.h"
+#include "resource/Texture.h"
 
 namespace lux::resource
 {
@@ -6,7 +6,7 @@ namespace lux::resource
 	using namespace lux;
 
 	Texture::Texture() noexcept
-		: sampler(VK_NULL_HANDLE)
+		: sampler(VK_NULL_HANDLE), hasTransparentTexels(false)
 	{
 
 	}
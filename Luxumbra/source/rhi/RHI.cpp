@@ -1,24 +1,29 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
 
 #include <array>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 
-#include "imgui\imgui.h"
-#include "imgui\imgui_impl_vulkan.h"
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_vulkan.h"
 
-#include "resource\ResourceManager.h"
+#include "resource/ResourceManager.h"
+#include "Logger.h"
+#include "CpuProfiler.h"
 
 namespace lux::rhi
 {
 	RHI::RHI() noexcept
-		: isInitialized(false), instance(VK_NULL_HANDLE), surface(VK_NULL_HANDLE), physicalDevice(VK_NULL_HANDLE), device(VK_NULL_HANDLE),
+		: isInitialized(false), isHeadless(false), isCpuCullingEnabled(true), instance(VK_NULL_HANDLE), surface(VK_NULL_HANDLE), physicalDevice(VK_NULL_HANDLE), device(VK_NULL_HANDLE),
 		graphicsQueueIndex(UINT32_MAX), presentQueueIndex(UINT32_MAX), computeQueueIndex(UINT32_MAX), graphicsQueue(VK_NULL_HANDLE), presentQueue(VK_NULL_HANDLE), computeQueue(VK_NULL_HANDLE),
 		swapchainImageFormat(VK_FORMAT_UNDEFINED), swapchainExtent({ 0, 0 }), swapchainImageSubresourceRange{}, swapchain(VK_NULL_HANDLE),
-		swapchainImageCount(0), swapchainImages(0), swapchainImageViews(0), msaaSamples(VK_SAMPLE_COUNT_1_BIT),
+		swapchainImageCount(0), swapchainImages(0), swapchainImageViews(0), offscreenImageAllocations(0), msaaSamples(VK_SAMPLE_COUNT_1_BIT),
 		presentSemaphores(0), acquireSemaphores(0), fences(0),
-		imguiDescriptorPool(VK_NULL_HANDLE), materialDescriptorPool(VK_NULL_HANDLE), commandPool(VK_NULL_HANDLE), commandBuffers(0),
+		imguiDescriptorPool(VK_NULL_HANDLE), materialDescriptorPools(0), commandPool(VK_NULL_HANDLE), commandBuffers(0),
 		computeCommandPool(VK_NULL_HANDLE),
-		directionalLightUniformBuffers(0), pointLightUniformBuffers(0), lightCountsPushConstant(), frameCount(0), currentFrame(0), cube(nullptr),
-		shadowMapper(), forward()
+		directionalLightUniformOffset(0), pointLightUniformOffset(0), lightCountsPushConstant(), frameCount(0), currentFrame(0), cube(nullptr),
+		shadowMapper(), memoryAllocator(), uniformRingBuffer(), meshArena(), materialTable(), lightClusterer(), uploadBatch(), dynamicResolution(), forward()
 #ifdef VULKAN_ENABLE_VALIDATION
 		, debugReportCallback(VK_NULL_HANDLE)
 #endif // VULKAN_ENABLE_VALIDATION
@@ -30,23 +35,50 @@ namespace lux::rhi
 	{
 		vkDeviceWaitIdle(device);
 
-		vkDestroyDescriptorPool(device, imguiDescriptorPool, nullptr);
-		ImGui_ImplVulkan_Shutdown();
+		if (!isHeadless)
+		{
+			vkDestroyDescriptorPool(device, imguiDescriptorPool, nullptr);
+			ImGui_ImplVulkan_Shutdown();
+		}
 
 		DestroyShadowMapper();
 
+		DestroyUploadBatch();
+
+		DestroyParallelRecorder();
+
+		DestroyGpuProfiler();
+
 		DestroySwapchainRelatedResources();
 
 		DestroyComputeRelatedResources();
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		for (size_t i = 0; i < presentSemaphores.size(); i++)
 		{
 			vkDestroySemaphore(device, presentSemaphores[i], nullptr);
+		}
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
 			vkDestroySemaphore(device, acquireSemaphores[i], nullptr);
 			vkDestroyFence(device, fences[i], nullptr);
 		}
 
-		vkDestroyFence(device, shadowFence, nullptr);
+		DestroyUniformRingBuffer();
+
+		DestroyMeshArena();
+
+		DestroyInstanceBuffer();
+
+		DestroyDrawCommandBuffer();
+
+		DestroyGpuCulling();
+
+		DestroyMaterialTable();
+
+		DestroyLightClusters();
+
+		DestroyMemoryAllocator();
 
 		vkDestroyDevice(device, nullptr);
 
@@ -54,21 +86,48 @@ namespace lux::rhi
 		vkDestroyDebugReportCallbackEXT(instance, debugReportCallback, nullptr);
 #endif
 
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+		// The surface functions are not loaded without the surface extension
+		if (surface != VK_NULL_HANDLE)
+			vkDestroySurfaceKHR(instance, surface, nullptr);
 		
 		vkDestroyInstance(instance, nullptr);
 	}
 
-	bool RHI::Initialize(const Window& window) noexcept
+	bool RHI::Initialize(const Window& window, JobSystem& jobSystem) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		CHECK_VK(volkInitialize());
 
+		isHeadless = window.GetIsHeadless();
+
 		InitInstanceAndDevice(window);
 
+		InitMemoryAllocator();
+
+		if (isHeadless)
+			swapchainExtent = { window.GetWidth(), window.GetHeight() };
+
 		InitSwapchain();
 
 		InitCommandBuffer();
 
+		InitUploadBatch();
+
+		InitParallelRecorder(jobSystem);
+
+		InitGpuProfiler();
+
+		InitUniformRingBuffer();
+
+		InitMeshArena();
+
+		InitInstanceBuffer();
+
+		InitDrawCommandBuffer();
+
+		InitGpuCulling();
+
 		// Shadow mapper
 
 		InitShadowMapperRenderPasses();
@@ -91,17 +150,22 @@ namespace lux::rhi
 		
 		InitForwardGraphicsPipelines();
 
-		InitForwardUniformBuffers();
+		InitForwardDescriptorSets();
 
-		BuildLightUniformBuffers(2);
+		InitHiZPyramid();
 
-		InitForwardDescriptorSets();
+		InitDynamicResolution();
+
+		InitMaterialTable();
+
+		InitLightClusters();
 
 		GenerateSSAOKernels();
 
 		// End
 
-		InitImgui();
+		if (!isHeadless)
+			InitImgui();
 
 		isInitialized = true;
 
@@ -121,13 +185,19 @@ namespace lux::rhi
 		appInfo.apiVersion = VK_API_VERSION_1_0;
 
 		std::vector<const char*> enabledExtensionNames = {
-			VK_KHR_SURFACE_EXTENSION_NAME,
-			VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
 	#ifdef VULKAN_ENABLE_VALIDATION
 			VK_EXT_DEBUG_REPORT_EXTENSION_NAME
 	#endif // VULKAN_ENABLE_VALIDATION
 		};
 
+		if (!isHeadless)
+		{
+			enabledExtensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#if defined(_WIN32)
+			enabledExtensionNames.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif // defined(_WIN32)
+		}
+
 		std::vector<const char*> enabledLayerNames = {
 #ifdef VULKAN_ENABLE_VALIDATION
 			"VK_LAYER_LUNARG_standard_validation"
@@ -163,12 +233,15 @@ namespace lux::rhi
 #endif // VULKAN_ENABLE_VALIDATION
 
 #if defined(_WIN32)
-		VkWin32SurfaceCreateInfoKHR win32SurfaceCI = {};
-		win32SurfaceCI.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-		win32SurfaceCI.hinstance = GetModuleHandle(nullptr);
-		win32SurfaceCI.hwnd = window.GetHandle();
+		if (!isHeadless)
+		{
+			VkWin32SurfaceCreateInfoKHR win32SurfaceCI = {};
+			win32SurfaceCI.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+			win32SurfaceCI.hinstance = GetModuleHandle(nullptr);
+			win32SurfaceCI.hwnd = window.GetHandle();
 
-		CHECK_VK(vkCreateWin32SurfaceKHR(instance, &win32SurfaceCI, nullptr, &surface));
+			CHECK_VK(vkCreateWin32SurfaceKHR(instance, &win32SurfaceCI, nullptr, &surface));
+		}
 #endif // defined(_WIN32)
 
 		// Physical device
@@ -182,12 +255,35 @@ namespace lux::rhi
 		VkPhysicalDeviceProperties physicalDeviceProperties;
 		std::string swapChainExtensionName(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+		// Discrete GPUs first, CPU implementations such as lavapipe are the last resort
+		auto getPhysicalDeviceTypeScore = [](VkPhysicalDeviceType type) -> int32_t
+		{
+			switch (type)
+			{
+			case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 4;
+			case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+			case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 2;
+			case VK_PHYSICAL_DEVICE_TYPE_CPU: return 1;
+			default: return 0;
+			}
+		};
+
+		int32_t bestPhysicalDeviceScore = -1;
+
 		for (uint32_t i = 0; i < availablePhysicalDeviceCount; i++)
 		{
 			VkPhysicalDevice availablePhysicalDevice = availablePhysicalDevices[TO_SIZE_T(i)];
 
 			vkGetPhysicalDeviceProperties(availablePhysicalDevice, &physicalDeviceProperties);
-			if (physicalDeviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+			int32_t physicalDeviceScore = getPhysicalDeviceTypeScore(physicalDeviceProperties.deviceType);
+
+			if (physicalDeviceScore <= bestPhysicalDeviceScore)
+				continue;
+
+			// Headless rendering never presents, it does not need the swapchain extension
+			bool foundSwapChainExtension = isHeadless;
+
+			if (!foundSwapChainExtension)
 			{
 				uint32_t physicalDeviceExtensionCount;
 				vkEnumerateDeviceExtensionProperties(availablePhysicalDevice, nullptr, &physicalDeviceExtensionCount, nullptr);
@@ -195,8 +291,6 @@ namespace lux::rhi
 				std::vector<VkExtensionProperties> physicalDeviceExtensionsProperties(TO_SIZE_T(physicalDeviceExtensionCount));
 				vkEnumerateDeviceExtensionProperties(availablePhysicalDevice, nullptr, &physicalDeviceExtensionCount, physicalDeviceExtensionsProperties.data());
 
-				bool foundSwapChainExtension = false;
-
 				for (uint32_t j = 0; j < physicalDeviceExtensionCount; j++)
 				{
 					const VkExtensionProperties& extensionProperties = physicalDeviceExtensionsProperties[TO_SIZE_T(j)];
@@ -206,17 +300,20 @@ namespace lux::rhi
 						break;
 					}
 				}
+			}
 
-				if (foundSwapChainExtension)
-				{
-					physicalDevice = availablePhysicalDevice;
-					break;
-				}
+			if (foundSwapChainExtension)
+			{
+				physicalDevice = availablePhysicalDevice;
+				bestPhysicalDeviceScore = physicalDeviceScore;
 			}
 		}
 
 		ASSERT(physicalDevice != VK_NULL_HANDLE);
 
+		vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Using physical device ", physicalDeviceProperties.deviceName);
+
 		// MSAA 
 		VkSampleCountFlags counts = std::min(physicalDeviceProperties.limits.framebufferColorSampleCounts, physicalDeviceProperties.limits.framebufferDepthSampleCounts);
 
@@ -259,7 +356,7 @@ namespace lux::rhi
 				foundComputeQueue = true;
 			}
 
-			if (!foundPresentQueue)
+			if (!foundPresentQueue && !isHeadless)
 			{
 				VkBool32 surfaceSupported;
 				CHECK_VK(vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &surfaceSupported));
@@ -275,6 +372,13 @@ namespace lux::rhi
 				break;
 		}
 
+		// Without presentation the frames are submitted on the graphics queue
+		if (isHeadless)
+		{
+			presentQueueIndex = graphicsQueueIndex;
+			foundPresentQueue = true;
+		}
+
 		if (!foundComputeQueue)
 		{
 			for (uint32_t i = 0; i < queueFamilieCount; i++)
@@ -321,9 +425,25 @@ namespace lux::rhi
 			deviceQueueCIs.push_back(computeQueueCI);
 		}
 
+		VkPhysicalDeviceFeatures supportedPhysicalDeviceFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedPhysicalDeviceFeatures);
+
 		VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
 
-		std::vector<const char*> deviceExtensionNames{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		// Instanced batches are drawn indirectly, their firstInstance locates the per draw data
+		physicalDeviceFeatures.drawIndirectFirstInstance = supportedPhysicalDeviceFeatures.drawIndirectFirstInstance;
+		physicalDeviceFeatures.multiDrawIndirect = supportedPhysicalDeviceFeatures.multiDrawIndirect;
+
+		drawCommandBuffer.isIndirectFirstInstanceSupported = physicalDeviceFeatures.drawIndirectFirstInstance == VK_TRUE;
+		drawCommandBuffer.isMultiDrawIndirectSupported = physicalDeviceFeatures.multiDrawIndirect == VK_TRUE;
+
+		if (!drawCommandBuffer.isIndirectFirstInstanceSupported)
+			Logger::Log(LogLevel::LOG_LEVEL_WARNING, "drawIndirectFirstInstance is not supported, draws are recorded directly");
+
+		std::vector<const char*> deviceExtensionNames;
+
+		if (!isHeadless)
+			deviceExtensionNames.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 		std::vector<const char*> deviceLayerNames{
 #ifdef VULKAN_ENABLE_VALIDATION
 			"VK_LAYER_LUNARG_standard_validation"
@@ -354,6 +474,69 @@ namespace lux::rhi
 	}
 
 	void RHI::InitSwapchain() noexcept
+	{
+		if (isHeadless)
+			CreateOffscreenImages();
+		else
+			CreateSwapchain();
+
+		swapchainImageViews.resize(TO_SIZE_T(swapchainImageCount));
+
+		swapchainImageSubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		swapchainImageSubresourceRange.baseMipLevel = 0;
+		swapchainImageSubresourceRange.levelCount = 1;
+		swapchainImageSubresourceRange.baseArrayLayer = 0;
+		swapchainImageSubresourceRange.layerCount = 1;
+
+		VkImageViewCreateInfo swapchainImageViewCI = {};
+		swapchainImageViewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		swapchainImageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		swapchainImageViewCI.format = swapchainImageFormat;
+		swapchainImageViewCI.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		swapchainImageViewCI.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		swapchainImageViewCI.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		swapchainImageViewCI.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		swapchainImageViewCI.subresourceRange = swapchainImageSubresourceRange;
+
+		for (uint32_t i = 0; i < swapchainImageCount; i++)
+		{
+			swapchainImageViewCI.image = swapchainImages[TO_SIZE_T(i)];
+
+			CHECK_VK(vkCreateImageView(device, &swapchainImageViewCI, nullptr, &swapchainImageViews[TO_SIZE_T(i)]));
+		}
+	
+		// Fences and semaphores
+		VkSemaphoreCreateInfo rtSemaphoreCI = {};
+		rtSemaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		VkFenceCreateInfo rtFenceCI = {};
+		rtFenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		rtFenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+
+		// Present semaphores are waited on by the presentation engine, one per swapchain image
+		presentSemaphores.resize(TO_SIZE_T(swapchainImageCount));
+
+		for (size_t i = 0; i < swapchainImageCount; i++)
+		{
+			CHECK_VK(vkCreateSemaphore(device, &rtSemaphoreCI, nullptr, &presentSemaphores[i]));
+		}
+
+		acquireSemaphores.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
+		fences.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			CHECK_VK(vkCreateSemaphore(device, &rtSemaphoreCI, nullptr, &acquireSemaphores[i]));
+
+			CHECK_VK(vkCreateFence(device, &rtFenceCI, nullptr, &fences[i]));
+		}
+
+
+		materialDescriptorPools.push_back(CreateMaterialDescriptorPool());
+	}
+
+	void RHI::CreateSwapchain() noexcept
 	{
 		VkSurfaceCapabilitiesKHR surfaceCapabilities;
 		CHECK_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities));
@@ -437,74 +620,48 @@ namespace lux::rhi
 
 		swapchainImages.resize(TO_SIZE_T(swapchainImageCount));
 		CHECK_VK(vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, swapchainImages.data()));
+	}
 
-		swapchainImageViews.resize(TO_SIZE_T(swapchainImageCount));
+	void RHI::CreateOffscreenImages() noexcept
+	{
+		// One image per frame in flight, the frame fence protects it like an acquired swapchain image
+		swapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		swapchainImageCount = MAX_FRAMES_IN_FLIGHT;
+
+		VkImageCreateInfo offscreenImageCI = {};
+		offscreenImageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		offscreenImageCI.imageType = VK_IMAGE_TYPE_2D;
+		offscreenImageCI.format = swapchainImageFormat;
+		offscreenImageCI.extent = { swapchainExtent.width, swapchainExtent.height, 1 };
+		offscreenImageCI.mipLevels = 1;
+		offscreenImageCI.arrayLayers = 1;
+		offscreenImageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+		offscreenImageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+		offscreenImageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		offscreenImageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		offscreenImageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-		swapchainImageSubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		swapchainImageSubresourceRange.baseMipLevel = 0;
-		swapchainImageSubresourceRange.levelCount = 1;
-		swapchainImageSubresourceRange.baseArrayLayer = 0;
-		swapchainImageSubresourceRange.layerCount = 1;
+		swapchainImages.resize(TO_SIZE_T(swapchainImageCount));
+		offscreenImageAllocations.resize(TO_SIZE_T(swapchainImageCount));
 
-		VkImageViewCreateInfo swapchainImageViewCI = {};
-		swapchainImageViewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		swapchainImageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		swapchainImageViewCI.format = swapchainImageFormat;
-		swapchainImageViewCI.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		swapchainImageViewCI.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		swapchainImageViewCI.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		swapchainImageViewCI.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-		swapchainImageViewCI.subresourceRange = swapchainImageSubresourceRange;
+		VkMemoryRequirements memoryRequirements;
 
 		for (uint32_t i = 0; i < swapchainImageCount; i++)
 		{
-			swapchainImageViewCI.image = swapchainImages[TO_SIZE_T(i)];
+			VkImage& offscreenImage = swapchainImages[TO_SIZE_T(i)];
+			MemoryAllocation& offscreenImageAllocation = offscreenImageAllocations[TO_SIZE_T(i)];
 
-			CHECK_VK(vkCreateImageView(device, &swapchainImageViewCI, nullptr, &swapchainImageViews[TO_SIZE_T(i)]));
-		}
-	
-		// Fences and semaphores
-		VkSemaphoreCreateInfo rtSemaphoreCI = {};
-		rtSemaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			CHECK_VK(vkCreateImage(device, &offscreenImageCI, nullptr, &offscreenImage));
 
-		VkFenceCreateInfo rtFenceCI = {};
-		rtFenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		rtFenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-
-		presentSemaphores.resize(TO_SIZE_T(swapchainImageCount));
-		acquireSemaphores.resize(TO_SIZE_T(swapchainImageCount));
-		fences.resize(TO_SIZE_T(swapchainImageCount));
-
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			CHECK_VK(vkCreateSemaphore(device, &rtSemaphoreCI, nullptr, &presentSemaphores[i]));
-			CHECK_VK(vkCreateSemaphore(device, &rtSemaphoreCI, nullptr, &acquireSemaphores[i]));
+			vkGetImageMemoryRequirements(device, offscreenImage, &memoryRequirements);
+			if (AllocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, MemoryCategory::MEMORY_CATEGORY_ATTACHMENT, "Offscreen Image " + std::to_string(i), offscreenImageAllocation) == false)
+			{
+				Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate the memory of offscreen image ", i);
+				std::abort();
+			}
 
-			CHECK_VK(vkCreateFence(device, &rtFenceCI, nullptr, &fences[i]));
+			CHECK_VK(vkBindImageMemory(device, offscreenImage, offscreenImageAllocation.memory, offscreenImageAllocation.offset));
 		}
-
-		rtFenceCI.flags = 0;
-		CHECK_VK(vkCreateFence(device, &rtFenceCI, nullptr, &shadowFence));
-
-
-		VkDescriptorPoolSize materialsUniformDescriptorPoolSize = {};
-		materialsUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		materialsUniformDescriptorPoolSize.descriptorCount = swapchainImageCount * MATERIAL_MAX_SET;
-
-		VkDescriptorPoolSize materialsSamplerDescriptorPoolSize = {};
-		materialsSamplerDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		materialsSamplerDescriptorPoolSize.descriptorCount = swapchainImageCount * 4 * MATERIAL_MAX_SET;
-
-		std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes = { materialsUniformDescriptorPoolSize, materialsSamplerDescriptorPoolSize };
-
-		VkDescriptorPoolCreateInfo descriptorPoolCI = {};
-		descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		descriptorPoolCI.poolSizeCount = TO_UINT32_T(descriptorPoolSizes.size());
-		descriptorPoolCI.pPoolSizes = descriptorPoolSizes.data();
-		descriptorPoolCI.maxSets = swapchainImageCount * MATERIAL_MAX_SET;
-
-		CHECK_VK(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &materialDescriptorPool));
 	}
 
 	void RHI::InitCommandBuffer() noexcept
@@ -520,10 +677,10 @@ namespace lux::rhi
 		VkCommandBufferAllocateInfo commandBufferAI = {};
 		commandBufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		commandBufferAI.commandPool = commandPool;
-		commandBufferAI.commandBufferCount = swapchainImageCount;
+		commandBufferAI.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
 		commandBufferAI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-		commandBuffers.resize(TO_SIZE_T(swapchainImageCount));
+		commandBuffers.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
 		CHECK_VK(vkAllocateCommandBuffers(device, &commandBufferAI, commandBuffers.data()));
 
 
@@ -539,6 +696,8 @@ namespace lux::rhi
 
 	void RHI::Render(const scene::CameraNode* camera, const std::vector<scene::MeshNode*> meshes, const std::vector<scene::LightNode*>& lights) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		// Acquire next image
 		VkFence* fence = &fences[currentFrame];
 		VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
@@ -547,14 +706,50 @@ namespace lux::rhi
 		vkResetFences(device, 1, fence);
 		vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
 
+		BeginUniformRingBufferFrame();
+
+		BeginInstanceBufferFrame();
+
+		BeginDrawCommandBufferFrame();
+
+		BeginGpuCullingFrame();
+
+		BeginParallelRecordingFrame();
+
+		BeginGpuProfilerFrame();
+
+		UpdateDynamicResolution();
+
 		VkSemaphore* acquireSemaphore = &acquireSemaphores[currentFrame];
-		VkSemaphore* presentSemaphore = &presentSemaphores[currentFrame];
 
 		uint32_t imageIndex;
 		uint64_t timeout = UINT64_MAX;
 
-		CHECK_VK(vkAcquireNextImageKHR(device, swapchain, timeout, *acquireSemaphore, VK_NULL_HANDLE, &imageIndex));
+		// Offscreen images follow the frames in flight, the fence waited on above already made this one available
+		if (isHeadless)
+			imageIndex = currentFrame;
+		else
+			CHECK_VK(vkAcquireNextImageKHR(device, swapchain, timeout, *acquireSemaphore, VK_NULL_HANDLE, &imageIndex));
+
+		VkSemaphore* presentSemaphore = &presentSemaphores[imageIndex];
+
+
+		std::chrono::steady_clock::time_point recordingStartTime = std::chrono::steady_clock::now();
+
+		// Uniforms are pushed on this thread, then the render pass contents are recorded in parallel
+		PrepareShadowMaps(lights, meshes);
+
+		PrepareForward(camera, meshes);
+
+		UploadInstanceBuffer();
+
+		UploadDrawCommandBuffer();
+
+		UploadGpuCulling();
+
+		UploadMaterialTable();
 
+		ExecuteRecordingTasks();
 
 		// Begin Command Buffer
 		VkCommandBufferBeginInfo commandBufferBI = {};
@@ -563,48 +758,53 @@ namespace lux::rhi
 
 		CHECK_VK(vkBeginCommandBuffer(commandBuffer, &commandBufferBI));
 
-		RenderShadowMaps(commandBuffer, lights, meshes);
-
-		CHECK_VK(vkEndCommandBuffer(commandBuffer));
-		
-		VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-		submitInfo.pWaitDstStageMask = &stageMask;
+		CommandResetGpuProfiler(commandBuffer);
 
+		uint32_t frameScope = AddGpuTimestampScope("Frame");
+		CommandBeginGpuTimestamp(commandBuffer, frameScope);
 
-		CHECK_VK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, shadowFence));
+		// Fills the instance counts of the culled draw records read by every pass below, the occluded ones are re-tested in the forward pass
+		CommandDispatchGpuCulling(commandBuffer, GpuCullingPhase::GPU_CULLING_PHASE_EARLY);
 
-		vkWaitForFences(device, 1, &shadowFence, false, UINT64_MAX);
-		vkResetFences(device, 1, &shadowFence);
-		vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
-		
-		CHECK_VK(vkBeginCommandBuffer(commandBuffer, &commandBufferBI));
+		// Shadow maps are recorded in the frame command buffer, their barriers make them visible to the forward pass
+		RenderShadowMaps(commandBuffer);
 
-		RenderForward(commandBuffer, imageIndex, camera, meshes, lights);
+		RenderForward(commandBuffer);
 
 		RenderPostProcess(commandBuffer, imageIndex, camera);
 
+		CommandEndGpuTimestamp(commandBuffer, frameScope);
+
 		CHECK_VK(vkEndCommandBuffer(commandBuffer));
 
+		std::chrono::duration<float, std::milli> recordingTime = std::chrono::steady_clock::now() - recordingStartTime;
+		parallelRecorder.lastRecordingTime = recordingTime.count();
+
 		// Submit Command Buffer
 
+		// Only the swapchain writes wait for the acquire, the shadow passes can start right away
+		VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
-		submitInfo = {};
+		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 		submitInfo.pWaitDstStageMask = &stageMask;
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = isHeadless ? 0 : 1;
 		submitInfo.pWaitSemaphores = acquireSemaphore;
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = isHeadless ? 0 : 1;
 		submitInfo.pSignalSemaphores = presentSemaphore;
 
 		CHECK_VK(vkQueueSubmit(presentQueue, 1, &submitInfo, *fence));
 
+		if (isHeadless)
+		{
+			frameCount++;
+			currentFrame = frameCount % MAX_FRAMES_IN_FLIGHT;
+
+			return;
+		}
+
 
 		// Present
 		VkPresentInfoKHR presentInfo = {};
@@ -618,7 +818,7 @@ namespace lux::rhi
 		CHECK_VK(vkQueuePresentKHR(graphicsQueue, &presentInfo));
 
 		frameCount++;
-		currentFrame = frameCount % swapchainImageCount;
+		currentFrame = frameCount % MAX_FRAMES_IN_FLIGHT;
 	}
 
 	void RHI::InitImgui() noexcept
@@ -657,7 +857,8 @@ namespace lux::rhi
 		imguiInitInfo.DescriptorPool = imguiDescriptorPool;
 		imguiInitInfo.Allocator = VK_NULL_HANDLE;
 		imguiInitInfo.MinImageCount = SWAPCHAIN_MIN_IMAGE_COUNT;
-		imguiInitInfo.ImageCount = swapchainImageCount;
+		// ImGui rotates its vertex buffers over ImageCount frames, it must cover every frame in flight
+		imguiInitInfo.ImageCount = std::max(swapchainImageCount, TO_UINT32_T(MAX_FRAMES_IN_FLIGHT));
 		imguiInitInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 
 		ImGui_ImplVulkan_Init(&imguiInitInfo, forward.blitRenderPass);
@@ -702,57 +903,80 @@ namespace lux::rhi
 		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffers[currentFrame]);
 	}
 
-	void RHI::BuildLightUniformBuffers(size_t lightCount) noexcept
+	VkDescriptorPool RHI::CreateMaterialDescriptorPool() noexcept
 	{
-		BufferCreateInfo lightBufferCI = {};
-		lightBufferCI.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		lightBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		lightBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		VkDescriptorPoolSize materialsSamplerDescriptorPoolSize = {};
+		materialsSamplerDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		materialsSamplerDescriptorPoolSize.descriptorCount = 4 * MATERIAL_DESCRIPTOR_POOL_SET_COUNT;
 
-		lightBufferCI.size = sizeof(DirectionalLightBuffer) * DIRECTIONAL_LIGHT_MAX_COUNT;
-		directionalLightUniformBuffers.resize(TO_SIZE_T(swapchainImageCount));
-		for (size_t i = 0; i < swapchainImageCount; i++)
-			CreateBuffer(lightBufferCI, directionalLightUniformBuffers[i]);
+		VkDescriptorPoolCreateInfo descriptorPoolCI = {};
+		descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCI.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		descriptorPoolCI.poolSizeCount = 1;
+		descriptorPoolCI.pPoolSizes = &materialsSamplerDescriptorPoolSize;
+		descriptorPoolCI.maxSets = MATERIAL_DESCRIPTOR_POOL_SET_COUNT;
 
-		lightBufferCI.size = sizeof(PointLightBuffer) * POINT_LIGHT_MAX_COUNT;
-		pointLightUniformBuffers.resize(TO_SIZE_T(swapchainImageCount));
-		for (size_t i = 0; i < swapchainImageCount; i++)
-			CreateBuffer(lightBufferCI, pointLightUniformBuffers[i]);
+		VkDescriptorPool descriptorPool;
+		CHECK_VK(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &descriptorPool));
+
+		return descriptorPool;
 	}
 
 	void RHI::CreateMaterial(resource::Material& material) noexcept
 	{
-		material.buffer.resize(TO_SIZE_T(swapchainImageCount));
-		material.descriptorSet.resize(TO_SIZE_T(swapchainImageCount));
+		// Parameters
+		if (materialTable.freeIndices.empty() == false)
+		{
+			material.materialIndex = materialTable.freeIndices.back();
+			materialTable.freeIndices.pop_back();
+		}
+		else
+		{
+			// The material index is packed in the draw keys, materials sharing its key bits would be drawn with the same bindings
+			if (materialTable.entries.size() >= (1ull << RENDER_QUEUE_MATERIAL_BITS))
+			{
+				Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to create material, the draw keys hold at most ", 1u << RENDER_QUEUE_MATERIAL_BITS, " materials");
+				std::abort();
+			}
 
+			material.materialIndex = TO_UINT32_T(materialTable.entries.size());
+			materialTable.entries.emplace_back();
+		}
 
-		std::vector<VkDescriptorSetLayout> materialDescriptorSetLayout(swapchainImageCount, forward.rtGraphicsPipeline.materialDescriptorSetLayout);
-		VkDescriptorSetAllocateInfo materialDescriptorSetAI = {};
-		materialDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		materialDescriptorSetAI.descriptorPool = materialDescriptorPool;
-		materialDescriptorSetAI.descriptorSetCount = swapchainImageCount;
-		materialDescriptorSetAI.pSetLayouts = materialDescriptorSetLayout.data();
+		if (material.materialIndex >= materialTable.capacity)
+		{
+			// The table is read by frames in flight, grow it while the device is idle
+			WaitIdle();
 
-		CHECK_VK(vkAllocateDescriptorSets(device, &materialDescriptorSetAI, material.descriptorSet.data()));
+			uint32_t capacity = materialTable.capacity;
+			while (material.materialIndex >= capacity)
+				capacity *= 2;
 
-		// Parameters
-		VkWriteDescriptorSet writeMaterialParametersDescriptorSet = {};
-		writeMaterialParametersDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeMaterialParametersDescriptorSet.descriptorCount = 1;
-		writeMaterialParametersDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeMaterialParametersDescriptorSet.dstBinding = 0;
-		writeMaterialParametersDescriptorSet.dstArrayElement = 0;
+			DestroyBuffer(materialTable.buffer);
+			CreateMaterialTableBuffer(capacity);
 
-		VkDescriptorBufferInfo materialParametersDescriptorBufferInfo = {};
-		materialParametersDescriptorBufferInfo.offset = 0;
-		materialParametersDescriptorBufferInfo.range = sizeof(resource::MaterialParameters);
+			for (uint32_t i = 0; i < TO_UINT32_T(materialTable.entries.size()); i++)
+				MarkMaterialTableEntryDirty(i);
+		}
 
+		UpdateMaterial(material);
 
-		BufferCreateInfo materialBufferCI = {};
-		materialBufferCI.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		materialBufferCI.size = sizeof(resource::MaterialParameters);
-		materialBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		materialBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		// Textures, a new pool is created when the current one is full
+		VkDescriptorSetAllocateInfo materialDescriptorSetAI = {};
+		materialDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		materialDescriptorSetAI.descriptorPool = materialDescriptorPools.back();
+		materialDescriptorSetAI.descriptorSetCount = 1;
+		materialDescriptorSetAI.pSetLayouts = &forward.rtGraphicsPipeline.materialDescriptorSetLayout;
+
+		if (vkAllocateDescriptorSets(device, &materialDescriptorSetAI, &material.descriptorSet) != VK_SUCCESS)
+		{
+			materialDescriptorPools.push_back(CreateMaterialDescriptorPool());
+			materialDescriptorSetAI.descriptorPool = materialDescriptorPools.back();
+
+			CHECK_VK(vkAllocateDescriptorSets(device, &materialDescriptorSetAI, &material.descriptorSet));
+		}
+
+		material.descriptorPool = materialDescriptorSetAI.descriptorPool;
 
 
 		// Albedo
@@ -816,62 +1040,58 @@ namespace lux::rhi
 		writeMaterialAmbientOcclusionDescriptorSet.pImageInfo = &materialAmbientOcclusionDescriptorImageInfo;
 
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			CreateBuffer(materialBufferCI, material.buffer[i]);
-
-			materialParametersDescriptorBufferInfo.buffer = material.buffer[i].buffer;
-			writeMaterialParametersDescriptorSet.pBufferInfo = &materialParametersDescriptorBufferInfo;
-			writeMaterialParametersDescriptorSet.dstSet = material.descriptorSet[i];
-
-			writeMaterialAlbedoDescriptorSet.dstSet = material.descriptorSet[i];
-			writeMaterialNormalDescriptorSet.dstSet = material.descriptorSet[i];
-			writeMaterialMetallicRoughnessDescriptorSet.dstSet = material.descriptorSet[i];
-			writeMaterialAmbientOcclusionDescriptorSet.dstSet = material.descriptorSet[i];
-
-			std::array<VkWriteDescriptorSet, 5> writeDescriptorSets = 
-			{ 
-				writeMaterialParametersDescriptorSet, 
-				writeMaterialAlbedoDescriptorSet, 
-				writeMaterialNormalDescriptorSet,
-				writeMaterialMetallicRoughnessDescriptorSet,
-				writeMaterialAmbientOcclusionDescriptorSet
-			};
-
-			vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
-		}
+		writeMaterialAlbedoDescriptorSet.dstSet = material.descriptorSet;
+		writeMaterialNormalDescriptorSet.dstSet = material.descriptorSet;
+		writeMaterialMetallicRoughnessDescriptorSet.dstSet = material.descriptorSet;
+		writeMaterialAmbientOcclusionDescriptorSet.dstSet = material.descriptorSet;
+
+		std::array<VkWriteDescriptorSet, 4> writeDescriptorSets = 
+		{ 
+			writeMaterialAlbedoDescriptorSet, 
+			writeMaterialNormalDescriptorSet,
+			writeMaterialMetallicRoughnessDescriptorSet,
+			writeMaterialAmbientOcclusionDescriptorSet
+		};
+
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
 	void RHI::DestroyMaterial(resource::Material& material) noexcept
 	{
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			DestroyBuffer(material.buffer[i]);
-		}
+		vkFreeDescriptorSets(device, material.descriptorPool, 1, &material.descriptorSet);
+		material.descriptorPool = VK_NULL_HANDLE;
+		material.descriptorSet = VK_NULL_HANDLE;
+
+		materialTable.freeIndices.push_back(material.materialIndex);
+		material.materialIndex = UINT32_MAX;
 	}
 
 	void RHI::CreateEnvMapDescriptorSet(Image& image) noexcept
 	{
-		std::vector<VkDescriptorSetLayout> envViewDescriptorSetLayout(swapchainImageCount, forward.envMapGraphicsPipeline.viewDescriptorSetLayout);
-		VkDescriptorSetAllocateInfo envMapViewDescriptorSetAI = {};
-		envMapViewDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		envMapViewDescriptorSetAI.descriptorPool = forward.descriptorPool;
-		envMapViewDescriptorSetAI.descriptorSetCount = swapchainImageCount;
-		envMapViewDescriptorSetAI.pSetLayouts = envViewDescriptorSetLayout.data();
+		if (forward.envMapViewDescriptorSet == VK_NULL_HANDLE)
+		{
+			VkDescriptorSetAllocateInfo envMapViewDescriptorSetAI = {};
+			envMapViewDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			envMapViewDescriptorSetAI.descriptorPool = forward.descriptorPool;
+			envMapViewDescriptorSetAI.descriptorSetCount = 1;
+			envMapViewDescriptorSetAI.pSetLayouts = &forward.envMapGraphicsPipeline.viewDescriptorSetLayout;
 
-		forward.envMapViewDescriptorSets.resize(TO_SIZE_T(swapchainImageCount));
-		CHECK_VK(vkAllocateDescriptorSets(device, &envMapViewDescriptorSetAI, forward.envMapViewDescriptorSets.data()));
+			CHECK_VK(vkAllocateDescriptorSets(device, &envMapViewDescriptorSetAI, &forward.envMapViewDescriptorSet));
+		}
+
+		VkDescriptorBufferInfo envMapViewProjDescriptorBufferInfo = {};
+		envMapViewProjDescriptorBufferInfo.buffer = uniformRingBuffer.buffer.buffer;
+		envMapViewProjDescriptorBufferInfo.offset = 0;
+		envMapViewProjDescriptorBufferInfo.range = sizeof(RtViewProjUniform);
 
 		VkWriteDescriptorSet envMapWriteViewProjDescriptorSet = {};
 		envMapWriteViewProjDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		envMapWriteViewProjDescriptorSet.descriptorCount = 1;
-		envMapWriteViewProjDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		envMapWriteViewProjDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		envMapWriteViewProjDescriptorSet.dstBinding = 0;
 		envMapWriteViewProjDescriptorSet.dstArrayElement = 0;
-
-		VkDescriptorBufferInfo envMapViewProjDescriptorBufferInfo = {};
-		envMapViewProjDescriptorBufferInfo.offset = 0;
-		envMapViewProjDescriptorBufferInfo.range = sizeof(RtViewProjUniform);
+		envMapWriteViewProjDescriptorSet.pBufferInfo = &envMapViewProjDescriptorBufferInfo;
+		envMapWriteViewProjDescriptorSet.dstSet = forward.envMapViewDescriptorSet;
 
 
 		VkDescriptorImageInfo descriptorSamplerImageInfo = {};
@@ -886,24 +1106,17 @@ namespace lux::rhi
 		envMapWriteSamplerDescriptorSet.dstBinding = 1;
 		envMapWriteSamplerDescriptorSet.dstArrayElement = 0;
 		envMapWriteSamplerDescriptorSet.pImageInfo = &descriptorSamplerImageInfo;
+		envMapWriteSamplerDescriptorSet.dstSet = forward.envMapViewDescriptorSet;
 
-
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			envMapViewProjDescriptorBufferInfo.buffer = forward.viewProjUniformBuffers[i].buffer;
-
-			envMapWriteViewProjDescriptorSet.pBufferInfo = &envMapViewProjDescriptorBufferInfo;
-			envMapWriteViewProjDescriptorSet.dstSet = forward.envMapViewDescriptorSets[i];
-
-			envMapWriteSamplerDescriptorSet.dstSet = forward.envMapViewDescriptorSets[i];
-
-			std::array<VkWriteDescriptorSet, 2> writeDescriptorSets = { envMapWriteViewProjDescriptorSet, envMapWriteSamplerDescriptorSet};
-			vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
-		}
+		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets = { envMapWriteViewProjDescriptorSet, envMapWriteSamplerDescriptorSet};
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
-	VkCommandBuffer RHI::BeginSingleTimeCommandBuffer() const noexcept
+	VkCommandBuffer RHI::BeginSingleTimeCommandBuffer() noexcept
 	{
+		// Batched uploads must land before any direct submission reads them
+		FlushUploadBatch();
+
 		VkCommandBufferAllocateInfo commandBufferAI = {};
 		commandBufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		commandBufferAI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -940,11 +1153,11 @@ namespace lux::rhi
 
 	void RHI::CommandTransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t layerCount, uint32_t levelCount, uint32_t baseMipLevel) noexcept
 	{
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommandBuffer();
+		BeginUploadBatch();
 
-		CommandTransitionImageLayout(commandBuffer, image, format, oldLayout, newLayout, layerCount, levelCount, baseMipLevel);
+		CommandTransitionImageLayout(RecordUploadCommands(), image, format, oldLayout, newLayout, layerCount, levelCount, baseMipLevel);
 
-		EndSingleTimeCommandBuffer(commandBuffer);
+		EndUploadBatch();
 	}
 
 	void RHI::CommandTransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t layerCount, uint32_t levelCount, uint32_t baseMipLevel) noexcept
@@ -1104,6 +1317,9 @@ namespace lux::rhi
 		UpdateGraphicsPipelineShaderStages(forward.rtCutoutGraphicsPipeline, forward.rtCutoutGraphicsPipelineCI);
 		UpdateGraphicsPipelineShaderStages(forward.rtTransparentFrontGraphicsPipeline, forward.rtTransparentFrontGraphicsPipelineCI);
 		UpdateGraphicsPipelineShaderStages(forward.rtTransparentBackGraphicsPipeline, forward.rtTransparentBackGraphicsPipelineCI);
+		UpdateGraphicsPipelineShaderStages(forward.rtTransparentTwoSidedGraphicsPipeline, forward.rtTransparentTwoSidedGraphicsPipelineCI);
+		UpdateGraphicsPipelineShaderStages(forward.rtDepthPrepassGraphicsPipeline, forward.rtDepthPrepassGraphicsPipelineCI);
+		UpdateGraphicsPipelineShaderStages(forward.rtDepthEqualGraphicsPipeline, forward.rtDepthEqualGraphicsPipelineCI);
 
 		UpdateGraphicsPipelineShaderStages(forward.envMapGraphicsPipeline, forward.envMapGraphicsPipelineCI);
 	}
@@ -1117,20 +1333,32 @@ namespace lux::rhi
 	{
 		DestroyForwardRenderer();
 
-		vkDestroyDescriptorPool(device, materialDescriptorPool, nullptr);
+		for (VkDescriptorPool materialDescriptorPool : materialDescriptorPools)
+			vkDestroyDescriptorPool(device, materialDescriptorPool, nullptr);
+
+		materialDescriptorPools.clear();
 
-		vkFreeCommandBuffers(device, commandPool, 2, commandBuffers.data());
+		vkFreeCommandBuffers(device, commandPool, TO_UINT32_T(commandBuffers.size()), commandBuffers.data());
 
 		vkDestroyCommandPool(device, commandPool, nullptr);
 
 		for (size_t i = 0; i < swapchainImageCount; i++)
 		{
 			vkDestroyImageView(device, swapchainImageViews[i], nullptr);
-			DestroyBuffer(directionalLightUniformBuffers[i]);
-			DestroyBuffer(pointLightUniformBuffers[i]);
 		}
 
-		vkDestroySwapchainKHR(device, swapchain, nullptr);
+		if (isHeadless)
+		{
+			for (size_t i = 0; i < swapchainImageCount; i++)
+			{
+				vkDestroyImage(device, swapchainImages[i], nullptr);
+				FreeMemory(offscreenImageAllocations[i]);
+			}
+
+			offscreenImageAllocations.clear();
+		}
+		else
+			vkDestroySwapchainKHR(device, swapchain, nullptr);
 	}
 
 	void RHI::DestroyComputeRelatedResources() noexcept
@@ -1,11 +1,14 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
+
+#include <cstdlib>
+#include <cstring>
 
 
 namespace lux::rhi
 {
 
 	Buffer::Buffer() noexcept
-		: buffer(VK_NULL_HANDLE), memory(VK_NULL_HANDLE)
+		: buffer(VK_NULL_HANDLE), allocation(), size(0)
 	{
 
 	}
@@ -20,21 +23,24 @@ namespace lux::rhi
 		bufferCI.usage = luxBufferCI.usageFlags;
 		bufferCI.sharingMode = luxBufferCI.sharingMode;
 
+		// Buffers outside of host visible memory are filled through a staging buffer
+		if ((luxBufferCI.memoryProperty & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+			bufferCI.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
 		CHECK_VK(vkCreateBuffer(device, &bufferCI, nullptr, &buffer.buffer));
 	
 		
 		VkMemoryRequirements memoryRequirements;
 		vkGetBufferMemoryRequirements(device, buffer.buffer, &memoryRequirements);
-		uint32_t memoryIndex = FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		ASSERT(memoryIndex != UINT32_MAX);
 
-		VkMemoryAllocateInfo memoryAI = {};
-		memoryAI.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memoryAI.allocationSize = memoryRequirements.size;
-		memoryAI.memoryTypeIndex = memoryIndex;
+		// Binding an invalid allocation is undefined, a buffer without memory cannot be recovered from
+		if (AllocateMemory(memoryRequirements, luxBufferCI.memoryProperty, true, luxBufferCI.memoryCategory, luxBufferCI.debugName, buffer.allocation) == false)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate the memory of buffer ", luxBufferCI.debugName);
+			std::abort();
+		}
 
-		CHECK_VK(vkAllocateMemory(device, &memoryAI, nullptr, &buffer.memory));
-		CHECK_VK(vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0));
+		CHECK_VK(vkBindBufferMemory(device, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset));
 
 		if (luxBufferCI.data != nullptr)
 			UpdateBuffer(buffer, luxBufferCI.data);
@@ -42,16 +48,42 @@ namespace lux::rhi
 
 	void RHI::UpdateBuffer(Buffer& buffer, void* newData) noexcept
 	{
-		void* bufferData;
-		CHECK_VK(vkMapMemory(device, buffer.memory, 0, buffer.size, 0, &bufferData));
-		memcpy(bufferData, newData, TO_SIZE_T(buffer.size));
-		vkUnmapMemory(device, buffer.memory);
+		UpdateBuffer(buffer, newData, 0, buffer.size);
+	}
+
+	void RHI::UpdateBuffer(Buffer& buffer, const void* newData, VkDeviceSize offset, VkDeviceSize size) noexcept
+	{
+		ASSERT(offset + size <= buffer.size);
+
+		// Host visible blocks are persistently mapped by the allocator
+		if (buffer.allocation.mappedData != nullptr)
+		{
+			memcpy(static_cast<uint8_t*>(buffer.allocation.mappedData) + offset, newData, TO_SIZE_T(size));
+			return;
+		}
+
+		BeginUploadBatch();
+
+		VkBuffer stagingBuffer;
+		VkDeviceSize stagingOffset;
+		void* stagingData = AllocateUploadStaging(size, stagingBuffer, stagingOffset);
+
+		memcpy(stagingData, newData, TO_SIZE_T(size));
+
+		VkBufferCopy bufferCopy = {};
+		bufferCopy.srcOffset = stagingOffset;
+		bufferCopy.dstOffset = offset;
+		bufferCopy.size = size;
+
+		vkCmdCopyBuffer(RecordUploadCommands(), stagingBuffer, buffer.buffer, 1, &bufferCopy);
+
+		EndUploadBatch();
 	}
 
 	void RHI::DestroyBuffer(Buffer& buffer) noexcept
 	{
 		vkDestroyBuffer(device, buffer.buffer, nullptr);
-		vkFreeMemory(device, buffer.memory, nullptr);
+		FreeMemory(buffer.allocation);
 	}
 
 
@@ -1,4 +1,4 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
 
 namespace lux::rhi
 {
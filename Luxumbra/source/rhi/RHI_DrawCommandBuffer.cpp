@@ -0,0 +1,100 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lux::rhi
+{
+
+	DrawCommandBuffer::DrawCommandBuffer() noexcept
+		: isIndirectFirstInstanceSupported(false), isMultiDrawIndirectSupported(false), buffers(), capacities(), commands(0)
+	{
+
+	}
+
+	void RHI::InitDrawCommandBuffer() noexcept
+	{
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			CreateDrawCommandBuffer(i, DRAW_COMMAND_BUFFER_INITIAL_CAPACITY);
+	}
+
+	void RHI::CreateDrawCommandBuffer(size_t frameIndex, uint32_t capacity) noexcept
+	{
+		BufferCreateInfo drawCommandBufferCI = {};
+		// The GPU culling pass counts the visible instances of the culled records
+		drawCommandBufferCI.usageFlags = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		drawCommandBufferCI.size = sizeof(VkDrawIndexedIndirectCommand) * TO_SIZE_T(capacity);
+		drawCommandBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		drawCommandBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		drawCommandBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_DRAW_COMMAND;
+		drawCommandBufferCI.debugName = "Draw Command Buffer " + std::to_string(frameIndex);
+
+		CreateBuffer(drawCommandBufferCI, drawCommandBuffer.buffers[frameIndex]);
+
+		ASSERT(drawCommandBuffer.buffers[frameIndex].allocation.mappedData != nullptr);
+
+		drawCommandBuffer.capacities[frameIndex] = capacity;
+	}
+
+	void RHI::BeginDrawCommandBufferFrame() noexcept
+	{
+		drawCommandBuffer.commands.clear();
+	}
+
+	void RHI::UploadDrawCommandBuffer() noexcept
+	{
+		uint32_t commandCount = TO_UINT32_T(drawCommandBuffer.commands.size());
+
+		if (commandCount == 0)
+			return;
+
+		// The frame fence was waited on and nothing was recorded with this buffer yet, it can be replaced
+		if (commandCount > drawCommandBuffer.capacities[currentFrame])
+		{
+			uint32_t newCapacity = std::max(commandCount, drawCommandBuffer.capacities[currentFrame] * 2);
+
+			DestroyBuffer(drawCommandBuffer.buffers[currentFrame]);
+			CreateDrawCommandBuffer(currentFrame, newCapacity);
+		}
+
+		memcpy(drawCommandBuffer.buffers[currentFrame].allocation.mappedData, drawCommandBuffer.commands.data(), sizeof(VkDrawIndexedIndirectCommand) * drawCommandBuffer.commands.size());
+	}
+
+	void RHI::CommandDrawIndexedIndirect(VkCommandBuffer commandBuffer, uint32_t firstDrawCommand, uint32_t drawCount) const noexcept
+	{
+		if (drawCount == 0)
+			return;
+
+		if (drawCommandBuffer.isIndirectFirstInstanceSupported == false)
+		{
+			for (uint32_t i = firstDrawCommand; i < firstDrawCommand + drawCount; i++)
+			{
+				const VkDrawIndexedIndirectCommand& command = drawCommandBuffer.commands[TO_SIZE_T(i)];
+				vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+			}
+
+			return;
+		}
+
+		VkBuffer buffer = drawCommandBuffer.buffers[currentFrame].buffer;
+		VkDeviceSize offset = sizeof(VkDrawIndexedIndirectCommand) * TO_SIZE_T(firstDrawCommand);
+
+		if (drawCommandBuffer.isMultiDrawIndirectSupported)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+			return;
+		}
+
+		for (uint32_t i = 0; i < drawCount; i++)
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + sizeof(VkDrawIndexedIndirectCommand) * TO_SIZE_T(i), 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+	void RHI::DestroyDrawCommandBuffer() noexcept
+	{
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			DestroyBuffer(drawCommandBuffer.buffers[i]);
+
+		drawCommandBuffer.commands.clear();
+	}
+
+} // namespace lux::rhi
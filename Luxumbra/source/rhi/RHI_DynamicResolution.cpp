@@ -0,0 +1,136 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lux::rhi
+{
+
+	DynamicResolution::DynamicResolution() noexcept
+		: isEnabled(true), scale(DYNAMIC_RESOLUTION_MAX_SCALE), renderExtent({ 0, 0 }), targetFrameTime(DYNAMIC_RESOLUTION_DEFAULT_TARGET_FRAME_TIME),
+		smoothedFrameTime(0.f), lastAdjustmentFrame(0)
+	{
+
+	}
+
+	void RHI::InitDynamicResolution() noexcept
+	{
+		UpdateRenderExtent();
+	}
+
+	bool RHI::GetIsDynamicResolutionEnabled() const noexcept
+	{
+		return dynamicResolution.isEnabled;
+	}
+
+	void RHI::SetIsDynamicResolutionEnabled(bool isEnabled) noexcept
+	{
+		dynamicResolution.isEnabled = isEnabled;
+		dynamicResolution.smoothedFrameTime = 0.f;
+	}
+
+	float RHI::GetRenderScale() const noexcept
+	{
+		return dynamicResolution.scale;
+	}
+
+	void RHI::SetRenderScale(float newScale) noexcept
+	{
+		dynamicResolution.scale = std::clamp(newScale, DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE);
+		dynamicResolution.lastAdjustmentFrame = frameCount;
+
+		UpdateRenderExtent();
+	}
+
+	VkExtent2D RHI::GetRenderExtent() const noexcept
+	{
+		return dynamicResolution.renderExtent;
+	}
+
+	float RHI::GetDynamicResolutionTargetFrameTime() const noexcept
+	{
+		return dynamicResolution.targetFrameTime;
+	}
+
+	void RHI::SetDynamicResolutionTargetFrameTime(float newTargetFrameTime) noexcept
+	{
+		dynamicResolution.targetFrameTime = std::max(newTargetFrameTime, 1.f);
+	}
+
+	void RHI::UpdateDynamicResolution() noexcept
+	{
+		if (dynamicResolution.isEnabled == false)
+			return;
+
+		// Frames recorded before the last change still run at the previous scale
+		if (frameCount - dynamicResolution.lastAdjustmentFrame < MAX_FRAMES_IN_FLIGHT)
+			return;
+
+		float frameTime;
+		if (GetGpuPassLastTime("Frame", frameTime) == false)
+			return;
+
+		if (dynamicResolution.smoothedFrameTime == 0.f)
+			dynamicResolution.smoothedFrameTime = frameTime;
+		else
+			dynamicResolution.smoothedFrameTime += (frameTime - dynamicResolution.smoothedFrameTime) * DYNAMIC_RESOLUTION_SMOOTHING;
+
+		if (frameCount - dynamicResolution.lastAdjustmentFrame < DYNAMIC_RESOLUTION_ADJUSTMENT_INTERVAL)
+			return;
+
+		float smoothedFrameTime = dynamicResolution.smoothedFrameTime;
+		float targetFrameTime = dynamicResolution.targetFrameTime;
+
+		if (smoothedFrameTime <= targetFrameTime && smoothedFrameTime >= targetFrameTime * DYNAMIC_RESOLUTION_INCREASE_THRESHOLD)
+			return;
+
+		// The shaded pixel count grows with the square of the scale, aim for the scale that fits the budget
+		float targetScale = dynamicResolution.scale * std::sqrt(targetFrameTime / smoothedFrameTime);
+		float scaleStep = std::clamp(targetScale - dynamicResolution.scale, -DYNAMIC_RESOLUTION_MAX_SCALE_STEP, DYNAMIC_RESOLUTION_MAX_SCALE_STEP);
+		float newScale = std::clamp(dynamicResolution.scale + scaleStep, DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE);
+
+		// Ignore changes too small to be worth a resolution switch
+		if (std::abs(newScale - dynamicResolution.scale) < 0.01f)
+			return;
+
+		dynamicResolution.scale = newScale;
+		dynamicResolution.smoothedFrameTime = 0.f;
+		dynamicResolution.lastAdjustmentFrame = frameCount;
+
+		UpdateRenderExtent();
+	}
+
+	void RHI::UpdateRenderExtent() noexcept
+	{
+		VkExtent2D& renderExtent = dynamicResolution.renderExtent;
+		renderExtent.width = std::max(TO_UINT32_T(std::lround(swapchainExtent.width * dynamicResolution.scale)), 1u);
+		renderExtent.height = std::max(TO_UINT32_T(std::lround(swapchainExtent.height * dynamicResolution.scale)), 1u);
+
+		// The extents are rounded, the shaders use the exact fraction of the targets that was rendered
+		glm::vec2 renderScale(TO_FLOAT(renderExtent.width) / TO_FLOAT(swapchainExtent.width), TO_FLOAT(renderExtent.height) / TO_FLOAT(swapchainExtent.height));
+
+		forward.postProcessParameters.renderScale = renderScale;
+		forward.ssaoParameters.renderScale = renderScale;
+	}
+
+	void RHI::CommandSetRenderViewport(VkCommandBuffer commandBuffer) const noexcept
+	{
+		const VkExtent2D& renderExtent = dynamicResolution.renderExtent;
+
+		VkViewport viewport = {};
+		viewport.x = 0.f;
+		viewport.y = 0.f;
+		viewport.width = TO_FLOAT(renderExtent.width);
+		viewport.height = TO_FLOAT(renderExtent.height);
+		viewport.minDepth = 0.f;
+		viewport.maxDepth = 1.f;
+
+		VkRect2D scissor = {};
+		scissor.offset = { 0, 0 };
+		scissor.extent = renderExtent;
+
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+
+} // namespace lux::rhi
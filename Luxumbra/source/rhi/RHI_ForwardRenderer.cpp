@@ -1,28 +1,30 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
 
 #include <array>
-#include <map>
+#include <algorithm>
 #include <random>
+#include <cstdlib>
 
-#include "glm\glm.hpp"
-#include "glm\gtx\transform.hpp"
+#include "glm/glm.hpp"
+#include "glm/gtx/transform.hpp"
 
-#include "utility\Utility.h"
+#include "utility/Utility.h"
+#include "CpuProfiler.h"
 
 namespace lux::rhi
 {
-	using sortedMeshNodesIterator = std::map<std::string, std::vector<scene::MeshNode*>>::iterator;
-	using sortedMeshNodesConstIterator = std::map<std::string, std::vector<scene::MeshNode*>>::const_iterator;
-	
+
 	ForwardRenderer::ForwardRenderer() noexcept
-		: rtImageFormat(VK_FORMAT_R32G32B32A32_SFLOAT), rtRenderPass(VK_NULL_HANDLE), rtFrameBuffers(0), descriptorPool(VK_NULL_HANDLE),
+		: rtImageFormat(VK_FORMAT_R32G32B32A32_SFLOAT), rtRenderPass(VK_NULL_HANDLE), rtEarlyRenderPass(VK_NULL_HANDLE), rtLateRenderPass(VK_NULL_HANDLE), rtFrameBuffers(0), descriptorPool(VK_NULL_HANDLE),
 		blitRenderPass(VK_NULL_HANDLE), blitFrameBuffers(0), blitGraphicsPipeline(), blitGraphicsPipelineCI(), blitDescriptorSets(0),
 		ssaoRenderPass(VK_NULL_HANDLE), ssaoFrameBuffers(0), ssaoColorAttachments(0),
-		rtGraphicsPipeline(), rtCutoutGraphicsPipeline(), rtTransparentBackGraphicsPipeline(), rtTransparentFrontGraphicsPipeline(),
-		rtGraphicsPipelineCI(), rtCutoutGraphicsPipelineCI(), rtTransparentBackGraphicsPipelineCI(), rtTransparentFrontGraphicsPipelineCI(),
-		rtViewDescriptorSets(0), rtModelDescriptorSets(0), rtColorAttachmentImages(0), rtColorAttachmentImageMemories(0), rtColorAttachmentImageViews(0),
-		rtDepthAttachmentImage(VK_NULL_HANDLE), rtDepthAttachmentMemory(VK_NULL_HANDLE), rtDepthAttachmentImageView(VK_NULL_HANDLE),
-		envMapGraphicsPipeline(), envMapGraphicsPipelineCI(), envMapViewDescriptorSets(0), modelConstant(), viewProjUniformBuffers(0),
+		rtGraphicsPipeline(), rtCutoutGraphicsPipeline(), rtTransparentBackGraphicsPipeline(), rtTransparentFrontGraphicsPipeline(), rtTransparentTwoSidedGraphicsPipeline(),
+		rtGraphicsPipelineCI(), rtCutoutGraphicsPipelineCI(), rtTransparentBackGraphicsPipelineCI(), rtTransparentFrontGraphicsPipelineCI(), rtTransparentTwoSidedGraphicsPipelineCI(),
+		isDepthPrepassEnabled(false), rtDepthPrepassGraphicsPipeline(), rtDepthEqualGraphicsPipeline(), rtDepthPrepassGraphicsPipelineCI(), rtDepthEqualGraphicsPipelineCI(),
+		rtViewDescriptorSet(VK_NULL_HANDLE), rtModelDescriptorSets(0), rtColorAttachmentImages(0), rtColorAttachmentImageAllocations(0), rtColorAttachmentImageViews(0),
+		rtDepthAttachmentImage(VK_NULL_HANDLE), rtDepthAttachmentAllocation(), rtDepthAttachmentImageView(VK_NULL_HANDLE),
+		envMapGraphicsPipeline(), envMapGraphicsPipelineCI(), envMapViewDescriptorSet(VK_NULL_HANDLE), viewProjUniformOffset(0),
+		renderQueue(), firstRecordingTaskIndex(0), earlyRecordingTaskCount(0), recordingTaskCount(0), lateFirstDrawCommand(0), meshBounds(), visibleMeshIndices(0), visibleMeshes(0),
 		sampler(VK_NULL_HANDLE), cubemapSampler(VK_NULL_HANDLE), irradianceSampler(VK_NULL_HANDLE), prefilteredSampler(VK_NULL_HANDLE)
 	{
 
@@ -211,6 +213,39 @@ namespace lux::rhi
 
 		CHECK_VK(vkCreateRenderPass(device, &rtRenderPassCI, nullptr, &forward.rtRenderPass));
 
+		// The early pass keeps its depth for the Hi-Z pyramid and the late pass, which loads every target back
+		attachments[ForwardRenderer::FORWARD_RT_DEPTH_ATTACHMENT_BIND_POINT].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+		CHECK_VK(vkCreateRenderPass(device, &rtRenderPassCI, nullptr, &forward.rtEarlyRenderPass));
+
+		std::array<uint32_t, 4> loadedColorAttachmentBindPoints =
+		{
+			ForwardRenderer::FORWARD_RT_COLOR_ATTACHMENT_BIND_POINT,
+			ForwardRenderer::FORWARD_RT_POSITION_ATTACHMENT_BIND_POINT,
+			ForwardRenderer::FORWARD_RT_NORMAL_ATTACHMENT_BIND_POINT,
+			ForwardRenderer::FORWARD_RT_INDIRECT_COLOR_ATTACHMENT_BIND_POINT
+		};
+
+		for (uint32_t bindPoint : loadedColorAttachmentBindPoints)
+		{
+			attachments[bindPoint].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[bindPoint].initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		attachments[ForwardRenderer::FORWARD_RT_DEPTH_ATTACHMENT_BIND_POINT].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachments[ForwardRenderer::FORWARD_RT_DEPTH_ATTACHMENT_BIND_POINT].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[ForwardRenderer::FORWARD_RT_DEPTH_ATTACHMENT_BIND_POINT].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		// The early pass wrote the targets, the culling between the passes read its depth
+		subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		subpassDependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		subpassDependencies[0].dependencyFlags = 0;
+
+		CHECK_VK(vkCreateRenderPass(device, &rtRenderPassCI, nullptr, &forward.rtLateRenderPass));
+
 		VkAttachmentDescription SSAOAttachment = {};
 		SSAOAttachment.format = VK_FORMAT_R8_UNORM;
 		SSAOAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -270,7 +305,8 @@ namespace lux::rhi
 		swapchainAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		swapchainAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		swapchainAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		swapchainAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		// The present layout needs the swapchain extension, offscreen images are left ready to be copied
+		swapchainAttachment.finalLayout = isHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference swapchainAttachmentRef = {};
 		swapchainAttachmentRef.attachment = ForwardRenderer::FORWARD_SWAPCHAIN_COLOR_ATTACHMENT_BIND_POINT;
@@ -296,8 +332,6 @@ namespace lux::rhi
 		// TODO: Use CreateImage
 		// Used by color & depth attachments
 		VkMemoryRequirements memoryRequirements;
-		VkMemoryAllocateInfo rtAttachmentImageAI = {};
-		rtAttachmentImageAI.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 
 		// Color attachment
 
@@ -324,24 +358,26 @@ namespace lux::rhi
 		rtColorAttachmentImageViewCI.subresourceRange = swapchainImageSubresourceRange;
 
 
-		forward.rtColorAttachmentImages.resize(TO_SIZE_T(swapchainImageCount));
-		forward.rtColorAttachmentImageMemories.resize(TO_SIZE_T(swapchainImageCount));
-		forward.rtColorAttachmentImageViews.resize(TO_SIZE_T(swapchainImageCount));
+		forward.rtColorAttachmentImages.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
+		forward.rtColorAttachmentImageAllocations.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
+		forward.rtColorAttachmentImageViews.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
 
-		for (uint32_t i = 0; i < swapchainImageCount; i++)
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			VkImage* rtColorAttachmentImage = &forward.rtColorAttachmentImages[TO_SIZE_T(i)];
-			VkDeviceMemory* rtColorAttachmentImageMemory = &forward.rtColorAttachmentImageMemories[TO_SIZE_T(i)];
+			MemoryAllocation* rtColorAttachmentImageAllocation = &forward.rtColorAttachmentImageAllocations[TO_SIZE_T(i)];
 			VkImageView* rtColorAttachmentImageView = &forward.rtColorAttachmentImageViews[TO_SIZE_T(i)];
 
 			CHECK_VK(vkCreateImage(device, &rtColorAttachmentImageCI, nullptr, rtColorAttachmentImage));
 
 			vkGetImageMemoryRequirements(device, *rtColorAttachmentImage, &memoryRequirements);
-			rtAttachmentImageAI.allocationSize = memoryRequirements.size;
-			rtAttachmentImageAI.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (AllocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, MemoryCategory::MEMORY_CATEGORY_ATTACHMENT, "Forward Color Attachment " + std::to_string(i), *rtColorAttachmentImageAllocation) == false)
+			{
+				Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate the memory of forward color attachment ", i);
+				std::abort();
+			}
 
-			CHECK_VK(vkAllocateMemory(device, &rtAttachmentImageAI, nullptr, rtColorAttachmentImageMemory));
-			CHECK_VK(vkBindImageMemory(device, *rtColorAttachmentImage, *rtColorAttachmentImageMemory, 0));
+			CHECK_VK(vkBindImageMemory(device, *rtColorAttachmentImage, rtColorAttachmentImageAllocation->memory, rtColorAttachmentImageAllocation->offset));
 
 			rtColorAttachmentImageViewCI.image = *rtColorAttachmentImage;
 
@@ -368,11 +404,13 @@ namespace lux::rhi
 		CHECK_VK(vkCreateImage(device, &rtDepthAttachmentImageCI, nullptr, &forward.rtDepthAttachmentImage));
 
 		vkGetImageMemoryRequirements(device, forward.rtDepthAttachmentImage, &memoryRequirements);
-		rtAttachmentImageAI.allocationSize = memoryRequirements.size;
-		rtAttachmentImageAI.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (AllocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, MemoryCategory::MEMORY_CATEGORY_ATTACHMENT, "Forward Depth Attachment", forward.rtDepthAttachmentAllocation) == false)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate the memory of the forward depth attachment");
+			std::abort();
+		}
 
-		CHECK_VK(vkAllocateMemory(device, &rtAttachmentImageAI, nullptr, &forward.rtDepthAttachmentMemory));
-		CHECK_VK(vkBindImageMemory(device, forward.rtDepthAttachmentImage, forward.rtDepthAttachmentMemory, 0));
+		CHECK_VK(vkBindImageMemory(device, forward.rtDepthAttachmentImage, forward.rtDepthAttachmentAllocation.memory, forward.rtDepthAttachmentAllocation.offset));
 
 		VkImageViewCreateInfo rtDepthAttachmentImageViewCI = {};
 		rtDepthAttachmentImageViewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -398,6 +436,8 @@ namespace lux::rhi
 		rtResolveColorAttachmentCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtResolveColorAttachmentCI.subresourceRangeLayerCount = 1;
 		rtResolveColorAttachmentCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtResolveColorAttachmentCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtResolveColorAttachmentCI.debugName = "Forward Resolve Color Attachment";
 
 		CreateImage(rtResolveColorAttachmentCI, forward.rtResolveColorAttachment);
 
@@ -413,6 +453,8 @@ namespace lux::rhi
 		rtPositionImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtPositionImageCI.subresourceRangeLayerCount = 1;
 		rtPositionImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtPositionImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtPositionImageCI.debugName = "Forward Position Map";
 
 		CreateImage(rtPositionImageCI, forward.rtPositionMap);
 
@@ -426,6 +468,8 @@ namespace lux::rhi
 		rtResolvePositionImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtResolvePositionImageCI.subresourceRangeLayerCount = 1;
 		rtResolvePositionImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtResolvePositionImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtResolvePositionImageCI.debugName = "Forward Resolve Position Map";
 
 		CreateImage(rtResolvePositionImageCI, forward.rtResolvePositionMap);
 
@@ -441,6 +485,8 @@ namespace lux::rhi
 		rtNormalImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtNormalImageCI.subresourceRangeLayerCount = 1;
 		rtNormalImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtNormalImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtNormalImageCI.debugName = "Forward Normal Map";
 
 		CreateImage(rtNormalImageCI, forward.rtNormalMap);
 
@@ -454,6 +500,8 @@ namespace lux::rhi
 		rtResolveNormalImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtResolveNormalImageCI.subresourceRangeLayerCount = 1;
 		rtResolveNormalImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtResolveNormalImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtResolveNormalImageCI.debugName = "Forward Resolve Normal Map";
 
 		CreateImage(rtResolveNormalImageCI, forward.rtResolveNormalMap);
 
@@ -469,8 +517,10 @@ namespace lux::rhi
 		rtIndirectColorImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtIndirectColorImageCI.subresourceRangeLayerCount = 1;
 		rtIndirectColorImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtIndirectColorImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtIndirectColorImageCI.debugName = "Forward Indirect Color Map";
 
-		CreateImage(rtNormalImageCI, forward.rtIndirectColorMap);
+		CreateImage(rtIndirectColorImageCI, forward.rtIndirectColorMap);
 
 		ImageCreateInfo rtResolveIndirectColorImageCI = {};
 		rtResolveIndirectColorImageCI.format = forward.rtImageFormat;
@@ -482,6 +532,8 @@ namespace lux::rhi
 		rtResolveIndirectColorImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		rtResolveIndirectColorImageCI.subresourceRangeLayerCount = 1;
 		rtResolveIndirectColorImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		rtResolveIndirectColorImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
+		rtResolveIndirectColorImageCI.debugName = "Forward Resolve Indirect Color Map";
 
 		CreateImage(rtResolveIndirectColorImageCI, forward.rtResolveIndirectColorMap);
 
@@ -497,11 +549,13 @@ namespace lux::rhi
 		ssaoImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		ssaoImageCI.subresourceRangeLayerCount = 1;
 		ssaoImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		ssaoImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_ATTACHMENT;
 
 
-		forward.ssaoColorAttachments.resize(TO_SIZE_T(swapchainImageCount));
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		forward.ssaoColorAttachments.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
+			ssaoImageCI.debugName = "SSAO Attachment " + std::to_string(i);
 			CreateImage(ssaoImageCI, forward.ssaoColorAttachments[i]);
 		}
 
@@ -534,13 +588,12 @@ namespace lux::rhi
 		SSAOFramebufferCI.layers = 1;
 		SSAOFramebufferCI.attachmentCount = 1;
 
-		forward.rtFrameBuffers.resize(TO_SIZE_T(swapchainImageCount));
-		forward.blitFrameBuffers.resize(TO_SIZE_T(swapchainImageCount));
-		forward.ssaoFrameBuffers.resize(TO_SIZE_T(swapchainImageCount));
+		// Render target and SSAO framebuffers follow the frames in flight, only the blit framebuffers target a swapchain image
+		forward.rtFrameBuffers.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
+		forward.ssaoFrameBuffers.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
-			blitFramebufferCI.pAttachments = &swapchainImageViews[i];
 			SSAOFramebufferCI.pAttachments = &forward.ssaoColorAttachments[i].imageView;
 			attachments[TO_SIZE_T(ForwardRenderer::FORWARD_RT_COLOR_ATTACHMENT_BIND_POINT)] = forward.rtColorAttachmentImageViews[i];
 			attachments[TO_SIZE_T(ForwardRenderer::FORWARD_RT_DEPTH_ATTACHMENT_BIND_POINT)] = forward.rtDepthAttachmentImageView;
@@ -553,67 +606,83 @@ namespace lux::rhi
 			attachments[TO_SIZE_T(ForwardRenderer::FORWARD_RT_RESOLVE_INDIRECT_COLOR_ATTACHMENT_BIND_POINT)] = forward.rtResolveIndirectColorMap.imageView;
 
 			CHECK_VK(vkCreateFramebuffer(device, &rtFramebufferCI, nullptr, &forward.rtFrameBuffers[i]));
-			CHECK_VK(vkCreateFramebuffer(device, &blitFramebufferCI, nullptr, &forward.blitFrameBuffers[i]));
 			CHECK_VK(vkCreateFramebuffer(device, &SSAOFramebufferCI, nullptr, &forward.ssaoFrameBuffers[i]));
 		}
 
+		forward.blitFrameBuffers.resize(TO_SIZE_T(swapchainImageCount));
+
+		for (size_t i = 0; i < swapchainImageCount; i++)
+		{
+			blitFramebufferCI.pAttachments = &swapchainImageViews[i];
+
+			CHECK_VK(vkCreateFramebuffer(device, &blitFramebufferCI, nullptr, &forward.blitFrameBuffers[i]));
+		}
+
 	}
 
 	void RHI::InitForwardDescriptorPool() noexcept
 	{
 		VkDescriptorPoolSize blitSamplersDescriptorPoolSize = {};
 		blitSamplersDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		blitSamplersDescriptorPoolSize.descriptorCount = swapchainImageCount * 3;
+		blitSamplersDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT * 3;
 
 		VkDescriptorPoolSize SSAOSamplersDescriptorPoolSize = {};
 		SSAOSamplersDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		SSAOSamplersDescriptorPoolSize.descriptorCount = swapchainImageCount * 3;
+		SSAOSamplersDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT * 3;
 
 		VkDescriptorPoolSize SSAOKernelDescriptorPoolSize = {};
 		SSAOKernelDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		SSAOKernelDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		SSAOKernelDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize rtViewProjUniformDescriptorPoolSize = {};
-		rtViewProjUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		rtViewProjUniformDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		rtViewProjUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		rtViewProjUniformDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize directionalLightUniformDescriptorPoolSize = {};
-		directionalLightUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		directionalLightUniformDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		directionalLightUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		directionalLightUniformDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize pointLightUniformDescriptorPoolSize = {};
-		pointLightUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		pointLightUniformDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		pointLightUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		pointLightUniformDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize directionalLightShadowMapsDescriptorPoolSize = {};
 		directionalLightShadowMapsDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		directionalLightShadowMapsDescriptorPoolSize.descriptorCount = swapchainImageCount * DIRECTIONAL_LIGHT_MAX_COUNT;
+		directionalLightShadowMapsDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT * DIRECTIONAL_LIGHT_MAX_COUNT;
 
 		VkDescriptorPoolSize pointLightShadowMapsDescriptorPoolSize = {};
 		pointLightShadowMapsDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		pointLightShadowMapsDescriptorPoolSize.descriptorCount = swapchainImageCount * POINT_LIGHT_MAX_COUNT;
+		pointLightShadowMapsDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT * POINT_LIGHT_MAX_COUNT;
 
 		VkDescriptorPoolSize irradianceMapDescriptorPoolSize = {};
 		irradianceMapDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		irradianceMapDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		irradianceMapDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize prefilteredMapDescriptorPoolSize = {};
 		prefilteredMapDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		prefilteredMapDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		prefilteredMapDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize BRDFLutMapDescriptorPoolSize = {};
 		BRDFLutMapDescriptorPoolSize .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		BRDFLutMapDescriptorPoolSize .descriptorCount = swapchainImageCount;
+		BRDFLutMapDescriptorPoolSize .descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize envMapSamplerDescriptorPoolSize = {};
 		envMapSamplerDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		envMapSamplerDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		envMapSamplerDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 		VkDescriptorPoolSize envMapUniformDescriptorPoolSize = {};
-		envMapUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		envMapUniformDescriptorPoolSize.descriptorCount = swapchainImageCount;
+		envMapUniformDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		envMapUniformDescriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolSize materialTableDescriptorPoolSize = {};
+		materialTableDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		materialTableDescriptorPoolSize.descriptorCount = 1;
+
+		VkDescriptorPoolSize lightClusterDescriptorPoolSize = {};
+		lightClusterDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		lightClusterDescriptorPoolSize.descriptorCount = 2;
 
-		std::array<VkDescriptorPoolSize, 13> descriptorPoolSizes = 
+		std::array<VkDescriptorPoolSize, 15> descriptorPoolSizes = 
 		{ 
 			blitSamplersDescriptorPoolSize,
 			SSAOSamplersDescriptorPoolSize,
@@ -627,14 +696,16 @@ namespace lux::rhi
 			prefilteredMapDescriptorPoolSize,
 			BRDFLutMapDescriptorPoolSize,
 			envMapSamplerDescriptorPoolSize,
-			envMapUniformDescriptorPoolSize
+			envMapUniformDescriptorPoolSize,
+			materialTableDescriptorPoolSize,
+			lightClusterDescriptorPoolSize
 		};
 
 		VkDescriptorPoolCreateInfo descriptorPoolCI = {};
 		descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		descriptorPoolCI.poolSizeCount = TO_UINT32_T(descriptorPoolSizes.size());
 		descriptorPoolCI.pPoolSizes = descriptorPoolSizes.data();
-		descriptorPoolCI.maxSets = swapchainImageCount * TO_UINT32_T(descriptorPoolSizes.size());
+		descriptorPoolCI.maxSets = MAX_FRAMES_IN_FLIGHT * TO_UINT32_T(descriptorPoolSizes.size());
 
 		CHECK_VK(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &forward.descriptorPool));
 	}
@@ -740,6 +811,7 @@ namespace lux::rhi
 		ssaoGraphicsPipelineCI.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
 		ssaoGraphicsPipelineCI.viewportWidth = TO_FLOAT(swapchainExtent.width);
 		ssaoGraphicsPipelineCI.viewportHeight = TO_FLOAT(swapchainExtent.height);
+		ssaoGraphicsPipelineCI.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 		ssaoGraphicsPipelineCI.rasterizerCullMode = VK_CULL_MODE_BACK_BIT;
 		ssaoGraphicsPipelineCI.rasterizerFrontFace = VK_FRONT_FACE_CLOCKWISE;
 		ssaoGraphicsPipelineCI.disableMSAA = true;
@@ -768,19 +840,19 @@ namespace lux::rhi
 		VkDescriptorSetLayoutBinding rtViewProjDescriptorSetLayoutBinding = {};
 		rtViewProjDescriptorSetLayoutBinding.binding = 0;
 		rtViewProjDescriptorSetLayoutBinding.descriptorCount = 1;
-		rtViewProjDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		rtViewProjDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		rtViewProjDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 		VkDescriptorSetLayoutBinding directionalLightUniformDescriptorSetLayoutBinding = {};
 		directionalLightUniformDescriptorSetLayoutBinding.binding = 1;
 		directionalLightUniformDescriptorSetLayoutBinding.descriptorCount = 1;
-		directionalLightUniformDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		directionalLightUniformDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		directionalLightUniformDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 		VkDescriptorSetLayoutBinding pointLightUniformDescriptorSetLayoutBinding = {};
 		pointLightUniformDescriptorSetLayoutBinding.binding = 2;
 		pointLightUniformDescriptorSetLayoutBinding.descriptorCount = 1;
-		pointLightUniformDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		pointLightUniformDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		pointLightUniformDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 		VkDescriptorSetLayoutBinding directionalLightShadowMapsDescriptorSetLayoutBinding = {};
@@ -813,14 +885,27 @@ namespace lux::rhi
 		BRDFLutDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 		BRDFLutDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+		VkDescriptorSetLayoutBinding materialTableDescriptorSetLayoutBinding = {};
+		materialTableDescriptorSetLayoutBinding.binding = 8;
+		materialTableDescriptorSetLayoutBinding.descriptorCount = 1;
+		materialTableDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		materialTableDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-		// Material Layout
-		VkDescriptorSetLayoutBinding materialParametersDescriptorSetLayoutBinding = {};
-		materialParametersDescriptorSetLayoutBinding.binding = 0;
-		materialParametersDescriptorSetLayoutBinding.descriptorCount = 1;
-		materialParametersDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		materialParametersDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		// Froxel grid and light index list, both in the frame region of the light cluster buffer
+		VkDescriptorSetLayoutBinding lightClusterGridDescriptorSetLayoutBinding = {};
+		lightClusterGridDescriptorSetLayoutBinding.binding = 9;
+		lightClusterGridDescriptorSetLayoutBinding.descriptorCount = 1;
+		lightClusterGridDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		lightClusterGridDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+		VkDescriptorSetLayoutBinding lightIndexListDescriptorSetLayoutBinding = {};
+		lightIndexListDescriptorSetLayoutBinding.binding = 10;
+		lightIndexListDescriptorSetLayoutBinding.descriptorCount = 1;
+		lightIndexListDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		lightIndexListDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+
+		// Material Layout, parameters live in the material table
 		VkDescriptorSetLayoutBinding materialAlbedoDescriptorSetLayoutBinding = {};
 		materialAlbedoDescriptorSetLayoutBinding.binding = 1;
 		materialAlbedoDescriptorSetLayoutBinding.descriptorCount = 1;
@@ -847,15 +932,10 @@ namespace lux::rhi
 
 
 		// Push Constant
-		VkPushConstantRange rtModelPushConstantRange = {};
-		rtModelPushConstantRange.offset = 0;
-		rtModelPushConstantRange.size = sizeof(RtModelConstant);
-		rtModelPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-		VkPushConstantRange lightCountPushConstantRange = {};
-		lightCountPushConstantRange.offset = sizeof(RtModelConstant);
-		lightCountPushConstantRange.size = sizeof(LightCountsPushConstant);
-		lightCountPushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		VkPushConstantRange rtFragmentPushConstantRange = {};
+		rtFragmentPushConstantRange.offset = 0;
+		rtFragmentPushConstantRange.size = sizeof(LightCountsPushConstant) + sizeof(RtMaterialConstant);
+		rtFragmentPushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 
 		// Graphics Pipeline
@@ -867,9 +947,12 @@ namespace lux::rhi
 		forward.rtGraphicsPipelineCI.binaryFragmentFilePath = "data/shaders/cameraSpaceLight/cameraSpaceLight.frag.spv";
 		forward.rtGraphicsPipelineCI.cacheFilePath = "data/pipelineCache/rtGraphics.bin";
 		forward.rtGraphicsPipelineCI.vertexLayout = lux::VertexLayout::VERTEX_FULL_LAYOUT;
+		forward.rtGraphicsPipelineCI.enableInstancing = VK_TRUE;
 		forward.rtGraphicsPipelineCI.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 		forward.rtGraphicsPipelineCI.viewportWidth = TO_FLOAT(swapchainExtent.width);
 		forward.rtGraphicsPipelineCI.viewportHeight = TO_FLOAT(swapchainExtent.height);
+		// The render scale changes the viewport without recreating the pipelines
+		forward.rtGraphicsPipelineCI.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 		forward.rtGraphicsPipelineCI.rasterizerCullMode = VK_CULL_MODE_BACK_BIT;
 		forward.rtGraphicsPipelineCI.rasterizerFrontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 		forward.rtGraphicsPipelineCI.enableDepthTest = VK_TRUE;
@@ -890,18 +973,20 @@ namespace lux::rhi
 			irradianceMapDescriptorSetLayoutBinding, 
 			prefilteredMapDescriptorSetLayoutBinding,
 			BRDFLutDescriptorSetLayoutBinding,
+			materialTableDescriptorSetLayoutBinding,
+			lightClusterGridDescriptorSetLayoutBinding,
+			lightIndexListDescriptorSetLayoutBinding
 		};
 
 		forward.rtGraphicsPipelineCI.materialDescriptorSetLayoutBindings =
 		{ 
-			materialParametersDescriptorSetLayoutBinding, 
 			materialAlbedoDescriptorSetLayoutBinding, 
 			materialNormalDescriptorSetLayoutBinding,
 			materialMetallicRoughnessDescriptorSetLayoutBinding,
 			materialAmbientOcclusionDescriptorSetLayoutBinding,
 		};
 
-		forward.rtGraphicsPipelineCI.pushConstants = { rtModelPushConstantRange, lightCountPushConstantRange };
+		forward.rtGraphicsPipelineCI.pushConstants = { rtFragmentPushConstantRange };
 
 		CreateGraphicsPipeline(forward.rtGraphicsPipelineCI, forward.rtGraphicsPipeline);
 
@@ -936,11 +1021,40 @@ namespace lux::rhi
 		CreateGraphicsPipeline(forward.rtTransparentBackGraphicsPipelineCI, forward.rtTransparentBackGraphicsPipeline);
 
 
+		// Two Sided Transparent Graphics Pipeline, planar meshes have a single layer whichever side is seen
+		forward.rtTransparentTwoSidedGraphicsPipelineCI = forward.rtTransparentFrontGraphicsPipelineCI;
+		forward.rtTransparentTwoSidedGraphicsPipelineCI.rasterizerCullMode = VK_CULL_MODE_NONE;
+		forward.rtTransparentTwoSidedGraphicsPipelineCI.cacheFilePath = "data/pipelineCache/rtTransparentTwoSidedGraphics.bin";
+
+		CreateGraphicsPipeline(forward.rtTransparentTwoSidedGraphicsPipelineCI, forward.rtTransparentTwoSidedGraphicsPipeline);
+
+
+		// Depth Prepass Graphics Pipeline
+		// Same descriptor set layouts and push constants as the render target pipeline so its view descriptor set can be bound
+		forward.rtDepthPrepassGraphicsPipelineCI = forward.rtGraphicsPipelineCI;
+		forward.rtDepthPrepassGraphicsPipelineCI.binaryVertexFilePath = "data/shaders/depthPrepass/depthPrepass.vert.spv";
+		forward.rtDepthPrepassGraphicsPipelineCI.binaryFragmentFilePath = "";
+		forward.rtDepthPrepassGraphicsPipelineCI.cacheFilePath = "data/pipelineCache/rtDepthPrepassGraphics.bin";
+		forward.rtDepthPrepassGraphicsPipelineCI.vertexLayout = lux::VertexLayout::VERTEX_POSITION_ONLY_LAYOUT;
+		forward.rtDepthPrepassGraphicsPipelineCI.disableColorWriteMask = VK_TRUE;
+
+		CreateGraphicsPipeline(forward.rtDepthPrepassGraphicsPipelineCI, forward.rtDepthPrepassGraphicsPipeline);
+
+
+		// Depth Equal Graphics Pipeline
+		forward.rtDepthEqualGraphicsPipelineCI = forward.rtGraphicsPipelineCI;
+		forward.rtDepthEqualGraphicsPipelineCI.cacheFilePath = "data/pipelineCache/rtDepthEqualGraphics.bin";
+		forward.rtDepthEqualGraphicsPipelineCI.enableDepthWrite = VK_FALSE;
+		forward.rtDepthEqualGraphicsPipelineCI.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+		CreateGraphicsPipeline(forward.rtDepthEqualGraphicsPipelineCI, forward.rtDepthEqualGraphicsPipeline);
+
+
 		// Env map Pipeline
 		VkDescriptorSetLayoutBinding envMapViewProjDescriptorSetLayoutBinding = {};
 		envMapViewProjDescriptorSetLayoutBinding.binding = 0;
 		envMapViewProjDescriptorSetLayoutBinding.descriptorCount = 1;
-		envMapViewProjDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		envMapViewProjDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		envMapViewProjDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 		VkDescriptorSetLayoutBinding envMapSamplerDescriptorSetLayoutBinding = {};
@@ -959,6 +1073,7 @@ namespace lux::rhi
 		forward.envMapGraphicsPipelineCI.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
 		forward.envMapGraphicsPipelineCI.viewportWidth = TO_FLOAT(swapchainExtent.width);
 		forward.envMapGraphicsPipelineCI.viewportHeight = TO_FLOAT(swapchainExtent.height);
+		forward.envMapGraphicsPipelineCI.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 		forward.envMapGraphicsPipelineCI.rasterizerCullMode = VK_CULL_MODE_NONE;
 		forward.envMapGraphicsPipelineCI.rasterizerFrontFace = VK_FRONT_FACE_CLOCKWISE;
 		forward.envMapGraphicsPipelineCI.colorBlendAttachmentStateCount = 4;
@@ -1031,14 +1146,14 @@ namespace lux::rhi
 	void RHI::InitForwardDescriptorSets() noexcept
 	{
 		// Allocate Blit Descriptor Sets
-		std::vector<VkDescriptorSetLayout> blitDescriptorSetLayout(swapchainImageCount, forward.blitGraphicsPipeline.viewDescriptorSetLayout);
+		std::vector<VkDescriptorSetLayout> blitDescriptorSetLayout(MAX_FRAMES_IN_FLIGHT, forward.blitGraphicsPipeline.viewDescriptorSetLayout);
 		VkDescriptorSetAllocateInfo blitDescriptorSetAI = {};
 		blitDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		blitDescriptorSetAI.descriptorPool = forward.descriptorPool;
-		blitDescriptorSetAI.descriptorSetCount = swapchainImageCount;
+		blitDescriptorSetAI.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
 		blitDescriptorSetAI.pSetLayouts = blitDescriptorSetLayout.data();
 
-		forward.blitDescriptorSets.resize(TO_SIZE_T(swapchainImageCount));
+		forward.blitDescriptorSets.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
 		CHECK_VK(vkAllocateDescriptorSets(device, &blitDescriptorSetAI, forward.blitDescriptorSets.data()));
 	
 	
@@ -1078,7 +1193,7 @@ namespace lux::rhi
 		writeIndirectColorMapDescriptorSet.dstBinding = 2;
 		writeIndirectColorMapDescriptorSet.pImageInfo = &indirectColorMapDescriptorImageInfo;
 		
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			SSAOMapDescriptorImageInfo.imageView = forward.ssaoColorAttachments[i].imageView;
 
@@ -1098,14 +1213,14 @@ namespace lux::rhi
 
 
 		// Allocate SSAO Descriptor Set
-		std::vector<VkDescriptorSetLayout> SSAODescriptorSetLayout(swapchainImageCount, forward.ssaoGraphicsPipeline.viewDescriptorSetLayout);
+		std::vector<VkDescriptorSetLayout> SSAODescriptorSetLayout(MAX_FRAMES_IN_FLIGHT, forward.ssaoGraphicsPipeline.viewDescriptorSetLayout);
 		VkDescriptorSetAllocateInfo ssaoDescriptorSetAI = {};
 		ssaoDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		ssaoDescriptorSetAI.descriptorPool = forward.descriptorPool;
-		ssaoDescriptorSetAI.descriptorSetCount = swapchainImageCount;
+		ssaoDescriptorSetAI.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
 		ssaoDescriptorSetAI.pSetLayouts = SSAODescriptorSetLayout.data();
 
-		forward.ssaoDescriptorSets.resize(TO_SIZE_T(swapchainImageCount));
+		forward.ssaoDescriptorSets.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
 		CHECK_VK(vkAllocateDescriptorSets(device, &ssaoDescriptorSetAI, forward.ssaoDescriptorSets.data()));
 
 
@@ -1134,7 +1249,7 @@ namespace lux::rhi
 		writeNormalMapDescriptorSet.dstBinding = 1;
 		writeNormalMapDescriptorSet.pImageInfo = &normalMapDescriptorImageInfo;
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			writePositionMapDescriptorSet.dstSet = forward.ssaoDescriptorSets[i];
 			writeNormalMapDescriptorSet.dstSet = forward.ssaoDescriptorSets[i];
@@ -1149,102 +1264,116 @@ namespace lux::rhi
 		}
 
 		// Allocate Render Target Descriptor Set
-		std::vector<VkDescriptorSetLayout> rtViewDescriptorSetLayout(swapchainImageCount, forward.rtGraphicsPipeline.viewDescriptorSetLayout);
 		VkDescriptorSetAllocateInfo rtViewDescriptorSetAI = {};
 		rtViewDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		rtViewDescriptorSetAI.descriptorPool = forward.descriptorPool;
-		rtViewDescriptorSetAI.descriptorSetCount = swapchainImageCount;
-		rtViewDescriptorSetAI.pSetLayouts = rtViewDescriptorSetLayout.data();
+		rtViewDescriptorSetAI.descriptorSetCount = 1;
+		rtViewDescriptorSetAI.pSetLayouts = &forward.rtGraphicsPipeline.viewDescriptorSetLayout;
 
-		forward.rtViewDescriptorSets.resize(TO_SIZE_T(swapchainImageCount));
-		CHECK_VK(vkAllocateDescriptorSets(device, &rtViewDescriptorSetAI, forward.rtViewDescriptorSets.data()));
+		CHECK_VK(vkAllocateDescriptorSets(device, &rtViewDescriptorSetAI, &forward.rtViewDescriptorSet));
 
 
-		std::vector<VkDescriptorSetLayout> rtModelDescriptorSetLayout(swapchainImageCount, forward.rtGraphicsPipeline.modelDescriptorSetLayout);
+		std::vector<VkDescriptorSetLayout> rtModelDescriptorSetLayout(MAX_FRAMES_IN_FLIGHT, forward.rtGraphicsPipeline.modelDescriptorSetLayout);
 		VkDescriptorSetAllocateInfo rtModelDescriptorSetAI = {};
 		rtModelDescriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		rtModelDescriptorSetAI.descriptorPool = forward.descriptorPool;
-		rtModelDescriptorSetAI.descriptorSetCount = swapchainImageCount;
+		rtModelDescriptorSetAI.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
 		rtModelDescriptorSetAI.pSetLayouts = rtModelDescriptorSetLayout.data();
 
-		forward.rtModelDescriptorSets.resize(TO_SIZE_T(swapchainImageCount));
+		forward.rtModelDescriptorSets.resize(TO_SIZE_T(MAX_FRAMES_IN_FLIGHT));
 		CHECK_VK(vkAllocateDescriptorSets(device, &rtModelDescriptorSetAI, forward.rtModelDescriptorSets.data()));
 
 
-		// Update Render Target Descriptor Sets
+		// Update Render Target Descriptor Set
 
-		// ViewProj UBO
+		// ViewProj UBO, written every frame in the uniform ring buffer
 		VkDescriptorBufferInfo rtViewProjDescriptorBufferInfo = {};
+		rtViewProjDescriptorBufferInfo.buffer = uniformRingBuffer.buffer.buffer;
 		rtViewProjDescriptorBufferInfo.offset = 0;
 		rtViewProjDescriptorBufferInfo.range = sizeof(RtViewProjUniform);
 
 		VkWriteDescriptorSet rtWriteViewProjDescriptorSet = {};
 		rtWriteViewProjDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		rtWriteViewProjDescriptorSet.descriptorCount = 1;
-		rtWriteViewProjDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		rtWriteViewProjDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		rtWriteViewProjDescriptorSet.dstBinding = 0;
 		rtWriteViewProjDescriptorSet.dstArrayElement = 0;
 		rtWriteViewProjDescriptorSet.pBufferInfo = &rtViewProjDescriptorBufferInfo;
+		rtWriteViewProjDescriptorSet.dstSet = forward.rtViewDescriptorSet;
 
-		// Light UBOs
+		// Light UBOs, written every frame in the uniform ring buffer
 		VkDescriptorBufferInfo directionalLightDescriptorBufferInfo = {};
+		directionalLightDescriptorBufferInfo.buffer = uniformRingBuffer.buffer.buffer;
 		directionalLightDescriptorBufferInfo.offset = 0;
 		directionalLightDescriptorBufferInfo.range = sizeof(DirectionalLightBuffer) * DIRECTIONAL_LIGHT_MAX_COUNT;
 
 		VkWriteDescriptorSet writeDirectionalLightDescriptorSet = {};
 		writeDirectionalLightDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		writeDirectionalLightDescriptorSet.descriptorCount = 1;
-		writeDirectionalLightDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writeDirectionalLightDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		writeDirectionalLightDescriptorSet.dstBinding = 1;
 		writeDirectionalLightDescriptorSet.dstArrayElement = 0;
 		writeDirectionalLightDescriptorSet.pBufferInfo = &directionalLightDescriptorBufferInfo;
+		writeDirectionalLightDescriptorSet.dstSet = forward.rtViewDescriptorSet;
 
 		VkDescriptorBufferInfo pointLightDescriptorBufferInfo = {};
+		pointLightDescriptorBufferInfo.buffer = uniformRingBuffer.buffer.buffer;
 		pointLightDescriptorBufferInfo.offset = 0;
 		pointLightDescriptorBufferInfo.range = sizeof(PointLightBuffer) * POINT_LIGHT_MAX_COUNT;
 
 		VkWriteDescriptorSet writePointLightDescriptorSet = {};
 		writePointLightDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		writePointLightDescriptorSet.descriptorCount = 1;
-		writePointLightDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writePointLightDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		writePointLightDescriptorSet.dstBinding = 2;
 		writePointLightDescriptorSet.dstArrayElement = 0;
 		writePointLightDescriptorSet.pBufferInfo = &pointLightDescriptorBufferInfo;
+		writePointLightDescriptorSet.dstSet = forward.rtViewDescriptorSet;
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		// Shadow maps, slots are replaced when a light gets its shadow mapping resources
+		std::array<VkDescriptorImageInfo, DIRECTIONAL_LIGHT_MAX_COUNT> directionalShadowMapsImageDescriptorInfo;
+		for (VkDescriptorImageInfo& shadowMapDescriptorInfo : directionalShadowMapsImageDescriptorInfo)
 		{
-			rtViewProjDescriptorBufferInfo.buffer = forward.viewProjUniformBuffers[i].buffer;
-			rtWriteViewProjDescriptorSet.dstSet = forward.rtViewDescriptorSets[i];
-
-			directionalLightDescriptorBufferInfo.buffer = directionalLightUniformBuffers[i].buffer;
-			writeDirectionalLightDescriptorSet.dstSet = forward.rtViewDescriptorSets[i];
-
-			pointLightDescriptorBufferInfo.buffer = pointLightUniformBuffers[i].buffer;
-			writePointLightDescriptorSet.dstSet = forward.rtViewDescriptorSets[i];
-
-			std::array<VkWriteDescriptorSet, 3> writeDescriptorSets = {
-				rtWriteViewProjDescriptorSet,
-				writeDirectionalLightDescriptorSet,
-				writePointLightDescriptorSet
-			};
-
-			vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+			shadowMapDescriptorInfo.imageView = shadowMapper.dummyDirectionalShadowMap.imageView;
+			shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			shadowMapDescriptorInfo.sampler = forward.sampler;
 		}
-	}
 
-	void RHI::InitForwardUniformBuffers() noexcept
-	{
-		BufferCreateInfo viewProjUniformBufferCI = {};
-		viewProjUniformBufferCI.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		viewProjUniformBufferCI.size = sizeof(RtViewProjUniform);
-		viewProjUniformBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		viewProjUniformBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-
-		forward.viewProjUniformBuffers.resize(TO_UINT32_T(swapchainImageCount));
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		VkWriteDescriptorSet writeDirectionalShadowMapsDescriptorSet = {};
+		writeDirectionalShadowMapsDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDirectionalShadowMapsDescriptorSet.descriptorCount = DIRECTIONAL_LIGHT_MAX_COUNT;
+		writeDirectionalShadowMapsDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writeDirectionalShadowMapsDescriptorSet.dstBinding = 3;
+		writeDirectionalShadowMapsDescriptorSet.dstArrayElement = 0;
+		writeDirectionalShadowMapsDescriptorSet.pImageInfo = directionalShadowMapsImageDescriptorInfo.data();
+		writeDirectionalShadowMapsDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+		std::array<VkDescriptorImageInfo, POINT_LIGHT_MAX_COUNT> pointShadowMapsImageDescriptorInfo;
+		for (VkDescriptorImageInfo& shadowMapDescriptorInfo : pointShadowMapsImageDescriptorInfo)
 		{
-			CreateBuffer(viewProjUniformBufferCI, forward.viewProjUniformBuffers[i]);
+			shadowMapDescriptorInfo.imageView = shadowMapper.dummyPointShadowMap.imageView;
+			shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			shadowMapDescriptorInfo.sampler = forward.sampler;
 		}
+
+		VkWriteDescriptorSet writePointShadowMapsDescriptorSet = {};
+		writePointShadowMapsDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writePointShadowMapsDescriptorSet.descriptorCount = POINT_LIGHT_MAX_COUNT;
+		writePointShadowMapsDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writePointShadowMapsDescriptorSet.dstBinding = 4;
+		writePointShadowMapsDescriptorSet.dstArrayElement = 0;
+		writePointShadowMapsDescriptorSet.pImageInfo = pointShadowMapsImageDescriptorInfo.data();
+		writePointShadowMapsDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+		std::array<VkWriteDescriptorSet, 5> writeDescriptorSets = {
+			rtWriteViewProjDescriptorSet,
+			writeDirectionalLightDescriptorSet,
+			writePointLightDescriptorSet,
+			writeDirectionalShadowMapsDescriptorSet,
+			writePointShadowMapsDescriptorSet
+		};
+
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
 	void RHI::GenerateSSAOKernels() noexcept
@@ -1281,6 +1410,8 @@ namespace lux::rhi
 		SSAOKernelBufferCI.data = ssaoKernel.data();
 		SSAOKernelBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		SSAOKernelBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		SSAOKernelBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_UNIFORM;
+		SSAOKernelBufferCI.debugName = "SSAO Kernels";
 
 		CreateBuffer(SSAOKernelBufferCI, forward.SSAOKernelsUniformBuffer);
 
@@ -1301,6 +1432,8 @@ namespace lux::rhi
 		ssaoNoiseImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		ssaoNoiseImageCI.subresourceRangeLayerCount = 1;
 		ssaoNoiseImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		ssaoNoiseImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_TEXTURE;
+		ssaoNoiseImageCI.debugName = "SSAO Noise";
 
 		CreateImageFromBuffer(ssaoNoiseImageCI, ssaoNoise.data(), TO_UINT32_T(ssaoNoise.size()) * sizeof(glm::vec4), forward.SSAONoiseImage);
 
@@ -1331,7 +1464,7 @@ namespace lux::rhi
 		writeSSAONoiseDescriptorSet.pImageInfo = &SSAONoiseDescriptorImageInfo;
 
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			writeSSAOKernelsDescriptorSet.dstSet = forward.ssaoDescriptorSets[i];
 			writeSSAONoiseDescriptorSet.dstSet = forward.ssaoDescriptorSets[i];
@@ -1346,7 +1479,7 @@ namespace lux::rhi
 		}
 	}
 
-	void RHI::UpdateForwardUniformBuffers(const scene::CameraNode* camera, const std::vector<resource::Material*>& materials) noexcept
+	void RHI::UpdateForwardUniformBuffers(const scene::CameraNode* camera) noexcept
 	{
 		// Camera View & Proj
 
@@ -1354,20 +1487,144 @@ namespace lux::rhi
 		forward.rtViewProjUniform.projection = camera->GetPerspectiveProjectionTransform();
 		forward.rtViewProjUniform.nearFarPlane = glm::vec2(camera->GetNearDistance(), camera->GetFarDistance());
 
-		UpdateBuffer(forward.viewProjUniformBuffers[currentFrame], &forward.rtViewProjUniform);
+		forward.viewProjUniformOffset = PushUniformData(&forward.rtViewProjUniform, sizeof(RtViewProjUniform));
+	}
+
+	bool RHI::GetIsDepthPrepassEnabled() const noexcept
+	{
+		return forward.isDepthPrepassEnabled;
+	}
+
+	void RHI::SetIsDepthPrepassEnabled(bool isEnabled) noexcept
+	{
+		forward.isDepthPrepassEnabled = isEnabled;
+	}
+
+	void RHI::PrepareForward(const scene::CameraNode* camera, const std::vector<scene::MeshNode*>& meshes) noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		const std::vector<scene::MeshNode*>* queuedMeshes = &meshes;
+
+		if (isCpuCullingEnabled)
+		{
+			forward.meshBounds.Clear();
+			forward.meshBounds.Reserve(meshes.size());
+
+			for (const scene::MeshNode* meshNode : meshes)
+				forward.meshBounds.Add(meshNode->GetMesh().aabb, meshNode->GetCachedWorldTransform());
+
+			CullBounds(camera->GetFrustum(), forward.meshBounds, forward.visibleMeshIndices);
+
+			forward.visibleMeshes.clear();
 
-		// Materials
+			for (uint32_t index : forward.visibleMeshIndices)
+				forward.visibleMeshes.push_back(meshes[index]);
 
-		for (size_t i = 0; i < materials.size(); i++)
+			queuedMeshes = &forward.visibleMeshes;
+		}
+
+		// The sorted queue is a flat list, the opaque draws can be split in even chunks
+		BuildRenderQueue(forward.renderQueue, camera, *queuedMeshes);
+		BuildRenderBatches(forward.renderQueue);
+
+		// The draw loops read the culled copies of the records when the GPU culling runs
+		glm::mat4 viewProj = camera->GetPerspectiveProjectionTransform() * camera->GetViewTransform();
+
+		forward.renderQueue.firstDrawCommand = AddGpuOcclusionCullingView(forward.renderQueue, viewProj, forward.lateFirstDrawCommand);
+
+		UpdateForwardUniformBuffers(camera);
+
+		// Point light lists of the froxels, read by the shading of every pass below
+		BuildLightClusters();
+
+		// Recording tasks, executed in this order inside the render pass
+		VkFramebuffer framebuffer = forward.rtFrameBuffers[currentFrame];
+		VkRenderPass renderPass = forward.rtRenderPass;
+
+		forward.firstRecordingTaskIndex = parallelRecorder.tasks.size();
+		forward.earlyRecordingTaskCount = 0;
+
+		if (gpuCuller.isOcclusionActive)
 		{
-			UpdateBuffer(materials[i]->buffer[currentFrame], &materials[i]->parameter);
+			// The early pass draws the opaque instances visible in last frame's pyramid, the late pass the ones found hidden wrongly
+			AddForwardOpaqueRecordingTasks(forward.rtEarlyRenderPass, forward.renderQueue.firstDrawCommand, "Forward Early Depth Prepass", "Forward Early Opaque");
+			forward.earlyRecordingTaskCount = parallelRecorder.tasks.size() - forward.firstRecordingTaskIndex;
+
+			renderPass = forward.rtLateRenderPass;
+			AddForwardOpaqueRecordingTasks(renderPass, forward.lateFirstDrawCommand, "Forward Late Depth Prepass", "Forward Late Opaque");
 		}
+		else
+			AddForwardOpaqueRecordingTasks(renderPass, forward.renderQueue.firstDrawCommand, "Forward Depth Prepass", "Forward Opaque");
+
+		uint32_t envMapScope = AddGpuTimestampScope("Forward Env Map");
+		uint32_t transparentScope = AddGpuTimestampScope("Forward Transparent");
+
+		AddRecordingTask(renderPass, framebuffer, [this, envMapScope](VkCommandBuffer secondaryCommandBuffer)
+		{
+			CommandBeginGpuTimestamp(secondaryCommandBuffer, envMapScope);
+			CommandSetRenderViewport(secondaryCommandBuffer);
+			RecordForwardEnvMap(secondaryCommandBuffer);
+			CommandEndGpuTimestamp(secondaryCommandBuffer, envMapScope);
+		});
+
+		AddRecordingTask(renderPass, framebuffer, [this, transparentScope](VkCommandBuffer secondaryCommandBuffer)
+		{
+			CommandBeginGpuTimestamp(secondaryCommandBuffer, transparentScope);
+			CommandSetRenderViewport(secondaryCommandBuffer);
+			RecordForwardTransparentDraws(secondaryCommandBuffer);
+			CommandEndGpuTimestamp(secondaryCommandBuffer, transparentScope);
+		});
+
+		forward.recordingTaskCount = parallelRecorder.tasks.size() - forward.firstRecordingTaskIndex;
 	}
 
-	void RHI::RenderForward(VkCommandBuffer commandBuffer, int imageIndex, const scene::CameraNode* camera, const std::vector<scene::MeshNode*>& meshes, const std::vector<scene::LightNode*>& lights) noexcept
+	void RHI::AddForwardOpaqueRecordingTasks(VkRenderPass renderPass, uint32_t firstDrawCommand, const std::string& depthPrepassScopeName, const std::string& opaqueScopeName) noexcept
 	{
+		VkFramebuffer framebuffer = forward.rtFrameBuffers[currentFrame];
+		size_t opaqueBatchCount = forward.renderQueue.opaqueBatchCount;
 
-		VkDeviceSize vertexBufferOffsets[] = { 0 };
+		if (forward.isDepthPrepassEnabled && forward.renderQueue.depthPrepassBatchCount > 0)
+		{
+			uint32_t depthPrepassScope = AddGpuTimestampScope(depthPrepassScopeName);
+
+			AddRecordingTask(renderPass, framebuffer, [this, firstDrawCommand, depthPrepassScope](VkCommandBuffer secondaryCommandBuffer)
+			{
+				CommandBeginGpuTimestamp(secondaryCommandBuffer, depthPrepassScope);
+				CommandSetRenderViewport(secondaryCommandBuffer);
+				RecordForwardDepthPrepass(secondaryCommandBuffer, firstDrawCommand);
+				CommandEndGpuTimestamp(secondaryCommandBuffer, depthPrepassScope);
+			});
+		}
+
+		// The forward pass contents are secondary command buffers, the timestamps are written inside them
+		uint32_t opaqueScope = opaqueBatchCount > 0 ? AddGpuTimestampScope(opaqueScopeName) : GPU_PROFILER_INVALID_SCOPE;
+
+		for (size_t first = 0; first < opaqueBatchCount; first += RECORDING_DRAWS_PER_TASK)
+		{
+			size_t count = std::min(TO_SIZE_T(RECORDING_DRAWS_PER_TASK), opaqueBatchCount - first);
+			bool isFirstTask = first == 0;
+			bool isLastTask = first + count == opaqueBatchCount;
+
+			AddRecordingTask(renderPass, framebuffer, [this, firstDrawCommand, first, count, isFirstTask, isLastTask, opaqueScope](VkCommandBuffer secondaryCommandBuffer)
+			{
+				if (isFirstTask)
+					CommandBeginGpuTimestamp(secondaryCommandBuffer, opaqueScope);
+
+				// Secondary command buffers do not inherit the dynamic state
+				CommandSetRenderViewport(secondaryCommandBuffer);
+
+				RecordForwardOpaqueDraws(secondaryCommandBuffer, firstDrawCommand, first, count);
+
+				if (isLastTask)
+					CommandEndGpuTimestamp(secondaryCommandBuffer, opaqueScope);
+			});
+		}
+	}
+
+	void RHI::RenderForward(VkCommandBuffer commandBuffer) noexcept
+	{
+		CPU_PROFILE_FUNCTION();
 
 		VkClearColorValue clearColor{ 0.5f, 0.5703125f, 0.6171875f, 1.0F };
 
@@ -1384,138 +1641,199 @@ namespace lux::rhi
 		VkRenderPassBeginInfo renderPassBI = {};
 		renderPassBI.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassBI.renderPass = forward.rtRenderPass;
-		renderPassBI.framebuffer = forward.rtFrameBuffers[imageIndex];
-		renderPassBI.renderArea.extent = swapchainExtent;
+		renderPassBI.framebuffer = forward.rtFrameBuffers[currentFrame];
+		renderPassBI.renderArea.extent = dynamicResolution.renderExtent;
 		renderPassBI.clearValueCount = TO_UINT32_T(clearValues.size());
 		renderPassBI.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassBI, VK_SUBPASS_CONTENTS_INLINE);
+		size_t lateRecordingTaskIndex = forward.firstRecordingTaskIndex;
 
-		// Sort mesh node by material
-		std::map<std::string, std::vector<scene::MeshNode*>> sortedMeshNodes;
-		std::map<std::string, std::vector<scene::MeshNode*>> sortedTransparentMeshNodes;
-		std::vector<resource::Material*> materials;
+		if (gpuCuller.isOcclusionActive)
 		{
-			std::vector<scene::MeshNode*>::const_iterator it = meshes.cbegin();
-			std::vector<scene::MeshNode*>::const_iterator itE = meshes.cend();
+			renderPassBI.renderPass = forward.rtEarlyRenderPass;
 
-			for (; it != itE; ++it)
-			{
-				resource::Material* currentMaterial = &(*it)->GetMaterial();
-				std::string key = currentMaterial->name;
-
-				std::map<std::string, std::vector<scene::MeshNode*>>::iterator firstMaterial = sortedMeshNodes.find(key);
-				std::map<std::string, std::vector<scene::MeshNode*>>::iterator firstTransparentMaterial = sortedTransparentMeshNodes.find(key);
-				if (firstMaterial == sortedMeshNodes.end() || firstTransparentMaterial == sortedTransparentMeshNodes.end())
-				{
-					materials.push_back(currentMaterial);
-				}
-
-				if (currentMaterial->isTransparent)
-				{
-					//sortedMeshNodes[key].push_back(*it);
-					sortedTransparentMeshNodes[key].push_back(*it);
-				}
-				else
-					sortedMeshNodes[key].push_back(*it);
-			}
+			vkCmdBeginRenderPass(commandBuffer, &renderPassBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			CommandExecuteRecordingTasks(commandBuffer, forward.firstRecordingTaskIndex, forward.earlyRecordingTaskCount);
+
+			vkCmdEndRenderPass(commandBuffer);
+
+			// The pyramid of the early depth finds which of the instances hidden last frame are visible now
+			CommandBuildHiZPyramid(commandBuffer);
+
+			CommandDispatchGpuCulling(commandBuffer, GpuCullingPhase::GPU_CULLING_PHASE_LATE);
+
+			renderPassBI.renderPass = forward.rtLateRenderPass;
+			lateRecordingTaskIndex += forward.earlyRecordingTaskCount;
 		}
 
-		UpdateForwardUniformBuffers(camera, materials);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		CommandExecuteRecordingTasks(commandBuffer, lateRecordingTaskIndex, forward.recordingTaskCount - forward.earlyRecordingTaskCount);
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void RHI::RecordForwardDepthPrepass(VkCommandBuffer commandBuffer, uint32_t firstDrawCommand) const noexcept
+	{
+		std::array<uint32_t, 5> rtViewDynamicOffsets = { forward.viewProjUniformOffset, directionalLightUniformOffset, pointLightUniformOffset, lightClusterer.frameOffset, lightClusterer.frameOffset };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtDepthPrepassGraphicsPipeline.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtDepthPrepassGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_VIEW_DESCRIPTOR_SET_LAYOUT, 1, &forward.rtViewDescriptorSet, TO_UINT32_T(rtViewDynamicOffsets.size()), rtViewDynamicOffsets.data());
+
+		BindMeshArena(commandBuffer);
+		BindInstanceBuffer(commandBuffer);
+
+		// Positions only and no material, the leading opaque batches are drawn by a single indirect call
+		CommandDrawIndexedIndirect(commandBuffer, firstDrawCommand, TO_UINT32_T(forward.renderQueue.depthPrepassBatchCount));
+	}
+
+	void RHI::RecordForwardOpaqueDraws(VkCommandBuffer commandBuffer, uint32_t firstDrawCommand, size_t firstBatch, size_t batchCount) const noexcept
+	{
+		std::array<uint32_t, 5> rtViewDynamicOffsets = { forward.viewProjUniformOffset, directionalLightUniformOffset, pointLightUniformOffset, lightClusterer.frameOffset, lightClusterer.frameOffset };
+
+		// The batches drawn by the depth prepass only shade the fragments that wrote the closest depth
+		bool isDepthPrepassDrawn = forward.isDepthPrepassEnabled && forward.renderQueue.depthPrepassBatchCount > 0;
+		VkPipeline depthPrepassedPipeline = isDepthPrepassDrawn ? forward.rtDepthEqualGraphicsPipeline.pipeline : forward.rtGraphicsPipeline.pipeline;
+		VkPipeline boundPipeline = VK_NULL_HANDLE;
 
 		// Render Target Subpass
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_VIEW_DESCRIPTOR_SET_LAYOUT, 1, &forward.rtViewDescriptorSets[currentFrame], 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_VIEW_DESCRIPTOR_SET_LAYOUT, 1, &forward.rtViewDescriptorSet, TO_UINT32_T(rtViewDynamicOffsets.size()), rtViewDynamicOffsets.data());
 
-		vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(RtModelConstant), sizeof(LightCountsPushConstant), &lightCountsPushConstant);
+		vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(LightCountsPushConstant), &lightCountsPushConstant);
 
-		sortedMeshNodesConstIterator it = sortedMeshNodes.cbegin();
-		sortedMeshNodesConstIterator itE = sortedMeshNodes.cend();
-		
-		// Draw opaque object
-		for (; it != itE; ++it)
+		BindMeshArena(commandBuffer);
+		BindInstanceBuffer(commandBuffer);
+
+		const RenderQueue& renderQueue = forward.renderQueue;
+
+		RtMaterialConstant materialConstant = {};
+
+		size_t lastBatch = firstBatch + batchCount;
+		size_t i = firstBatch;
+
+		while (i < lastBatch)
 		{
-			std::vector<scene::MeshNode*> meshNodes = it->second;
-			const resource::Material& material = meshNodes[0]->GetMaterial();
+			// Pass, pipeline and material lead the key, the batches sharing them are drawn by one indirect call
+			uint64_t stateKey = renderQueue.batches[i].key >> RENDER_QUEUE_MATERIAL_SHIFT;
 
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_MATERIAL_DESCRIPTOR_SET_LAYOUT, 1, &material.descriptorSet[currentFrame], 0, nullptr);
+			size_t runEnd = i + 1;
+			while (runEnd < lastBatch && (renderQueue.batches[runEnd].key >> RENDER_QUEUE_MATERIAL_SHIFT) == stateKey)
+				runEnd++;
 
+			VkPipeline pipeline = i < renderQueue.depthPrepassBatchCount ? depthPrepassedPipeline : forward.rtGraphicsPipeline.pipeline;
 
-			std::vector<scene::MeshNode*>::const_iterator itMesh = meshNodes.cbegin();
-			std::vector<scene::MeshNode*>::const_iterator itMeshEnd = meshNodes.cend();
-		
-			for (; itMesh != itMeshEnd; ++itMesh)
+			if (pipeline != boundPipeline)
 			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				boundPipeline = pipeline;
+			}
 
-				forward.modelConstant.model = (*itMesh)->GetWorldTransform();
-				vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(RtModelConstant), &forward.modelConstant);
+			const resource::Material& material = renderQueue.batches[i].meshNode->GetMaterial();
 
-				const resource::Mesh& currentMesh = (*itMesh)->GetMesh();
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &currentMesh.vertexBuffer.buffer, vertexBufferOffsets);
-				vkCmdBindIndexBuffer(commandBuffer, currentMesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(commandBuffer, currentMesh.indexCount, 1, 0, 0, 0);
-			}
-		}
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_MATERIAL_DESCRIPTOR_SET_LAYOUT, 1, &material.descriptorSet, 0, nullptr);
+
+			materialConstant.materialIndex = material.materialIndex;
+			vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(LightCountsPushConstant), sizeof(RtMaterialConstant), &materialConstant);
+
+			CommandDrawIndexedIndirect(commandBuffer, firstDrawCommand + TO_UINT32_T(i), TO_UINT32_T(runEnd - i));
 
+			i = runEnd;
+		}
+	}
 
-		// Environment Map
+	void RHI::RecordForwardEnvMap(VkCommandBuffer commandBuffer) const noexcept
+	{
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.envMapGraphicsPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.envMapGraphicsPipeline.pipelineLayout, 0, 1, &forward.envMapViewDescriptorSets[currentFrame], 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.envMapGraphicsPipeline.pipelineLayout, 0, 1, &forward.envMapViewDescriptorSet, 1, &forward.viewProjUniformOffset);
+
+		BindMeshArena(commandBuffer);
+
+		vkCmdDrawIndexed(commandBuffer, cube->indexCount, 1, cube->firstIndex, cube->vertexOffset, 0);
+	}
 
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &cube->vertexBuffer.buffer, vertexBufferOffsets);
-		vkCmdBindIndexBuffer(commandBuffer, cube->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	void RHI::RecordForwardTransparentDraws(VkCommandBuffer commandBuffer) const noexcept
+	{
+		std::array<uint32_t, 5> rtViewDynamicOffsets = { forward.viewProjUniformOffset, directionalLightUniformOffset, pointLightUniformOffset, lightClusterer.frameOffset, lightClusterer.frameOffset };
 
-		vkCmdDrawIndexed(commandBuffer, cube->indexCount, 1, 0, 0, 0);
+		// The transparent pipelines share the render target pipeline layout
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_VIEW_DESCRIPTOR_SET_LAYOUT, 1, &forward.rtViewDescriptorSet, TO_UINT32_T(rtViewDynamicOffsets.size()), rtViewDynamicOffsets.data());
 
+		vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(LightCountsPushConstant), &lightCountsPushConstant);
 
+		BindMeshArena(commandBuffer);
+		BindInstanceBuffer(commandBuffer);
 
-		// Draw transparent object
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_VIEW_DESCRIPTOR_SET_LAYOUT, 1, &forward.rtViewDescriptorSets[currentFrame], 0, nullptr);
+		const RenderQueue& renderQueue = forward.renderQueue;
 
-		it = sortedTransparentMeshNodes.cbegin();
-		itE = sortedTransparentMeshNodes.cend();
+		uint32_t boundMaterialIndex = UINT32_MAX;
+		VkPipeline boundPipeline = VK_NULL_HANDLE;
+		RtMaterialConstant materialConstant = {};
 
-		// TODO: Split transparent rendering into 3 loops - 1 per pipeline
-		for (; it != itE; ++it)
+		auto bindPipeline = [commandBuffer, &boundPipeline](VkPipeline pipeline)
 		{
-			std::vector<scene::MeshNode*> meshNodes = it->second;
-			const resource::Material& material = meshNodes[0]->GetMaterial();
+			if (pipeline == boundPipeline)
+				return;
 
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_MATERIAL_DESCRIPTOR_SET_LAYOUT, 1, &material.descriptorSet[currentFrame], 0, nullptr);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+		};
 
+		size_t batchCount = renderQueue.batches.size();
+		size_t i = renderQueue.opaqueBatchCount;
 
-			std::vector<scene::MeshNode*>::const_iterator itMesh = meshNodes.cbegin();
-			std::vector<scene::MeshNode*>::const_iterator itMeshEnd = meshNodes.cend();
+		// The batches are sorted back to front, the draw order is kept and only the bindings that change are recorded
+		while (i < batchCount)
+		{
+			const RenderBatch& batch = renderQueue.batches[i];
+			const resource::Material& material = batch.meshNode->GetMaterial();
+			bool isPlanar = batch.meshNode->GetMesh().isPlanar;
 
-			for (; itMesh != itMeshEnd; ++itMesh)
+			if (material.materialIndex != boundMaterialIndex)
 			{
-				forward.modelConstant.model = (*itMesh)->GetWorldTransform();
-				vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(RtModelConstant), &forward.modelConstant);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtGraphicsPipeline.pipelineLayout, ForwardRenderer::FORWARD_MATERIAL_DESCRIPTOR_SET_LAYOUT, 1, &material.descriptorSet, 0, nullptr);
 
-				const resource::Mesh& currentMesh = (*itMesh)->GetMesh();
+				materialConstant.materialIndex = material.materialIndex;
+				vkCmdPushConstants(commandBuffer, forward.rtGraphicsPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(LightCountsPushConstant), sizeof(RtMaterialConstant), &materialConstant);
 
-				//vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtCutoutGraphicsPipeline.pipeline);
-				//vkCmdBindVertexBuffers(commandBuffer, 0, 1, &currentMesh.vertexBuffer.buffer, vertexBufferOffsets);
-				//vkCmdBindIndexBuffer(commandBuffer, currentMesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-				//vkCmdDrawIndexed(commandBuffer, currentMesh.indexCount, 1, 0, 0, 0);
+				boundMaterialIndex = material.materialIndex;
+			}
 
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtTransparentBackGraphicsPipeline.pipeline);
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &currentMesh.vertexBuffer.buffer, vertexBufferOffsets);
-				vkCmdBindIndexBuffer(commandBuffer, currentMesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(commandBuffer, currentMesh.indexCount, 1, 0, 0, 0);
+			// Consecutive planar batches sharing the material are one two sided indirect call, their records are adjacent
+			size_t runEnd = i + 1;
 
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.rtTransparentFrontGraphicsPipeline.pipeline);
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &currentMesh.vertexBuffer.buffer, vertexBufferOffsets);
-				vkCmdBindIndexBuffer(commandBuffer, currentMesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(commandBuffer, currentMesh.indexCount, 1, 0, 0, 0);
+			if (isPlanar)
+			{
+				while (runEnd < batchCount && renderQueue.batches[runEnd].meshNode->GetMesh().isPlanar
+					&& renderQueue.batches[runEnd].meshNode->GetMaterial().materialIndex == material.materialIndex)
+					runEnd++;
 			}
-		}
 
-		vkCmdEndRenderPass(commandBuffer);
+			uint32_t drawCommand = renderQueue.firstDrawCommand + TO_UINT32_T(i);
+
+			if (isPlanar)
+			{
+				bindPipeline(forward.rtTransparentTwoSidedGraphicsPipeline.pipeline);
+				CommandDrawIndexedIndirect(commandBuffer, drawCommand, TO_UINT32_T(runEnd - i));
+			}
+			else
+			{
+				// A closed mesh blends its far side first, then its near side over it
+				bindPipeline(forward.rtTransparentBackGraphicsPipeline.pipeline);
+				CommandDrawIndexedIndirect(commandBuffer, drawCommand, 1);
+
+				bindPipeline(forward.rtTransparentFrontGraphicsPipeline.pipeline);
+				CommandDrawIndexedIndirect(commandBuffer, drawCommand, 1);
+			}
+
+			i = runEnd;
+		}
 	}
 
 	void RHI::RenderPostProcess(VkCommandBuffer commandBuffer, int imageIndex, const scene::CameraNode* camera) noexcept
 	{
+		CPU_PROFILE_FUNCTION();
+
 		VkDeviceSize vertexBufferOffsets[] = { 0 };
 
 		VkClearColorValue clearColor{ 1.0f, 1.0f, 1.0f, 1.0F };
@@ -1528,14 +1846,18 @@ namespace lux::rhi
 		VkRenderPassBeginInfo SSAOrenderPassBI = {};
 		SSAOrenderPassBI.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		SSAOrenderPassBI.renderPass = forward.ssaoRenderPass;
-		SSAOrenderPassBI.framebuffer = forward.ssaoFrameBuffers[imageIndex];
-		SSAOrenderPassBI.renderArea.extent = swapchainExtent;
+		SSAOrenderPassBI.framebuffer = forward.ssaoFrameBuffers[currentFrame];
+		SSAOrenderPassBI.renderArea.extent = dynamicResolution.renderExtent;
 		SSAOrenderPassBI.clearValueCount = TO_UINT32_T(clearValues.size());
 		SSAOrenderPassBI.pClearValues = clearValues.data();
 
+		uint32_t ssaoScope = AddGpuTimestampScope("SSAO");
+		CommandBeginGpuTimestamp(commandBuffer, ssaoScope);
+
 		vkCmdBeginRenderPass(commandBuffer, &SSAOrenderPassBI, VK_SUBPASS_CONTENTS_INLINE);
 
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.ssaoGraphicsPipeline.pipeline);
+		CommandSetRenderViewport(commandBuffer);
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.ssaoGraphicsPipeline.pipelineLayout, 0, 1, &forward.ssaoDescriptorSets[currentFrame], 0, nullptr);
 
 		forward.ssaoParameters.proj = camera->GetPerspectiveProjectionTransform();
@@ -1545,6 +1867,8 @@ namespace lux::rhi
 
 		vkCmdEndRenderPass(commandBuffer);
 
+		CommandEndGpuTimestamp(commandBuffer, ssaoScope);
+
 
 		// Begin Blit Render Pass
 		VkRenderPassBeginInfo blitRenderPassBI = {};
@@ -1555,8 +1879,14 @@ namespace lux::rhi
 		blitRenderPassBI.clearValueCount = TO_UINT32_T(clearValues.size());
 		blitRenderPassBI.pClearValues = clearValues.data();
 
+		uint32_t blitScope = AddGpuTimestampScope("Blit FXAA");
+		// A scope that is never written would keep the whole frame's queries unavailable
+		uint32_t imguiScope = isHeadless ? GPU_PROFILER_INVALID_SCOPE : AddGpuTimestampScope("ImGui");
+
 		vkCmdBeginRenderPass(commandBuffer, &blitRenderPassBI, VK_SUBPASS_CONTENTS_INLINE);
 
+		CommandBeginGpuTimestamp(commandBuffer, blitScope);
+
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.blitGraphicsPipeline.pipeline);
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forward.blitGraphicsPipeline.pipelineLayout, 0, 1, &forward.blitDescriptorSets[currentFrame], 0, nullptr);
 
@@ -1564,7 +1894,15 @@ namespace lux::rhi
 
 		vkCmdDraw(commandBuffer, 4, 1, 0, 0);
 
-		RenderImgui();
+		CommandEndGpuTimestamp(commandBuffer, blitScope);
+
+		CommandBeginGpuTimestamp(commandBuffer, imguiScope);
+
+		// Headless runs have no UI
+		if (!isHeadless)
+			RenderImgui();
+
+		CommandEndGpuTimestamp(commandBuffer, imguiScope);
 
 		vkCmdEndRenderPass(commandBuffer);
 	}
@@ -1577,19 +1915,25 @@ namespace lux::rhi
 		DestroyGraphicsPipeline(forward.rtCutoutGraphicsPipeline);
 		DestroyGraphicsPipeline(forward.rtTransparentBackGraphicsPipeline);
 		DestroyGraphicsPipeline(forward.rtTransparentFrontGraphicsPipeline);
+		DestroyGraphicsPipeline(forward.rtTransparentTwoSidedGraphicsPipeline);
+		DestroyGraphicsPipeline(forward.rtDepthPrepassGraphicsPipeline);
+		DestroyGraphicsPipeline(forward.rtDepthEqualGraphicsPipeline);
 		DestroyGraphicsPipeline(forward.envMapGraphicsPipeline);
 
 		vkDestroyDescriptorPool(device, forward.descriptorPool, nullptr);
 
 		for (size_t i = 0; i < swapchainImageCount; i++)
 		{
-			DestroyBuffer(forward.viewProjUniformBuffers[i]);
-			vkDestroyFramebuffer(device, forward.rtFrameBuffers[i], nullptr);
 			vkDestroyFramebuffer(device, forward.blitFrameBuffers[i], nullptr);
+		}
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			vkDestroyFramebuffer(device, forward.rtFrameBuffers[i], nullptr);
 
 			vkDestroyImage(device, forward.rtColorAttachmentImages[i], nullptr);
 			vkDestroyImageView(device, forward.rtColorAttachmentImageViews[i], nullptr);
-			vkFreeMemory(device, forward.rtColorAttachmentImageMemories[i], nullptr);
+			FreeMemory(forward.rtColorAttachmentImageAllocations[i]);
 
 			DestroyImage(forward.ssaoColorAttachments[i]);
 			vkDestroyFramebuffer(device, forward.ssaoFrameBuffers[i], nullptr);
@@ -1603,7 +1947,7 @@ namespace lux::rhi
 
 		vkDestroyImage(device, forward.rtDepthAttachmentImage, nullptr);
 		vkDestroyImageView(device, forward.rtDepthAttachmentImageView, nullptr);
-		vkFreeMemory(device, forward.rtDepthAttachmentMemory, nullptr);
+		FreeMemory(forward.rtDepthAttachmentAllocation);
 
 		DestroyImage(forward.rtResolveColorAttachment);
 		DestroyImage(forward.rtPositionMap);
@@ -1616,6 +1960,8 @@ namespace lux::rhi
 		DestroyBuffer(forward.SSAOKernelsUniformBuffer);
 
 		vkDestroyRenderPass(device, forward.rtRenderPass, nullptr);
+		vkDestroyRenderPass(device, forward.rtEarlyRenderPass, nullptr);
+		vkDestroyRenderPass(device, forward.rtLateRenderPass, nullptr);
 		vkDestroyRenderPass(device, forward.blitRenderPass, nullptr);
 		vkDestroyRenderPass(device, forward.ssaoRenderPass, nullptr);
 	}
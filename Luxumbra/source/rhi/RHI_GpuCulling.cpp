@@ -0,0 +1,635 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+#include "Frustum.h"
+
+namespace lux::rhi
+{
+
+	GpuCuller::GpuCuller() noexcept
+		: isSupported(false), isEnabled(true), isActive(false), pipeline(), descriptorPool(VK_NULL_HANDLE), descriptorSets(),
+		instanceBuffers(), instanceCapacities(), viewBuffers(), viewCapacities(), culledInstanceBuffers(), culledInstanceCapacities(),
+		instances(0), views(0), culledInstanceCount(0), isOcclusionCullingEnabled(true), isOcclusionActive(false), earlyVisibilityBuffers(), earlyVisibilityCapacities(),
+		hiZImage(), hiZMipImageViews(), hiZImageExtent({ 0, 0 }), hiZSampler(VK_NULL_HANDLE), hiZDepthPipeline(), hiZDownsamplePipeline(), hiZDescriptorPool(VK_NULL_HANDLE), hiZDescriptorSets(),
+		isHiZValid(false), hiZViewProj(1.f), hiZRenderExtent({ 0, 0 })
+	{
+
+	}
+
+	void RHI::InitGpuCulling() noexcept
+	{
+		gpuCuller.isSupported = drawCommandBuffer.isIndirectFirstInstanceSupported;
+
+		if (gpuCuller.isSupported == false)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_WARNING, "GPU culling needs drawIndirectFirstInstance, the draws are not culled");
+			return;
+		}
+
+		// Pipeline
+
+		// Storage buffers, then the Hi-Z pyramid
+		std::array<VkDescriptorSetLayoutBinding, 7> descriptorSetLayoutBindings = {};
+
+		for (size_t i = 0; i < descriptorSetLayoutBindings.size(); i++)
+		{
+			descriptorSetLayoutBindings[i].binding = TO_UINT32_T(i);
+			descriptorSetLayoutBindings[i].descriptorCount = 1;
+			descriptorSetLayoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorSetLayoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		descriptorSetLayoutBindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		VkPushConstantRange cullingPushConstantRange = {};
+		cullingPushConstantRange.offset = 0;
+		cullingPushConstantRange.size = sizeof(GpuCullingPushConstant);
+		cullingPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		ComputePipelineCreateInfo computePipelineCI = {};
+		computePipelineCI.binaryComputeFilePath = "data/shaders/culling/frustumCulling.comp.spv";
+		computePipelineCI.descriptorSetLayoutBindings.assign(descriptorSetLayoutBindings.cbegin(), descriptorSetLayoutBindings.cend());
+		computePipelineCI.pushConstants = { cullingPushConstantRange };
+
+		CreateComputePipeline(computePipelineCI, gpuCuller.pipeline);
+
+		// Descriptor sets, the buffers are rewritten every frame since they can be replaced
+
+		std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes = {};
+		descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorPoolSizes[0].descriptorCount = TO_UINT32_T(descriptorSetLayoutBindings.size() - 1) * MAX_FRAMES_IN_FLIGHT;
+		descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorPoolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo descriptorPoolCI = {};
+		descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCI.poolSizeCount = TO_UINT32_T(descriptorPoolSizes.size());
+		descriptorPoolCI.pPoolSizes = descriptorPoolSizes.data();
+		descriptorPoolCI.maxSets = MAX_FRAMES_IN_FLIGHT;
+
+		CHECK_VK(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &gpuCuller.descriptorPool));
+
+		std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> descriptorSetLayouts;
+		descriptorSetLayouts.fill(gpuCuller.pipeline.descriptorSetLayout);
+
+		VkDescriptorSetAllocateInfo descriptorSetAI = {};
+		descriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAI.descriptorPool = gpuCuller.descriptorPool;
+		descriptorSetAI.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+		descriptorSetAI.pSetLayouts = descriptorSetLayouts.data();
+
+		CHECK_VK(vkAllocateDescriptorSets(device, &descriptorSetAI, gpuCuller.descriptorSets.data()));
+
+		// Buffers
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			std::string frameIndex = std::to_string(i);
+
+			CreateGpuCullingBuffer(gpuCuller.instanceBuffers[i], gpuCuller.instanceCapacities[i], GPU_CULLING_INITIAL_INSTANCE_CAPACITY, sizeof(GpuCullingInstance),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "GPU Culling Instance Buffer " + frameIndex);
+
+			CreateGpuCullingBuffer(gpuCuller.viewBuffers[i], gpuCuller.viewCapacities[i], GPU_CULLING_INITIAL_VIEW_CAPACITY, sizeof(GpuCullingView),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "GPU Culling View Buffer " + frameIndex);
+
+			CreateGpuCullingBuffer(gpuCuller.culledInstanceBuffers[i], gpuCuller.culledInstanceCapacities[i], GPU_CULLING_INITIAL_INSTANCE_CAPACITY, sizeof(glm::mat4),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Culled Instance Buffer " + frameIndex);
+
+			CreateGpuCullingBuffer(gpuCuller.earlyVisibilityBuffers[i], gpuCuller.earlyVisibilityCapacities[i], GPU_CULLING_INITIAL_INSTANCE_CAPACITY, sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "GPU Culling Early Visibility Buffer " + frameIndex);
+		}
+	}
+
+	void RHI::InitHiZPyramid() noexcept
+	{
+		if (gpuCuller.isSupported == false)
+			return;
+
+		// Pyramid, mip 0 is rounded up so the region of every mip is inside the image
+
+		uint32_t lastMipSize = 1u << (HI_Z_MIP_COUNT - 1);
+
+		gpuCuller.hiZImageExtent.width = (swapchainExtent.width + lastMipSize - 1) / lastMipSize * lastMipSize;
+		gpuCuller.hiZImageExtent.height = (swapchainExtent.height + lastMipSize - 1) / lastMipSize * lastMipSize;
+
+		ImageCreateInfo hiZImageCI = {};
+		hiZImageCI.format = VK_FORMAT_R32_SFLOAT;
+		hiZImageCI.width = gpuCuller.hiZImageExtent.width;
+		hiZImageCI.height = gpuCuller.hiZImageExtent.height;
+		hiZImageCI.arrayLayers = 1;
+		hiZImageCI.mipmapCount = HI_Z_MIP_COUNT;
+		hiZImageCI.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		hiZImageCI.subresourceRangeLayerCount = 1;
+		hiZImageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		hiZImageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		hiZImageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_CULLING;
+		hiZImageCI.debugName = "Hi-Z Pyramid";
+
+		CreateImage(hiZImageCI, gpuCuller.hiZImage);
+
+		// Written and read by compute shaders only, it stays in the general layout
+		CommandTransitionImageLayout(gpuCuller.hiZImage.image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1, HI_Z_MIP_COUNT);
+
+		for (uint32_t i = 0; i < HI_Z_MIP_COUNT; i++)
+		{
+			VkImageViewCreateInfo mipImageViewCI = {};
+			mipImageViewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			mipImageViewCI.image = gpuCuller.hiZImage.image;
+			mipImageViewCI.format = VK_FORMAT_R32_SFLOAT;
+			mipImageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			mipImageViewCI.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			mipImageViewCI.subresourceRange.baseMipLevel = i;
+			mipImageViewCI.subresourceRange.levelCount = 1;
+			mipImageViewCI.subresourceRange.baseArrayLayer = 0;
+			mipImageViewCI.subresourceRange.layerCount = 1;
+
+			CHECK_VK(vkCreateImageView(device, &mipImageViewCI, nullptr, &gpuCuller.hiZMipImageViews[i]));
+		}
+
+		// The culling shader fetches texels, the sampler is only there for the combined descriptor
+		VkSamplerCreateInfo samplerCI = {};
+		samplerCI.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerCI.magFilter = VK_FILTER_NEAREST;
+		samplerCI.minFilter = VK_FILTER_NEAREST;
+		samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCI.anisotropyEnable = VK_FALSE;
+		samplerCI.maxAnisotropy = 1.f;
+		samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		samplerCI.unnormalizedCoordinates = VK_FALSE;
+		samplerCI.compareEnable = VK_FALSE;
+		samplerCI.compareOp = VK_COMPARE_OP_ALWAYS;
+		samplerCI.mipLodBias = 0.0f;
+		samplerCI.minLod = 0.0f;
+		samplerCI.maxLod = TO_FLOAT(HI_Z_MIP_COUNT);
+
+		CHECK_VK(vkCreateSampler(device, &samplerCI, nullptr, &gpuCuller.hiZSampler));
+
+		// Pipelines, the first mip reduces the depth samples and the others the mip below
+
+		VkPushConstantRange hiZPushConstantRange = {};
+		hiZPushConstantRange.offset = 0;
+		hiZPushConstantRange.size = sizeof(HiZPushConstant);
+		hiZPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		std::array<VkDescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings = {};
+
+		for (size_t i = 0; i < descriptorSetLayoutBindings.size(); i++)
+		{
+			descriptorSetLayoutBindings[i].binding = TO_UINT32_T(i);
+			descriptorSetLayoutBindings[i].descriptorCount = 1;
+			descriptorSetLayoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			descriptorSetLayoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		ComputePipelineCreateInfo computePipelineCI = {};
+		computePipelineCI.binaryComputeFilePath = "data/shaders/culling/hiZDownsample.comp.spv";
+		computePipelineCI.descriptorSetLayoutBindings.assign(descriptorSetLayoutBindings.cbegin(), descriptorSetLayoutBindings.cend());
+		computePipelineCI.pushConstants = { hiZPushConstantRange };
+
+		CreateComputePipeline(computePipelineCI, gpuCuller.hiZDownsamplePipeline);
+
+		descriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		computePipelineCI.binaryComputeFilePath = "data/shaders/culling/hiZDepth.comp.spv";
+		computePipelineCI.descriptorSetLayoutBindings.assign(descriptorSetLayoutBindings.cbegin(), descriptorSetLayoutBindings.cend());
+
+		CreateComputePipeline(computePipelineCI, gpuCuller.hiZDepthPipeline);
+
+		// Descriptor sets, one per mip
+
+		std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes = {};
+		descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorPoolSizes[0].descriptorCount = 1;
+		descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorPoolSizes[1].descriptorCount = HI_Z_MIP_COUNT * 2 - 1;
+
+		VkDescriptorPoolCreateInfo descriptorPoolCI = {};
+		descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCI.poolSizeCount = TO_UINT32_T(descriptorPoolSizes.size());
+		descriptorPoolCI.pPoolSizes = descriptorPoolSizes.data();
+		descriptorPoolCI.maxSets = HI_Z_MIP_COUNT;
+
+		CHECK_VK(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &gpuCuller.hiZDescriptorPool));
+
+		std::array<VkDescriptorSetLayout, HI_Z_MIP_COUNT> descriptorSetLayouts;
+		descriptorSetLayouts.fill(gpuCuller.hiZDownsamplePipeline.descriptorSetLayout);
+		descriptorSetLayouts[0] = gpuCuller.hiZDepthPipeline.descriptorSetLayout;
+
+		VkDescriptorSetAllocateInfo descriptorSetAI = {};
+		descriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAI.descriptorPool = gpuCuller.hiZDescriptorPool;
+		descriptorSetAI.descriptorSetCount = HI_Z_MIP_COUNT;
+		descriptorSetAI.pSetLayouts = descriptorSetLayouts.data();
+
+		CHECK_VK(vkAllocateDescriptorSets(device, &descriptorSetAI, gpuCuller.hiZDescriptorSets.data()));
+
+		VkDescriptorImageInfo depthDescriptorImageInfo = {};
+		depthDescriptorImageInfo.sampler = gpuCuller.hiZSampler;
+		depthDescriptorImageInfo.imageView = forward.rtDepthAttachmentImageView;
+		depthDescriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		std::array<VkDescriptorImageInfo, HI_Z_MIP_COUNT> mipDescriptorImageInfos = {};
+
+		for (size_t i = 0; i < HI_Z_MIP_COUNT; i++)
+		{
+			mipDescriptorImageInfos[i].imageView = gpuCuller.hiZMipImageViews[i];
+			mipDescriptorImageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		}
+
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets(HI_Z_MIP_COUNT * 2);
+
+		for (size_t i = 0; i < HI_Z_MIP_COUNT; i++)
+		{
+			VkWriteDescriptorSet& sourceWriteDescriptorSet = writeDescriptorSets[i * 2];
+			sourceWriteDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			sourceWriteDescriptorSet.descriptorCount = 1;
+			sourceWriteDescriptorSet.descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			sourceWriteDescriptorSet.dstBinding = 0;
+			sourceWriteDescriptorSet.dstArrayElement = 0;
+			sourceWriteDescriptorSet.pImageInfo = i == 0 ? &depthDescriptorImageInfo : &mipDescriptorImageInfos[i - 1];
+			sourceWriteDescriptorSet.dstSet = gpuCuller.hiZDescriptorSets[i];
+
+			VkWriteDescriptorSet& mipWriteDescriptorSet = writeDescriptorSets[i * 2 + 1];
+			mipWriteDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			mipWriteDescriptorSet.descriptorCount = 1;
+			mipWriteDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			mipWriteDescriptorSet.dstBinding = 1;
+			mipWriteDescriptorSet.dstArrayElement = 0;
+			mipWriteDescriptorSet.pImageInfo = &mipDescriptorImageInfos[i];
+			mipWriteDescriptorSet.dstSet = gpuCuller.hiZDescriptorSets[i];
+		}
+
+		// The culling sets read the whole pyramid, it is never replaced
+		VkDescriptorImageInfo hiZDescriptorImageInfo = {};
+		hiZDescriptorImageInfo.sampler = gpuCuller.hiZSampler;
+		hiZDescriptorImageInfo.imageView = gpuCuller.hiZImage.imageView;
+		hiZDescriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			VkWriteDescriptorSet hiZWriteDescriptorSet = {};
+			hiZWriteDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			hiZWriteDescriptorSet.descriptorCount = 1;
+			hiZWriteDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			hiZWriteDescriptorSet.dstBinding = 6;
+			hiZWriteDescriptorSet.dstArrayElement = 0;
+			hiZWriteDescriptorSet.pImageInfo = &hiZDescriptorImageInfo;
+			hiZWriteDescriptorSet.dstSet = gpuCuller.descriptorSets[i];
+
+			writeDescriptorSets.push_back(hiZWriteDescriptorSet);
+		}
+
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	void RHI::CreateGpuCullingBuffer(Buffer& buffer, uint32_t& capacity, uint32_t newCapacity, VkDeviceSize elementSize, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryProperty, const std::string& debugName) noexcept
+	{
+		BufferCreateInfo bufferCI = {};
+		bufferCI.usageFlags = usageFlags;
+		bufferCI.size = elementSize * TO_SIZE_T(newCapacity);
+		bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		bufferCI.memoryProperty = memoryProperty;
+		bufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_CULLING;
+		bufferCI.debugName = debugName;
+
+		CreateBuffer(bufferCI, buffer);
+
+		capacity = newCapacity;
+	}
+
+	void RHI::ReserveGpuCullingBuffer(Buffer& buffer, uint32_t& capacity, uint32_t count, VkDeviceSize elementSize, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryProperty, const std::string& debugName) noexcept
+	{
+		if (count <= capacity)
+			return;
+
+		// The frame fence was waited on and nothing was recorded with this buffer yet, it can be replaced
+		DestroyBuffer(buffer);
+		CreateGpuCullingBuffer(buffer, capacity, std::max(count, capacity * 2), elementSize, usageFlags, memoryProperty, debugName);
+	}
+
+	bool RHI::GetIsGpuCullingSupported() const noexcept
+	{
+		return gpuCuller.isSupported;
+	}
+
+	bool RHI::GetIsGpuCullingEnabled() const noexcept
+	{
+		return gpuCuller.isEnabled;
+	}
+
+	void RHI::SetIsGpuCullingEnabled(bool isEnabled) noexcept
+	{
+		gpuCuller.isEnabled = isEnabled;
+	}
+
+	bool RHI::GetIsOcclusionCullingEnabled() const noexcept
+	{
+		return gpuCuller.isOcclusionCullingEnabled;
+	}
+
+	void RHI::SetIsOcclusionCullingEnabled(bool isEnabled) noexcept
+	{
+		gpuCuller.isOcclusionCullingEnabled = isEnabled;
+	}
+
+	void RHI::BeginGpuCullingFrame() noexcept
+	{
+		gpuCuller.isActive = gpuCuller.isSupported && gpuCuller.isEnabled;
+		gpuCuller.isOcclusionActive = gpuCuller.isActive && gpuCuller.isOcclusionCullingEnabled;
+
+		// The pyramid is only built by the frames that split the forward pass
+		if (gpuCuller.isOcclusionActive == false)
+			gpuCuller.isHiZValid = false;
+
+		gpuCuller.instances.clear();
+		gpuCuller.views.clear();
+		gpuCuller.culledInstanceCount = 0;
+	}
+
+	uint32_t RHI::AddGpuCullingView(const RenderQueue& renderQueue, const glm::mat4& viewProj) noexcept
+	{
+		if (gpuCuller.isActive == false)
+			return renderQueue.firstDrawCommand;
+
+		GpuCullingView view;
+		view.planes = Frustum(viewProj).planes;
+		view.viewProj = viewProj;
+		view.previousViewProj = viewProj;
+
+		uint32_t viewIndex = TO_UINT32_T(gpuCuller.views.size());
+		gpuCuller.views.push_back(view);
+
+		// The copies keep the batch order, the draw loops can index them like the queue's own records
+		std::vector<VkDrawIndexedIndirectCommand>& commands = drawCommandBuffer.commands;
+		uint32_t firstDrawCommand = TO_UINT32_T(commands.size());
+
+		for (const RenderBatch& batch : renderQueue.batches)
+		{
+			const resource::Mesh& mesh = batch.meshNode->GetMesh();
+			uint32_t drawCommand = TO_UINT32_T(commands.size());
+
+			commands.push_back({ mesh.indexCount, 0, mesh.firstIndex, mesh.vertexOffset, gpuCuller.culledInstanceCount });
+
+			glm::vec4 aabbMin(mesh.aabb.min, 0.f);
+			glm::vec4 aabbMax(mesh.aabb.max, 0.f);
+
+			for (uint32_t i = 0; i < batch.instanceCount; i++)
+				gpuCuller.instances.push_back({ aabbMin, aabbMax, batch.firstInstance + i, drawCommand, viewIndex, GPU_CULLING_INVALID_DRAW_COMMAND });
+
+			gpuCuller.culledInstanceCount += batch.instanceCount;
+		}
+
+		return firstDrawCommand;
+	}
+
+	uint32_t RHI::AddGpuOcclusionCullingView(const RenderQueue& renderQueue, const glm::mat4& viewProj, uint32_t& lateFirstDrawCommand) noexcept
+	{
+		if (gpuCuller.isOcclusionActive == false)
+		{
+			lateFirstDrawCommand = AddGpuCullingView(renderQueue, viewProj);
+			return lateFirstDrawCommand;
+		}
+
+		GpuCullingView view;
+		view.planes = Frustum(viewProj).planes;
+		view.viewProj = viewProj;
+		view.previousViewProj = gpuCuller.hiZViewProj;
+
+		uint32_t viewIndex = TO_UINT32_T(gpuCuller.views.size());
+		gpuCuller.views.push_back(view);
+
+		// Every batch gets an early record, the opaque ones get a late record as well after them.
+		// The transparent batches are only drawn after the late phase, it fills their early record
+		std::vector<VkDrawIndexedIndirectCommand>& commands = drawCommandBuffer.commands;
+		uint32_t firstDrawCommand = TO_UINT32_T(commands.size());
+		size_t batchCount = renderQueue.batches.size();
+
+		lateFirstDrawCommand = firstDrawCommand + TO_UINT32_T(batchCount);
+
+		for (size_t i = 0; i < batchCount; i++)
+		{
+			const RenderBatch& batch = renderQueue.batches[i];
+			const resource::Mesh& mesh = batch.meshNode->GetMesh();
+
+			bool isOpaque = i < renderQueue.opaqueBatchCount;
+			uint32_t drawCommand = firstDrawCommand + TO_UINT32_T(i);
+			uint32_t earlyDrawCommand = isOpaque ? drawCommand : GPU_CULLING_INVALID_DRAW_COMMAND;
+			uint32_t lateDrawCommand = isOpaque ? lateFirstDrawCommand + TO_UINT32_T(i) : drawCommand;
+
+			commands.push_back({ mesh.indexCount, 0, mesh.firstIndex, mesh.vertexOffset, gpuCuller.culledInstanceCount });
+
+			glm::vec4 aabbMin(mesh.aabb.min, 0.f);
+			glm::vec4 aabbMax(mesh.aabb.max, 0.f);
+
+			for (uint32_t j = 0; j < batch.instanceCount; j++)
+				gpuCuller.instances.push_back({ aabbMin, aabbMax, batch.firstInstance + j, earlyDrawCommand, viewIndex, lateDrawCommand });
+
+			gpuCuller.culledInstanceCount += batch.instanceCount;
+		}
+
+		for (size_t i = 0; i < renderQueue.opaqueBatchCount; i++)
+		{
+			const RenderBatch& batch = renderQueue.batches[i];
+			const resource::Mesh& mesh = batch.meshNode->GetMesh();
+
+			commands.push_back({ mesh.indexCount, 0, mesh.firstIndex, mesh.vertexOffset, gpuCuller.culledInstanceCount });
+
+			gpuCuller.culledInstanceCount += batch.instanceCount;
+		}
+
+		return firstDrawCommand;
+	}
+
+	void RHI::UploadGpuCulling() noexcept
+	{
+		if (gpuCuller.isActive == false || gpuCuller.instances.empty())
+			return;
+
+		std::string frameIndex = std::to_string(currentFrame);
+
+		ReserveGpuCullingBuffer(gpuCuller.instanceBuffers[currentFrame], gpuCuller.instanceCapacities[currentFrame], TO_UINT32_T(gpuCuller.instances.size()), sizeof(GpuCullingInstance),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "GPU Culling Instance Buffer " + frameIndex);
+
+		ReserveGpuCullingBuffer(gpuCuller.viewBuffers[currentFrame], gpuCuller.viewCapacities[currentFrame], TO_UINT32_T(gpuCuller.views.size()), sizeof(GpuCullingView),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "GPU Culling View Buffer " + frameIndex);
+
+		ReserveGpuCullingBuffer(gpuCuller.culledInstanceBuffers[currentFrame], gpuCuller.culledInstanceCapacities[currentFrame], gpuCuller.culledInstanceCount, sizeof(glm::mat4),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Culled Instance Buffer " + frameIndex);
+
+		ReserveGpuCullingBuffer(gpuCuller.earlyVisibilityBuffers[currentFrame], gpuCuller.earlyVisibilityCapacities[currentFrame], TO_UINT32_T(gpuCuller.instances.size()), sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "GPU Culling Early Visibility Buffer " + frameIndex);
+
+		memcpy(gpuCuller.instanceBuffers[currentFrame].allocation.mappedData, gpuCuller.instances.data(), sizeof(GpuCullingInstance) * gpuCuller.instances.size());
+		memcpy(gpuCuller.viewBuffers[currentFrame].allocation.mappedData, gpuCuller.views.data(), sizeof(GpuCullingView) * gpuCuller.views.size());
+
+		// The instance and draw command buffers may have been replaced by their own upload as well
+		std::array<VkBuffer, 6> buffers =
+		{
+			gpuCuller.instanceBuffers[currentFrame].buffer,
+			gpuCuller.viewBuffers[currentFrame].buffer,
+			instanceBuffer.buffers[currentFrame].buffer,
+			drawCommandBuffer.buffers[currentFrame].buffer,
+			gpuCuller.culledInstanceBuffers[currentFrame].buffer,
+			gpuCuller.earlyVisibilityBuffers[currentFrame].buffer,
+		};
+
+		std::array<VkDescriptorBufferInfo, 6> descriptorBufferInfos = {};
+		std::array<VkWriteDescriptorSet, 6> writeDescriptorSets = {};
+
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			descriptorBufferInfos[i].buffer = buffers[i];
+			descriptorBufferInfos[i].offset = 0;
+			descriptorBufferInfos[i].range = VK_WHOLE_SIZE;
+
+			writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[i].descriptorCount = 1;
+			writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescriptorSets[i].dstBinding = TO_UINT32_T(i);
+			writeDescriptorSets[i].dstArrayElement = 0;
+			writeDescriptorSets[i].pBufferInfo = &descriptorBufferInfos[i];
+			writeDescriptorSets[i].dstSet = gpuCuller.descriptorSets[currentFrame];
+		}
+
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	void RHI::CommandDispatchGpuCulling(VkCommandBuffer commandBuffer, GpuCullingPhase phase) noexcept
+	{
+		if (gpuCuller.isActive == false || gpuCuller.instances.empty())
+			return;
+
+		bool isLatePhase = phase == GpuCullingPhase::GPU_CULLING_PHASE_LATE;
+
+		uint32_t cullingScope = AddGpuTimestampScope(isLatePhase ? "GPU Culling Late" : "GPU Culling");
+		CommandBeginGpuTimestamp(commandBuffer, cullingScope);
+
+		// The late phase reads the pyramid of this frame, the early one the pyramid of the previous frame
+		GpuCullingPushConstant pushConstant = {};
+		pushConstant.instanceCount = TO_UINT32_T(gpuCuller.instances.size());
+		pushConstant.phase = phase;
+		pushConstant.isHiZValid = (isLatePhase || gpuCuller.isHiZValid) ? 1 : 0;
+		pushConstant.hiZExtent = { gpuCuller.hiZRenderExtent.width, gpuCuller.hiZRenderExtent.height };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, gpuCuller.pipeline.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, gpuCuller.pipeline.pipelineLayout, 0, 1, &gpuCuller.descriptorSets[currentFrame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, gpuCuller.pipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullingPushConstant), &pushConstant);
+
+		vkCmdDispatch(commandBuffer, (pushConstant.instanceCount + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+
+		// The draws read the visible instance counts and the compacted model matrices, the late phase the early visibility
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+		VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
+		if (gpuCuller.isOcclusionActive && isLatePhase == false)
+		{
+			memoryBarrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			dstStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		CommandEndGpuTimestamp(commandBuffer, cullingScope);
+	}
+
+	void RHI::CommandBuildHiZPyramid(VkCommandBuffer commandBuffer) noexcept
+	{
+		uint32_t hiZScope = AddGpuTimestampScope("Hi-Z Build");
+		CommandBeginGpuTimestamp(commandBuffer, hiZScope);
+
+		// The early depth is complete and the early culling is done reading the previous pyramid
+		VkMemoryBarrier depthMemoryBarrier = {};
+		depthMemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		depthMemoryBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &depthMemoryBarrier, 0, nullptr, 0, nullptr);
+
+		// Each mip reads the one written just before
+		VkMemoryBarrier mipMemoryBarrier = {};
+		mipMemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		mipMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		mipMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		const VkExtent2D& renderExtent = dynamicResolution.renderExtent;
+
+		HiZPushConstant pushConstant = {};
+		pushConstant.sourceExtent = { renderExtent.width, renderExtent.height };
+		pushConstant.extent = pushConstant.sourceExtent;
+		pushConstant.sampleCount = TO_INT32_T(msaaSamples);
+
+		for (uint32_t i = 0; i < HI_Z_MIP_COUNT; i++)
+		{
+			const ComputePipeline& pipeline = i == 0 ? gpuCuller.hiZDepthPipeline : gpuCuller.hiZDownsamplePipeline;
+
+			if (i > 0)
+			{
+				pushConstant.sourceExtent = pushConstant.extent;
+				pushConstant.extent = { (pushConstant.extent.x + 1) / 2, (pushConstant.extent.y + 1) / 2 };
+
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &mipMemoryBarrier, 0, nullptr, 0, nullptr);
+			}
+
+			if (i <= 1)
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipelineLayout, 0, 1, &gpuCuller.hiZDescriptorSets[i], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstant), &pushConstant);
+
+			vkCmdDispatch(commandBuffer, (pushConstant.extent.x + HI_Z_GROUP_SIZE - 1) / HI_Z_GROUP_SIZE, (pushConstant.extent.y + HI_Z_GROUP_SIZE - 1) / HI_Z_GROUP_SIZE, 1);
+		}
+
+		// Read by the late culling of this frame and the early culling of the next one
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &mipMemoryBarrier, 0, nullptr, 0, nullptr);
+
+		CommandEndGpuTimestamp(commandBuffer, hiZScope);
+
+		gpuCuller.isHiZValid = true;
+		gpuCuller.hiZViewProj = forward.rtViewProjUniform.projection * forward.rtViewProjUniform.view;
+		gpuCuller.hiZRenderExtent = renderExtent;
+	}
+
+	void RHI::DestroyGpuCulling() noexcept
+	{
+		if (gpuCuller.isSupported == false)
+			return;
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			DestroyBuffer(gpuCuller.instanceBuffers[i]);
+			DestroyBuffer(gpuCuller.viewBuffers[i]);
+			DestroyBuffer(gpuCuller.culledInstanceBuffers[i]);
+			DestroyBuffer(gpuCuller.earlyVisibilityBuffers[i]);
+		}
+
+		vkDestroyDescriptorPool(device, gpuCuller.descriptorPool, nullptr);
+
+		DestroyComputePipeline(gpuCuller.pipeline);
+
+		for (VkImageView mipImageView : gpuCuller.hiZMipImageViews)
+			vkDestroyImageView(device, mipImageView, nullptr);
+
+		vkDestroySampler(device, gpuCuller.hiZSampler, nullptr);
+		vkDestroyDescriptorPool(device, gpuCuller.hiZDescriptorPool, nullptr);
+
+		DestroyComputePipeline(gpuCuller.hiZDepthPipeline);
+		DestroyComputePipeline(gpuCuller.hiZDownsamplePipeline);
+
+		DestroyImage(gpuCuller.hiZImage);
+
+		gpuCuller.instances.clear();
+		gpuCuller.views.clear();
+	}
+
+} // namespace lux::rhi
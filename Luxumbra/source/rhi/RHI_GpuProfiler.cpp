@@ -0,0 +1,256 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Logger.h"
+#include "utility/Utility.h"
+
+namespace lux::rhi
+{
+
+	GpuProfiler::GpuProfiler() noexcept
+		: isSupported(false), timestampPeriod(0.f), timestampMask(0), queryPools(), frameScopePassIndices(), queryResults(0),
+		passes(0), passIndices()
+	{
+
+	}
+
+	void RHI::InitGpuProfiler() noexcept
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		uint32_t queueFamilyCount;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+		std::vector<VkQueueFamilyProperties> queueFamiliesProperties(TO_SIZE_T(queueFamilyCount));
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamiliesProperties.data());
+
+		// Frames are submitted on the present queue
+		uint32_t timestampValidBits = queueFamiliesProperties[TO_SIZE_T(presentQueueIndex)].timestampValidBits;
+
+		if (timestampValidBits == 0)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_WARNING, "Timestamp queries are not supported, GPU profiler disabled");
+			return;
+		}
+
+		gpuProfiler.isSupported = true;
+		gpuProfiler.timestampPeriod = properties.limits.timestampPeriod;
+		gpuProfiler.timestampMask = timestampValidBits >= 64 ? UINT64_MAX : (uint64_t(1) << timestampValidBits) - 1;
+
+		VkQueryPoolCreateInfo queryPoolCI = {};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = GPU_PROFILER_MAX_SCOPE_COUNT * 2;
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			CHECK_VK(vkCreateQueryPool(device, &queryPoolCI, nullptr, &gpuProfiler.queryPools[i]));
+
+		gpuProfiler.queryResults.resize(GPU_PROFILER_MAX_SCOPE_COUNT * 2);
+	}
+
+	bool RHI::GetIsGpuProfilerSupported() const noexcept
+	{
+		return gpuProfiler.isSupported;
+	}
+
+	void RHI::BeginGpuProfilerFrame() noexcept
+	{
+		if (gpuProfiler.isSupported == false)
+			return;
+
+		std::vector<size_t>& scopePassIndices = gpuProfiler.frameScopePassIndices[currentFrame];
+		size_t scopeCount = scopePassIndices.size();
+
+		if (scopeCount > 0)
+		{
+			uint32_t queryCount = TO_UINT32_T(scopeCount * 2);
+
+			// The frame fence was waited on, the results are final and reading them does not stall
+			VkResult result = vkGetQueryPoolResults(device, gpuProfiler.queryPools[currentFrame], 0, queryCount, TO_SIZE_T(queryCount) * sizeof(uint64_t),
+				gpuProfiler.queryResults.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+			if (result == VK_SUCCESS)
+			{
+				for (size_t i = 0; i < scopeCount; i++)
+				{
+					uint64_t ticks = (gpuProfiler.queryResults[i * 2 + 1] - gpuProfiler.queryResults[i * 2]) & gpuProfiler.timestampMask;
+					float time = TO_FLOAT(static_cast<double>(ticks) * gpuProfiler.timestampPeriod / 1000000.0);
+
+					GpuPassTimings& pass = gpuProfiler.passes[scopePassIndices[i]];
+
+					// A pass that disappeared for a while starts a new history
+					if (frameCount - pass.lastFrame > 1)
+						pass.sampleCount = 0;
+
+					pass.samples[pass.sampleCount % GPU_PROFILER_HISTORY_SIZE] = time;
+					pass.sampleCount++;
+					pass.lastFrame = frameCount;
+				}
+			}
+		}
+
+		scopePassIndices.clear();
+	}
+
+	void RHI::CommandResetGpuProfiler(VkCommandBuffer commandBuffer) noexcept
+	{
+		if (gpuProfiler.isSupported == false)
+			return;
+
+		vkCmdResetQueryPool(commandBuffer, gpuProfiler.queryPools[currentFrame], 0, GPU_PROFILER_MAX_SCOPE_COUNT * 2);
+	}
+
+	uint32_t RHI::AddGpuTimestampScope(const std::string& passName) noexcept
+	{
+		if (gpuProfiler.isSupported == false)
+			return GPU_PROFILER_INVALID_SCOPE;
+
+		std::vector<size_t>& scopePassIndices = gpuProfiler.frameScopePassIndices[currentFrame];
+
+		if (scopePassIndices.size() == GPU_PROFILER_MAX_SCOPE_COUNT)
+			return GPU_PROFILER_INVALID_SCOPE;
+
+		size_t passIndex;
+		std::map<std::string, size_t>::const_iterator it = gpuProfiler.passIndices.find(passName);
+
+		if (it == gpuProfiler.passIndices.cend())
+		{
+			passIndex = gpuProfiler.passes.size();
+			gpuProfiler.passes.push_back({ passName, {}, 0, 0 });
+			gpuProfiler.passIndices[passName] = passIndex;
+		}
+		else
+			passIndex = it->second;
+
+		scopePassIndices.push_back(passIndex);
+
+		return TO_UINT32_T(scopePassIndices.size() - 1);
+	}
+
+	void RHI::CommandBeginGpuTimestamp(VkCommandBuffer commandBuffer, uint32_t scopeIndex) const noexcept
+	{
+		if (scopeIndex == GPU_PROFILER_INVALID_SCOPE)
+			return;
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuProfiler.queryPools[currentFrame], scopeIndex * 2);
+	}
+
+	void RHI::CommandEndGpuTimestamp(VkCommandBuffer commandBuffer, uint32_t scopeIndex) const noexcept
+	{
+		if (scopeIndex == GPU_PROFILER_INVALID_SCOPE)
+			return;
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpuProfiler.queryPools[currentFrame], scopeIndex * 2 + 1);
+	}
+
+	void RHI::GetGpuPassStatistics(std::vector<GpuPassStatistics>& statistics) const noexcept
+	{
+		statistics.clear();
+
+		std::vector<float> sortedSamples;
+		sortedSamples.reserve(GPU_PROFILER_HISTORY_SIZE);
+
+		for (const GpuPassTimings& pass : gpuProfiler.passes)
+		{
+			// Skip passes that are not rendered anymore
+			if (pass.sampleCount == 0 || frameCount - pass.lastFrame > MAX_FRAMES_IN_FLIGHT + 1)
+				continue;
+
+			size_t sampleCount = std::min(pass.sampleCount, TO_SIZE_T(GPU_PROFILER_HISTORY_SIZE));
+
+			sortedSamples.assign(pass.samples.cbegin(), pass.samples.cbegin() + sampleCount);
+			std::sort(sortedSamples.begin(), sortedSamples.end());
+
+			float sum = 0.f;
+			for (float sample : sortedSamples)
+				sum += sample;
+
+			GpuPassStatistics passStatistics;
+			passStatistics.name = pass.name;
+			passStatistics.last = pass.samples[(pass.sampleCount - 1) % GPU_PROFILER_HISTORY_SIZE];
+			passStatistics.average = sum / TO_FLOAT(sampleCount);
+			passStatistics.p50 = utility::Percentile(sortedSamples, 0.50f);
+			passStatistics.p95 = utility::Percentile(sortedSamples, 0.95f);
+			passStatistics.p99 = utility::Percentile(sortedSamples, 0.99f);
+			passStatistics.max = sortedSamples.back();
+			passStatistics.sampleCount = sampleCount;
+
+			statistics.push_back(passStatistics);
+		}
+	}
+
+	void RHI::GetLastGpuPassTimes(std::vector<GpuPassTime>& times) const noexcept
+	{
+		times.clear();
+
+		// Durations read back by the last Render call, they belong to the frame submitted MAX_FRAMES_IN_FLIGHT frames before it
+		for (const GpuPassTimings& pass : gpuProfiler.passes)
+		{
+			if (pass.sampleCount == 0 || pass.lastFrame + 1 != frameCount)
+				continue;
+
+			times.push_back({ pass.name, pass.samples[(pass.sampleCount - 1) % GPU_PROFILER_HISTORY_SIZE] });
+		}
+	}
+
+	bool RHI::GetGpuPassLastTime(const std::string& passName, float& time) const noexcept
+	{
+		std::map<std::string, size_t>::const_iterator it = gpuProfiler.passIndices.find(passName);
+
+		if (it == gpuProfiler.passIndices.cend())
+			return false;
+
+		const GpuPassTimings& pass = gpuProfiler.passes[it->second];
+
+		// Only a sample read back during this frame is new
+		if (pass.sampleCount == 0 || pass.lastFrame != frameCount)
+			return false;
+
+		time = pass.samples[(pass.sampleCount - 1) % GPU_PROFILER_HISTORY_SIZE];
+
+		return true;
+	}
+
+	bool RHI::ExportGpuProfile(const std::string& filePath) const noexcept
+	{
+		std::ofstream file(filePath, std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to open GPU profile file ", filePath);
+			return false;
+		}
+
+		std::vector<GpuPassStatistics> statistics;
+		GetGpuPassStatistics(statistics);
+
+		file << "pass,last_ms,average_ms,p50_ms,p95_ms,p99_ms,max_ms,samples\n";
+
+		for (const GpuPassStatistics& passStatistics : statistics)
+		{
+			file << passStatistics.name << ',' << passStatistics.last << ',' << passStatistics.average << ','
+				<< passStatistics.p50 << ',' << passStatistics.p95 << ',' << passStatistics.p99 << ','
+				<< passStatistics.max << ',' << passStatistics.sampleCount << '\n';
+		}
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "GPU profile exported to ", filePath);
+
+		return true;
+	}
+
+	void RHI::DestroyGpuProfiler() noexcept
+	{
+		if (gpuProfiler.isSupported == false)
+			return;
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			vkDestroyQueryPool(device, gpuProfiler.queryPools[i], nullptr);
+
+		gpuProfiler.passes.clear();
+		gpuProfiler.passIndices.clear();
+	}
+
+} // namespace lux::rhi
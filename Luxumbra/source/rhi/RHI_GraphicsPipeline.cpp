@@ -1,12 +1,14 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
 
 #include <array>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 
-#include "utility\Utility.h"
+#include "utility/Utility.h"
 #include "Logger.h"
 #include "Vertex.h"
-#include "rhi\LuxVkImpl.h"
+#include "rhi/LuxVkImpl.h"
 
 namespace lux::rhi
 {
@@ -29,7 +31,7 @@ namespace lux::rhi
 		VkPipelineVertexInputStateCreateInfo vertexInputStateCI = {};
 		vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-		VkVertexInputBindingDescription bindingDescription = Vertex::GetBindingDescription();
+		std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { Vertex::GetBindingDescription(), Vertex::GetInstanceBindingDescription() };
 		std::vector< VkVertexInputAttributeDescription> attributesDescription;
 
 		switch (luxGraphicsPipelineCI.vertexLayout)
@@ -46,7 +48,7 @@ namespace lux::rhi
 			attributesDescription.push_back(Vertex::GetPositionOnlyAttributeDescription());
 
 			vertexInputStateCI.vertexBindingDescriptionCount = 1;
-			vertexInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputStateCI.vertexAttributeDescriptionCount = 1;
 			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
 			break;
@@ -62,7 +64,7 @@ namespace lux::rhi
 			}
 
 			vertexInputStateCI.vertexBindingDescriptionCount = 1;
-			vertexInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputStateCI.vertexAttributeDescriptionCount = TO_UINT32_T(attributesDescription.size());
 			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
 			break;
@@ -77,7 +79,7 @@ namespace lux::rhi
 			}
 
 			vertexInputStateCI.vertexBindingDescriptionCount = 1;
-			vertexInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputStateCI.vertexAttributeDescriptionCount = TO_UINT32_T(attributesDescription.size());
 			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
 			break;
@@ -87,6 +89,16 @@ namespace lux::rhi
 			break;
 		}
 
+		if (luxGraphicsPipelineCI.enableInstancing && luxGraphicsPipelineCI.vertexLayout != VertexLayout::NO_VERTEX_LAYOUT)
+		{
+			std::array<VkVertexInputAttributeDescription, 4> instanceAttributesDescription = Vertex::GetInstanceAttributeDescriptions(TO_UINT32_T(attributesDescription.size()));
+			attributesDescription.insert(attributesDescription.end(), instanceAttributesDescription.cbegin(), instanceAttributesDescription.cend());
+
+			vertexInputStateCI.vertexBindingDescriptionCount = TO_UINT32_T(bindingDescriptions.size());
+			vertexInputStateCI.vertexAttributeDescriptionCount = TO_UINT32_T(attributesDescription.size());
+			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
+		}
+
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI = {};
 		inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -259,7 +271,7 @@ namespace lux::rhi
 		VkPipelineVertexInputStateCreateInfo vertexInputStateCI = {};
 		vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-		VkVertexInputBindingDescription bindingDescription = Vertex::GetBindingDescription();
+		std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { Vertex::GetBindingDescription(), Vertex::GetInstanceBindingDescription() };
 		std::vector< VkVertexInputAttributeDescription> attributesDescription;
 
 		switch (luxGraphicsPipelineCI.vertexLayout)
@@ -276,7 +288,7 @@ namespace lux::rhi
 			attributesDescription.push_back(Vertex::GetPositionOnlyAttributeDescription());
 
 			vertexInputStateCI.vertexBindingDescriptionCount = 1;
-			vertexInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputStateCI.vertexAttributeDescriptionCount = 1;
 			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
 			break;
@@ -291,7 +303,7 @@ namespace lux::rhi
 			}
 
 			vertexInputStateCI.vertexBindingDescriptionCount = 1;
-			vertexInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputStateCI.vertexAttributeDescriptionCount = TO_UINT32_T(attributesDescription.size());
 			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
 			break;
@@ -306,7 +318,7 @@ namespace lux::rhi
 			}
 
 			vertexInputStateCI.vertexBindingDescriptionCount = 1;
-			vertexInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputStateCI.vertexAttributeDescriptionCount = TO_UINT32_T(attributesDescription.size());
 			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
 			break;
@@ -316,6 +328,16 @@ namespace lux::rhi
 			break;
 		}
 
+		if (luxGraphicsPipelineCI.enableInstancing && luxGraphicsPipelineCI.vertexLayout != VertexLayout::NO_VERTEX_LAYOUT)
+		{
+			std::array<VkVertexInputAttributeDescription, 4> instanceAttributesDescription = Vertex::GetInstanceAttributeDescriptions(TO_UINT32_T(attributesDescription.size()));
+			attributesDescription.insert(attributesDescription.end(), instanceAttributesDescription.cbegin(), instanceAttributesDescription.cend());
+
+			vertexInputStateCI.vertexBindingDescriptionCount = TO_UINT32_T(bindingDescriptions.size());
+			vertexInputStateCI.vertexAttributeDescriptionCount = TO_UINT32_T(attributesDescription.size());
+			vertexInputStateCI.pVertexAttributeDescriptions = attributesDescription.data();
+		}
+
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI = {};
 		inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -578,6 +600,13 @@ namespace lux::rhi
 	{
 		std::vector<char> shaderCode = utility::ReadFile(binaryFilePath);
 
+		// Binaries are compiled from the GLSL sources by the project build
+		if (shaderCode.empty())
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to read the shader binary ", binaryFilePath);
+			std::abort();
+		}
+
 		VkShaderModuleCreateInfo shaderModuleCI = {};
 		shaderModuleCI.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		shaderModuleCI.codeSize = shaderCode.size();
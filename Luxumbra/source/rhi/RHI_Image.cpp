@@ -1,6 +1,8 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
 
 #include <array>
+#include <cstdlib>
+#include <cstring>
 
 namespace lux::rhi
 {
@@ -10,7 +12,7 @@ namespace lux::rhi
 	std::vector<VkImageView> tmp_imageViews;
 
 	Image::Image() noexcept
-		: image(VK_NULL_HANDLE), imageView(VK_NULL_HANDLE), memory(VK_NULL_HANDLE)
+		: image(VK_NULL_HANDLE), imageView(VK_NULL_HANDLE), allocation()
 	{
 
 	}
@@ -54,16 +56,14 @@ namespace lux::rhi
 	
 		VkMemoryRequirements memoryRequirements;
 		vkGetImageMemoryRequirements(device, image.image, &memoryRequirements);
-		uint32_t memoryType = FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		ASSERT(memoryType != UINT32_MAX);
 
-		VkMemoryAllocateInfo memoryAllocateInfo = {};
-		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memoryAllocateInfo.memoryTypeIndex = memoryType;
-		memoryAllocateInfo.allocationSize = memoryRequirements.size;
+		if (AllocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, luxImageCI.memoryCategory, luxImageCI.debugName, image.allocation) == false)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate the memory of image ", luxImageCI.debugName);
+			std::abort();
+		}
 
-		CHECK_VK(vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &image.memory));
-		CHECK_VK(vkBindImageMemory(device, image.image, image.memory, 0));
+		CHECK_VK(vkBindImageMemory(device, image.image, image.allocation.memory, image.allocation.offset));
 	
 		if (luxImageCI.imageData != nullptr)
 			FillImage(luxImageCI, image);
@@ -109,20 +109,20 @@ namespace lux::rhi
 
 	void RHI::FillImage(const ImageCreateInfo& luxImageCI, Image& image) noexcept
 	{
-		BufferCreateInfo stagingBufferCI = {};
-		stagingBufferCI.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		stagingBufferCI.size = luxImageCI.imageSize;
-		stagingBufferCI.data = luxImageCI.imageData;
-		stagingBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		stagingBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		BeginUploadBatch();
+
+		VkBuffer stagingBuffer;
+		VkDeviceSize stagingOffset;
+		void* stagingData = AllocateUploadStaging(luxImageCI.imageSize, stagingBuffer, stagingOffset);
 
-		Buffer stagingBuffer;
-		CreateBuffer(stagingBufferCI, stagingBuffer);
+		memcpy(stagingData, luxImageCI.imageData, TO_SIZE_T(luxImageCI.imageSize));
 
-		CommandTransitionImageLayout(image.image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		VkCommandBuffer commandBuffer = RecordUploadCommands();
+
+		CommandTransitionImageLayout(commandBuffer, image.image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
 		VkBufferImageCopy bufferImageCopy = {};
-		bufferImageCopy.bufferOffset = 0;
+		bufferImageCopy.bufferOffset = stagingOffset;
 		bufferImageCopy.bufferImageHeight = 0;
 		bufferImageCopy.bufferRowLength = 0;
 		bufferImageCopy.imageSubresource.aspectMask = luxImageCI.subresourceRangeAspectMask;
@@ -134,33 +134,18 @@ namespace lux::rhi
 		bufferImageCopy.imageExtent.height = luxImageCI.height;
 		bufferImageCopy.imageExtent.depth = 1;
 
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommandBuffer();
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
 
-		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
-
-		EndSingleTimeCommandBuffer(commandBuffer);
-
-		CommandTransitionImageLayout(image.image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	
-		DestroyBuffer(stagingBuffer);
+		CommandTransitionImageLayout(commandBuffer, image.image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		if (luxImageCI.mipmapCount > 1)
 			GenerateMipChain(luxImageCI, image);
+
+		EndUploadBatch();
 	}
 	
 	void RHI::CreateImageFromBuffer(ImageCreateInfo& luxImageCI, void* data, uint32_t size, Image& image) noexcept
 	{
-		BufferCreateInfo stagingBufferCI = {};
-		stagingBufferCI.size = size;
-		stagingBufferCI.data = data;
-		stagingBufferCI.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		stagingBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		stagingBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	
-		Buffer stagingBuffer;
-		CreateBuffer(stagingBufferCI, stagingBuffer);
-
-
 		if ((luxImageCI.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == false)
 		{
 			luxImageCI.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
@@ -169,7 +154,15 @@ namespace lux::rhi
 		CreateImage(luxImageCI, image);
 
 
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommandBuffer();
+		BeginUploadBatch();
+
+		VkBuffer stagingBuffer;
+		VkDeviceSize stagingOffset;
+		void* stagingData = AllocateUploadStaging(size, stagingBuffer, stagingOffset);
+
+		memcpy(stagingData, data, TO_SIZE_T(size));
+
+		VkCommandBuffer commandBuffer = RecordUploadCommands();
 
 		CommandTransitionImageLayout(commandBuffer, image.image, luxImageCI.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
@@ -182,23 +175,22 @@ namespace lux::rhi
 		bufferCopyRegion.imageExtent.width = luxImageCI.width;
 		bufferCopyRegion.imageExtent.height = luxImageCI.height;
 		bufferCopyRegion.imageExtent.depth = 1;
-		bufferCopyRegion.bufferOffset = 0;
+		bufferCopyRegion.bufferOffset = stagingOffset;
 
-		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 
 		CommandTransitionImageLayout(commandBuffer, image.image, luxImageCI.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 
-		EndSingleTimeCommandBuffer(commandBuffer);
-
-
-		DestroyBuffer(stagingBuffer);
+		EndUploadBatch();
 	}
 
 
 	void RHI::GenerateMipChain(const ImageCreateInfo& luxImageCI, Image& image) noexcept
 	{
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommandBuffer();
+		BeginUploadBatch();
+
+		VkCommandBuffer commandBuffer = RecordUploadCommands();
 
 		CommandTransitionImageLayout(commandBuffer, image.image, luxImageCI.format, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
 
@@ -235,11 +227,14 @@ namespace lux::rhi
 
 		CommandTransitionImageLayout(commandBuffer, image.image, luxImageCI.format, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, luxImageCI.mipmapCount);
 
-		EndSingleTimeCommandBuffer(commandBuffer);
+		EndUploadBatch();
 	}
 
 	void RHI::GenerateIBLResources(const Image& cubemapSource, Image& irradiance, Image& prefiltered, Image& BRDFLut) noexcept
 	{
+		// The compute queue does not see the upload batch
+		FlushUploadBatch();
+
 		GenerateIrradianceFromCubemap(cubemapSource, irradiance);
 		GeneratePrefilteredFromCubemap(cubemapSource, prefiltered);
 		GenerateBRDFLut(BRDFLut);
@@ -280,6 +275,8 @@ namespace lux::rhi
 #else
 		imageCI.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 #endif
+		imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_IBL;
+		imageCI.debugName = "Environment Cubemap";
 
 		CreateImage(imageCI, cubemap);
 
@@ -312,6 +309,8 @@ namespace lux::rhi
 #else
 		imageCI.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 #endif
+		imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_IBL;
+		imageCI.debugName = "Irradiance Cubemap";
 
 		CreateImage(imageCI, irradiance);
 
@@ -334,13 +333,9 @@ namespace lux::rhi
 		writeIrradianceMapDescriptorSet.dstBinding = 5;
 		writeIrradianceMapDescriptorSet.dstArrayElement = 0;
 		writeIrradianceMapDescriptorSet.pImageInfo = &irradianceMapDescriptorImageInfo;
+		writeIrradianceMapDescriptorSet.dstSet = forward.rtViewDescriptorSet;
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			writeIrradianceMapDescriptorSet.dstSet = forward.rtViewDescriptorSets[i];
-
-			vkUpdateDescriptorSets(device, 1, &writeIrradianceMapDescriptorSet, 0, nullptr);
-		}
+		vkUpdateDescriptorSets(device, 1, &writeIrradianceMapDescriptorSet, 0, nullptr);
 	}
 
 	void RHI::GenerateIrradianceFromCubemapFS(const Image& cubemapSource, Image& irradiance) noexcept
@@ -555,6 +550,8 @@ namespace lux::rhi
 #else
 		imageCI.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 #endif
+		imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_IBL;
+		imageCI.debugName = "Prefiltered Cubemap";
 
 		CreateImage(imageCI, prefiltered);
 
@@ -578,13 +575,9 @@ namespace lux::rhi
 		writePrefilteredMapDescriptorSet.dstBinding = 6;
 		writePrefilteredMapDescriptorSet.dstArrayElement = 0;
 		writePrefilteredMapDescriptorSet.pImageInfo = &prefilteredMapDescriptorImageInfo;
+		writePrefilteredMapDescriptorSet.dstSet = forward.rtViewDescriptorSet;
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			writePrefilteredMapDescriptorSet.dstSet = forward.rtViewDescriptorSets[i];
-
-			vkUpdateDescriptorSets(device, 1, &writePrefilteredMapDescriptorSet, 0, nullptr);
-		}
+		vkUpdateDescriptorSets(device, 1, &writePrefilteredMapDescriptorSet, 0, nullptr);
 	}
 
 	void RHI::GeneratePrefilteredFromCubemapFS(const Image& cubemapSource, Image& prefiltered) noexcept
@@ -854,6 +847,8 @@ namespace lux::rhi
 		imageCI.subresourceRangeLayerCount = 1;
 		imageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		imageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_IBL;
+		imageCI.debugName = "Cubemap Offscreen";
 
 		CreateImage(imageCI, offscreen.image);
 
@@ -988,7 +983,7 @@ namespace lux::rhi
 
 		CommandTransitionImageLayout(commandBuffer, image.image, luxCubemapCI.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 6, luxCubemapCI.mipmapCount);
 
-		VkDeviceSize offset[] = { 0 };
+		BindMeshArena(commandBuffer);
 
 		VkViewport viewport = {};
 		viewport.x = 0.0f;
@@ -1024,10 +1019,7 @@ namespace lux::rhi
 				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreen.pipeline.pipeline);
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreen.pipeline.pipelineLayout, 0, 1, &offscreen.descriptorSet, 0, nullptr);
 
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &cube->vertexBuffer.buffer, offset);
-				vkCmdBindIndexBuffer(commandBuffer, cube->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(commandBuffer, cube->indexCount, 1, 0, 0, 0);
+				vkCmdDrawIndexed(commandBuffer, cube->indexCount, 1, cube->firstIndex, cube->vertexOffset, 0);
 
 				vkCmdEndRenderPass(commandBuffer);
 
@@ -1087,6 +1079,8 @@ namespace lux::rhi
 #endif
 
 		imageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_IBL;
+		imageCI.debugName = "BRDF Lut";
 
 		CreateImage(imageCI, BRDFLut);
 
@@ -1111,13 +1105,9 @@ namespace lux::rhi
 		writeBRDFLutDescriptorSet.dstBinding = 7;
 		writeBRDFLutDescriptorSet.dstArrayElement = 0;
 		writeBRDFLutDescriptorSet.pImageInfo = &BRDFLutDescriptorImageInfo;
+		writeBRDFLutDescriptorSet.dstSet = forward.rtViewDescriptorSet;
 
-		for (size_t i = 0; i < swapchainImageCount; i++)
-		{
-			writeBRDFLutDescriptorSet.dstSet = forward.rtViewDescriptorSets[i];
-
-			vkUpdateDescriptorSets(device, 1, &writeBRDFLutDescriptorSet, 0, nullptr);
-		}
+		vkUpdateDescriptorSets(device, 1, &writeBRDFLutDescriptorSet, 0, nullptr);
 	}
 
 	void RHI::GenerateBRDFLutFS(Image& BRDFLut) noexcept
@@ -1382,7 +1372,7 @@ namespace lux::rhi
 	{
 		vkDestroyImageView(device, image.imageView, nullptr);
 		vkDestroyImage(device, image.image, nullptr);
-		vkFreeMemory(device, image.memory, nullptr);
+		FreeMemory(image.allocation);
 	}
 
 	void RHI::DestroyImage(Image& image, VkSampler* sampler) noexcept
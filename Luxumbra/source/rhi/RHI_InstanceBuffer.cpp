@@ -0,0 +1,81 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lux::rhi
+{
+
+	InstanceBuffer::InstanceBuffer() noexcept
+		: buffers(), capacities(), instances(0)
+	{
+
+	}
+
+	void RHI::InitInstanceBuffer() noexcept
+	{
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			CreateInstanceBuffer(i, INSTANCE_BUFFER_INITIAL_CAPACITY);
+	}
+
+	void RHI::CreateInstanceBuffer(size_t frameIndex, uint32_t capacity) noexcept
+	{
+		BufferCreateInfo instanceBufferCI = {};
+		// Also read by the GPU culling pass
+		instanceBufferCI.usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		instanceBufferCI.size = sizeof(glm::mat4) * TO_SIZE_T(capacity);
+		instanceBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		instanceBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		instanceBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_INSTANCE;
+		instanceBufferCI.debugName = "Instance Buffer " + std::to_string(frameIndex);
+
+		CreateBuffer(instanceBufferCI, instanceBuffer.buffers[frameIndex]);
+
+		ASSERT(instanceBuffer.buffers[frameIndex].allocation.mappedData != nullptr);
+
+		instanceBuffer.capacities[frameIndex] = capacity;
+	}
+
+	void RHI::BeginInstanceBufferFrame() noexcept
+	{
+		instanceBuffer.instances.clear();
+	}
+
+	void RHI::UploadInstanceBuffer() noexcept
+	{
+		uint32_t instanceCount = TO_UINT32_T(instanceBuffer.instances.size());
+
+		if (instanceCount == 0)
+			return;
+
+		// The frame fence was waited on and nothing was recorded with this buffer yet, it can be replaced
+		if (instanceCount > instanceBuffer.capacities[currentFrame])
+		{
+			uint32_t newCapacity = std::max(instanceCount, instanceBuffer.capacities[currentFrame] * 2);
+
+			DestroyBuffer(instanceBuffer.buffers[currentFrame]);
+			CreateInstanceBuffer(currentFrame, newCapacity);
+		}
+
+		memcpy(instanceBuffer.buffers[currentFrame].allocation.mappedData, instanceBuffer.instances.data(), sizeof(glm::mat4) * instanceBuffer.instances.size());
+	}
+
+	void RHI::BindInstanceBuffer(VkCommandBuffer commandBuffer) const noexcept
+	{
+		VkDeviceSize instanceBufferOffset = 0;
+
+		// The culled draw records point into the compacted copy written by the culling pass
+		const Buffer& buffer = gpuCuller.isActive ? gpuCuller.culledInstanceBuffers[currentFrame] : instanceBuffer.buffers[currentFrame];
+
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &buffer.buffer, &instanceBufferOffset);
+	}
+
+	void RHI::DestroyInstanceBuffer() noexcept
+	{
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			DestroyBuffer(instanceBuffer.buffers[i]);
+
+		instanceBuffer.instances.clear();
+	}
+
+} // namespace lux::rhi
@@ -0,0 +1,348 @@
+#include "rhi/RHI.h"
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+#include "CpuProfiler.h"
+
+namespace lux::rhi
+{
+
+	static_assert(LIGHT_CLUSTER_POINT_LIGHT_MAX_COUNT == POINT_LIGHT_MAX_COUNT, "The light clusters index the point light buffer");
+
+	LightClusterer::LightClusterer() noexcept
+		: isEnabled(true), buffer(), mappedData(nullptr), indexListOffset(0), frameSize(0), frameOffset(0),
+		pointLights(), pointLightCount(0), boundsProjection(0.f), clusterMins(0), clusterMaxs(0),
+		lightClusterIndices(0), lightFirstClusterIndices(), clusterLightCounts(0),
+		clusterRecords(0), lightIndices(0), statistics()
+	{
+
+	}
+
+	void RHI::InitLightClusters() noexcept
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+
+		VkDeviceSize gridSize = sizeof(LightClusterParameters) + sizeof(LightClusterRecord) * LIGHT_CLUSTER_COUNT;
+		VkDeviceSize indexListSize = sizeof(uint32_t) * LIGHT_CLUSTER_MAX_INDEX_COUNT;
+
+		lightClusterer.indexListOffset = (gridSize + alignment - 1) / alignment * alignment;
+		lightClusterer.frameSize = (lightClusterer.indexListOffset + indexListSize + alignment - 1) / alignment * alignment;
+
+		// Written by the CPU every frame, small enough to be read by the fragment shader from host visible memory
+
+		BufferCreateInfo lightClusterBufferCI = {};
+		lightClusterBufferCI.usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		lightClusterBufferCI.size = lightClusterer.frameSize * MAX_FRAMES_IN_FLIGHT;
+		lightClusterBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		lightClusterBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		lightClusterBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_UNIFORM;
+		lightClusterBufferCI.debugName = "Light Cluster Buffer";
+
+		CreateBuffer(lightClusterBufferCI, lightClusterer.buffer);
+
+		lightClusterer.mappedData = static_cast<uint8_t*>(lightClusterer.buffer.allocation.mappedData);
+		ASSERT(lightClusterer.mappedData != nullptr);
+
+		lightClusterer.clusterMins.resize(LIGHT_CLUSTER_COUNT);
+		lightClusterer.clusterMaxs.resize(LIGHT_CLUSTER_COUNT);
+		lightClusterer.clusterLightCounts.resize(LIGHT_CLUSTER_COUNT);
+		lightClusterer.clusterRecords.resize(LIGHT_CLUSTER_COUNT);
+		lightClusterer.lightIndices.reserve(LIGHT_CLUSTER_MAX_INDEX_COUNT);
+
+		// Both bindings are dynamic, they move to the region of the frame with the same offset
+
+		VkDescriptorBufferInfo lightClusterGridDescriptorBufferInfo = {};
+		lightClusterGridDescriptorBufferInfo.buffer = lightClusterer.buffer.buffer;
+		lightClusterGridDescriptorBufferInfo.offset = 0;
+		lightClusterGridDescriptorBufferInfo.range = gridSize;
+
+		VkWriteDescriptorSet writeLightClusterGridDescriptorSet = {};
+		writeLightClusterGridDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeLightClusterGridDescriptorSet.descriptorCount = 1;
+		writeLightClusterGridDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeLightClusterGridDescriptorSet.dstBinding = 9;
+		writeLightClusterGridDescriptorSet.dstArrayElement = 0;
+		writeLightClusterGridDescriptorSet.pBufferInfo = &lightClusterGridDescriptorBufferInfo;
+		writeLightClusterGridDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+		VkDescriptorBufferInfo lightIndexListDescriptorBufferInfo = {};
+		lightIndexListDescriptorBufferInfo.buffer = lightClusterer.buffer.buffer;
+		lightIndexListDescriptorBufferInfo.offset = lightClusterer.indexListOffset;
+		lightIndexListDescriptorBufferInfo.range = indexListSize;
+
+		VkWriteDescriptorSet writeLightIndexListDescriptorSet = {};
+		writeLightIndexListDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeLightIndexListDescriptorSet.descriptorCount = 1;
+		writeLightIndexListDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeLightIndexListDescriptorSet.dstBinding = 10;
+		writeLightIndexListDescriptorSet.dstArrayElement = 0;
+		writeLightIndexListDescriptorSet.pBufferInfo = &lightIndexListDescriptorBufferInfo;
+		writeLightIndexListDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets =
+		{
+			writeLightClusterGridDescriptorSet,
+			writeLightIndexListDescriptorSet
+		};
+
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	bool RHI::GetIsLightClusteringEnabled() const noexcept
+	{
+		return lightClusterer.isEnabled;
+	}
+
+	void RHI::SetIsLightClusteringEnabled(bool isEnabled) noexcept
+	{
+		lightClusterer.isEnabled = isEnabled;
+	}
+
+	const LightClusterStatistics& RHI::GetLightClusterStatistics() const noexcept
+	{
+		return lightClusterer.statistics;
+	}
+
+	void RHI::BuildLightClusterBounds(const glm::mat4& projection, float nearPlane, float farPlane) noexcept
+	{
+		glm::mat4 inverseProjection = glm::inverse(projection);
+
+		// Exponential slices, each one is as deep as it is wide in screen space
+		std::array<float, LIGHT_CLUSTER_GRID_Z + 1> sliceDepths;
+
+		for (uint32_t z = 0; z <= LIGHT_CLUSTER_GRID_Z; z++)
+			sliceDepths[z] = nearPlane * std::pow(farPlane / nearPlane, TO_FLOAT(z) / TO_FLOAT(LIGHT_CLUSTER_GRID_Z));
+
+		for (uint32_t y = 0; y < LIGHT_CLUSTER_GRID_Y; y++)
+		{
+			for (uint32_t x = 0; x < LIGHT_CLUSTER_GRID_X; x++)
+			{
+				// View rays through the tile corners, scaled to a depth of 1
+				std::array<glm::vec3, 4> cornerRays;
+
+				for (uint32_t corner = 0; corner < 4; corner++)
+				{
+					glm::vec2 ndc;
+					ndc.x = TO_FLOAT(x + (corner & 1)) / TO_FLOAT(LIGHT_CLUSTER_GRID_X) * 2.f - 1.f;
+					ndc.y = TO_FLOAT(y + (corner >> 1)) / TO_FLOAT(LIGHT_CLUSTER_GRID_Y) * 2.f - 1.f;
+
+					glm::vec4 farCorner = inverseProjection * glm::vec4(ndc, 1.f, 1.f);
+					glm::vec3 ray = glm::vec3(farCorner) / farCorner.w;
+
+					cornerRays[corner] = ray / -ray.z;
+				}
+
+				for (uint32_t z = 0; z < LIGHT_CLUSTER_GRID_Z; z++)
+				{
+					size_t clusterIndex = (TO_SIZE_T(z) * LIGHT_CLUSTER_GRID_Y + y) * LIGHT_CLUSTER_GRID_X + x;
+
+					glm::vec3 clusterMin(FLT_MAX);
+					glm::vec3 clusterMax(-FLT_MAX);
+
+					for (const glm::vec3& ray : cornerRays)
+					{
+						clusterMin = glm::min(clusterMin, glm::min(ray * sliceDepths[z], ray * sliceDepths[z + 1]));
+						clusterMax = glm::max(clusterMax, glm::max(ray * sliceDepths[z], ray * sliceDepths[z + 1]));
+					}
+
+					lightClusterer.clusterMins[clusterIndex] = clusterMin;
+					lightClusterer.clusterMaxs[clusterIndex] = clusterMax;
+				}
+			}
+		}
+
+		lightClusterer.boundsProjection = projection;
+	}
+
+	void RHI::BuildLightClusters() noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		const glm::mat4& view = forward.rtViewProjUniform.view;
+		const glm::mat4& projection = forward.rtViewProjUniform.projection;
+		float nearPlane = forward.rtViewProjUniform.nearFarPlane.x;
+		float farPlane = forward.rtViewProjUniform.nearFarPlane.y;
+
+		if (projection != lightClusterer.boundsProjection)
+			BuildLightClusterBounds(projection, nearPlane, farPlane);
+
+		lightClusterer.frameOffset = TO_UINT32_T(lightClusterer.frameSize * currentFrame);
+
+		uint8_t* frameData = lightClusterer.mappedData + lightClusterer.frameOffset;
+		LightClusterParameters* parameters = reinterpret_cast<LightClusterParameters*>(frameData);
+		LightClusterRecord* records = reinterpret_cast<LightClusterRecord*>(frameData + sizeof(LightClusterParameters));
+		uint32_t* lightIndices = reinterpret_cast<uint32_t*>(frameData + lightClusterer.indexListOffset);
+
+		LightClusterStatistics& statistics = lightClusterer.statistics;
+		statistics = {};
+
+		if (lightClusterer.isEnabled == false)
+		{
+			// Every fragment maps to the first cluster, it holds all the lights that light anything
+			*parameters = { glm::vec2(0.f), 0.f, 0.f };
+
+			uint32_t lightCount = 0;
+
+			for (uint32_t i = 0; i < lightClusterer.pointLightCount; i++)
+			{
+				if (lightClusterer.pointLights[i].w > 0.f)
+					lightIndices[lightCount++] = i;
+			}
+
+			records[0] = { 0, lightCount };
+
+			statistics.indexCount = lightCount;
+			statistics.maxClusterLightCount = lightCount;
+
+			return;
+		}
+
+		VkExtent2D renderExtent = dynamicResolution.renderExtent;
+		float depthRange = std::log(farPlane / nearPlane);
+
+		LightClusterParameters clusterParameters;
+		clusterParameters.tileScale = glm::vec2(TO_FLOAT(LIGHT_CLUSTER_GRID_X) / TO_FLOAT(renderExtent.width), TO_FLOAT(LIGHT_CLUSTER_GRID_Y) / TO_FLOAT(renderExtent.height));
+		clusterParameters.depthScale = TO_FLOAT(LIGHT_CLUSTER_GRID_Z) / depthRange;
+		clusterParameters.depthBias = -TO_FLOAT(LIGHT_CLUSTER_GRID_Z) * std::log(nearPlane) / depthRange;
+
+		*parameters = clusterParameters;
+
+		// Clusters overlapped by the light spheres. The shadow cube faces end on planes one radius away from the light,
+		// so a point light reaches up to the corners of that cube
+
+		lightClusterer.lightClusterIndices.clear();
+		std::fill(lightClusterer.clusterLightCounts.begin(), lightClusterer.clusterLightCounts.end(), 0);
+
+		for (uint32_t lightIndex = 0; lightIndex < lightClusterer.pointLightCount; lightIndex++)
+		{
+			lightClusterer.lightFirstClusterIndices[lightIndex] = TO_UINT32_T(lightClusterer.lightClusterIndices.size());
+
+			const glm::vec4& pointLight = lightClusterer.pointLights[lightIndex];
+			float radius = pointLight.w * std::sqrt(3.f);
+
+			if (radius <= 0.f)
+				continue;
+
+			glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(pointLight), 1.f));
+			float nearDepth = -center.z - radius;
+			float farDepth = -center.z + radius;
+
+			if (farDepth < nearPlane || nearDepth > farPlane)
+				continue;
+
+			int32_t firstSlice = TO_INT32_T(std::log(std::max(nearDepth, nearPlane)) * clusterParameters.depthScale + clusterParameters.depthBias);
+			int32_t lastSlice = TO_INT32_T(std::log(std::min(farDepth, farPlane)) * clusterParameters.depthScale + clusterParameters.depthBias);
+
+			firstSlice = std::clamp(firstSlice, 0, LIGHT_CLUSTER_GRID_Z - 1);
+			lastSlice = std::clamp(lastSlice, 0, LIGHT_CLUSTER_GRID_Z - 1);
+
+			glm::ivec2 maxTile(LIGHT_CLUSTER_GRID_X - 1, LIGHT_CLUSTER_GRID_Y - 1);
+			glm::ivec2 firstTile(0);
+			glm::ivec2 lastTile = maxTile;
+
+			// A sphere entirely in front of the near plane only covers the tiles of its projected bounding box
+			if (nearDepth > nearPlane)
+			{
+				glm::vec2 ndcMin(FLT_MAX);
+				glm::vec2 ndcMax(-FLT_MAX);
+
+				for (uint32_t corner = 0; corner < 8; corner++)
+				{
+					glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+					glm::vec4 clipCorner = projection * glm::vec4(center + offset, 1.f);
+					glm::vec2 ndcCorner = glm::vec2(clipCorner) / clipCorner.w;
+
+					ndcMin = glm::min(ndcMin, ndcCorner);
+					ndcMax = glm::max(ndcMax, ndcCorner);
+				}
+
+				glm::vec2 gridSize(LIGHT_CLUSTER_GRID_X, LIGHT_CLUSTER_GRID_Y);
+
+				firstTile = glm::clamp(glm::ivec2(glm::floor((ndcMin * 0.5f + 0.5f) * gridSize)), glm::ivec2(0), maxTile);
+				lastTile = glm::clamp(glm::ivec2(glm::floor((ndcMax * 0.5f + 0.5f) * gridSize)), glm::ivec2(0), maxTile);
+			}
+
+			float sqrRadius = radius * radius;
+
+			for (int32_t z = firstSlice; z <= lastSlice; z++)
+			{
+				for (int32_t y = firstTile.y; y <= lastTile.y; y++)
+				{
+					for (int32_t x = firstTile.x; x <= lastTile.x; x++)
+					{
+						uint32_t clusterIndex = TO_UINT32_T((z * LIGHT_CLUSTER_GRID_Y + y) * LIGHT_CLUSTER_GRID_X + x);
+
+						glm::vec3 closestPoint = glm::clamp(center, lightClusterer.clusterMins[clusterIndex], lightClusterer.clusterMaxs[clusterIndex]);
+						glm::vec3 centerToClosest = closestPoint - center;
+
+						if (glm::dot(centerToClosest, centerToClosest) > sqrRadius)
+							continue;
+
+						lightClusterer.lightClusterIndices.push_back(clusterIndex);
+						lightClusterer.clusterLightCounts[clusterIndex]++;
+					}
+				}
+			}
+		}
+
+		lightClusterer.lightFirstClusterIndices[lightClusterer.pointLightCount] = TO_UINT32_T(lightClusterer.lightClusterIndices.size());
+
+		// Compact lists, the clusters that do not fit in the index list keep the lights with the lowest indices
+
+		uint32_t indexCount = 0;
+
+		for (uint32_t clusterIndex = 0; clusterIndex < LIGHT_CLUSTER_COUNT; clusterIndex++)
+		{
+			uint32_t clusterLightCount = lightClusterer.clusterLightCounts[clusterIndex];
+			uint32_t keptLightCount = std::min(clusterLightCount, LIGHT_CLUSTER_MAX_INDEX_COUNT - indexCount);
+
+			lightClusterer.clusterRecords[clusterIndex] = { indexCount, 0 };
+			lightClusterer.clusterLightCounts[clusterIndex] = keptLightCount;
+
+			indexCount += keptLightCount;
+			statistics.maxClusterLightCount = std::max(statistics.maxClusterLightCount, clusterLightCount);
+			statistics.droppedIndexCount += clusterLightCount - keptLightCount;
+		}
+
+		lightClusterer.lightIndices.resize(indexCount);
+
+		for (uint32_t lightIndex = 0; lightIndex < lightClusterer.pointLightCount; lightIndex++)
+		{
+			uint32_t firstClusterIndex = lightClusterer.lightFirstClusterIndices[lightIndex];
+			uint32_t lastClusterIndex = lightClusterer.lightFirstClusterIndices[lightIndex + 1];
+
+			for (uint32_t i = firstClusterIndex; i < lastClusterIndex; i++)
+			{
+				uint32_t clusterIndex = lightClusterer.lightClusterIndices[i];
+				LightClusterRecord& record = lightClusterer.clusterRecords[clusterIndex];
+
+				if (record.lightCount == lightClusterer.clusterLightCounts[clusterIndex])
+					continue;
+
+				lightClusterer.lightIndices[TO_SIZE_T(record.firstLightIndex + record.lightCount)] = lightIndex;
+				record.lightCount++;
+			}
+		}
+
+		// Built in system memory, the mapped region is only written
+		memcpy(records, lightClusterer.clusterRecords.data(), sizeof(LightClusterRecord) * LIGHT_CLUSTER_COUNT);
+		memcpy(lightIndices, lightClusterer.lightIndices.data(), sizeof(uint32_t) * TO_SIZE_T(indexCount));
+
+		statistics.indexCount = indexCount;
+	}
+
+	void RHI::DestroyLightClusters() noexcept
+	{
+		DestroyBuffer(lightClusterer.buffer);
+
+		lightClusterer.mappedData = nullptr;
+	}
+
+} // namespace lux::rhi
@@ -0,0 +1,139 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lux::rhi
+{
+
+	MaterialTable::MaterialTable() noexcept
+		: buffer(), capacity(0), entries(0), freeIndices(0), dirtyIndices(0), isEntryDirty(0)
+	{
+
+	}
+
+	void RHI::InitMaterialTable() noexcept
+	{
+		materialTable.entries.reserve(MATERIAL_TABLE_INITIAL_CAPACITY);
+
+		CreateMaterialTableBuffer(MATERIAL_TABLE_INITIAL_CAPACITY);
+	}
+
+	void RHI::UpdateMaterial(const resource::Material& material) noexcept
+	{
+		uint32_t materialIndex = material.materialIndex;
+		ASSERT(materialIndex < materialTable.entries.size());
+
+		materialTable.entries[TO_SIZE_T(materialIndex)].parameters = material.parameter;
+
+		MarkMaterialTableEntryDirty(materialIndex);
+	}
+
+	void RHI::MarkMaterialTableEntryDirty(uint32_t materialIndex) noexcept
+	{
+		if (materialTable.isEntryDirty.size() < materialTable.entries.size())
+			materialTable.isEntryDirty.resize(materialTable.entries.size(), false);
+
+		if (materialTable.isEntryDirty[TO_SIZE_T(materialIndex)])
+			return;
+
+		materialTable.isEntryDirty[TO_SIZE_T(materialIndex)] = true;
+		materialTable.dirtyIndices.push_back(materialIndex);
+	}
+
+	void RHI::CreateMaterialTableBuffer(uint32_t capacity) noexcept
+	{
+		materialTable.capacity = capacity;
+
+		BufferCreateInfo materialTableCI = {};
+		materialTableCI.usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		materialTableCI.size = sizeof(MaterialTableEntry) * TO_SIZE_T(capacity);
+		materialTableCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		materialTableCI.memoryProperty = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		materialTableCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_MATERIAL;
+		materialTableCI.debugName = "Material Table";
+
+		CreateBuffer(materialTableCI, materialTable.buffer);
+
+		VkDescriptorBufferInfo materialTableDescriptorBufferInfo = {};
+		materialTableDescriptorBufferInfo.buffer = materialTable.buffer.buffer;
+		materialTableDescriptorBufferInfo.offset = 0;
+		materialTableDescriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet writeMaterialTableDescriptorSet = {};
+		writeMaterialTableDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeMaterialTableDescriptorSet.descriptorCount = 1;
+		writeMaterialTableDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writeMaterialTableDescriptorSet.dstBinding = 8;
+		writeMaterialTableDescriptorSet.dstArrayElement = 0;
+		writeMaterialTableDescriptorSet.pBufferInfo = &materialTableDescriptorBufferInfo;
+		writeMaterialTableDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+		vkUpdateDescriptorSets(device, 1, &writeMaterialTableDescriptorSet, 0, nullptr);
+	}
+
+	void RHI::UploadMaterialTable() noexcept
+	{
+		if (materialTable.dirtyIndices.empty())
+			return;
+
+		// The other frames in flight still read the table, material edits are rare enough to wait for them
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			if (i != TO_SIZE_T(currentFrame))
+				vkWaitForFences(device, 1, &fences[i], true, UINT64_MAX);
+		}
+
+		std::sort(materialTable.dirtyIndices.begin(), materialTable.dirtyIndices.end());
+
+		// Staged through the upload batch, whose arena falls back to a dedicated buffer for a table bigger than it
+		BeginUploadBatch();
+
+		size_t dirtyCount = materialTable.dirtyIndices.size();
+
+		for (size_t first = 0, last = 0; first < dirtyCount; first = last)
+		{
+			uint32_t firstIndex = materialTable.dirtyIndices[first];
+
+			last = first + 1;
+			while (last < dirtyCount && materialTable.dirtyIndices[last] == firstIndex + TO_UINT32_T(last - first))
+				last++;
+
+			VkDeviceSize dirtyOffset = sizeof(MaterialTableEntry) * TO_SIZE_T(firstIndex);
+			VkDeviceSize dirtySize = sizeof(MaterialTableEntry) * (last - first);
+
+			VkBuffer stagingBuffer;
+			VkDeviceSize stagingOffset;
+			void* stagingData = AllocateUploadStaging(dirtySize, stagingBuffer, stagingOffset);
+
+			memcpy(stagingData, &materialTable.entries[TO_SIZE_T(firstIndex)], TO_SIZE_T(dirtySize));
+
+			VkCommandBuffer commandBuffer = RecordUploadCommands();
+
+			VkBufferCopy bufferCopy = {};
+			bufferCopy.srcOffset = stagingOffset;
+			bufferCopy.dstOffset = dirtyOffset;
+			bufferCopy.size = dirtySize;
+
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer, materialTable.buffer.buffer, 1, &bufferCopy);
+		}
+
+		EndUploadBatch();
+
+		for (uint32_t materialIndex : materialTable.dirtyIndices)
+			materialTable.isEntryDirty[TO_SIZE_T(materialIndex)] = false;
+
+		materialTable.dirtyIndices.clear();
+	}
+
+	void RHI::DestroyMaterialTable() noexcept
+	{
+		DestroyBuffer(materialTable.buffer);
+
+		materialTable.entries.clear();
+		materialTable.freeIndices.clear();
+		materialTable.dirtyIndices.clear();
+		materialTable.isEntryDirty.clear();
+	}
+
+} // namespace lux::rhi
@@ -0,0 +1,479 @@
+#include "rhi/RHI.h"
+
+#include <fstream>
+
+#include "Logger.h"
+
+namespace lux::rhi
+{
+
+	MemoryAllocation::MemoryAllocation() noexcept
+		: memory(VK_NULL_HANDLE), offset(0), size(0), memoryType(UINT32_MAX), blockIndex(UINT32_MAX), recordIndex(UINT32_MAX), mappedData(nullptr)
+	{
+
+	}
+
+	MemoryAllocator::MemoryAllocator() noexcept
+		: memoryProperties(), blocks(0), records(0), freeRecordIndices(0)
+	{
+
+	}
+
+	const char* GetMemoryCategoryName(MemoryCategory category) noexcept
+	{
+		switch (category)
+		{
+		case MemoryCategory::MEMORY_CATEGORY_ATTACHMENT:
+			return "Attachment";
+		case MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP:
+			return "Shadow Map";
+		case MemoryCategory::MEMORY_CATEGORY_IBL:
+			return "IBL";
+		case MemoryCategory::MEMORY_CATEGORY_TEXTURE:
+			return "Texture";
+		case MemoryCategory::MEMORY_CATEGORY_MESH:
+			return "Mesh";
+		case MemoryCategory::MEMORY_CATEGORY_UNIFORM:
+			return "Uniform";
+		case MemoryCategory::MEMORY_CATEGORY_MATERIAL:
+			return "Material";
+		case MemoryCategory::MEMORY_CATEGORY_INSTANCE:
+			return "Instance";
+		case MemoryCategory::MEMORY_CATEGORY_DRAW_COMMAND:
+			return "Draw Command";
+		case MemoryCategory::MEMORY_CATEGORY_CULLING:
+			return "Culling";
+		case MemoryCategory::MEMORY_CATEGORY_STAGING:
+			return "Staging";
+		default:
+			return "Other";
+		}
+	}
+
+	void RHI::InitMemoryAllocator() noexcept
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryAllocator.memoryProperties);
+
+		memoryAllocator.blocks.reserve(32);
+		memoryAllocator.records.reserve(256);
+	}
+
+	bool RHI::AllocateMemory(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags memoryProperty, bool isLinear, MemoryCategory category, const std::string& debugName, MemoryAllocation& allocation) noexcept
+	{
+		uint32_t memoryType = FindMemoryType(memoryRequirements.memoryTypeBits, memoryProperty);
+
+		if (memoryType == UINT32_MAX)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to find a suitable memory type");
+			return false;
+		}
+
+		// Sub-allocate from an existing block
+
+		for (size_t i = 0, blockCount = memoryAllocator.blocks.size(); i < blockCount; i++)
+		{
+			MemoryBlock& block = memoryAllocator.blocks[i];
+
+			if (block.memory == VK_NULL_HANDLE || block.isDedicated || block.memoryType != memoryType || block.isLinear != isLinear)
+				continue;
+
+			if (block.size - block.usedSize < memoryRequirements.size)
+				continue;
+
+			VkDeviceSize offset;
+			if (SubAllocateMemoryBlock(block, memoryRequirements.size, memoryRequirements.alignment, offset))
+			{
+				allocation.memory = block.memory;
+				allocation.offset = offset;
+				allocation.size = memoryRequirements.size;
+				allocation.memoryType = memoryType;
+				allocation.blockIndex = TO_UINT32_T(i);
+				allocation.mappedData = block.mappedData != nullptr ? static_cast<uint8_t*>(block.mappedData) + offset : nullptr;
+
+				CreateMemoryAllocationRecord(category, debugName, allocation);
+
+				return true;
+			}
+		}
+
+		// Create a new block, resources bigger than half a block get their own memory
+
+		bool isDedicated = memoryRequirements.size > MEMORY_BLOCK_SIZE / 2;
+		VkDeviceSize blockSize = isDedicated ? memoryRequirements.size : MEMORY_BLOCK_SIZE;
+
+		uint32_t blockIndex = CreateMemoryBlock(memoryType, blockSize, isLinear, isDedicated);
+
+		if (blockIndex == UINT32_MAX)
+			return false;
+
+		MemoryBlock& block = memoryAllocator.blocks[TO_SIZE_T(blockIndex)];
+
+		VkDeviceSize offset;
+		bool subAllocated = SubAllocateMemoryBlock(block, memoryRequirements.size, memoryRequirements.alignment, offset);
+		ASSERT(subAllocated);
+
+		allocation.memory = block.memory;
+		allocation.offset = offset;
+		allocation.size = memoryRequirements.size;
+		allocation.memoryType = memoryType;
+		allocation.blockIndex = blockIndex;
+		allocation.mappedData = block.mappedData != nullptr ? static_cast<uint8_t*>(block.mappedData) + offset : nullptr;
+
+		CreateMemoryAllocationRecord(category, debugName, allocation);
+
+		return subAllocated;
+	}
+
+	void RHI::FreeMemory(MemoryAllocation& allocation) noexcept
+	{
+		if (allocation.blockIndex == UINT32_MAX)
+			return;
+
+		MemoryBlock& block = memoryAllocator.blocks[TO_SIZE_T(allocation.blockIndex)];
+
+		ASSERT(block.memory == allocation.memory);
+
+		// Insert the range back in the offset-sorted free list and merge it with its neighbours
+
+		std::vector<MemoryRange>& freeRanges = block.freeRanges;
+
+		size_t insertIndex = 0;
+		size_t freeRangeCount = freeRanges.size();
+
+		while (insertIndex < freeRangeCount && freeRanges[insertIndex].offset < allocation.offset)
+			insertIndex++;
+
+		freeRanges.insert(freeRanges.begin() + insertIndex, { allocation.offset, allocation.size });
+
+		if (insertIndex + 1 < freeRanges.size() && freeRanges[insertIndex].offset + freeRanges[insertIndex].size == freeRanges[insertIndex + 1].offset)
+		{
+			freeRanges[insertIndex].size += freeRanges[insertIndex + 1].size;
+			freeRanges.erase(freeRanges.begin() + insertIndex + 1);
+		}
+
+		if (insertIndex > 0 && freeRanges[insertIndex - 1].offset + freeRanges[insertIndex - 1].size == freeRanges[insertIndex].offset)
+		{
+			freeRanges[insertIndex - 1].size += freeRanges[insertIndex].size;
+			freeRanges.erase(freeRanges.begin() + insertIndex);
+		}
+
+		block.usedSize -= allocation.size;
+		block.allocationCount--;
+
+		if (block.isDedicated && block.allocationCount == 0)
+			DestroyMemoryBlock(block);
+
+		if (allocation.recordIndex != UINT32_MAX)
+		{
+			MemoryAllocationRecord& record = memoryAllocator.records[TO_SIZE_T(allocation.recordIndex)];
+			record.isAlive = false;
+			record.debugName.clear();
+
+			memoryAllocator.freeRecordIndices.push_back(allocation.recordIndex);
+		}
+
+		allocation.memory = VK_NULL_HANDLE;
+		allocation.offset = 0;
+		allocation.size = 0;
+		allocation.memoryType = UINT32_MAX;
+		allocation.blockIndex = UINT32_MAX;
+		allocation.recordIndex = UINT32_MAX;
+		allocation.mappedData = nullptr;
+	}
+
+	void RHI::CreateMemoryAllocationRecord(MemoryCategory category, const std::string& debugName, MemoryAllocation& allocation) noexcept
+	{
+		uint32_t recordIndex;
+
+		if (memoryAllocator.freeRecordIndices.empty())
+		{
+			recordIndex = TO_UINT32_T(memoryAllocator.records.size());
+			memoryAllocator.records.emplace_back();
+		}
+		else
+		{
+			recordIndex = memoryAllocator.freeRecordIndices.back();
+			memoryAllocator.freeRecordIndices.pop_back();
+		}
+
+		MemoryAllocationRecord& record = memoryAllocator.records[TO_SIZE_T(recordIndex)];
+		record.debugName = debugName.empty() ? "Unnamed" : debugName;
+		record.category = category;
+		record.size = allocation.size;
+		record.memoryType = allocation.memoryType;
+		record.isAlive = true;
+
+		allocation.recordIndex = recordIndex;
+	}
+
+	void RHI::GetMemoryHeapUsages(std::vector<MemoryHeapUsage>& heapUsages) const noexcept
+	{
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = memoryAllocator.memoryProperties;
+
+		heapUsages.resize(TO_SIZE_T(memoryProperties.memoryHeapCount));
+
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			MemoryHeapUsage& heapUsage = heapUsages[TO_SIZE_T(i)];
+			heapUsage = {};
+			heapUsage.flags = memoryProperties.memoryHeaps[i].flags;
+			heapUsage.heapSize = memoryProperties.memoryHeaps[i].size;
+		}
+
+		for (const MemoryBlock& block : memoryAllocator.blocks)
+		{
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+
+			MemoryHeapUsage& heapUsage = heapUsages[TO_SIZE_T(memoryProperties.memoryTypes[block.memoryType].heapIndex)];
+			heapUsage.blockSize += block.size;
+			heapUsage.usedSize += block.usedSize;
+			heapUsage.blockCount++;
+			heapUsage.allocationCount += block.allocationCount;
+		}
+	}
+
+	void RHI::GetMemoryCategoryUsages(std::vector<MemoryCategoryUsage>& categoryUsages) const noexcept
+	{
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = memoryAllocator.memoryProperties;
+
+		categoryUsages.assign(TO_SIZE_T(MemoryCategory::MEMORY_CATEGORY_COUNT), {});
+
+		for (const MemoryAllocationRecord& record : memoryAllocator.records)
+		{
+			if (record.isAlive == false)
+				continue;
+
+			MemoryCategoryUsage& categoryUsage = categoryUsages[TO_SIZE_T(record.category)];
+			categoryUsage.usedSize += record.size;
+			categoryUsage.allocationCount++;
+
+			const VkMemoryType& memoryType = memoryProperties.memoryTypes[record.memoryType];
+
+			if (memoryProperties.memoryHeaps[memoryType.heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+				categoryUsage.deviceLocalSize += record.size;
+
+			if (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+				categoryUsage.hostVisibleSize += record.size;
+		}
+	}
+
+	const std::vector<MemoryAllocationRecord>& RHI::GetMemoryAllocationRecords() const noexcept
+	{
+		return memoryAllocator.records;
+	}
+
+	bool RHI::DumpMemoryReport(const std::string& filePath) const noexcept
+	{
+		std::ofstream file(filePath, std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to open memory report file ", filePath);
+			return false;
+		}
+
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = memoryAllocator.memoryProperties;
+
+		std::vector<MemoryHeapUsage> heapUsages;
+		GetMemoryHeapUsages(heapUsages);
+
+		std::vector<MemoryCategoryUsage> categoryUsages;
+		GetMemoryCategoryUsages(categoryUsages);
+
+		file << "{\n\t\"heaps\": [";
+
+		for (size_t i = 0, heapCount = heapUsages.size(); i < heapCount; i++)
+		{
+			const MemoryHeapUsage& heapUsage = heapUsages[i];
+
+			file << (i == 0 ? "\n" : ",\n");
+			file << "\t\t{ \"index\": " << i
+				<< ", \"deviceLocal\": " << ((heapUsage.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+				<< ", \"heapSize\": " << heapUsage.heapSize
+				<< ", \"blockSize\": " << heapUsage.blockSize
+				<< ", \"usedSize\": " << heapUsage.usedSize
+				<< ", \"blockCount\": " << heapUsage.blockCount
+				<< ", \"allocationCount\": " << heapUsage.allocationCount << " }";
+		}
+
+		file << "\n\t],\n\t\"categories\": [";
+
+		for (size_t i = 0, categoryCount = categoryUsages.size(); i < categoryCount; i++)
+		{
+			const MemoryCategoryUsage& categoryUsage = categoryUsages[i];
+
+			file << (i == 0 ? "\n" : ",\n");
+			file << "\t\t{ \"name\": \"" << GetMemoryCategoryName(static_cast<MemoryCategory>(i)) << "\""
+				<< ", \"usedSize\": " << categoryUsage.usedSize
+				<< ", \"deviceLocalSize\": " << categoryUsage.deviceLocalSize
+				<< ", \"hostVisibleSize\": " << categoryUsage.hostVisibleSize
+				<< ", \"allocationCount\": " << categoryUsage.allocationCount << " }";
+		}
+
+		file << "\n\t],\n\t\"allocations\": [";
+
+		bool isFirstRecord = true;
+
+		for (const MemoryAllocationRecord& record : memoryAllocator.records)
+		{
+			if (record.isAlive == false)
+				continue;
+
+			// Debug names are engine or file paths, only backslashes and quotes need escaping
+			std::string debugName;
+			debugName.reserve(record.debugName.size());
+
+			for (char c : record.debugName)
+			{
+				if (c == '\\' || c == '"')
+					debugName.push_back('\\');
+
+				debugName.push_back(c);
+			}
+
+			file << (isFirstRecord ? "\n" : ",\n");
+			file << "\t\t{ \"name\": \"" << debugName << "\""
+				<< ", \"category\": \"" << GetMemoryCategoryName(record.category) << "\""
+				<< ", \"heap\": " << memoryProperties.memoryTypes[record.memoryType].heapIndex
+				<< ", \"size\": " << record.size << " }";
+
+			isFirstRecord = false;
+		}
+
+		file << "\n\t]\n}\n";
+
+		file.close();
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Memory report written to ", filePath);
+
+		return true;
+	}
+
+	uint32_t RHI::CreateMemoryBlock(uint32_t memoryType, VkDeviceSize size, bool isLinear, bool isDedicated) noexcept
+	{
+		VkMemoryAllocateInfo memoryAI = {};
+		memoryAI.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAI.allocationSize = size;
+		memoryAI.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory;
+		VkResult result = vkAllocateMemory(device, &memoryAI, nullptr, &memory);
+
+		if (result != VK_SUCCESS)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate a device memory block");
+			return UINT32_MAX;
+		}
+
+		// Reuse the slot of a released dedicated block so allocation block indices stay valid
+
+		size_t blockIndex = 0;
+		size_t blockCount = memoryAllocator.blocks.size();
+
+		while (blockIndex < blockCount && memoryAllocator.blocks[blockIndex].memory != VK_NULL_HANDLE)
+			blockIndex++;
+
+		if (blockIndex == blockCount)
+			memoryAllocator.blocks.resize(blockCount + 1);
+
+		MemoryBlock& block = memoryAllocator.blocks[blockIndex];
+		block.memory = memory;
+		block.size = size;
+		block.usedSize = 0;
+		block.memoryType = memoryType;
+		block.allocationCount = 0;
+		block.isLinear = isLinear;
+		block.isDedicated = isDedicated;
+		block.mappedData = nullptr;
+		block.freeRanges = { { 0, size } };
+
+		// Host visible blocks stay mapped for their whole lifetime
+
+		if (memoryAllocator.memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			CHECK_VK(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &block.mappedData));
+
+		return TO_UINT32_T(blockIndex);
+	}
+
+	bool RHI::SubAllocateMemoryBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) noexcept
+	{
+		std::vector<MemoryRange>& freeRanges = block.freeRanges;
+
+		for (size_t i = 0, freeRangeCount = freeRanges.size(); i < freeRangeCount; i++)
+		{
+			MemoryRange& freeRange = freeRanges[i];
+
+			VkDeviceSize alignedOffset = (freeRange.offset + alignment - 1) / alignment * alignment;
+			VkDeviceSize padding = alignedOffset - freeRange.offset;
+
+			if (freeRange.size < padding + size)
+				continue;
+
+			VkDeviceSize remainingSize = freeRange.size - padding - size;
+
+			// Keep the alignment padding and the tail of the range in the free list
+
+			if (padding > 0 && remainingSize > 0)
+			{
+				freeRange.size = padding;
+				freeRanges.insert(freeRanges.begin() + i + 1, { alignedOffset + size, remainingSize });
+			}
+			else if (padding > 0)
+			{
+				freeRange.size = padding;
+			}
+			else if (remainingSize > 0)
+			{
+				freeRange.offset = alignedOffset + size;
+				freeRange.size = remainingSize;
+			}
+			else
+			{
+				freeRanges.erase(freeRanges.begin() + i);
+			}
+
+			block.usedSize += size;
+			block.allocationCount++;
+
+			offset = alignedOffset;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void RHI::DestroyMemoryBlock(MemoryBlock& block) noexcept
+	{
+		if (block.mappedData != nullptr)
+			vkUnmapMemory(device, block.memory);
+
+		vkFreeMemory(device, block.memory, nullptr);
+
+		block.memory = VK_NULL_HANDLE;
+		block.mappedData = nullptr;
+		block.freeRanges.clear();
+	}
+
+	void RHI::DestroyMemoryAllocator() noexcept
+	{
+		for (MemoryBlock& block : memoryAllocator.blocks)
+		{
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+
+#ifdef _DEBUG
+			if (block.allocationCount != 0)
+				Logger::Log(LogLevel::LOG_LEVEL_WARNING, "Memory block released with live allocations");
+#endif // _DEBUG
+
+			DestroyMemoryBlock(block);
+		}
+
+		memoryAllocator.blocks.clear();
+		memoryAllocator.records.clear();
+		memoryAllocator.freeRecordIndices.clear();
+	}
+
+} // namespace lux::rhi
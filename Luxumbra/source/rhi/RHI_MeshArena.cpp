@@ -0,0 +1,348 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace lux::rhi
+{
+
+	MeshArena::MeshArena() noexcept
+		: isDeviceLocal(true), vertexBuffer(), indexBuffer(), vertexCapacity(0), indexCapacity(0), freeVertexRanges(0), freeIndexRanges(0), meshes(0),
+		freeMeshIndices(0), meshIndexCount(0)
+	{
+
+	}
+
+	void RHI::InitMeshArena() noexcept
+	{
+		CreateMeshArenaBuffers(MESH_ARENA_VERTEX_CAPACITY, MESH_ARENA_INDEX_CAPACITY);
+	}
+
+	bool RHI::GetIsMeshArenaDeviceLocal() const noexcept
+	{
+		return meshArena.isDeviceLocal;
+	}
+
+	void RHI::SetIsMeshArenaDeviceLocal(bool isDeviceLocal) noexcept
+	{
+		// The arena buffers are created by Initialize
+		ASSERT(isInitialized == false);
+
+		meshArena.isDeviceLocal = isDeviceLocal;
+	}
+
+	bool RHI::CreateMeshGeometry(resource::Mesh& mesh, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) noexcept
+	{
+		// The mesh index is packed in the draw keys, meshes sharing its key bits would be drawn as one
+		if (meshArena.freeMeshIndices.empty() && meshArena.meshIndexCount >= (1u << RENDER_QUEUE_MESH_BITS))
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to create mesh geometry, the draw keys hold at most ", 1u << RENDER_QUEUE_MESH_BITS, " meshes");
+			return false;
+		}
+
+		uint32_t vertexCount = TO_UINT32_T(vertices.size());
+		uint32_t indexCount = TO_UINT32_T(indices.size());
+
+		uint32_t vertexOffset = 0;
+		uint32_t firstIndex = 0;
+
+		bool allocated = AllocateMeshArenaRange(meshArena.freeVertexRanges, vertexCount, vertexOffset);
+
+		if (allocated && AllocateMeshArenaRange(meshArena.freeIndexRanges, indexCount, firstIndex) == false)
+		{
+			FreeMeshArenaRange(meshArena.freeVertexRanges, vertexOffset, vertexCount);
+			allocated = false;
+		}
+
+		// Pack the live meshes at the start of the arena, growing it if it is still too small
+		if (allocated == false)
+		{
+			CompactMeshArena(vertexCount, indexCount);
+
+			allocated = AllocateMeshArenaRange(meshArena.freeVertexRanges, vertexCount, vertexOffset)
+				&& AllocateMeshArenaRange(meshArena.freeIndexRanges, indexCount, firstIndex);
+
+			if (allocated == false)
+			{
+				Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Failed to allocate mesh geometry in the mesh arena");
+				return false;
+			}
+		}
+
+		UpdateBuffer(meshArena.vertexBuffer, vertices.data(), sizeof(Vertex) * TO_SIZE_T(vertexOffset), sizeof(Vertex) * vertices.size());
+		UpdateBuffer(meshArena.indexBuffer, indices.data(), sizeof(uint32_t) * TO_SIZE_T(firstIndex), sizeof(uint32_t) * indices.size());
+
+		mesh.indexCount = indexCount;
+		mesh.firstIndex = firstIndex;
+		mesh.vertexOffset = static_cast<int32_t>(vertexOffset);
+		mesh.vertexCount = vertexCount;
+
+		if (meshArena.freeMeshIndices.empty())
+			mesh.meshIndex = meshArena.meshIndexCount++;
+		else
+		{
+			mesh.meshIndex = meshArena.freeMeshIndices.back();
+			meshArena.freeMeshIndices.pop_back();
+		}
+
+		meshArena.meshes.push_back(&mesh);
+
+		return true;
+	}
+
+	void RHI::DestroyMeshGeometry(resource::Mesh& mesh) noexcept
+	{
+		std::vector<resource::Mesh*>::iterator it = std::find(meshArena.meshes.begin(), meshArena.meshes.end(), &mesh);
+
+		if (it == meshArena.meshes.end())
+			return;
+
+		meshArena.meshes.erase(it);
+
+		FreeMeshArenaRange(meshArena.freeVertexRanges, TO_UINT32_T(mesh.vertexOffset), mesh.vertexCount);
+		FreeMeshArenaRange(meshArena.freeIndexRanges, mesh.firstIndex, mesh.indexCount);
+
+		meshArena.freeMeshIndices.push_back(mesh.meshIndex);
+
+		mesh.indexCount = 0;
+		mesh.firstIndex = 0;
+		mesh.vertexOffset = 0;
+		mesh.vertexCount = 0;
+		mesh.meshIndex = 0;
+	}
+
+	void RHI::BindMeshArena(VkCommandBuffer commandBuffer) const noexcept
+	{
+		VkDeviceSize vertexBufferOffsets[] = { 0 };
+
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &meshArena.vertexBuffer.buffer, vertexBufferOffsets);
+		vkCmdBindIndexBuffer(commandBuffer, meshArena.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void RHI::CreateMeshArenaBuffers(uint32_t vertexCapacity, uint32_t indexCapacity) noexcept
+	{
+		meshArena.vertexCapacity = vertexCapacity;
+		meshArena.indexCapacity = indexCapacity;
+
+		VkMemoryPropertyFlags memoryProperty = meshArena.isDeviceLocal ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		BufferCreateInfo vertexBufferCI = {};
+		vertexBufferCI.usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		vertexBufferCI.size = sizeof(Vertex) * TO_SIZE_T(vertexCapacity);
+		vertexBufferCI.memoryProperty = memoryProperty;
+		vertexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		vertexBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_MESH;
+		vertexBufferCI.debugName = "Mesh Arena Vertices";
+
+		BufferCreateInfo indexBufferCI = {};
+		indexBufferCI.usageFlags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		indexBufferCI.size = sizeof(uint32_t) * TO_SIZE_T(indexCapacity);
+		indexBufferCI.memoryProperty = memoryProperty;
+		indexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		indexBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_MESH;
+		indexBufferCI.debugName = "Mesh Arena Indices";
+
+		CreateBuffer(vertexBufferCI, meshArena.vertexBuffer);
+		CreateBuffer(indexBufferCI, meshArena.indexBuffer);
+
+		meshArena.freeVertexRanges = { { 0, vertexCapacity } };
+		meshArena.freeIndexRanges = { { 0, indexCapacity } };
+	}
+
+	bool RHI::AllocateMeshArenaRange(std::vector<MeshArenaRange>& freeRanges, uint32_t count, uint32_t& offset) noexcept
+	{
+		if (count == 0)
+		{
+			offset = 0;
+			return true;
+		}
+
+		for (size_t i = 0, freeRangeCount = freeRanges.size(); i < freeRangeCount; i++)
+		{
+			MeshArenaRange& freeRange = freeRanges[i];
+
+			if (freeRange.count < count)
+				continue;
+
+			offset = freeRange.offset;
+
+			if (freeRange.count == count)
+			{
+				freeRanges.erase(freeRanges.begin() + i);
+			}
+			else
+			{
+				freeRange.offset += count;
+				freeRange.count -= count;
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void RHI::FreeMeshArenaRange(std::vector<MeshArenaRange>& freeRanges, uint32_t offset, uint32_t count) noexcept
+	{
+		if (count == 0)
+			return;
+
+		// Insert the range back in the offset-sorted free list and merge it with its neighbours
+
+		size_t insertIndex = 0;
+		size_t freeRangeCount = freeRanges.size();
+
+		while (insertIndex < freeRangeCount && freeRanges[insertIndex].offset < offset)
+			insertIndex++;
+
+		freeRanges.insert(freeRanges.begin() + insertIndex, { offset, count });
+
+		if (insertIndex + 1 < freeRanges.size() && freeRanges[insertIndex].offset + freeRanges[insertIndex].count == freeRanges[insertIndex + 1].offset)
+		{
+			freeRanges[insertIndex].count += freeRanges[insertIndex + 1].count;
+			freeRanges.erase(freeRanges.begin() + insertIndex + 1);
+		}
+
+		if (insertIndex > 0 && freeRanges[insertIndex - 1].offset + freeRanges[insertIndex - 1].count == freeRanges[insertIndex].offset)
+		{
+			freeRanges[insertIndex - 1].count += freeRanges[insertIndex].count;
+			freeRanges.erase(freeRanges.begin() + insertIndex);
+		}
+	}
+
+	void RHI::CompactMeshArena(uint32_t requiredVertexCount, uint32_t requiredIndexCount) noexcept
+	{
+		// The arena buffers may be in use by frames in flight
+		WaitIdle();
+
+		uint32_t usedVertexCount = 0;
+		uint32_t usedIndexCount = 0;
+
+		for (const resource::Mesh* mesh : meshArena.meshes)
+		{
+			usedVertexCount += mesh->vertexCount;
+			usedIndexCount += mesh->indexCount;
+		}
+
+		uint32_t vertexCapacity = meshArena.vertexCapacity;
+		while (usedVertexCount + requiredVertexCount > vertexCapacity)
+			vertexCapacity *= 2;
+
+		uint32_t indexCapacity = meshArena.indexCapacity;
+		while (usedIndexCount + requiredIndexCount > indexCapacity)
+			indexCapacity *= 2;
+
+		// Pack the live ranges into temporary buffers
+
+		BufferCreateInfo packedVertexBufferCI = {};
+		packedVertexBufferCI.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		packedVertexBufferCI.size = sizeof(Vertex) * TO_SIZE_T(std::max(usedVertexCount, 1u));
+		packedVertexBufferCI.memoryProperty = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		packedVertexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		packedVertexBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_STAGING;
+		packedVertexBufferCI.debugName = "Mesh Arena Packed Vertices";
+
+		BufferCreateInfo packedIndexBufferCI = {};
+		packedIndexBufferCI.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		packedIndexBufferCI.size = sizeof(uint32_t) * TO_SIZE_T(std::max(usedIndexCount, 1u));
+		packedIndexBufferCI.memoryProperty = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		packedIndexBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		packedIndexBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_STAGING;
+		packedIndexBufferCI.debugName = "Mesh Arena Packed Indices";
+
+		Buffer packedVertexBuffer;
+		Buffer packedIndexBuffer;
+		CreateBuffer(packedVertexBufferCI, packedVertexBuffer);
+		CreateBuffer(packedIndexBufferCI, packedIndexBuffer);
+
+		std::vector<VkBufferCopy> vertexCopies;
+		std::vector<VkBufferCopy> indexCopies;
+		vertexCopies.reserve(meshArena.meshes.size());
+		indexCopies.reserve(meshArena.meshes.size());
+
+		uint32_t packedVertexOffset = 0;
+		uint32_t packedIndexOffset = 0;
+
+		for (resource::Mesh* mesh : meshArena.meshes)
+		{
+			if (mesh->vertexCount > 0)
+			{
+				VkBufferCopy& vertexCopy = vertexCopies.emplace_back();
+				vertexCopy.srcOffset = sizeof(Vertex) * TO_SIZE_T(mesh->vertexOffset);
+				vertexCopy.dstOffset = sizeof(Vertex) * TO_SIZE_T(packedVertexOffset);
+				vertexCopy.size = sizeof(Vertex) * TO_SIZE_T(mesh->vertexCount);
+			}
+
+			if (mesh->indexCount > 0)
+			{
+				VkBufferCopy& indexCopy = indexCopies.emplace_back();
+				indexCopy.srcOffset = sizeof(uint32_t) * TO_SIZE_T(mesh->firstIndex);
+				indexCopy.dstOffset = sizeof(uint32_t) * TO_SIZE_T(packedIndexOffset);
+				indexCopy.size = sizeof(uint32_t) * TO_SIZE_T(mesh->indexCount);
+			}
+
+			// Indices are relative to vertexOffset, only the ranges move
+			mesh->vertexOffset = static_cast<int32_t>(packedVertexOffset);
+			mesh->firstIndex = packedIndexOffset;
+
+			packedVertexOffset += mesh->vertexCount;
+			packedIndexOffset += mesh->indexCount;
+		}
+
+		VkCommandBuffer commandBuffer = BeginSingleTimeCommandBuffer();
+
+		if (vertexCopies.empty() == false)
+			vkCmdCopyBuffer(commandBuffer, meshArena.vertexBuffer.buffer, packedVertexBuffer.buffer, TO_UINT32_T(vertexCopies.size()), vertexCopies.data());
+
+		if (indexCopies.empty() == false)
+			vkCmdCopyBuffer(commandBuffer, meshArena.indexBuffer.buffer, packedIndexBuffer.buffer, TO_UINT32_T(indexCopies.size()), indexCopies.data());
+
+		EndSingleTimeCommandBuffer(commandBuffer);
+
+		// Recreate the arena and copy the packed ranges back at its start
+
+		DestroyMeshArena();
+		CreateMeshArenaBuffers(vertexCapacity, indexCapacity);
+
+		commandBuffer = BeginSingleTimeCommandBuffer();
+
+		if (usedVertexCount > 0)
+		{
+			VkBufferCopy vertexCopy = {};
+			vertexCopy.size = sizeof(Vertex) * TO_SIZE_T(usedVertexCount);
+
+			vkCmdCopyBuffer(commandBuffer, packedVertexBuffer.buffer, meshArena.vertexBuffer.buffer, 1, &vertexCopy);
+		}
+
+		if (usedIndexCount > 0)
+		{
+			VkBufferCopy indexCopy = {};
+			indexCopy.size = sizeof(uint32_t) * TO_SIZE_T(usedIndexCount);
+
+			vkCmdCopyBuffer(commandBuffer, packedIndexBuffer.buffer, meshArena.indexBuffer.buffer, 1, &indexCopy);
+		}
+
+		EndSingleTimeCommandBuffer(commandBuffer);
+
+		DestroyBuffer(packedVertexBuffer);
+		DestroyBuffer(packedIndexBuffer);
+
+		uint32_t allocatedVertexOffset;
+		uint32_t allocatedIndexOffset;
+		AllocateMeshArenaRange(meshArena.freeVertexRanges, usedVertexCount, allocatedVertexOffset);
+		AllocateMeshArenaRange(meshArena.freeIndexRanges, usedIndexCount, allocatedIndexOffset);
+
+		Logger::Log(LogLevel::LOG_LEVEL_INFO, "Mesh arena compacted");
+	}
+
+	void RHI::DestroyMeshArena() noexcept
+	{
+		DestroyBuffer(meshArena.vertexBuffer);
+		DestroyBuffer(meshArena.indexBuffer);
+
+		meshArena.freeVertexRanges.clear();
+		meshArena.freeIndexRanges.clear();
+	}
+
+} // namespace lux::rhi
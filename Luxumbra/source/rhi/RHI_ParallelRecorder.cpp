@@ -0,0 +1,174 @@
+#include "rhi/RHI.h"
+
+#include <algorithm>
+
+#include "CpuProfiler.h"
+
+namespace lux::rhi
+{
+
+	RecordingThreadContext::RecordingThreadContext() noexcept
+		: commandPools(), commandBuffers(), usedCommandBufferCount(0)
+	{
+
+	}
+
+	ParallelRecorder::ParallelRecorder() noexcept
+		: jobSystem(nullptr), threadContexts(), tasks(0), nextTaskIndex(0), lastRecordingTime(0.f)
+	{
+
+	}
+
+	void RHI::InitParallelRecorder(JobSystem& jobSystem) noexcept
+	{
+		parallelRecorder.jobSystem = &jobSystem;
+
+		VkCommandPoolCreateInfo commandPoolCI = {};
+		commandPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCI.queueFamilyIndex = presentQueueIndex;
+		commandPoolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		uint32_t maxThreadCount = jobSystem.GetMaxThreadCount();
+
+		for (uint32_t i = 0; i < maxThreadCount; i++)
+		{
+			RecordingThreadContext& context = parallelRecorder.threadContexts[TO_SIZE_T(i)];
+
+			for (size_t j = 0; j < MAX_FRAMES_IN_FLIGHT; j++)
+			{
+				CHECK_VK(vkCreateCommandPool(device, &commandPoolCI, nullptr, &context.commandPools[j]));
+			}
+		}
+	}
+
+	float RHI::GetLastRecordingTime() const noexcept
+	{
+		return parallelRecorder.lastRecordingTime;
+	}
+
+	void RHI::BeginParallelRecordingFrame() noexcept
+	{
+		// The frame fence was waited on, every secondary command buffer of this frame can be recycled
+		uint32_t maxThreadCount = parallelRecorder.jobSystem->GetMaxThreadCount();
+
+		for (uint32_t i = 0; i < maxThreadCount; i++)
+		{
+			RecordingThreadContext& context = parallelRecorder.threadContexts[TO_SIZE_T(i)];
+
+			CHECK_VK(vkResetCommandPool(device, context.commandPools[currentFrame], 0));
+			context.usedCommandBufferCount = 0;
+		}
+
+		parallelRecorder.tasks.clear();
+	}
+
+	size_t RHI::AddRecordingTask(VkRenderPass renderPass, VkFramebuffer framebuffer, std::function<void(VkCommandBuffer)>&& record) noexcept
+	{
+		parallelRecorder.tasks.push_back({ renderPass, framebuffer, std::move(record), VK_NULL_HANDLE });
+
+		return parallelRecorder.tasks.size() - 1;
+	}
+
+	void RHI::ExecuteRecordingTasks() noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		parallelRecorder.nextTaskIndex = 0;
+
+		JobSystem& jobSystem = *parallelRecorder.jobSystem;
+
+		// One job per thread, each one pulls tasks until none is left and records them with its thread's command pool
+		size_t jobCount = std::min(TO_SIZE_T(jobSystem.GetThreadCount()), parallelRecorder.tasks.size());
+
+		JobCounter recordingCounter;
+
+		for (size_t i = 0; i < jobCount; i++)
+			jobSystem.Run([this]() { RunRecordingTasks(JobSystem::GetCurrentThreadIndex()); }, recordingCounter);
+
+		// The render thread records too instead of waiting idle
+		jobSystem.Wait(recordingCounter);
+	}
+
+	void RHI::CommandExecuteRecordingTasks(VkCommandBuffer commandBuffer, size_t firstTaskIndex, size_t taskCount) const noexcept
+	{
+		if (taskCount == 0)
+			return;
+
+		std::vector<VkCommandBuffer> secondaryCommandBuffers(taskCount);
+
+		for (size_t i = 0; i < taskCount; i++)
+		{
+			secondaryCommandBuffers[i] = parallelRecorder.tasks[firstTaskIndex + i].commandBuffer;
+			ASSERT(secondaryCommandBuffers[i] != VK_NULL_HANDLE);
+		}
+
+		vkCmdExecuteCommands(commandBuffer, TO_UINT32_T(taskCount), secondaryCommandBuffers.data());
+	}
+
+	void RHI::RunRecordingTasks(uint32_t threadIndex) noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		RecordingThreadContext& context = parallelRecorder.threadContexts[TO_SIZE_T(threadIndex)];
+		std::vector<VkCommandBuffer>& commandBuffers = context.commandBuffers[currentFrame];
+
+		size_t taskCount = parallelRecorder.tasks.size();
+
+		for (size_t taskIndex = parallelRecorder.nextTaskIndex++; taskIndex < taskCount; taskIndex = parallelRecorder.nextTaskIndex++)
+		{
+			RecordingTask& task = parallelRecorder.tasks[taskIndex];
+
+			if (context.usedCommandBufferCount == commandBuffers.size())
+			{
+				VkCommandBufferAllocateInfo commandBufferAI = {};
+				commandBufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				commandBufferAI.commandPool = context.commandPools[currentFrame];
+				commandBufferAI.commandBufferCount = 1;
+				commandBufferAI.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+				VkCommandBuffer newCommandBuffer;
+				CHECK_VK(vkAllocateCommandBuffers(device, &commandBufferAI, &newCommandBuffer));
+
+				commandBuffers.push_back(newCommandBuffer);
+			}
+
+			task.commandBuffer = commandBuffers[context.usedCommandBufferCount++];
+
+			VkCommandBufferInheritanceInfo inheritanceInfo = {};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = task.renderPass;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = task.framebuffer;
+
+			VkCommandBufferBeginInfo commandBufferBI = {};
+			commandBufferBI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			commandBufferBI.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			commandBufferBI.pInheritanceInfo = &inheritanceInfo;
+
+			CHECK_VK(vkBeginCommandBuffer(task.commandBuffer, &commandBufferBI));
+
+			task.record(task.commandBuffer);
+
+			CHECK_VK(vkEndCommandBuffer(task.commandBuffer));
+		}
+	}
+
+	void RHI::DestroyParallelRecorder() noexcept
+	{
+		uint32_t maxThreadCount = parallelRecorder.jobSystem->GetMaxThreadCount();
+
+		for (uint32_t i = 0; i < maxThreadCount; i++)
+		{
+			RecordingThreadContext& context = parallelRecorder.threadContexts[TO_SIZE_T(i)];
+
+			for (size_t j = 0; j < MAX_FRAMES_IN_FLIGHT; j++)
+			{
+				vkDestroyCommandPool(device, context.commandPools[j], nullptr);
+				context.commandBuffers[j].clear();
+			}
+		}
+
+		parallelRecorder.tasks.clear();
+	}
+
+} // namespace lux::rhi
@@ -0,0 +1,202 @@
+#include "rhi/RHI.h"
+
+#include <array>
+#include <algorithm>
+
+#include "CpuProfiler.h"
+
+namespace lux::rhi
+{
+
+	RenderQueue::RenderQueue() noexcept
+		: items(0), sortScratch(0), opaqueItemCount(0), batches(0), opaqueBatchCount(0), depthPrepassBatchCount(0), firstDrawCommand(0)
+	{
+
+	}
+
+	bool RHI::GetIsCpuCullingEnabled() const noexcept
+	{
+		return isCpuCullingEnabled;
+	}
+
+	void RHI::SetIsCpuCullingEnabled(bool isEnabled) noexcept
+	{
+		isCpuCullingEnabled = isEnabled;
+	}
+
+	// Stable LSD radix sort on the draw keys
+	static void SortRenderQueue(RenderQueue& renderQueue) noexcept
+	{
+		size_t itemCount = renderQueue.items.size();
+
+		if (itemCount < 2)
+			return;
+
+		renderQueue.sortScratch.resize(itemCount);
+
+		// One read of the keys builds the histograms of every digit
+		std::array<std::array<uint32_t, RENDER_QUEUE_RADIX_SIZE>, RENDER_QUEUE_RADIX_PASS_COUNT> histograms = {};
+
+		for (const RenderQueueItem& item : renderQueue.items)
+		{
+			for (size_t pass = 0; pass < RENDER_QUEUE_RADIX_PASS_COUNT; pass++)
+				histograms[pass][TO_SIZE_T((item.key >> (pass * RENDER_QUEUE_RADIX_BITS)) & (RENDER_QUEUE_RADIX_SIZE - 1))]++;
+		}
+
+		for (size_t pass = 0; pass < RENDER_QUEUE_RADIX_PASS_COUNT; pass++)
+		{
+			std::array<uint32_t, RENDER_QUEUE_RADIX_SIZE>& histogram = histograms[pass];
+			size_t shift = pass * RENDER_QUEUE_RADIX_BITS;
+
+			// A digit shared by every key would leave the order unchanged
+			if (TO_SIZE_T(histogram[TO_SIZE_T((renderQueue.items[0].key >> shift) & (RENDER_QUEUE_RADIX_SIZE - 1))]) == itemCount)
+				continue;
+
+			uint32_t offset = 0;
+			for (uint32_t& count : histogram)
+			{
+				uint32_t digitCount = count;
+				count = offset;
+				offset += digitCount;
+			}
+
+			for (const RenderQueueItem& item : renderQueue.items)
+				renderQueue.sortScratch[TO_SIZE_T(histogram[TO_SIZE_T((item.key >> shift) & (RENDER_QUEUE_RADIX_SIZE - 1))]++)] = item;
+
+			renderQueue.items.swap(renderQueue.sortScratch);
+		}
+	}
+
+	void RHI::BuildRenderQueue(RenderQueue& renderQueue, const scene::CameraNode* camera, const std::vector<scene::MeshNode*>& meshes) const noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		renderQueue.items.clear();
+		renderQueue.opaqueItemCount = 0;
+
+		glm::mat4 view = camera->GetViewTransform();
+
+		const float maxDepth = TO_FLOAT((1 << RENDER_QUEUE_DEPTH_BITS) - 1);
+		float depthScale = maxDepth / camera->GetFarDistance();
+
+		for (const scene::MeshNode* meshNode : meshes)
+		{
+			const resource::Material& material = meshNode->GetMaterial();
+			const resource::Mesh& mesh = meshNode->GetMesh();
+
+			// The draw loops rebind on key changes, CreateMaterial and CreateMeshGeometry keep the indices within their key bits
+			ASSERT(material.materialIndex < (1u << RENDER_QUEUE_MATERIAL_BITS));
+			ASSERT(mesh.meshIndex < (1u << RENDER_QUEUE_MESH_BITS));
+
+			// View space depth of the node origin
+			float viewDepth = -(view * meshNode->GetCachedWorldTransform()[3]).z;
+			uint64_t depth = static_cast<uint64_t>(std::clamp(viewDepth * depthScale, 0.f, maxDepth));
+
+			uint64_t pass = material.isTransparent ? RENDER_QUEUE_PASS_TRANSPARENT : RENDER_QUEUE_PASS_OPAQUE;
+			uint64_t pipeline = RENDER_QUEUE_PIPELINE_OPAQUE;
+
+			if (material.isTransparent)
+				pipeline = RENDER_QUEUE_PIPELINE_TRANSPARENT;
+			else if (material.isAlphaTested)
+				pipeline = RENDER_QUEUE_PIPELINE_ALPHA_TESTED;
+
+			uint64_t key = (pass << RENDER_QUEUE_PASS_SHIFT) | (pipeline << RENDER_QUEUE_PIPELINE_SHIFT);
+
+			if (material.isTransparent)
+			{
+				// The farthest items come first
+				uint64_t invertedDepth = static_cast<uint64_t>(maxDepth) - depth;
+
+				key |= (invertedDepth << RENDER_QUEUE_TRANSPARENT_DEPTH_SHIFT)
+					| (static_cast<uint64_t>(material.materialIndex) << RENDER_QUEUE_TRANSPARENT_MATERIAL_SHIFT)
+					| (static_cast<uint64_t>(mesh.meshIndex) << RENDER_QUEUE_TRANSPARENT_MESH_SHIFT);
+			}
+			else
+			{
+				key |= (static_cast<uint64_t>(material.materialIndex) << RENDER_QUEUE_MATERIAL_SHIFT)
+					| (static_cast<uint64_t>(mesh.meshIndex) << RENDER_QUEUE_MESH_SHIFT)
+					| (depth << RENDER_QUEUE_DEPTH_SHIFT);
+			}
+
+			renderQueue.items.push_back({ key, meshNode });
+
+			if (material.isTransparent == false)
+				renderQueue.opaqueItemCount++;
+		}
+
+		SortRenderQueue(renderQueue);
+	}
+
+	void RHI::BuildShadowRenderQueue(RenderQueue& renderQueue, const std::vector<scene::MeshNode*>& meshes) const noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		renderQueue.items.clear();
+
+		// Shadow casters only differ by their mesh, every light view filters this queue into its own batches
+		for (const scene::MeshNode* meshNode : meshes)
+		{
+			if (meshNode->GetIsCastingShadow() == false)
+				continue;
+
+			const resource::Mesh& mesh = meshNode->GetMesh();
+
+			ASSERT(mesh.meshIndex < (1u << RENDER_QUEUE_MESH_BITS));
+
+			renderQueue.items.push_back({ static_cast<uint64_t>(mesh.meshIndex) << RENDER_QUEUE_MESH_SHIFT, meshNode });
+		}
+
+		renderQueue.opaqueItemCount = renderQueue.items.size();
+
+		SortRenderQueue(renderQueue);
+	}
+
+	void RHI::BuildRenderBatches(RenderQueue& renderQueue) noexcept
+	{
+		renderQueue.batches.clear();
+		renderQueue.opaqueBatchCount = 0;
+		renderQueue.depthPrepassBatchCount = 0;
+
+		std::vector<glm::mat4>& instances = instanceBuffer.instances;
+
+		for (size_t i = 0, itemCount = renderQueue.items.size(); i < itemCount; i++)
+		{
+			const RenderQueueItem& item = renderQueue.items[i];
+			bool isOpaque = i < renderQueue.opaqueItemCount;
+
+			// Sorted opaque items sharing pass, pipeline, material and mesh are adjacent,
+			// transparent items keep one draw each so their order is preserved
+			if (isOpaque && renderQueue.batches.empty() == false)
+			{
+				RenderBatch& lastBatch = renderQueue.batches.back();
+
+				if ((lastBatch.key >> RENDER_QUEUE_MESH_SHIFT) == (item.key >> RENDER_QUEUE_MESH_SHIFT))
+				{
+					instances.push_back(item.meshNode->GetCachedWorldTransform());
+					lastBatch.instanceCount++;
+					continue;
+				}
+			}
+
+			renderQueue.batches.push_back({ item.key, item.meshNode, TO_UINT32_T(instances.size()), 1 });
+			instances.push_back(item.meshNode->GetCachedWorldTransform());
+
+			if (isOpaque)
+				renderQueue.opaqueBatchCount++;
+
+			if (isOpaque && ((item.key >> RENDER_QUEUE_PIPELINE_SHIFT) & ((1ull << RENDER_QUEUE_PIPELINE_BITS) - 1)) == RENDER_QUEUE_PIPELINE_OPAQUE)
+				renderQueue.depthPrepassBatchCount++;
+		}
+
+		// One indirect draw record per batch, in batch order so consecutive batches are drawn by a single call
+		std::vector<VkDrawIndexedIndirectCommand>& commands = drawCommandBuffer.commands;
+		renderQueue.firstDrawCommand = TO_UINT32_T(commands.size());
+
+		for (const RenderBatch& batch : renderQueue.batches)
+		{
+			const resource::Mesh& mesh = batch.meshNode->GetMesh();
+			commands.push_back({ mesh.indexCount, batch.instanceCount, mesh.firstIndex, mesh.vertexOffset, batch.firstInstance });
+		}
+	}
+
+} // namespace lux::rhi
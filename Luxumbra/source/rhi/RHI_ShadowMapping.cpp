@@ -1,7 +1,9 @@
-#include "rhi\RHI.h"
+#include "rhi/RHI.h"
 
-#include "glm\glm.hpp"
-#include "glm\gtc\matrix_transform.hpp"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "CpuProfiler.h"
 
 namespace lux::rhi
 {
@@ -15,9 +17,9 @@ namespace lux::rhi
 		directionalShadowMappingPipelineCI(), pointShadowMappingPipelineCI(),
 		descriptorPool(VK_NULL_HANDLE),
 		directionalShadowMapIntermediate(), dummyDirectionalShadowMap(), directionalFramebuffer(VK_NULL_HANDLE), directionalShadowMaps(0),
-		directionalUniformBuffers(0), directionalUniformBufferDescriptorSets(0),
+		directionalViewProjDescriptorSet(VK_NULL_HANDLE),
 		pointShadowMapIntermediate(), dummyPointShadowMap(), pointFramebuffer(VK_NULL_HANDLE), pointShadowMaps(0),
-		pointUniformBuffers(0), pointUniformBufferDescriptorSets(0)
+		pointViewProjDescriptorSet(VK_NULL_HANDLE), passes(0), renderQueue(), casterBounds(), visibleCasterIndices(0), viewQueues(), viewQueueCount(0)
 	{
 
 	}
@@ -95,22 +97,18 @@ namespace lux::rhi
 		VkDescriptorSetLayoutBinding viewProjUniformBufferDescriptorSetLayoutBinding = {};
 		viewProjUniformBufferDescriptorSetLayoutBinding.binding = 0;
 		viewProjUniformBufferDescriptorSetLayoutBinding.descriptorCount = 1;
-		viewProjUniformBufferDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		viewProjUniformBufferDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		viewProjUniformBufferDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 		// Directional lights
 
-		VkPushConstantRange modelPushConstantRange = {};
-		modelPushConstantRange.offset = 0;
-		modelPushConstantRange.size = TO_UINT32_T(sizeof(ShadowMappingModelConstant));
-		modelPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
 		shadowMapper.directionalShadowMappingPipelineCI = {};
 		shadowMapper.directionalShadowMappingPipelineCI.renderPass = shadowMapper.directionalShadowMappingRenderPass;
 		shadowMapper.directionalShadowMappingPipelineCI.subpassIndex = 0;
 		shadowMapper.directionalShadowMappingPipelineCI.binaryVertexFilePath = "data/shaders/shadowMapping/directionalShadowMapping.vert.spv";
 		shadowMapper.directionalShadowMappingPipelineCI.cacheFilePath = "data/pipelineCache/directionalShadowMapping.bin";
 		shadowMapper.directionalShadowMappingPipelineCI.vertexLayout = VertexLayout::VERTEX_POSITION_ONLY_LAYOUT;
+		shadowMapper.directionalShadowMappingPipelineCI.enableInstancing = VK_TRUE;
 		shadowMapper.directionalShadowMappingPipelineCI.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 		shadowMapper.directionalShadowMappingPipelineCI.viewportWidth = DIRECTIONAL_SHADOW_MAP_TEXTURE_SIZE;
 		shadowMapper.directionalShadowMappingPipelineCI.viewportHeight = DIRECTIONAL_SHADOW_MAP_TEXTURE_SIZE;
@@ -124,17 +122,16 @@ namespace lux::rhi
 		shadowMapper.directionalShadowMappingPipelineCI.depthBiasSlopeFactor = 1.5f;
 		shadowMapper.directionalShadowMappingPipelineCI.depthCompareOp = VK_COMPARE_OP_LESS;
 		shadowMapper.directionalShadowMappingPipelineCI.viewDescriptorSetLayoutBindings = { viewProjUniformBufferDescriptorSetLayoutBinding };
-		shadowMapper.directionalShadowMappingPipelineCI.pushConstants = { modelPushConstantRange };
 		shadowMapper.directionalShadowMappingPipelineCI.dynamicStates = { VK_DYNAMIC_STATE_DEPTH_BIAS };
 
 		CreateGraphicsPipeline(shadowMapper.directionalShadowMappingPipelineCI, shadowMapper.directionalShadowMappingPipeline);
 
 		// Point lights
 
-		VkPushConstantRange modelAndVPIndexPushConstantRange = {};
-		modelAndVPIndexPushConstantRange.offset = 0;
-		modelAndVPIndexPushConstantRange.size = TO_UINT32_T(sizeof(ShadowMappingModelConstant) + sizeof(uint32_t));
-		modelAndVPIndexPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		VkPushConstantRange vpIndexPushConstantRange = {};
+		vpIndexPushConstantRange.offset = 0;
+		vpIndexPushConstantRange.size = TO_UINT32_T(sizeof(uint32_t));
+		vpIndexPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 		shadowMapper.pointShadowMappingPipelineCI = {};
 		shadowMapper.pointShadowMappingPipelineCI.renderPass = shadowMapper.pointShadowMappingRenderPass;
@@ -143,6 +140,7 @@ namespace lux::rhi
 		shadowMapper.pointShadowMappingPipelineCI.binaryFragmentFilePath = "data/shaders/shadowMapping/pointShadowMapping.frag.spv";
 		shadowMapper.pointShadowMappingPipelineCI.cacheFilePath = "data/pipelineCache/pointShadowMapping.bin";
 		shadowMapper.pointShadowMappingPipelineCI.vertexLayout = VertexLayout::VERTEX_POSITION_ONLY_LAYOUT;
+		shadowMapper.pointShadowMappingPipelineCI.enableInstancing = VK_TRUE;
 		shadowMapper.pointShadowMappingPipelineCI.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 		shadowMapper.pointShadowMappingPipelineCI.viewportWidth = POINT_SHADOW_MAP_TEXTURE_SIZE;
 		shadowMapper.pointShadowMappingPipelineCI.viewportHeight = POINT_SHADOW_MAP_TEXTURE_SIZE;
@@ -156,7 +154,7 @@ namespace lux::rhi
 		shadowMapper.pointShadowMappingPipelineCI.depthBiasSlopeFactor = 1.5f;
 		shadowMapper.pointShadowMappingPipelineCI.depthCompareOp = VK_COMPARE_OP_LESS;
 		shadowMapper.pointShadowMappingPipelineCI.viewDescriptorSetLayoutBindings = { viewProjUniformBufferDescriptorSetLayoutBinding };
-		shadowMapper.pointShadowMappingPipelineCI.pushConstants = { modelAndVPIndexPushConstantRange };
+		shadowMapper.pointShadowMappingPipelineCI.pushConstants = { vpIndexPushConstantRange };
 		shadowMapper.pointShadowMappingPipelineCI.dynamicStates = { VK_DYNAMIC_STATE_DEPTH_BIAS };
 
 		CreateGraphicsPipeline(shadowMapper.pointShadowMappingPipelineCI, shadowMapper.pointShadowMappingPipeline);
@@ -164,18 +162,17 @@ namespace lux::rhi
 
 	void RHI::InitShadowMapperDescriptorPool() noexcept
 	{
-		uint32_t lightMaxCount = DIRECTIONAL_LIGHT_MAX_COUNT + POINT_LIGHT_MAX_COUNT;
+		// One directional and one point light view proj set, lights are selected with dynamic offsets
 
 		VkDescriptorPoolSize shadowMappingUniformBuffersDescriptorPoolSize = {};
-		shadowMappingUniformBuffersDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		shadowMappingUniformBuffersDescriptorPoolSize.descriptorCount = lightMaxCount;
+		shadowMappingUniformBuffersDescriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		shadowMappingUniformBuffersDescriptorPoolSize.descriptorCount = 2;
 
 		VkDescriptorPoolCreateInfo descriptorPoolCI = {};
 		descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		descriptorPoolCI.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 		descriptorPoolCI.poolSizeCount = 1;
 		descriptorPoolCI.pPoolSizes = &shadowMappingUniformBuffersDescriptorPoolSize;
-		descriptorPoolCI.maxSets = lightMaxCount;
+		descriptorPoolCI.maxSets = 2;
 
 		CHECK_VK(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &shadowMapper.descriptorPool));
 	}
@@ -193,6 +190,8 @@ namespace lux::rhi
 		directionalShadowMapIntermediateCI.subresourceRangeLayerCount = 1;
 		directionalShadowMapIntermediateCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 		directionalShadowMapIntermediateCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		directionalShadowMapIntermediateCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+		directionalShadowMapIntermediateCI.debugName = "Directional Shadow Map Intermediate";
 
 		CreateImage(directionalShadowMapIntermediateCI, shadowMapper.directionalShadowMapIntermediate);
 
@@ -205,6 +204,8 @@ namespace lux::rhi
 		dummyDirectionalShadowMapCI.subresourceRangeLayerCount = 1;
 		dummyDirectionalShadowMapCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 		dummyDirectionalShadowMapCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		dummyDirectionalShadowMapCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+		dummyDirectionalShadowMapCI.debugName = "Dummy Directional Shadow Map";
 
 		CreateImage(dummyDirectionalShadowMapCI, shadowMapper.dummyDirectionalShadowMap);
 
@@ -222,8 +223,6 @@ namespace lux::rhi
 		CHECK_VK(vkCreateFramebuffer(device, &directionalFramebufferCI, nullptr, &shadowMapper.directionalFramebuffer));
 
 		shadowMapper.directionalShadowMaps.reserve(DIRECTIONAL_LIGHT_MAX_COUNT);
-		shadowMapper.directionalUniformBuffers.reserve(DIRECTIONAL_LIGHT_MAX_COUNT);
-		shadowMapper.directionalUniformBufferDescriptorSets.reserve(DIRECTIONAL_LIGHT_MAX_COUNT);
 
 		// Point lights
 
@@ -236,6 +235,8 @@ namespace lux::rhi
 		pointShadowMapIntermediateCI.subresourceRangeLayerCount = 1;
 		pointShadowMapIntermediateCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		pointShadowMapIntermediateCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		pointShadowMapIntermediateCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+		pointShadowMapIntermediateCI.debugName = "Point Shadow Map Intermediate";
 
 		CreateImage(pointShadowMapIntermediateCI, shadowMapper.pointShadowMapIntermediate);
 
@@ -248,6 +249,8 @@ namespace lux::rhi
 		pointShadowMapDepthCI.subresourceRangeLayerCount = 1;
 		pointShadowMapDepthCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 		pointShadowMapDepthCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+		pointShadowMapDepthCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+		pointShadowMapDepthCI.debugName = "Point Shadow Map Depth";
 
 		CreateImage(pointShadowMapDepthCI, shadowMapper.pointShadowMapDepth);
 
@@ -260,6 +263,8 @@ namespace lux::rhi
 		dummyPointShadowMapCI.subresourceRangeLayerCount = 6;
 		dummyPointShadowMapCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		dummyPointShadowMapCI.imageViewType = VK_IMAGE_VIEW_TYPE_CUBE;
+		dummyPointShadowMapCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+		dummyPointShadowMapCI.debugName = "Dummy Point Shadow Map";
 
 		CreateImage(dummyPointShadowMapCI, shadowMapper.dummyPointShadowMap);
 
@@ -279,8 +284,53 @@ namespace lux::rhi
 		CHECK_VK(vkCreateFramebuffer(device, &pointFramebufferCI, nullptr, &shadowMapper.pointFramebuffer));
 
 		shadowMapper.pointShadowMaps.reserve(POINT_LIGHT_MAX_COUNT);
-		shadowMapper.pointUniformBuffers.reserve(POINT_LIGHT_MAX_COUNT);
-		shadowMapper.pointUniformBufferDescriptorSets.reserve(POINT_LIGHT_MAX_COUNT);
+
+		// View proj descriptor sets, written every frame in the uniform ring buffer
+
+		std::array<VkDescriptorSetLayout, 2> viewProjDescriptorSetLayouts = 
+		{
+			shadowMapper.directionalShadowMappingPipeline.viewDescriptorSetLayout,
+			shadowMapper.pointShadowMappingPipeline.viewDescriptorSetLayout
+		};
+
+		VkDescriptorSetAllocateInfo descriptorSetAI = {};
+		descriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAI.descriptorPool = shadowMapper.descriptorPool;
+		descriptorSetAI.descriptorSetCount = TO_UINT32_T(viewProjDescriptorSetLayouts.size());
+		descriptorSetAI.pSetLayouts = viewProjDescriptorSetLayouts.data();
+
+		std::array<VkDescriptorSet, 2> viewProjDescriptorSets;
+		CHECK_VK(vkAllocateDescriptorSets(device, &descriptorSetAI, viewProjDescriptorSets.data()));
+
+		shadowMapper.directionalViewProjDescriptorSet = viewProjDescriptorSets[0];
+		shadowMapper.pointViewProjDescriptorSet = viewProjDescriptorSets[1];
+
+		VkDescriptorBufferInfo directionalViewProjDescriptorBufferInfo = {};
+		directionalViewProjDescriptorBufferInfo.buffer = uniformRingBuffer.buffer.buffer;
+		directionalViewProjDescriptorBufferInfo.offset = 0;
+		directionalViewProjDescriptorBufferInfo.range = sizeof(DirectionalShadowMappingViewProjUniform);
+
+		VkDescriptorBufferInfo pointViewProjDescriptorBufferInfo = {};
+		pointViewProjDescriptorBufferInfo.buffer = uniformRingBuffer.buffer.buffer;
+		pointViewProjDescriptorBufferInfo.offset = 0;
+		pointViewProjDescriptorBufferInfo.range = sizeof(PointShadowMappingViewProjUniform);
+
+		VkWriteDescriptorSet writeDirectionalViewProjDescriptorSet = {};
+		writeDirectionalViewProjDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDirectionalViewProjDescriptorSet.descriptorCount = 1;
+		writeDirectionalViewProjDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		writeDirectionalViewProjDescriptorSet.dstBinding = 0;
+		writeDirectionalViewProjDescriptorSet.dstArrayElement = 0;
+		writeDirectionalViewProjDescriptorSet.pBufferInfo = &directionalViewProjDescriptorBufferInfo;
+		writeDirectionalViewProjDescriptorSet.dstSet = shadowMapper.directionalViewProjDescriptorSet;
+
+		VkWriteDescriptorSet writePointViewProjDescriptorSet = writeDirectionalViewProjDescriptorSet;
+		writePointViewProjDescriptorSet.pBufferInfo = &pointViewProjDescriptorBufferInfo;
+		writePointViewProjDescriptorSet.dstSet = shadowMapper.pointViewProjDescriptorSet;
+
+		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets = { writeDirectionalViewProjDescriptorSet, writePointViewProjDescriptorSet };
+
+		vkUpdateDescriptorSets(device, TO_UINT32_T(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
 	void RHI::DestroyShadowMapper() noexcept
@@ -291,12 +341,8 @@ namespace lux::rhi
 		for (size_t i = 0; i < directionalLightCount; i++)
 		{
 			DestroyImage(shadowMapper.directionalShadowMaps[i]);
-			DestroyBuffer(shadowMapper.directionalUniformBuffers[i]);
 		}
 
-		if (directionalLightCount > 0)
-			vkFreeDescriptorSets(device, shadowMapper.descriptorPool, TO_UINT32_T(directionalLightCount), shadowMapper.directionalUniformBufferDescriptorSets.data());
-
 		vkDestroyFramebuffer(device, shadowMapper.directionalFramebuffer, nullptr);
 		DestroyImage(shadowMapper.directionalShadowMapIntermediate);
 		DestroyImage(shadowMapper.dummyDirectionalShadowMap);
@@ -311,12 +357,8 @@ namespace lux::rhi
 		for (size_t i = 0; i < pointLightCount; i++)
 		{
 			DestroyImage(shadowMapper.pointShadowMaps[i]);
-			DestroyBuffer(shadowMapper.pointUniformBuffers[i]);
 		}
 
-		if (pointLightCount > 0)
-			vkFreeDescriptorSets(device, shadowMapper.descriptorPool, TO_UINT32_T(pointLightCount), shadowMapper.pointUniformBufferDescriptorSets.data());
-
 		vkDestroyFramebuffer(device, shadowMapper.pointFramebuffer, nullptr);
 		DestroyImage(shadowMapper.pointShadowMapIntermediate);
 		DestroyImage(shadowMapper.pointShadowMapDepth);
@@ -351,45 +393,63 @@ namespace lux::rhi
 		shadowMapper.depthBiasSlopeFactor = newSlopeFactor;
 	}
 
-	void RHI::RenderShadowMaps(VkCommandBuffer commandBuffer, const std::vector<scene::LightNode*>& lights, const std::vector<scene::MeshNode*>& meshes) noexcept
+	void RHI::PrepareShadowMaps(const std::vector<scene::LightNode*>& lights, const std::vector<scene::MeshNode*>& meshes) noexcept
 	{
-		std::array<DirectionalLightBuffer, DIRECTIONAL_LIGHT_MAX_COUNT> directionalLightBuffer;
-		std::array<VkDescriptorImageInfo, DIRECTIONAL_LIGHT_MAX_COUNT> directionalShadowMapsImageDescriptorInfo;
+		CPU_PROFILE_FUNCTION();
 
-		std::array<PointLightBuffer, POINT_LIGHT_MAX_COUNT> pointLightBuffer;
-		std::array<VkDescriptorImageInfo, POINT_LIGHT_MAX_COUNT> pointShadowMapsImageDescriptorInfo;
+		// Lights are packed in scene order, each entry carries the resource index of its shadow map so the shadow map
+		// descriptors never change. A light without shadow map resources is lit without shadows
+		std::array<DirectionalLightBuffer, DIRECTIONAL_LIGHT_MAX_COUNT> directionalLightBuffer = {};
+		std::array<PointLightBuffer, POINT_LIGHT_MAX_COUNT> pointLightBuffer = {};
 
-		size_t directionalLightIndex = 0;
-		size_t pointLightIndex = 0;
+		size_t directionalLightCount = 0;
+		size_t pointLightCount = 0;
 
 		size_t lightCount = lights.size();
 		size_t meshCount = meshes.size();
 
-		VkDeviceSize vertexBufferOffsets[] = { 0 };
+		shadowMapper.passes.clear();
+		shadowMapper.viewQueueCount = 0;
+
+		BuildShadowRenderQueue(shadowMapper.renderQueue, meshes);
+
+		shadowMapper.casterBounds.Clear();
+		shadowMapper.casterBounds.Reserve(shadowMapper.renderQueue.items.size());
+
+		for (const RenderQueueItem& item : shadowMapper.renderQueue.items)
+			shadowMapper.casterBounds.Add(item.meshNode->GetMesh().aabb, item.meshNode->GetCachedWorldTransform());
 
 		for (size_t i = 0; i < lightCount; i++)
 		{
 			scene::LightNode* light = lights[i];
 
 			int16_t resourceIndex = light->GetShadowMappingResourceIndex();
-			if (resourceIndex == -1)
-				continue;
 
 			switch (light->GetType())
 			{
 
 			case scene::LightType::LIGHT_TYPE_DIRECTIONAL:
 			{
-				if (directionalLightIndex > DIRECTIONAL_LIGHT_MAX_COUNT)
+				if (directionalLightCount >= DIRECTIONAL_LIGHT_MAX_COUNT)
 					break;
 
-				DirectionalLightBuffer& lightBufferEntry = directionalLightBuffer[directionalLightIndex];
+				DirectionalLightBuffer& lightBufferEntry = directionalLightBuffer[directionalLightCount];
+				directionalLightCount++;
+
+				glm::mat4 lightTransform = glm::toMat4(light->GetWorldRotation());
+				glm::vec3 lightDir = glm::vec3(lightTransform * glm::vec4(0.f, 0.f, -1.f, 1.f));
+
+				lightBufferEntry.direction = lightDir;
+				lightBufferEntry.color = light->GetColor();
+				lightBufferEntry.shadowMapIndex = resourceIndex;
+
+				if (resourceIndex == -1)
+					break;
 
 				// Compute AABB in light space that bounds the entire scene
 
 				AABB lightAABB;
 
-				glm::mat4 lightTransform = glm::toMat4(light->GetWorldRotation());
 				glm::mat4 inverseLightTransform = glm::inverse(lightTransform);
 
 				for (size_t j = 0; j < meshCount; j++)
@@ -400,7 +460,7 @@ namespace lux::rhi
 						continue;
 
 
-					glm::mat4 localtoLightTransform = inverseLightTransform * meshNode->GetWorldTransform();
+					glm::mat4 localtoLightTransform = inverseLightTransform * meshNode->GetCachedWorldTransform();
 
 					AABB meshAABB = meshNode->GetMesh().aabb;
 
@@ -423,35 +483,119 @@ namespace lux::rhi
 
 				// Compute view from world to light space
 
-				glm::vec3 lightPos = (lightTransform * glm::vec4((lightAABB.min + lightAABB.max) * 0.5f, 1.0f)).xyz;
-				glm::vec3 lightDir = (lightTransform * glm::vec4(0.f, 0.f, -1.f, 1.f)).xyz;
+				glm::vec3 lightPos = glm::vec3(lightTransform * glm::vec4((lightAABB.min + lightAABB.max) * 0.5f, 1.0f));
 
 				glm::mat4 view = glm::lookAt(lightPos, lightPos + lightDir, glm::vec3(0.f, 1.f, 0.f));
 
 				glm::mat4 viewProj = proj * view;
 
-				// Update light UBO & descriptor
+				// Update light UBO
 
-				lightBufferEntry.direction = lightDir;
-				lightBufferEntry.color = light->GetColor();
 				lightBufferEntry.viewProj = viewProj;
 				lightBufferEntry.shadowMapTexelSize = 1.f / DIRECTIONAL_SHADOW_MAP_TEXTURE_SIZE;
 				lightBufferEntry.pcfExtent = 1.f;
 				lightBufferEntry.pcfKernelSize = lightBufferEntry.pcfExtent * 2.0f + 1.f;
 				lightBufferEntry.pcfKernelSize *= lightBufferEntry.pcfKernelSize;
 
-				VkDescriptorImageInfo& shadowMapDescriptorInfo = directionalShadowMapsImageDescriptorInfo[directionalLightIndex];
-				shadowMapDescriptorInfo.imageView = shadowMapper.directionalShadowMaps[resourceIndex].imageView;
-				shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-				shadowMapDescriptorInfo.sampler = forward.sampler;
-
 				// Update shadow mapping UBO
 
 				DirectionalShadowMappingViewProjUniform viewProjUniform;
 				viewProjUniform.viewProj = viewProj;
 
-				UpdateBuffer(shadowMapper.directionalUniformBuffers[resourceIndex], &viewProjUniform);
+				uint32_t viewProjUniformOffset = PushUniformData(&viewProjUniform, sizeof(DirectionalShadowMappingViewProjUniform));
+
+				const RenderQueue* viewQueue = &BuildShadowViewRenderQueue(viewProj);
+
+				// Render pass contents are recorded in parallel, the shadow batches outlive the recording
+
+				size_t taskIndex = AddRecordingTask(shadowMapper.directionalShadowMappingRenderPass, shadowMapper.directionalFramebuffer,
+					[this, viewProjUniformOffset, viewQueue](VkCommandBuffer secondaryCommandBuffer) { RecordDirectionalShadowMap(secondaryCommandBuffer, viewProjUniformOffset, *viewQueue); });
+
+				shadowMapper.passes.push_back({ scene::LightType::LIGHT_TYPE_DIRECTIONAL, resourceIndex, taskIndex });
+			}
+			break;
+
+			case scene::LightType::LIGHT_TYPE_POINT:
+			{
+				if (pointLightCount >= POINT_LIGHT_MAX_COUNT)
+					break;
+
+				PointLightBuffer& lightBufferEntry = pointLightBuffer[pointLightCount];
+
+				// Update light UBO
+
+				lightBufferEntry.position = light->GetWorldPosition();
+				lightBufferEntry.color = light->GetColor();
+				lightBufferEntry.radius = light->GetRadius();
+				lightBufferEntry.shadowMapIndex = resourceIndex;
+
+				lightClusterer.pointLights[pointLightCount] = glm::vec4(lightBufferEntry.position, lightBufferEntry.radius);
+				pointLightCount++;
+
+				if (resourceIndex == -1)
+					break;
+
+				// Update shadowMappingUBO
+
+				glm::vec3 lightPos = light->GetWorldPosition();
+
+				PointShadowMappingViewProjUniform viewProjUniformBuffer;
+				viewProjUniformBuffer.proj = glm::perspective(glm::radians(90.f), 1.f, 0.1f, light->GetRadius());;
+				viewProjUniformBuffer.proj[1][1] *= -1.f;
+
+				viewProjUniformBuffer.view[0] = glm::lookAt(lightPos, lightPos + glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f));
+				viewProjUniformBuffer.view[1] = glm::lookAt(lightPos, lightPos + glm::vec3(-1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f));
+				viewProjUniformBuffer.view[2] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 1.f));
+				viewProjUniformBuffer.view[3] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 0.f, -1.f));
+				viewProjUniformBuffer.view[4] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, -1.f, 0.f));
+				viewProjUniformBuffer.view[5] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, -1.f, 0.f));
+
+				uint32_t viewProjUniformOffset = PushUniformData(&viewProjUniformBuffer, sizeof(PointShadowMappingViewProjUniform));
+
+				// One recording task per cube face
+
+				size_t firstTaskIndex = parallelRecorder.tasks.size();
+
+				for (uint32_t face = 0; face < 6; face++)
+				{
+					// Each face only draws the casters inside its own frustum
+					const RenderQueue* viewQueue = &BuildShadowViewRenderQueue(viewProjUniformBuffer.proj * viewProjUniformBuffer.view[face]);
+
+					AddRecordingTask(shadowMapper.pointShadowMappingRenderPass, shadowMapper.pointFramebuffer,
+						[this, viewProjUniformOffset, face, viewQueue](VkCommandBuffer secondaryCommandBuffer) { RecordPointShadowMapFace(secondaryCommandBuffer, viewProjUniformOffset, face, *viewQueue); });
+				}
+
+				shadowMapper.passes.push_back({ scene::LightType::LIGHT_TYPE_POINT, resourceIndex, firstTaskIndex });
+			}
+			break;
+
+			default:
+				ASSERT(false);
+				break;
+			}
+		}
+
+		lightCountsPushConstant.directionalLightCount = TO_UINT32_T(directionalLightCount);
+		lightCountsPushConstant.pointLightCount = TO_UINT32_T(pointLightCount);
+		lightClusterer.pointLightCount = TO_UINT32_T(pointLightCount);
+
+		directionalLightUniformOffset = PushUniformData(directionalLightBuffer.data(), sizeof(DirectionalLightBuffer) * DIRECTIONAL_LIGHT_MAX_COUNT);
+		pointLightUniformOffset = PushUniformData(pointLightBuffer.data(), sizeof(PointLightBuffer) * POINT_LIGHT_MAX_COUNT);
+	}
+
+	void RHI::RenderShadowMaps(VkCommandBuffer commandBuffer) noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		for (const ShadowMapPass& pass : shadowMapper.passes)
+		{
+			int16_t resourceIndex = pass.resourceIndex;
 
+			switch (pass.lightType)
+			{
+
+			case scene::LightType::LIGHT_TYPE_DIRECTIONAL:
+			{
 				// Render shadow map
 
 				VkClearValue depthClearValue = {};
@@ -472,33 +616,12 @@ namespace lux::rhi
 				imageTransitionSubresourceRange.levelCount = 1;
 				imageTransitionSubresourceRange.baseMipLevel = 0;
 
-				// Render pass
-
-				vkCmdBeginRenderPass(commandBuffer, &shadowMappingRenderPassBI, VK_SUBPASS_CONTENTS_INLINE);
-
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.directionalShadowMappingPipeline.pipeline);
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.directionalShadowMappingPipeline.pipelineLayout, 0, 1, &shadowMapper.directionalUniformBufferDescriptorSets[resourceIndex], 0, nullptr);
-
-				vkCmdSetDepthBias(commandBuffer, shadowMapper.depthBiasConstantFactor, 0.f, shadowMapper.depthBiasSlopeFactor);
-
-				ShadowMappingModelConstant shadowMappingModelConstant = {};
-
-				for (size_t j = 0; j < meshCount; j++)
-				{
-					scene::MeshNode* meshNode = meshes[j];
-
-					if (meshNode->GetIsCastingShadow() == false)
-						continue;
-
+				uint32_t shadowScope = AddGpuTimestampScope("Directional Shadow " + std::to_string(resourceIndex));
+				CommandBeginGpuTimestamp(commandBuffer, shadowScope);
 
-					shadowMappingModelConstant.model = meshNode->GetWorldTransform();
-					vkCmdPushConstants(commandBuffer, shadowMapper.directionalShadowMappingPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, TO_UINT32_T(sizeof(ShadowMappingModelConstant)), &shadowMappingModelConstant);
+				vkCmdBeginRenderPass(commandBuffer, &shadowMappingRenderPassBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-					const resource::Mesh& mesh = meshNode->GetMesh();
-					vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer.buffer, vertexBufferOffsets);
-					vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-					vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, 0);
-				}
+				CommandExecuteRecordingTasks(commandBuffer, pass.firstTaskIndex, 1);
 
 				vkCmdEndRenderPass(commandBuffer);
 
@@ -595,45 +718,12 @@ namespace lux::rhi
 
 				//CommandTransitionImageLayout(commandBuffer, shadowMapper.directionalShadowMaps[resourceIndex].image, depthImageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
 
-				directionalLightIndex++;
+				CommandEndGpuTimestamp(commandBuffer, shadowScope);
 			}
 			break;
 
 			case scene::LightType::LIGHT_TYPE_POINT:
 			{
-				if (pointLightIndex > POINT_LIGHT_MAX_COUNT)
-					break;
-
-				PointLightBuffer& lightBufferEntry = pointLightBuffer[pointLightIndex];
-
-				// Update light UBO & descriptor
-
-				lightBufferEntry.position = light->GetWorldPosition();
-				lightBufferEntry.color = light->GetColor();
-				lightBufferEntry.radius = light->GetRadius();
-
-				VkDescriptorImageInfo& shadowMapDescriptorInfo = pointShadowMapsImageDescriptorInfo[pointLightIndex];
-				shadowMapDescriptorInfo.imageView = shadowMapper.pointShadowMaps[resourceIndex].imageView;
-				shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				shadowMapDescriptorInfo.sampler = forward.sampler;
-
-				// Update shadowMappingUBO
-
-				glm::vec3 lightPos = light->GetWorldPosition();
-
-				PointShadowMappingViewProjUniform viewProjUniformBuffer;
-				viewProjUniformBuffer.proj = glm::perspective(glm::radians(90.f), 1.f, 0.1f, light->GetRadius());;
-				viewProjUniformBuffer.proj[1][1] *= -1.f;
-
-				viewProjUniformBuffer.view[0] = glm::lookAt(lightPos, lightPos + glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f));
-				viewProjUniformBuffer.view[1] = glm::lookAt(lightPos, lightPos + glm::vec3(-1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f));
-				viewProjUniformBuffer.view[2] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 1.f));
-				viewProjUniformBuffer.view[3] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 0.f, -1.f));
-				viewProjUniformBuffer.view[4] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, -1.f, 0.f));
-				viewProjUniformBuffer.view[5] = glm::lookAt(lightPos, lightPos + glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, -1.f, 0.f));
-
-				UpdateBuffer(shadowMapper.pointUniformBuffers[resourceIndex], &viewProjUniformBuffer);
-
 				// Render shadow map
 
 				VkClearValue clearValues[2] = {};
@@ -681,33 +771,12 @@ namespace lux::rhi
 
 				for (uint32_t i = 0; i < 6; i++)
 				{
-					vkCmdBeginRenderPass(commandBuffer, &shadowMappingRenderPassBI, VK_SUBPASS_CONTENTS_INLINE);
-
-					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.pointShadowMappingPipeline.pipeline);
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.pointShadowMappingPipeline.pipelineLayout, 0, 1, &shadowMapper.pointUniformBufferDescriptorSets[resourceIndex], 0, nullptr);
-
-					vkCmdSetDepthBias(commandBuffer, shadowMapper.depthBiasConstantFactor, 0.f, shadowMapper.depthBiasSlopeFactor);
+					uint32_t faceScope = AddGpuTimestampScope("Point Shadow " + std::to_string(resourceIndex) + " Face " + std::to_string(i));
+					CommandBeginGpuTimestamp(commandBuffer, faceScope);
 
-					vkCmdPushConstants(commandBuffer, shadowMapper.pointShadowMappingPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, TO_UINT32_T(sizeof(ShadowMappingModelConstant)), sizeof(uint32_t), &i);
+					vkCmdBeginRenderPass(commandBuffer, &shadowMappingRenderPassBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-					ShadowMappingModelConstant shadowMappingModelConstant = {};
-
-					for (size_t j = 0; j < meshCount; j++)
-					{
-						scene::MeshNode* meshNode = meshes[j];
-
-						if (meshNode->GetIsCastingShadow() == false)
-							continue;
-
-
-						shadowMappingModelConstant.model = meshNode->GetWorldTransform();
-						vkCmdPushConstants(commandBuffer, shadowMapper.pointShadowMappingPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, TO_UINT32_T(sizeof(ShadowMappingModelConstant)), &shadowMappingModelConstant);
-
-						const resource::Mesh& mesh = meshNode->GetMesh();
-						vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer.buffer, vertexBufferOffsets);
-						vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-						vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, 0);
-					}
+					CommandExecuteRecordingTasks(commandBuffer, pass.firstTaskIndex + i, 1);
 
 					vkCmdEndRenderPass(commandBuffer);
 
@@ -715,11 +784,11 @@ namespace lux::rhi
 
 					vkCmdBlitImage(commandBuffer, shadowMapper.pointShadowMapIntermediate.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadowMapper.pointShadowMaps[resourceIndex].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blitRegion, VK_FILTER_NEAREST);
 					vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &blitBarrier);
+
+					CommandEndGpuTimestamp(commandBuffer, faceScope);
 				}
 
 				CommandTransitionImageLayout(commandBuffer, shadowMapper.pointShadowMaps[resourceIndex].image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 6);
-
-				pointLightIndex++;
 			}
 			break;
 
@@ -728,53 +797,68 @@ namespace lux::rhi
 				break;
 			}
 		}
+	}
+
+	RenderQueue& RHI::BuildShadowViewRenderQueue(const glm::mat4& viewProj) noexcept
+	{
+		if (shadowMapper.viewQueueCount == shadowMapper.viewQueues.size())
+			shadowMapper.viewQueues.emplace_back();
+
+		RenderQueue& viewQueue = shadowMapper.viewQueues[shadowMapper.viewQueueCount++];
+		const std::vector<RenderQueueItem>& casters = shadowMapper.renderQueue.items;
 
-		lightCountsPushConstant.directionalLightCount = TO_UINT32_T(directionalLightIndex);
-		lightCountsPushConstant.pointLightCount = TO_UINT32_T(pointLightIndex);
+		viewQueue.items.clear();
 
-		for (; directionalLightIndex < DIRECTIONAL_LIGHT_MAX_COUNT; directionalLightIndex++)
+		// The visible indices are increasing, the filtered items stay sorted by mesh
+		if (isCpuCullingEnabled)
 		{
-			VkDescriptorImageInfo& shadowMapDescriptorInfo = directionalShadowMapsImageDescriptorInfo[directionalLightIndex];
-			shadowMapDescriptorInfo.imageView = shadowMapper.dummyDirectionalShadowMap.imageView;
-			shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-			shadowMapDescriptorInfo.sampler = forward.sampler;
-		}
+			CullBounds(Frustum(viewProj), shadowMapper.casterBounds, shadowMapper.visibleCasterIndices);
 
-		for (; pointLightIndex < POINT_LIGHT_MAX_COUNT; pointLightIndex++)
+			for (uint32_t index : shadowMapper.visibleCasterIndices)
+				viewQueue.items.push_back(casters[index]);
+		}
+		else
 		{
-			VkDescriptorImageInfo& shadowMapDescriptorInfo = pointShadowMapsImageDescriptorInfo[pointLightIndex];
-			shadowMapDescriptorInfo.imageView = shadowMapper.dummyPointShadowMap.imageView;
-			shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			shadowMapDescriptorInfo.sampler = forward.sampler;
+			viewQueue.items.assign(casters.begin(), casters.end());
 		}
 
-		UpdateBuffer(directionalLightUniformBuffers[currentFrame], directionalLightBuffer.data());
-		UpdateBuffer(pointLightUniformBuffers[currentFrame], pointLightBuffer.data());
-
-		VkWriteDescriptorSet writeDirectionalShadowMapsDescriptorSet = {};
-		writeDirectionalShadowMapsDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDirectionalShadowMapsDescriptorSet.descriptorCount = DIRECTIONAL_LIGHT_MAX_COUNT;
-		writeDirectionalShadowMapsDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writeDirectionalShadowMapsDescriptorSet.dstBinding = 3;
-		writeDirectionalShadowMapsDescriptorSet.dstArrayElement = 0;
-		writeDirectionalShadowMapsDescriptorSet.pImageInfo = directionalShadowMapsImageDescriptorInfo.data();
-		writeDirectionalShadowMapsDescriptorSet.dstSet = forward.rtViewDescriptorSets[currentFrame];
-
-		VkWriteDescriptorSet writePointShadowMapsDescriptorSet = {};
-		writePointShadowMapsDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writePointShadowMapsDescriptorSet.descriptorCount = POINT_LIGHT_MAX_COUNT;
-		writePointShadowMapsDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writePointShadowMapsDescriptorSet.dstBinding = 4;
-		writePointShadowMapsDescriptorSet.dstArrayElement = 0;
-		writePointShadowMapsDescriptorSet.pImageInfo = pointShadowMapsImageDescriptorInfo.data();
-		writePointShadowMapsDescriptorSet.dstSet = forward.rtViewDescriptorSets[currentFrame];
-
-		std::array<VkWriteDescriptorSet, 2> descriptorSetWrites = {
-			writeDirectionalShadowMapsDescriptorSet,
-			writePointShadowMapsDescriptorSet
-		};
+		viewQueue.opaqueItemCount = viewQueue.items.size();
+
+		BuildRenderBatches(viewQueue);
+
+		viewQueue.firstDrawCommand = AddGpuCullingView(viewQueue, viewProj);
 
-		vkUpdateDescriptorSets(device, TO_UINT32_T(descriptorSetWrites.size()), descriptorSetWrites.data(), 0, nullptr);
+		return viewQueue;
+	}
+
+	void RHI::RecordDirectionalShadowMap(VkCommandBuffer commandBuffer, uint32_t viewProjUniformOffset, const RenderQueue& viewQueue) const noexcept
+	{
+		BindMeshArena(commandBuffer);
+		BindInstanceBuffer(commandBuffer);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.directionalShadowMappingPipeline.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.directionalShadowMappingPipeline.pipelineLayout, 0, 1, &shadowMapper.directionalViewProjDescriptorSet, 1, &viewProjUniformOffset);
+
+		vkCmdSetDepthBias(commandBuffer, shadowMapper.depthBiasConstantFactor, 0.f, shadowMapper.depthBiasSlopeFactor);
+
+		// The shadow batches only differ by their mesh, a single indirect call draws them all
+		CommandDrawIndexedIndirect(commandBuffer, viewQueue.firstDrawCommand, TO_UINT32_T(viewQueue.batches.size()));
+	}
+
+	void RHI::RecordPointShadowMapFace(VkCommandBuffer commandBuffer, uint32_t viewProjUniformOffset, uint32_t face, const RenderQueue& viewQueue) const noexcept
+	{
+		BindMeshArena(commandBuffer);
+		BindInstanceBuffer(commandBuffer);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.pointShadowMappingPipeline.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMapper.pointShadowMappingPipeline.pipelineLayout, 0, 1, &shadowMapper.pointViewProjDescriptorSet, 1, &viewProjUniformOffset);
+
+		vkCmdSetDepthBias(commandBuffer, shadowMapper.depthBiasConstantFactor, 0.f, shadowMapper.depthBiasSlopeFactor);
+
+		vkCmdPushConstants(commandBuffer, shadowMapper.pointShadowMappingPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &face);
+
+		// The shadow batches only differ by their mesh, a single indirect call draws them all
+		CommandDrawIndexedIndirect(commandBuffer, viewQueue.firstDrawCommand, TO_UINT32_T(viewQueue.batches.size()));
 	}
 
 	int16_t RHI::CreateLightShadowMappingResources(scene::LightType lightType) noexcept
@@ -785,12 +869,10 @@ namespace lux::rhi
 		{
 			size_t newResourceIndex = shadowMapper.directionalShadowMaps.size();
 
-			if (newResourceIndex > DIRECTIONAL_LIGHT_MAX_COUNT)
+			if (newResourceIndex >= DIRECTIONAL_LIGHT_MAX_COUNT)
 				return -1;
 
 			shadowMapper.directionalShadowMaps.resize(newResourceIndex + 1);
-			shadowMapper.directionalUniformBuffers.resize(newResourceIndex + 1);
-			shadowMapper.directionalUniformBufferDescriptorSets.resize(newResourceIndex + 1);
 
 			Image& shadowMap = shadowMapper.directionalShadowMaps[newResourceIndex];
 
@@ -803,42 +885,31 @@ namespace lux::rhi
 			imageCI.subresourceRangeLayerCount = 1;
 			imageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 			imageCI.imageViewType = VK_IMAGE_VIEW_TYPE_2D;
+			imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+			imageCI.debugName = "Directional Shadow Map " + std::to_string(newResourceIndex);
 
 			CreateImage(imageCI, shadowMap);
 
 			CommandTransitionImageLayout(shadowMap.image, depthImageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
 
-			BufferCreateInfo uniformBufferCI = {};
-			uniformBufferCI.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-			uniformBufferCI.size = sizeof(DirectionalShadowMappingViewProjUniform);
-			uniformBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			uniformBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-
-			CreateBuffer(uniformBufferCI, shadowMapper.directionalUniformBuffers[newResourceIndex]);
-
-			VkDescriptorSetAllocateInfo descriptorSetAI = {};
-			descriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			descriptorSetAI.descriptorPool = shadowMapper.descriptorPool;
-			descriptorSetAI.descriptorSetCount = 1;
-			descriptorSetAI.pSetLayouts = &shadowMapper.directionalShadowMappingPipeline.viewDescriptorSetLayout;
-			
-			CHECK_VK(vkAllocateDescriptorSets(device, &descriptorSetAI, &shadowMapper.directionalUniformBufferDescriptorSets[newResourceIndex]));
-			
-			VkDescriptorBufferInfo viewProjDescriptorBufferInfo = {};
-			viewProjDescriptorBufferInfo.offset = 0;
-			viewProjDescriptorBufferInfo.range = sizeof(DirectionalShadowMappingViewProjUniform);
-			viewProjDescriptorBufferInfo.buffer = shadowMapper.directionalUniformBuffers[newResourceIndex].buffer;
-			
-			VkWriteDescriptorSet writeViewProjUniformBufferDescriptorSet = {};
-			writeViewProjUniformBufferDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writeViewProjUniformBufferDescriptorSet.descriptorCount = 1;
-			writeViewProjUniformBufferDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			writeViewProjUniformBufferDescriptorSet.dstBinding = 0;
-			writeViewProjUniformBufferDescriptorSet.dstArrayElement = 0;
-			writeViewProjUniformBufferDescriptorSet.pBufferInfo = &viewProjDescriptorBufferInfo;
-			writeViewProjUniformBufferDescriptorSet.dstSet = shadowMapper.directionalUniformBufferDescriptorSets[newResourceIndex];
-			
-			vkUpdateDescriptorSets(device, 1, &writeViewProjUniformBufferDescriptorSet, 0, nullptr);
+			// Lights can be added while frames are in flight, which may still read the view descriptor set
+			WaitIdle();
+
+			VkDescriptorImageInfo shadowMapDescriptorInfo = {};
+			shadowMapDescriptorInfo.imageView = shadowMap.imageView;
+			shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			shadowMapDescriptorInfo.sampler = forward.sampler;
+
+			VkWriteDescriptorSet writeShadowMapDescriptorSet = {};
+			writeShadowMapDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeShadowMapDescriptorSet.descriptorCount = 1;
+			writeShadowMapDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeShadowMapDescriptorSet.dstBinding = 3;
+			writeShadowMapDescriptorSet.dstArrayElement = TO_UINT32_T(newResourceIndex);
+			writeShadowMapDescriptorSet.pImageInfo = &shadowMapDescriptorInfo;
+			writeShadowMapDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+			vkUpdateDescriptorSets(device, 1, &writeShadowMapDescriptorSet, 0, nullptr);
 
 			return TO_INT16_T(newResourceIndex);
 		}
@@ -847,12 +918,10 @@ namespace lux::rhi
 		{
 			size_t newResourceIndex = shadowMapper.pointShadowMaps.size();
 
-			if (newResourceIndex > POINT_LIGHT_MAX_COUNT)
+			if (newResourceIndex >= POINT_LIGHT_MAX_COUNT)
 				return -1;
 
 			shadowMapper.pointShadowMaps.resize(newResourceIndex + 1);
-			shadowMapper.pointUniformBuffers.resize(newResourceIndex + 1);
-			shadowMapper.pointUniformBufferDescriptorSets.resize(newResourceIndex + 1);
 
 			Image& shadowMap = shadowMapper.pointShadowMaps[newResourceIndex];
 
@@ -866,42 +935,31 @@ namespace lux::rhi
 			imageCI.subresourceRangeLayerCount = 6;
 			imageCI.subresourceRangeAspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			imageCI.imageViewType = VK_IMAGE_VIEW_TYPE_CUBE;
+			imageCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_SHADOW_MAP;
+			imageCI.debugName = "Point Shadow Map " + std::to_string(newResourceIndex);
 
 			CreateImage(imageCI, shadowMap);
 
 			CommandTransitionImageLayout(shadowMap.image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 6);
 
-			BufferCreateInfo uniformBufferCI = {};
-			uniformBufferCI.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-			uniformBufferCI.size = sizeof(PointShadowMappingViewProjUniform);
-			uniformBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			uniformBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-
-			CreateBuffer(uniformBufferCI, shadowMapper.pointUniformBuffers[newResourceIndex]);
-
-			VkDescriptorSetAllocateInfo descriptorSetAI = {};
-			descriptorSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			descriptorSetAI.descriptorPool = shadowMapper.descriptorPool;
-			descriptorSetAI.descriptorSetCount = 1;
-			descriptorSetAI.pSetLayouts = &shadowMapper.directionalShadowMappingPipeline.viewDescriptorSetLayout;
-
-			CHECK_VK(vkAllocateDescriptorSets(device, &descriptorSetAI, &shadowMapper.pointUniformBufferDescriptorSets[newResourceIndex]));
-
-			VkDescriptorBufferInfo viewProjDescriptorBufferInfo = {};
-			viewProjDescriptorBufferInfo.offset = 0;
-			viewProjDescriptorBufferInfo.range = sizeof(PointShadowMappingViewProjUniform);
-			viewProjDescriptorBufferInfo.buffer = shadowMapper.pointUniformBuffers[newResourceIndex].buffer;
-
-			VkWriteDescriptorSet writeViewProjUniformBufferDescriptorSet = {};
-			writeViewProjUniformBufferDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writeViewProjUniformBufferDescriptorSet.descriptorCount = 1;
-			writeViewProjUniformBufferDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			writeViewProjUniformBufferDescriptorSet.dstBinding = 0;
-			writeViewProjUniformBufferDescriptorSet.dstArrayElement = 0;
-			writeViewProjUniformBufferDescriptorSet.pBufferInfo = &viewProjDescriptorBufferInfo;
-			writeViewProjUniformBufferDescriptorSet.dstSet = shadowMapper.pointUniformBufferDescriptorSets[newResourceIndex];
-
-			vkUpdateDescriptorSets(device, 1, &writeViewProjUniformBufferDescriptorSet, 0, nullptr);
+			// Lights can be added while frames are in flight, which may still read the view descriptor set
+			WaitIdle();
+
+			VkDescriptorImageInfo shadowMapDescriptorInfo = {};
+			shadowMapDescriptorInfo.imageView = shadowMap.imageView;
+			shadowMapDescriptorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			shadowMapDescriptorInfo.sampler = forward.sampler;
+
+			VkWriteDescriptorSet writeShadowMapDescriptorSet = {};
+			writeShadowMapDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeShadowMapDescriptorSet.descriptorCount = 1;
+			writeShadowMapDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeShadowMapDescriptorSet.dstBinding = 4;
+			writeShadowMapDescriptorSet.dstArrayElement = TO_UINT32_T(newResourceIndex);
+			writeShadowMapDescriptorSet.pImageInfo = &shadowMapDescriptorInfo;
+			writeShadowMapDescriptorSet.dstSet = forward.rtViewDescriptorSet;
+
+			vkUpdateDescriptorSets(device, 1, &writeShadowMapDescriptorSet, 0, nullptr);
 
 			return TO_INT16_T(newResourceIndex);
 		}
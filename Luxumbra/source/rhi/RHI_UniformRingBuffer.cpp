@@ -0,0 +1,77 @@
+#include "rhi/RHI.h"
+
+#include <cstring>
+
+#include "Logger.h"
+
+namespace lux::rhi
+{
+
+	UniformRingBuffer::UniformRingBuffer() noexcept
+		: buffer(), mappedData(nullptr), alignment(0), frameSize(0), frameOffset(0), head(0)
+	{
+
+	}
+
+	void RHI::InitUniformRingBuffer() noexcept
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		uniformRingBuffer.alignment = properties.limits.minUniformBufferOffsetAlignment;
+		uniformRingBuffer.frameSize = UNIFORM_RING_BUFFER_FRAME_SIZE;
+
+		// One region per frame in flight, the whole buffer stays mapped.
+		// It also stages per-frame copies into device local buffers
+
+		BufferCreateInfo ringBufferCI = {};
+		ringBufferCI.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		ringBufferCI.size = uniformRingBuffer.frameSize * MAX_FRAMES_IN_FLIGHT;
+		ringBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ringBufferCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		ringBufferCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_UNIFORM;
+		ringBufferCI.debugName = "Uniform Ring Buffer";
+
+		CreateBuffer(ringBufferCI, uniformRingBuffer.buffer);
+
+		uniformRingBuffer.mappedData = static_cast<uint8_t*>(uniformRingBuffer.buffer.allocation.mappedData);
+		ASSERT(uniformRingBuffer.mappedData != nullptr);
+
+		uniformRingBuffer.frameOffset = 0;
+		uniformRingBuffer.head = 0;
+	}
+
+	void RHI::BeginUniformRingBufferFrame() noexcept
+	{
+		uniformRingBuffer.frameOffset = uniformRingBuffer.frameSize * currentFrame;
+		uniformRingBuffer.head = 0;
+	}
+
+	uint32_t RHI::PushUniformData(const void* data, VkDeviceSize size) noexcept
+	{
+		VkDeviceSize alignment = uniformRingBuffer.alignment;
+		VkDeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+
+		if (uniformRingBuffer.head + alignedSize > uniformRingBuffer.frameSize)
+		{
+			Logger::Log(LogLevel::LOG_LEVEL_ERROR, "Uniform ring buffer frame region is full");
+			ASSERT(false);
+			return TO_UINT32_T(uniformRingBuffer.frameOffset);
+		}
+
+		VkDeviceSize offset = uniformRingBuffer.frameOffset + uniformRingBuffer.head;
+		uniformRingBuffer.head += alignedSize;
+
+		memcpy(uniformRingBuffer.mappedData + offset, data, TO_SIZE_T(size));
+
+		return TO_UINT32_T(offset);
+	}
+
+	void RHI::DestroyUniformRingBuffer() noexcept
+	{
+		DestroyBuffer(uniformRingBuffer.buffer);
+
+		uniformRingBuffer.mappedData = nullptr;
+	}
+
+} // namespace lux::rhi
@@ -0,0 +1,176 @@
+#include "rhi/RHI.h"
+
+#include "Logger.h"
+
+namespace lux::rhi
+{
+
+	UploadBatch::UploadBatch() noexcept
+		: commandBuffer(VK_NULL_HANDLE), fence(VK_NULL_HANDLE), depth(0), isRecording(false), submitCount(0),
+		stagingArena(), stagingData(nullptr), stagingOffset(0), dedicatedStagingBuffers(0)
+	{
+
+	}
+
+	void RHI::InitUploadBatch() noexcept
+	{
+		VkCommandBufferAllocateInfo commandBufferAI = {};
+		commandBufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferAI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandBufferAI.commandBufferCount = 1;
+		commandBufferAI.commandPool = commandPool;
+
+		CHECK_VK(vkAllocateCommandBuffers(device, &commandBufferAI, &uploadBatch.commandBuffer));
+
+		VkFenceCreateInfo fenceCI = {};
+		fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		CHECK_VK(vkCreateFence(device, &fenceCI, nullptr, &uploadBatch.fence));
+
+		BufferCreateInfo stagingArenaCI = {};
+		stagingArenaCI.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		stagingArenaCI.size = UPLOAD_STAGING_ARENA_SIZE;
+		stagingArenaCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		stagingArenaCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		stagingArenaCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_STAGING;
+		stagingArenaCI.debugName = "Upload Staging Arena";
+
+		CreateBuffer(stagingArenaCI, uploadBatch.stagingArena);
+
+		uploadBatch.stagingData = static_cast<uint8_t*>(uploadBatch.stagingArena.allocation.mappedData);
+		ASSERT(uploadBatch.stagingData != nullptr);
+
+		uploadBatch.stagingOffset = 0;
+	}
+
+	void RHI::BeginUploadBatch() noexcept
+	{
+		uploadBatch.depth++;
+	}
+
+	void RHI::EndUploadBatch() noexcept
+	{
+		ASSERT(uploadBatch.depth > 0);
+
+		uploadBatch.depth--;
+
+		if (uploadBatch.depth == 0)
+			FlushUploadBatch();
+	}
+
+	VkCommandBuffer RHI::RecordUploadCommands() noexcept
+	{
+		ASSERT(uploadBatch.depth > 0);
+
+		if (uploadBatch.isRecording == false)
+		{
+			VkCommandBufferBeginInfo commandBufferBI = {};
+			commandBufferBI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			commandBufferBI.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			CHECK_VK(vkBeginCommandBuffer(uploadBatch.commandBuffer, &commandBufferBI));
+
+			uploadBatch.isRecording = true;
+		}
+
+		return uploadBatch.commandBuffer;
+	}
+
+	void* RHI::AllocateUploadStaging(VkDeviceSize size, VkBuffer& stagingBuffer, VkDeviceSize& stagingOffset) noexcept
+	{
+		ASSERT(uploadBatch.depth > 0);
+
+		if (size > UPLOAD_STAGING_ARENA_SIZE)
+		{
+			BufferCreateInfo dedicatedStagingCI = {};
+			dedicatedStagingCI.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			dedicatedStagingCI.size = size;
+			dedicatedStagingCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			dedicatedStagingCI.memoryProperty = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			dedicatedStagingCI.memoryCategory = MemoryCategory::MEMORY_CATEGORY_STAGING;
+			dedicatedStagingCI.debugName = "Upload Dedicated Staging";
+
+			uploadBatch.dedicatedStagingBuffers.emplace_back();
+			Buffer& dedicatedStaging = uploadBatch.dedicatedStagingBuffers.back();
+
+			CreateBuffer(dedicatedStagingCI, dedicatedStaging);
+
+			stagingBuffer = dedicatedStaging.buffer;
+			stagingOffset = 0;
+
+			return dedicatedStaging.allocation.mappedData;
+		}
+
+		VkDeviceSize alignedOffset = (uploadBatch.stagingOffset + UPLOAD_STAGING_ALIGNMENT - 1) / UPLOAD_STAGING_ALIGNMENT * UPLOAD_STAGING_ALIGNMENT;
+
+		// The arena is full, submit what was recorded so far and rewind it
+		if (alignedOffset + size > UPLOAD_STAGING_ARENA_SIZE)
+		{
+			FlushUploadBatch();
+			alignedOffset = 0;
+		}
+
+		uploadBatch.stagingOffset = alignedOffset + size;
+
+		stagingBuffer = uploadBatch.stagingArena.buffer;
+		stagingOffset = alignedOffset;
+
+		return uploadBatch.stagingData + alignedOffset;
+	}
+
+	void RHI::FlushUploadBatch() noexcept
+	{
+		if (uploadBatch.isRecording == false)
+			return;
+
+		// Make the uploads visible to every later submission
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		vkCmdPipelineBarrier(uploadBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		CHECK_VK(vkEndCommandBuffer(uploadBatch.commandBuffer));
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &uploadBatch.commandBuffer;
+
+		CHECK_VK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, uploadBatch.fence));
+		CHECK_VK(vkWaitForFences(device, 1, &uploadBatch.fence, VK_TRUE, UINT64_MAX));
+		CHECK_VK(vkResetFences(device, 1, &uploadBatch.fence));
+
+		for (Buffer& dedicatedStaging : uploadBatch.dedicatedStagingBuffers)
+			DestroyBuffer(dedicatedStaging);
+
+		uploadBatch.dedicatedStagingBuffers.clear();
+
+		uploadBatch.stagingOffset = 0;
+		uploadBatch.isRecording = false;
+		uploadBatch.submitCount++;
+	}
+
+	uint32_t RHI::GetUploadSubmitCount() const noexcept
+	{
+		return uploadBatch.submitCount;
+	}
+
+	void RHI::DestroyUploadBatch() noexcept
+	{
+#ifdef _DEBUG
+		if (uploadBatch.depth != 0)
+			Logger::Log(LogLevel::LOG_LEVEL_WARNING, "Upload batch destroyed while still open");
+#endif // _DEBUG
+
+		FlushUploadBatch();
+
+		DestroyBuffer(uploadBatch.stagingArena);
+
+		vkDestroyFence(device, uploadBatch.fence, nullptr);
+
+		vkFreeCommandBuffers(device, commandPool, 1, &uploadBatch.commandBuffer);
+	}
+
+} // namespace lux::rhi
@@ -1,4 +1,4 @@
-#include "scene\CameraNode.h"
+#include "scene/CameraNode.h"
 
 namespace lux::scene
 {
@@ -39,4 +39,9 @@ namespace lux::scene
 	{
 		return farDist;
 	}
+
+	Frustum CameraNode::GetFrustum() const noexcept
+	{
+		return Frustum(GetPerspectiveProjectionTransform() * GetViewTransform());
+	}
 }
\ No newline at end of file
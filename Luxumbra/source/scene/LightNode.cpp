@@ -1,4 +1,4 @@
-#include "scene\LightNode.h"
+#include "scene/LightNode.h"
 
 namespace lux::scene
 {
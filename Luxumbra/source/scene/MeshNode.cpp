@@ -1,4 +1,4 @@
-#include "scene\MeshNode.h"
+#include "scene/MeshNode.h"
 
 namespace lux::scene
 {
@@ -6,13 +6,13 @@ namespace lux::scene
 	using namespace lux;
 
 	MeshNode::MeshNode(Node* parent, const std::shared_ptr<resource::Mesh>& mesh, const std::shared_ptr<resource::Material>& material) noexcept
-		: Node(parent), mesh(mesh), material(material), isCastingShadow(true)
+		: Node(parent), mesh(mesh), material(material), isCastingShadow(true), worldTransform(1.f), worldAABB()
 	{
 
 	}
 
 	MeshNode::MeshNode(Node* parent, glm::vec3 position, glm::vec3 rotation, const std::shared_ptr<resource::Mesh>& mesh, const std::shared_ptr<resource::Material>& material) noexcept
-		: Node(parent, position, rotation), mesh(mesh), material(material), isCastingShadow(true)
+		: Node(parent, position, rotation), mesh(mesh), material(material), isCastingShadow(true), worldTransform(1.f), worldAABB()
 	{
 
 	}
@@ -37,5 +37,23 @@ namespace lux::scene
 		isCastingShadow = newIsCastingShadow;
 	}
 
+	void MeshNode::UpdateWorldTransform() noexcept
+	{
+		worldTransform = GetWorldTransform();
+
+		worldAABB = mesh->aabb;
+		worldAABB.Transform(worldTransform);
+	}
+
+	const glm::mat4& MeshNode::GetCachedWorldTransform() const noexcept
+	{
+		return worldTransform;
+	}
+
+	const AABB& MeshNode::GetWorldAABB() const noexcept
+	{
+		return worldAABB;
+	}
+
 
 }// namespace lux::scene
\ No newline at end of file
@@ -1,22 +1,22 @@
-#include "scene\Node.h"
+#include "scene/Node.h"
 
-#include "glm\gtc\matrix_transform.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 
 namespace lux::scene
 {
 	Node::Node() noexcept
-		: parent(nullptr), position(0.f), rotation(0.f), scale(1.f)
+		: parent(nullptr), position(0.f), rotation(0.f), scale(1.f), angularVelocity(0.f)
 	{
 	}
 
 	Node::Node(Node* parent) noexcept
-		: parent(parent), position(0.f), rotation(0.f), scale(1.f)
+		: parent(parent), position(0.f), rotation(0.f), scale(1.f), angularVelocity(0.f)
 	{
 
 	}
 
 	Node::Node(Node* parent, glm::vec3 position, glm::vec3 rotation) noexcept
-		: parent(parent), position(position), rotation(rotation), scale(1.f)
+		: parent(parent), position(position), rotation(rotation), scale(1.f), angularVelocity(0.f)
 	{
 
 	}
@@ -53,7 +53,7 @@ namespace lux::scene
 		if (parent)
 			position = parent->GetWorldTransform() * position;
 
-		return position.xyz;
+		return glm::vec3(position);
 	}
 
 	glm::quat Node::GetWorldRotation() const noexcept
@@ -114,4 +114,19 @@ namespace lux::scene
 		SetLocalRotation(newRotation);*/
 	}
 
+	glm::vec3 Node::GetAngularVelocity() const noexcept
+	{
+		return angularVelocity;
+	}
+
+	void Node::SetAngularVelocity(glm::vec3 newAngularVelocity) noexcept
+	{
+		angularVelocity = newAngularVelocity;
+	}
+
+	void Node::Update(float deltaTime) noexcept
+	{
+		rotation += angularVelocity * deltaTime;
+	}
+
 } // namespace lux::scene
\ No newline at end of file
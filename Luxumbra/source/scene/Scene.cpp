@@ -1,9 +1,11 @@
-#include "scene\Scene.h"
+#include "scene/Scene.h"
+
+#include "CpuProfiler.h"
 
 namespace lux::scene
 {
 	Scene::Scene() noexcept
-		: window(nullptr), resourceManager(nullptr), nodes(0), meshNodes(0), lightNodes(0), currentCamera(nullptr)
+		: window(nullptr), resourceManager(nullptr), nodes(0), meshNodes(0), lightNodes(0), currentCamera(nullptr), isDepthPrepassEnabled(false)
 	{
 
 	}
@@ -34,6 +36,32 @@ namespace lux::scene
 		lightNodes.reserve(128);
 	}
 
+	void Scene::Update(JobSystem& jobSystem, float deltaTime) noexcept
+	{
+		CPU_PROFILE_FUNCTION();
+
+		JobCounter updateCounter;
+
+		jobSystem.ParallelFor(nodes.size(), SCENE_UPDATE_BATCH_SIZE, [this, deltaTime](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				nodes[i]->Update(deltaTime);
+		}, updateCounter);
+
+		jobSystem.Wait(updateCounter);
+
+		// Every local transform is final, world transforms can be propagated down the hierarchy
+		JobCounter transformCounter;
+
+		jobSystem.ParallelFor(meshNodes.size(), SCENE_UPDATE_BATCH_SIZE, [this](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				meshNodes[i]->UpdateWorldTransform();
+		}, transformCounter);
+
+		jobSystem.Wait(transformCounter);
+	}
+
 	CameraNode* Scene::GetCurrentCamera() const noexcept
 	{
 		return currentCamera;
@@ -49,6 +77,32 @@ namespace lux::scene
 		return lightNodes;
 	}
 
+	bool Scene::GetIsDepthPrepassEnabled() const noexcept
+	{
+		return isDepthPrepassEnabled;
+	}
+
+	void Scene::SetIsDepthPrepassEnabled(bool isEnabled) noexcept
+	{
+		isDepthPrepassEnabled = isEnabled;
+	}
+
+	void Scene::GetNodeRotations(std::vector<glm::vec3>& rotations) const noexcept
+	{
+		rotations.resize(nodes.size());
+
+		for (size_t i = 0; i < nodes.size(); i++)
+			rotations[i] = nodes[i]->GetLocalRotation();
+	}
+
+	void Scene::SetNodeRotations(const std::vector<glm::vec3>& rotations) noexcept
+	{
+		ASSERT(rotations.size() == nodes.size());
+
+		for (size_t i = 0; i < nodes.size(); i++)
+			nodes[i]->SetLocalRotation(rotations[i]);
+	}
+
 	Node* Scene::AddNode(Node* parent, glm::vec3 position, glm::vec3 rotation, bool isWorldPosition) noexcept
 	{
 		Node* node;
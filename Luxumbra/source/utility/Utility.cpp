@@ -1,6 +1,8 @@
-#include "utility\Utility.h"
+#include "utility/Utility.h"
 
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 
 namespace lux::utility
 {
@@ -9,6 +11,9 @@ namespace lux::utility
 	{
 		std::ifstream file(filePath, std::ios::ate | std::ios::binary);
 
+		if (file.is_open() == false)
+			return {};
+
 		size_t fileSize = (size_t)file.tellg();
 		std::vector<char> buffer(fileSize);
 
@@ -25,4 +30,15 @@ namespace lux::utility
 		return a + t * (b - a);
 	}
 
+	float Percentile(const std::vector<float>& sortedSamples, float p) noexcept
+	{
+		size_t sampleCount = sortedSamples.size();
+
+		if (sampleCount == 0)
+			return 0.f;
+
+		size_t rank = TO_SIZE_T(std::ceil(p * TO_FLOAT(sampleCount)));
+		return sortedSamples[std::clamp(rank, TO_SIZE_T(1), sampleCount) - 1];
+	}
+
 } // namespace lux::utility
\ No newline at end of file